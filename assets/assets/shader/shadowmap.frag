@@ -4,8 +4,7 @@ precision mediump float;
 varying float theta;
 uniform sampler2D occlusions;
 
-uniform vec2 light_positions[8];
-uniform float light_shadow[8];
+uniform vec2 light_position;
 
 
 vec2 ndc2uv(vec2 p) {
@@ -13,28 +12,20 @@ vec2 ndc2uv(vec2 p) {
 }
 
 void main() {
-	vec2 distance = vec2(4.0, 4.0);
+	float distance = 4.0;
 
 	vec2 dir = vec2(cos(theta), sin(theta));
 
 	for (float r=0.0; r<2.0; r+=1.0/(1024.0)) {
-		vec2 coord1 = r*dir + light_positions[0];
-		vec2 coord2 = r*dir + light_positions[1];
+		vec2 coord = r*dir + light_position;
 
 		//sample the occlusion map
-		if(texture2D(occlusions, ndc2uv(coord1)).r>=0.1) {
-			distance.x = min(distance.x, r);
-		}
-
-		if(texture2D(occlusions, ndc2uv(coord2)).r>=0.1) {
-			distance.y = min(distance.y, r);
+		if(texture2D(occlusions, ndc2uv(coord)).r>=0.1) {
+			distance = min(distance, r);
 		}
 	}
 
-	distance.x += 10.0*(1.0-light_shadow[0]);
-	distance.y += 10.0*(1.0-light_shadow[1]);
-
-	distance = clamp(distance/vec2(4.0), vec2(0.0), vec2(1.0));
+	distance = clamp(distance/4.0, 0.0, 1.0);
 
-	gl_FragColor = vec4(distance, 0.0, 1.0);
+	gl_FragColor = vec4(distance, 0.0, 0.0, 1.0);
 }
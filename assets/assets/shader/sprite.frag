@@ -1,12 +1,20 @@
 #version 100
 precision mediump float;
 
+// world positions (light positions decoded from 2x8 bit, the fragment position)
+//   need more than the 10 bit mantissa of mediump, if the platform supports it
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+	#define POS_PRECISION highp
+#else
+	#define POS_PRECISION mediump
+#endif
+
 struct Dir_light {
 	vec3 color;
 	vec3 dir;
 };
 struct Point_light {
-	vec3 pos;
+	POS_PRECISION vec3 pos;
 	float dir;
 	float angle;
 	vec3 color;
@@ -16,27 +24,29 @@ struct Point_light {
 varying vec2 uv_frag;
 varying vec4 uv_clip_frag;
 varying vec2 decals_uv_frag;
-varying vec3 pos_frag;
+varying POS_PRECISION vec3 pos_frag;
 varying vec2 shadowmap_uv_frag;
 varying vec2 hue_change_frag;
 varying float shadow_resistence_frag;
 varying float decals_intensity_frag;
 varying mat3 TBN;
 
+// GLES2/WebGL only guarantee 8 samplers and 16 uniform vectors
 uniform sampler2D albedo_tex;
 uniform sampler2D normal_tex;
 uniform sampler2D material_tex;
-uniform sampler2D height_tex;
 
 uniform sampler2D shadowmaps_tex;
+uniform sampler2D lights_tex; // see Light_texture_data
 
 uniform sampler2D decals_tex;
 uniform samplerCube environment_tex;
-uniform sampler2D last_frame_tex;
 
 uniform float light_ambient;
 uniform Dir_light light_sun;
-uniform Point_light light[8];
+uniform vec4 light_tiles; // columns, rows, size of lights_tex
+uniform POS_PRECISION vec3 light_pos_origin;
+uniform POS_PRECISION vec3 light_pos_extent;
 
 uniform vec3 eye;
 uniform float alpha_cutoff;
@@ -99,17 +109,57 @@ float my_smoothstep(float edge0, float edge1, float x) {
 	return x*x*(3.0-2.0*x);
 }
 
-float calc_shadow(int light_num) {
+// only the lights with the ids 0 and 1 cast shadows
+float calc_shadow(float light_id) {
 	vec4 shadow = texture2D(shadowmaps_tex, shadowmap_uv_frag);
-	if(light_num>0) {
+	if(light_id>0.5) {
 		shadow.r = shadow.b;
 	}
 
 	return mix(shadow.r, 1.0, shadow_resistence_frag*0.9);
 }
 
+vec4 lights_texel(float x, float y) {
+	return texture2D(lights_tex, (vec2(x, y)+0.5) / light_tiles.zw);
+}
+// two bytes (high, low) => [0,1]
+POS_PRECISION float unpack16(POS_PRECISION vec2 v) {
+	return dot(v, vec2(65280.0, 255.0) / 65535.0);
+}
+// 0 or 2^-12 to 2^12
+float unpack_log16(vec2 v) {
+	float u = unpack16(v);
+	return u>0.0 ? exp2(u*24.0 - 12.0) : 0.0;
+}
+Point_light read_light(float id) {
+	POS_PRECISION vec4 t0 = lights_texel(id, 0.0);
+	POS_PRECISION vec4 t1 = lights_texel(id, 1.0);
+	vec4 t2 = lights_texel(id, 2.0);
+	vec4 t3 = lights_texel(id, 3.0);
+	vec4 t4 = lights_texel(id, 4.0);
+	vec4 t5 = lights_texel(id, 5.0);
+
+	const float two_pi = 6.28318;
+	Point_light light;
+	light.pos = light_pos_origin + vec3(unpack16(t0.rg), unpack16(t0.ba), unpack16(t1.rg)) * light_pos_extent;
+	light.dir = unpack16(t1.ba) * two_pi;
+	light.angle = unpack16(t2.rg) * two_pi;
+	light.color = vec3(unpack_log16(t2.ba), unpack_log16(t3.rg), unpack_log16(t3.ba));
+	light.factors = vec3(unpack_log16(t4.rg), unpack_log16(t4.ba), unpack_log16(t5.rg));
+	return light;
+}
+
+// entry 'i' of the list of the current tile (0: number of lights, 1-15: light ids)
+float tile_entry(vec4 l0, vec4 l1, vec4 l2, vec4 l3, int i) {
+	int texel = i/4;
+	int channel = i - texel*4;
+	vec4 l = texel==0 ? l0 : texel==1 ? l1 : texel==2 ? l2 : l3;
+	float v = channel==0 ? l.r : channel==1 ? l.g : channel==2 ? l.b : l.a;
+	return floor(v*255.0 + 0.5);
+}
+
 vec3 calc_point_light(Point_light light, vec3 normal, vec3 albedo, vec3 view_dir, float roughness, float metalness, float reflectance) {
-	vec3 light_dir = light.pos.xyz - pos_frag;
+	POS_PRECISION vec3 light_dir = light.pos.xyz - pos_frag;
 	float light_dist = length(light_dir);
 	light_dir /= light_dist;
 
@@ -198,18 +248,27 @@ void main() {
 	vec3 color = vec3(0.0);
 
 
-	if(fast_lighting) {
-		for(int i=0; i<4; i++) {
-			color += calc_point_light(light[i], normal, albedo.rgb, view_dir, roughness, metalness, reflectance);
-		}
+	// only the lights in the list of our screen tile can reach this fragment
+	vec2 tile = floor(clamp(shadowmap_uv_frag, 0.0, 0.999) * light_tiles.xy);
+	float tile_row = 6.0 + tile.y;
+	vec4 list0 = lights_texel(tile.x*4.0,     tile_row);
+	vec4 list1 = lights_texel(tile.x*4.0+1.0, tile_row);
+	vec4 list2 = lights_texel(tile.x*4.0+2.0, tile_row);
+	vec4 list3 = lights_texel(tile.x*4.0+3.0, tile_row);
+	int light_count = int(tile_entry(list0, list1, list2, list3, 0));
+	if(fast_lighting)
+		light_count = light_count<4 ? light_count : 4;
+
+	for(int i=1; i<16; i++) {
+		if(i>light_count)
+			break;
+
+		float id = tile_entry(list0, list1, list2, list3, i);
+		vec3 light_color = calc_point_light(read_light(id), normal, albedo.rgb, view_dir, roughness, metalness, reflectance);
+		if(!fast_lighting && id<1.5)
+			light_color *= calc_shadow(id);
 
-	} else {
-		for(int i=0; i<2; i++) {
-			color += calc_point_light(light[i], normal, albedo.rgb, view_dir, roughness, metalness, reflectance) * calc_shadow(i);
-		}
-		for(int i=2; i<8; i++) {
-			color += calc_point_light(light[i], normal, albedo.rgb, view_dir, roughness, metalness, reflectance);
-		}
+		color += light_color;
 	}
 
 	// in low-light scene, discard colors but keep down-scaled luminance
@@ -0,0 +1,26 @@
+#define STB_IMAGE_STATIC
+#define STBI_NO_FAILURE_STRINGS
+#define STBI_NO_DDS
+#define STBI_NO_PVR
+#define STBI_NO_PKM
+#define STBI_NO_EXT
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "stb_image_mt.h"
+
+unsigned char* stbi_mt_load_from_memory(const unsigned char* buffer, int len,
+                                        int* x, int* y, int* comp, int req_comp)
+{
+	return stbi_load_from_memory(buffer, len, x, y, comp, req_comp);
+}
+
+int stbi_mt_info_from_memory(const unsigned char* buffer, int len, int* x, int* y, int* comp)
+{
+	return stbi_info_from_memory(buffer, len, x, y, comp);
+}
+
+void stbi_mt_image_free(void* data)
+{
+	stbi_image_free(data);
+}
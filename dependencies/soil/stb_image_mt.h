@@ -0,0 +1,32 @@
+/*
+	Private instance of stb_image, that can be used from multiple threads
+	at once (e.g. to decode textures in the background).
+
+	The instance used by SOIL stores the reason of the last failure in a
+	global, which would be written concurrently. This one is compiled
+	without failure strings and doesn't write any global state.
+	It also doesn't include SOIL's extensions (DDS, PVR, PKM), those files
+	still have to be loaded through SOIL.
+
+	MIT license
+*/
+
+#ifndef HEADER_STB_IMAGE_MT
+#define HEADER_STB_IMAGE_MT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+unsigned char* stbi_mt_load_from_memory(const unsigned char* buffer, int len,
+                                        int* x, int* y, int* comp, int req_comp);
+
+int stbi_mt_info_from_memory(const unsigned char* buffer, int len, int* x, int* y, int* comp);
+
+void stbi_mt_image_free(void* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEADER_STB_IMAGE_MT	*/
@@ -154,6 +154,10 @@ namespace ecs {
 			std::size_t size()const noexcept {
 				return _pool.size();
 			}
+			/// index based access, e.g. to split the pool between worker threads
+			T& operator[](std::size_t i) {
+				return *reinterpret_cast<T*>(_pool.get(i));
+			}
 			bool empty()const noexcept {
 				return size()==0;
 			}
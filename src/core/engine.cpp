@@ -8,6 +8,7 @@
 #include "input/input_manager.hpp"
 #include "renderer/graphics_ctx.hpp"
 #include "utils/log.hpp"
+#include "utils/messagebus_stats.hpp"
 #include "utils/rest.hpp"
 
 #include <stdexcept>
@@ -45,6 +46,12 @@ namespace {
 	}
 
 	Engine::Sdl_wrapper::Sdl_wrapper() {
+#ifdef HEADLESS
+		// build machines have neither a display nor a sound card
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", false);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", false);
+#endif
+
 		INVARIANT(SDL_Init(0)==0, "Could not initialize SDL: "<<get_sdl_error());
 
 		init_sub_system(SDL_INIT_AUDIO, "SDL_Audio");
@@ -82,6 +89,10 @@ namespace {
 		}
 
 		assets().shrink_to_fit();
+
+#ifdef MESSAGEBUS_STATS
+		util::write_message_bus_stats("messagebus_stats.json");
+#endif
 	}
 
 	void Engine::add_event_filter(Sdl_event_filter& f) {
@@ -187,6 +198,13 @@ namespace {
 			if(event.type==SDL_KEYDOWN) {
 				if(event.key.keysym.sym==SDLK_F12)
 					assets().reload();
+
+#ifdef MESSAGEBUS_STATS
+				if(event.key.keysym.sym==SDLK_F11) {
+					util::write_message_bus_stats("messagebus_stats.json");
+					INFO("Message bus statistics written to messagebus_stats.json");
+				}
+#endif
 			}
 		}
 
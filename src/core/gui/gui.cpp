@@ -2,12 +2,7 @@
 
 #define GLM_SWIZZLE
 
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include "../renderer/gl.hpp"
 
 #include "gui.hpp"
 
@@ -16,6 +11,7 @@
 #include "../input/input_manager.hpp"
 #include "../renderer/camera.hpp"
 #include "../renderer/graphics_ctx.hpp"
+#include "../renderer/render_state.hpp"
 #include "../renderer/shader.hpp"
 #include "../renderer/texture.hpp"
 #include "../renderer/vertex_object.hpp"
@@ -342,13 +338,12 @@ namespace gui {
 			void draw(nk_context& ctx, Camera_2d& camera) {
 				glEnable(GL_SCISSOR_TEST);
 				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-				glDisable(GL_DEPTH_TEST);
-				glActiveTexture(GL_TEXTURE0);
+				render_state().option(Gl_option::depth_test, false);
 
 				ON_EXIT {
 					glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 					glDisable(GL_SCISSOR_TEST);
-					glEnable(GL_DEPTH_TEST);
+					render_state().option(Gl_option::depth_test, true);
 				};
 
 				graphics_ctx.reset_viewport();
@@ -384,7 +379,7 @@ namespace gui {
 				int offset = 0;
 				nk_draw_foreach(cmd, &ctx, &commands.buffer) {
 					if (cmd->elem_count==0) continue;
-					glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(cmd->texture.id));
+					render_state().texture(0, GL_TEXTURE_2D, static_cast<GLuint>(cmd->texture.id));
 					glScissor(
 						static_cast<GLint>(cmd->clip_rect.x * scale.x),
 						static_cast<GLint>((camera.size().y - static_cast<GLint>(cmd->clip_rect.y + cmd->clip_rect.h)) * scale.y),
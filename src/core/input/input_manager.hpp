@@ -51,6 +51,10 @@ namespace input {
 			auto last_pointer_world_position(int idx=0)const noexcept {
 				return _pointer_world_pos[idx];
 			}
+			/// overrides the position until the pointer is moved again (used by replays)
+			void last_pointer_world_position(glm::vec2 p, int idx=0)noexcept {
+				_pointer_world_pos[idx] = p;
+			}
 			auto last_pointer_screen_position(int idx=0)const noexcept {
 				return _pointer_screen_pos[idx];
 			}
@@ -1,11 +1,6 @@
 #define GLM_SWIZZLE
 
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include "gl.hpp"
 
 
 #include "camera.hpp"
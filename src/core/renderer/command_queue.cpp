@@ -1,47 +1,20 @@
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
-
 #include "command_queue.hpp"
 
 #include "texture.hpp"
 #include "vertex_object.hpp"
 #include "shader.hpp"
 
+#include "../utils/radix_sort.hpp"
+#include "../utils/thread_pool.hpp"
+
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <tuple>
+
 namespace lux {
 namespace renderer {
 
-	/*
-	 * commands are sorted by _gl_options, _shader, _textures, _uniforms, _obj
-	 * commands with order_dependent act as sync-points. Meaning all
-	 *  operations up to this point must be applied before this one, but
-	 *  later (non-order_dependent) commands may already be applied
-	 */
-	bool Command::operator<(const Command& rhs)const noexcept {
-		return std::tie(_gl_options, _shader, _textures_hash, _ext_uniforms, _obj) <
-			   std::tie(rhs._gl_options, rhs._shader, rhs._textures_hash, rhs._ext_uniforms, rhs._obj);
-	}
-
-	namespace {
-		template<class T>
-		auto hash_ptr_array(const T& array) {
-			intptr_t hash = 0;
-			for(auto ptr : array)
-				hash = hash*31 + reinterpret_cast<intptr_t>(ptr);
-
-			return hash;
-		}
-	}
-
-	void Command::_update_hashes()noexcept {
-		_textures_hash = static_cast<int>(hash_ptr_array(_textures));
-	}
-
 	Command& Command::shader(Shader_program& prog) {
 		_shader = &prog;
 		return *this;
@@ -50,8 +23,10 @@ namespace renderer {
 		_textures.at(static_cast<std::size_t>(unit)) = &tex;
 		return *this;
 	}
-	Command& Command::object(const Object& obj) {
+	Command& Command::object(const Object& obj, int offset, int count) {
 		_obj = &obj;
+		_obj_offset = offset;
+		_obj_count = count;
 
 		return *this;
 	}
@@ -77,47 +52,151 @@ namespace renderer {
 	}
 
 
-	Command_queue::Command_queue(std::size_t expected) {
-		_commands.reserve(expected*0.9f);
-		_order_dependent_commands.reserve(expected*0.1f);
+	Command_buffer::Command_buffer(std::size_t expected) {
+		_commands.reserve(expected);
+		_sort_keys.reserve(expected);
+	}
+
+	void Command_buffer::push_back(const Command& command) {
+		_commands.push_back(command);
+	}
+
+	void Command_buffer::_sort() {
+		util::radix_sort(_sort_keys, _sort_tmp, [](const Sort_key& k){return k.key;});
+	}
+	void Command_buffer::_clear() {
+		_commands.clear();
+		_sort_keys.clear();
+	}
+
+
+	Command_queue::Command_queue(std::size_t expected) : _expected(expected) {
+		reserve_buffers(1);
+	}
+
+	void Command_queue::reserve_buffers(std::size_t count) {
+		_buffers.reserve(count);
+		while(_buffers.size()<count) {
+			// the main buffer gets most of the commands, the others are only used for parallel recording
+			auto expected = _buffers.empty() ? _expected : _expected/4;
+			_buffers.emplace_back(new Command_buffer(expected));
+		}
+	}
+	auto Command_queue::buffer(std::size_t index) -> Command_buffer& {
+		INVARIANT(index<_buffers.size(), "Command_buffer "<<index<<" has not been reserved");
+		return *_buffers[index];
 	}
 
+	auto Command_queue::Texture_set_hash::operator()(const Texture_set& s)const noexcept -> std::size_t {
+		auto hash = std::size_t(0);
+		for(auto ptr : s)
+			hash = hash*31 + std::hash<const Texture*>{}(ptr);
+
+		return hash;
+	}
 
 	namespace {
-		void update_gl_options(Gl_options last, Gl_options next) {
-			if((last&Gl_option::blend) != (next&Gl_option::blend)) {
-				if(next&Gl_option::blend)
-					glEnable(GL_BLEND);
-				else
-					glDisable(GL_BLEND);
-			}
+		/*
+		 * layout of the sort keys (msb to lsb):
+		 *   order-independent commands:
+		 *     0 | gl_options:3 | shader:9 | texture_set:16 | ext_uniforms:11 | object:24
+		 *   order-dependent commands (sync-points, executed in insertion order after all others):
+		 *     1 | insertion index:63
+		 *
+		 * The ids are assigned in order of first appearance and are only valid
+		 *   until the next flush, so equal states are always grouped together
+		 *   (unlike the old texture-pointer hash that could collide).
+		 */
+		constexpr auto gl_options_bits   = 3;
+		constexpr auto shader_bits       = 9;
+		constexpr auto texture_set_bits  = 16;
+		constexpr auto ext_uniforms_bits = 11;
+		constexpr auto object_bits       = 24;
+		static_assert(1+gl_options_bits+shader_bits+texture_set_bits+ext_uniforms_bits+object_bits==64,
+		              "Sort key has to use exactly 64 bits");
+
+		constexpr auto order_dependent_flag = uint64_t(1) << 63;
+
+		template<class Map, class Key>
+		auto get_id(Map& ids, const Key& key, int bits) -> uint64_t {
+			auto iter = ids.find(key);
+			if(iter!=ids.end())
+				return iter->second;
+
+			auto id = static_cast<uint32_t>(ids.size());
+			INVARIANT(id < (uint64_t(1)<<bits), "Too many different states in one command queue: "<<id);
+			ids.emplace(key, id);
+			return id;
+		}
+	}
 
-			if((last&Gl_option::depth_test) != (next&Gl_option::depth_test)) {
-				if(next&Gl_option::depth_test)
-					glEnable(GL_DEPTH_TEST);
-				else
-					glDisable(GL_DEPTH_TEST);
-			}
+	auto Command_queue::_build_key(const Command& cmd) -> uint64_t {
+		if(cmd._order_dependent)
+			return order_dependent_flag | _order_dependent_count++;
+
+		auto key = uint64_t(cmd._gl_options);
+
+		key = (key << shader_bits)       | get_id(_shader_ids, cmd._shader, shader_bits);
+		key = (key << texture_set_bits)  | get_id(_texture_set_ids, cmd._textures, texture_set_bits);
+		key = (key << ext_uniforms_bits) | get_id(_ext_uniform_ids, cmd._ext_uniforms, ext_uniforms_bits);
+		key = (key << object_bits)       | get_id(_object_ids, cmd._obj, object_bits);
+
+		return key;
+	}
 
-			if((last&Gl_option::depth_write) != (next&Gl_option::depth_write)) {
-				if(next&Gl_option::depth_write)
-					glDepthMask(GL_TRUE);
-				else
-					glDepthMask(GL_FALSE);
+	void Command_queue::_build_keys() {
+		// in buffer order, so the ids (and the order of order_dependent commands)
+		//   are the same as if everything had been recorded into a single buffer
+		for(auto& buffer : _buffers) {
+			auto& commands = buffer->_commands;
+			auto& keys = buffer->_sort_keys;
+			keys.resize(commands.size());
+			for(auto i=0u; i<commands.size(); ++i) {
+				keys[i] = Sort_key{_build_key(commands[i]), i};
 			}
 		}
 	}
 
-	void Command_queue::_execute_commands(const IUniform_map* shared_uniforms,
-	                                      Command& last, bool& is_first,
-	                                      std::vector<Command>& commands) {
-		if(commands.empty())
+
+	void Command_queue::_execute_commands(const IUniform_map* shared_uniforms) {
+		// k-way merge of the sorted buffers, using a min-heap of their next keys
+		//   (ties are broken by the buffer index, like a stable sort of all buffers)
+		_merge_heap.clear();
+		for(auto i=0u; i<_buffers.size(); ++i) {
+			auto& keys = _buffers[i]->_sort_keys;
+			if(!keys.empty())
+				_merge_heap.push_back(Merge_head{keys.front().key, i, 0});
+		}
+
+		if(_merge_heap.empty())
 			return;
 
-		for(auto& cmd : commands) {
+		auto heap_order = [](const Merge_head& lhs, const Merge_head& rhs) {
+			return std::tie(lhs.key, lhs.buffer) > std::tie(rhs.key, rhs.buffer);
+		};
+		std::make_heap(_merge_heap.begin(), _merge_heap.end(), heap_order);
+
+		auto& state = render_state();
+
+		Command last;
+		bool is_first = true;
+
+		while(!_merge_heap.empty()) {
+			std::pop_heap(_merge_heap.begin(), _merge_heap.end(), heap_order);
+			auto& head = _merge_heap.back();
+			auto& buffer = *_buffers[head.buffer];
+			auto& cmd = buffer._commands[buffer._sort_keys[head.position].index];
+
+			if(++head.position < buffer._sort_keys.size()) {
+				head.key = buffer._sort_keys[head.position].key;
+				std::push_heap(_merge_heap.begin(), _merge_heap.end(), heap_order);
+			} else {
+				_merge_heap.pop_back();
+			}
+
 			// setup GL_options
 			if(is_first || last._gl_options!=cmd._gl_options) {
-				update_gl_options(last._gl_options, cmd._gl_options);
+				state.gl_options(cmd._gl_options);
 				last._gl_options = cmd._gl_options;
 			}
 
@@ -138,17 +217,19 @@ namespace renderer {
 
 			cmd._private_uniforms.bind_all(*cmd._shader);
 
-			// setup textures
+			// setup textures (redundant binds are filtered by the Render_state)
 			for(auto i=0u; i<texture_units; ++i) {
-				if(cmd._textures[i] && (is_first || last._textures[i]!=cmd._textures[i])) {
-					last._textures[i] = cmd._textures[i];
+				if(cmd._textures[i]) {
 					cmd._textures[i]->bind(i);
 				}
 			}
 
-			cmd._obj->draw();
+			cmd._obj->draw(cmd._obj_offset, cmd._obj_count);
 			is_first = false;
 		}
+
+		// reset GL_options if required
+		state.gl_options(default_gl_options);
 	}
 
 	auto Command_queue::shared_uniforms(std::shared_ptr<IUniform_map> umap) -> IUniform_map& {
@@ -160,29 +241,37 @@ namespace renderer {
 		return _shared_uniforms;
 	}
 
+	/*
+	 * commands are sorted by _gl_options, _shader, _textures, _ext_uniforms, _obj
+	 * commands with order_dependent act as sync-points. Meaning all
+	 *  operations up to this point must be applied before this one, but
+	 *  later (non-order_dependent) commands may already be applied
+	 * Only the 16 byte Sort_keys are sorted (per buffer and in parallel), the
+	 *  commands themselves stay in place.
+	 */
 	void Command_queue::flush() {
-		std::sort(_commands.begin(), _commands.end());
+		_build_keys();
 
-		Command last;
-		bool is_first = true;
+		util::default_thread_pool().parallel_for(_buffers.size(), 1, [&](auto begin, auto end, auto) {
+			for(auto i=begin; i<end; ++i)
+				_buffers[i]->_sort();
+		});
 
-		_execute_commands(_shared_uniforms.get(), last, is_first, _commands);
-		_execute_commands(_shared_uniforms.get(), last, is_first, _order_dependent_commands);
-
-		// reset GL_options if required
-		update_gl_options(last._gl_options, default_gl_options);
+		_execute_commands(_shared_uniforms.get());
 
 		// clear our queue
-		_commands.clear();
-		_order_dependent_commands.clear();
+		for(auto& b : _buffers)
+			b->_clear();
+
+		_order_dependent_count = 0;
+		_shader_ids.clear();
+		_texture_set_ids.clear();
+		_ext_uniform_ids.clear();
+		_object_ids.clear();
 	}
 
 	void Command_queue::push_back(const Command& command) {
-		std::vector<Command>& queue = command._order_dependent ?
-		                                  _order_dependent_commands : _commands;
-
-		queue.push_back(command);
-		queue.back()._update_hashes();
+		_buffers.front()->push_back(command);
 	}
 
 }
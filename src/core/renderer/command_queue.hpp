@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "render_state.hpp"
 #include "uniform_map.hpp"
 #include "vertex_object.hpp"
 #include "shader.hpp"
@@ -17,6 +18,9 @@
 
 #include <vector>
 #include <array>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
 
 
 namespace lux {
@@ -25,42 +29,29 @@ namespace renderer {
 	class Texture;
 
 
+	/*
+	 * The units of all samplers used by the sprite shader are below 8, because
+	 *   GLES2/WebGL don't guarantee more.
+	 */
 	enum class Texture_unit {
 		temporary = 0, //< may be rebound at any momemnt
 
 		color     = 1,
 		normal    = 2,
 		material  = 3, //< R:emmision, G:metallc, B:roughness
-		height    = 4,
 
-		shadowmaps=7,
-
-		decals = 8, // e.g. blood stains
-
-		environment = 11, //< used for reflections
-		last_frame = 12 //< used for reflections
-	};
-	constexpr auto texture_units = static_cast<std::size_t>(Texture_unit::last_frame)+1;
+		environment = 4, //< used for reflections
 
-	enum class Gl_option : unsigned int {
-		blend       = 0b001,
-		depth_test  = 0b010,
-		depth_write = 0b100
-	};
-	using Gl_options = unsigned int;
+		lights = 5, //< RGBA8 parameters of the visible lights and the lights of each screen tile
 
-	constexpr Gl_options operator|(Gl_option lhs, Gl_option rhs)noexcept {
-		return static_cast<Gl_options>(lhs) | static_cast<Gl_options>(rhs);
-	}
-	constexpr Gl_options operator|(Gl_options lhs, Gl_option rhs)noexcept {
-		return lhs | static_cast<Gl_options>(rhs);
-	}
-	constexpr bool operator&(Gl_options lhs, Gl_option rhs)noexcept {
-		return lhs & static_cast<Gl_options>(rhs);
-	}
+		decals = 6, // e.g. blood stains
 
-	constexpr auto default_gl_options = Gl_option::blend|Gl_option::depth_test|Gl_option::depth_write;
+		shadowmaps=7,
 
+		height = 8, //< only used by the shadowcaster shader
+		last_frame = 9 //< used for reflections
+	};
+	constexpr auto texture_units = static_cast<std::size_t>(Texture_unit::last_frame)+1;
 
 	constexpr auto uniforms_per_command = static_cast<std::size_t>(6);
 	constexpr auto uniform_size_per_command = sizeof(float)*4;
@@ -71,15 +62,14 @@ namespace renderer {
 		public:
 			auto shader(Shader_program&) -> Command&;
 			auto texture(Texture_unit, const Texture&) -> Command&;
-			auto object(const Object&) -> Command&;
+			/// count<=0 draws everything from offset to the end
+			auto object(const Object&, int offset=0, int count=-1) -> Command&;
 			auto order_dependent() -> Command&;
 			auto require(Gl_option) -> Command&;
 			auto require_not(Gl_option) -> Command&;
 			auto ext_uniforms(const IUniform_map&) -> Command&;
 			auto uniforms() -> Cmd_uniform_map&;
 
-			bool operator<(const Command& rhs)const noexcept;
-
 		private:
 			friend class Command_queue;
 
@@ -88,18 +78,53 @@ namespace renderer {
 			Cmd_uniform_map _private_uniforms;
 			const IUniform_map* _ext_uniforms = nullptr;
 			const Object* _obj = nullptr;
+			int _obj_offset = 0;
+			int _obj_count = -1;
 			Gl_options _gl_options = default_gl_options;
 
 			int _order_dependent = false;
-
-			int _textures_hash = 0;
-
-			void _update_hashes()noexcept;
 	};
 
 	inline auto create_command() -> Command {return Command{};}
 
 
+	class Command_queue;
+
+	/*
+	 * Recording buffer that can be filled from one thread, while other threads
+	 *   fill the other buffers of the same queue, without any locking.
+	 * The commands are only sorted and executed by Command_queue::flush() on
+	 *   the GL thread.
+	 */
+	class Command_buffer {
+		public:
+			void push_back(const Command& command);
+			auto size()const noexcept {return _commands.size();}
+
+		private:
+			friend class Command_queue;
+
+			/// index into _commands and the 64bit key it is sorted by
+			struct Sort_key {
+				uint64_t key;
+				uint32_t index;
+			};
+
+			std::vector<Command>  _commands; //< in insertion order, only _sort_keys are reordered
+			std::vector<Sort_key> _sort_keys;
+			std::vector<Sort_key> _sort_tmp;
+
+			explicit Command_buffer(std::size_t expected);
+			void _sort();
+			void _clear();
+	};
+
+	/*
+	 * The commands of all buffers are executed as if they had been recorded
+	 *   into a single buffer, in the order of the buffer indices. So a
+	 *   parallel_for() that records its ranges into buffer(range_index)
+	 *   produces the same frame as a single-threaded loop.
+	 */
 	class Command_queue {
 		public:
 			Command_queue(std::size_t expected=64);
@@ -108,20 +133,44 @@ namespace renderer {
 			auto shared_uniforms() -> std::shared_ptr<IUniform_map>;
 
 			void flush();
-			void push_back(const Command& command);
+			void push_back(const Command& command); //< records into buffer(0)
+
+			/// creates additional buffers; must not be called while any buffer is recorded
+			void reserve_buffers(std::size_t count);
+			/// can be used from any thread, as long as each buffer is only filled by one
+			auto buffer(std::size_t index) -> Command_buffer&;
+			auto buffers()const noexcept {return _buffers.size();}
 
 		private:
-			std::shared_ptr<IUniform_map> _shared_uniforms;
+			using Sort_key = Command_buffer::Sort_key;
+			using Texture_set = std::array<const Texture*, texture_units>;
+			struct Texture_set_hash {
+				auto operator()(const Texture_set& s)const noexcept -> std::size_t;
+			};
+			/// position of the next key of a buffer during the k-way merge
+			struct Merge_head {
+				uint64_t key;
+				uint32_t buffer;
+				uint32_t position;
+			};
 
-			std::vector<Command> _commands;
-			std::vector<Command> _order_dependent_commands;
+			std::shared_ptr<IUniform_map> _shared_uniforms;
+			std::size_t _expected;
 
-			void _execute_commands(const IUniform_map* shared_uniforms,
-			                       Command& last, bool& is_first,
-			                       std::vector<Command>& commands);
-	};
+			std::vector<std::unique_ptr<Command_buffer>> _buffers;
+			std::vector<Merge_head> _merge_heap;
 
+			// dense ids (per flush) for the parts of the sort key, shared by all buffers
+			uint32_t _order_dependent_count = 0;
+			std::unordered_map<const Shader_program*, uint32_t> _shader_ids;
+			std::unordered_map<Texture_set, uint32_t, Texture_set_hash> _texture_set_ids;
+			std::unordered_map<const IUniform_map*, uint32_t> _ext_uniform_ids;
+			std::unordered_map<const Object*, uint32_t> _object_ids;
 
+			auto _build_key(const Command&) -> uint64_t;
+			void _build_keys();
+			void _execute_commands(const IUniform_map* shared_uniforms);
+	};
 
 }
 }
@@ -0,0 +1,24 @@
+/** OpenGL headers for the current platform *********************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#if defined(HEADLESS)
+	// no context and no GLEW, the entry points are implemented by null_gl.cpp
+	#ifndef GL_GLEXT_PROTOTYPES
+		#define GL_GLEXT_PROTOTYPES
+	#endif
+	#include <GL/gl.h>
+	#include <GL/glext.h>
+
+#elif !defined(ANDROID)
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+
+#else
+	#include <GLES2/gl2.h>
+#endif
@@ -0,0 +1,121 @@
+#include "glyph_table.hpp"
+
+#include "../utils/log.hpp"
+
+#include <algorithm>
+
+
+namespace lux {
+namespace renderer {
+
+	void Glyph_table::reserve(std::size_t glyphs) {
+		_glyphs.reserve(glyphs);
+	}
+
+	auto Glyph_table::add(Text_char c) -> Glyph& {
+		auto index = _index(c);
+		if(index>=0)
+			return _glyphs[index];
+
+		index = static_cast<int32_t>(_glyphs.size());
+		_glyphs.emplace_back();
+
+		if(c < bmp_pages*page_size) {
+			auto& page = _pages[c >> page_bits];
+			if(!page) {
+				page = std::make_unique<Page>();
+				page->fill(-1);
+			}
+			(*page)[c & (page_size-1)] = index;
+
+		} else {
+			_sparse.emplace(c, index);
+		}
+
+		return _glyphs.back();
+	}
+
+	void Glyph_table::add_kerning(Text_char c, Text_char prev, int value) {
+		add(c);
+		_kerning.push_back(Kerning_pair{c, prev, value});
+	}
+
+	void Glyph_table::finish() {
+		for(auto& g : _glyphs) {
+			g.kerning_count = 0;
+		}
+
+		// at most half of the slots are used, so the probe sequences stay short
+		auto size = std::size_t(1);
+		_kerning_shift = 64;
+		while(size < _kerning.size()*2) {
+			size *= 2;
+			_kerning_shift--;
+		}
+		_kerning_table.assign(_kerning.empty() ? 0 : size, Kerning_slot{});
+
+		// pairs are inserted in the order they have been added, so the last definition wins
+		for(auto& pair : _kerning) {
+			auto glyph = static_cast<uint32_t>(_index(pair.c));
+			auto& slot = _kerning_table[_kerning_slot(glyph, pair.prev)];
+			if(slot.glyph!=glyph) {
+				slot.glyph = glyph;
+				slot.prev = pair.prev;
+				_glyphs[glyph].kerning_count++;
+			}
+			slot.value = pair.value;
+		}
+
+		auto max_advance = 0.f;
+		auto sum_advance = 0.f;
+		for(auto& g : _glyphs) {
+			max_advance = std::max(static_cast<float>(g.advance), max_advance);
+			sum_advance += g.advance;
+		}
+		_monospace_advance = _glyphs.empty() ? 0.f
+		                                     : max_advance*0.5f + sum_advance/_glyphs.size()*0.5f;
+	}
+
+	auto Glyph_table::find(Text_char c)const -> const Glyph& {
+		INVARIANT(!_glyphs.empty(), "Lookup in an empty glyph table");
+
+		auto index = _index(c);
+		return _glyphs[index>=0 ? index : 0];
+	}
+
+	auto Glyph_table::kerning(const Glyph& g, Text_char prev)const -> int {
+		if(g.kerning_count==0)
+			return 0;
+
+		auto glyph = static_cast<uint32_t>(&g - _glyphs.data());
+		auto& slot = _kerning_table[_kerning_slot(glyph, prev)];
+		return slot.glyph==glyph ? slot.value : 0;
+	}
+
+	/// the slot that contains the pair or the empty slot it would be inserted into
+	auto Glyph_table::_kerning_slot(uint32_t glyph, Text_char prev)const -> std::size_t {
+		auto key = (uint64_t(glyph) << 32) | prev;
+		auto mask = _kerning_table.size() - 1;
+		auto i = static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> _kerning_shift);
+
+		while(true) {
+			auto& slot = _kerning_table[i];
+			if(slot.glyph==~uint32_t(0) || (slot.glyph==glyph && slot.prev==prev))
+				return i;
+
+			i = (i+1) & mask;
+		}
+	}
+
+	auto Glyph_table::_index(Text_char c)const -> int32_t {
+		if(c < bmp_pages*page_size) {
+			auto& page = _pages[c >> page_bits];
+			return page ? (*page)[c & (page_size-1)] : -1;
+		}
+
+		auto iter = _sparse.find(c);
+		return iter!=_sparse.end() ? iter->second : -1;
+	}
+
+}
+}
@@ -0,0 +1,98 @@
+/** glyph and kerning lookup of a bitmap font ********************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace lux {
+namespace renderer {
+
+	using Text_char = uint32_t;
+
+	struct Glyph {
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+		int offset_x = 0;
+		int offset_y = 0;
+		int advance = 0;
+
+		// number of kerning pairs that end with this glyph, lookups are skipped if 0
+		uint32_t kerning_count = 0;
+	};
+
+	/*
+	 * Maps characters to their glyphs without hashing for the BMP.
+	 * The BMP is split into pages of 256 characters that are only allocated
+	 *   if they contain a glyph (Latin-1 is a single page), all other
+	 *   characters are stored in a sparse map.
+	 * Kerning pairs are stored in one open addressing hash table, keyed by
+	 *   the index of the glyph and the previous character.
+	 * Doesn't depend on OpenGL, so text layouts can be calculated without a
+	 *   graphics context.
+	 */
+	class Glyph_table {
+		public:
+			void reserve(std::size_t glyphs);
+
+			/// returns the glyph of the character, creating it if it doesn't exist
+			auto add(Text_char c) -> Glyph&;
+			/// 'value' is added to the advance of 'prev' if it's followed by 'c'
+			void add_kerning(Text_char c, Text_char prev, int value);
+			/// has to be called after all glyphs and kernings have been added
+			void finish();
+
+			/// the glyph of the character or the first glyph if it doesn't exist
+			auto find(Text_char c)const -> const Glyph&;
+			auto contains(Text_char c)const -> bool {return _index(c)>=0;}
+			auto kerning(const Glyph& g, Text_char prev)const -> int;
+
+			auto size()const noexcept {return _glyphs.size();}
+			auto empty()const noexcept {return _glyphs.empty();}
+			/// advance used for monospaced text, calculated by finish()
+			auto monospace_advance()const noexcept {return _monospace_advance;}
+
+		private:
+			static constexpr auto page_bits = 8;
+			static constexpr auto page_size = Text_char(1) << page_bits;
+			static constexpr auto bmp_pages = Text_char(0x10000) >> page_bits;
+
+			using Page = std::array<int32_t, page_size>; //< index in _glyphs or -1
+
+			struct Kerning_pair {
+				Text_char c;
+				Text_char prev;
+				int value;
+			};
+			struct Kerning_slot {
+				uint32_t glyph = ~uint32_t(0); //< index in _glyphs, ~0 = empty
+				Text_char prev = 0;
+				int value = 0;
+			};
+
+			std::vector<Glyph> _glyphs;
+			std::array<std::unique_ptr<Page>, bmp_pages> _pages;
+			std::unordered_map<Text_char, int32_t> _sparse;
+
+			std::vector<Kerning_pair> _kerning; //< all added pairs, inserted into _kerning_table by finish()
+			std::vector<Kerning_slot> _kerning_table; //< size is a power of two
+			int _kerning_shift = 64;
+			float _monospace_advance = 0.f;
+
+			auto _index(Text_char c)const -> int32_t;
+			auto _kerning_slot(uint32_t glyph, Text_char prev)const -> std::size_t;
+	};
+
+}
+}
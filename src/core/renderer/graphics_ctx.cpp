@@ -1,9 +1,4 @@
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include "gl.hpp"
 
 #include "graphics_ctx.hpp"
 
@@ -12,6 +7,8 @@
 #include "texture_batch.hpp"
 #include "material.hpp"
 #include "primitives.hpp"
+#include "render_state.hpp"
+#include "texture.hpp"
 
 #include "../utils/log.hpp"
 #include "../asset/asset_manager.hpp"
@@ -29,6 +26,7 @@ namespace renderer {
 	using namespace unit_literals;
 
 	namespace {
+#ifndef HEADLESS
 		void sdl_error_check() {
 			const char *err = SDL_GetError();
 			if(*err != '\0') {
@@ -37,8 +35,9 @@ namespace renderer {
 				FAIL("SDL: "<<errorStr);
 			}
 		}
+#endif
 
-#ifndef ANDROID
+#if !defined(ANDROID) && !defined(HEADLESS)
 	#ifndef EMSCRIPTEN
 		void
 	#ifdef GLAPIENTRY
@@ -105,7 +104,8 @@ namespace renderer {
 		bloom,
 		supersampling,
 		shadow_softness,
-		fast_lighting
+		fast_lighting,
+		text_cache_kb
 	)
 
 	auto default_settings(int display) -> Graphics_settings {
@@ -160,13 +160,20 @@ namespace renderer {
 			_settings = maybe_settings.get_or_throw();
 		}
 
+#ifdef HEADLESS
+		// no window and no context, all GL calls end up in null_gl.cpp
+		_win_width = _settings->width;
+		_win_height = _settings->height;
+		_viewport = glm::vec4{0,0,_settings->width, _settings->height};
+		reset_viewport();
 
-#ifndef EMSCRIPTEN
+#else
+	#ifndef EMSCRIPTEN
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-#endif
+	#endif
 		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 		SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
@@ -174,7 +181,7 @@ namespace renderer {
 		int win_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI;
 
 		auto display = _settings->display;
-#ifndef EMSCRIPTEN
+	#ifndef EMSCRIPTEN
 		_window.reset(SDL_CreateWindow(_name.c_str(),
 		                               SDL_WINDOWPOS_CENTERED_DISPLAY(display), SDL_WINDOWPOS_CENTERED_DISPLAY(display),
 		                               _settings->width, _settings->height, win_flags) );
@@ -187,7 +194,7 @@ namespace renderer {
 		if(!settings(*_settings)) { //< apply actual size/settings
 			FAIL("Couldn't apply graphics settings");
 		}
-#else
+	#else
 		_window.reset(SDL_CreateWindow(_name.c_str(),
 		                               SDL_WINDOWPOS_CENTERED_DISPLAY(display), SDL_WINDOWPOS_CENTERED_DISPLAY(display),
 		                               _settings->width, _settings->height, win_flags) );
@@ -201,7 +208,7 @@ namespace renderer {
 		_win_height = _settings->height;
 		_viewport = glm::vec4{0,0,_settings->width, _settings->height};
 		reset_viewport();
-#endif
+	#endif
 
 		sdl_error_check();
 
@@ -216,8 +223,9 @@ namespace renderer {
 		}
 
 		if(SDL_GL_SetSwapInterval(-1)!=0) SDL_GL_SetSwapInterval(1);
+#endif
 
-#ifndef ANDROID
+#if !defined(ANDROID) && !defined(HEADLESS)
 		glewExperimental = GL_TRUE;
 		glewInit();
 
@@ -233,15 +241,16 @@ namespace renderer {
 #endif
 
 		glLineWidth(2.0f);
-		glEnable(GL_BLEND);
+		render_state().invalidate();
+		render_state().gl_options(default_gl_options);
 		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-		glEnable(GL_DEPTH_TEST);
 		glDepthFunc(GL_LEQUAL);
 		glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
 		glEnable(GL_POINT_SPRITE);
 		set_clear_color(0.0f,0.0f,0.0f);
 
 		init_font_renderer(assets);
+		text_cache().budget(static_cast<std::size_t>(std::max(0, settings().text_cache_kb)) * 1024);
 		init_sprite_renderer(assets);
 		init_texture_renderer(assets);
 		init_materials(assets);
@@ -249,7 +258,12 @@ namespace renderer {
 	}
 
 	Graphics_ctx::~Graphics_ctx() {
+		// cached texts own buffers that have to be deleted while the context still exists
+		shutdown_font_renderer();
+
+#ifndef HEADLESS
 		SDL_GL_DeleteContext(_gl_ctx);
+#endif
 	}
 
 	void Graphics_ctx::reset_viewport()const noexcept {
@@ -266,6 +280,8 @@ namespace renderer {
 
 		glClear(GL_DEPTH_BUFFER_BIT|GL_COLOR_BUFFER_BIT);
 
+		texture_uploader().update();
+
 		_frame_start_time = SDL_GetTicks() / 1000.0f;
 	}
 	void Graphics_ctx::end_frame(Time delta_time) {
@@ -281,15 +297,24 @@ namespace renderer {
 			std::ostringstream osstr;
 			osstr<<_name<<" ("<<(int((1.0f/_delta_time_smoothed)*10.0f)/10.0f)<<" FPS, ";
 			osstr<<(int(_delta_time_smoothed*10000.0f)/10.0f)<<" ms/frame, ";
-			osstr<<(int(_cpu_delta_time_smoothed*10000.0f)/10.0f)<<" ms/frame [cpu])";
+			osstr<<(int(_cpu_delta_time_smoothed*10000.0f)/10.0f)<<" ms/frame [cpu], ";
 
-#ifdef EMSCRIPTEN
+			auto& stats = render_state().stats();
+			osstr<<stats.draw_calls<<" draws, "<<(stats.state_changes+stats.program_binds+stats.texture_binds)
+			     <<" state changes, "<<stats.uniform_uploads<<" uniforms, "
+			     <<stats.text_cache_hits<<"/"<<(stats.text_cache_hits+stats.text_cache_misses)
+			     <<" text cache hits)";
+
+#if defined(EMSCRIPTEN) || defined(HEADLESS)
 			// DEBUG(_cpu_delta_time_smoothed);
 #else
 			SDL_SetWindowTitle(_window.get(), osstr.str().c_str());
 #endif
 		}
+		render_state().end_frame();
+#ifndef HEADLESS
 		SDL_GL_SwapWindow(_window.get());
+#endif
 	}
 	void Graphics_ctx::set_clear_color(float r, float g, float b) {
 		_clear_color = glm::vec3(r,g,b);
@@ -317,6 +342,7 @@ namespace renderer {
 
 		_assets.save<Graphics_settings>("cfg:graphics"_aid, new_settings);
 		_settings = _assets.load<Graphics_settings>("cfg:graphics"_aid);
+		text_cache().budget(static_cast<std::size_t>(std::max(0, _settings->text_cache_kb)) * 1024);
 
 #ifndef EMSCRIPTEN
 		// update existing window
@@ -342,24 +368,24 @@ namespace renderer {
 	}
 
 	Disable_depthtest::Disable_depthtest() {
-		glDisable(GL_DEPTH_TEST);
+		render_state().option(Gl_option::depth_test, false);
 	}
 	Disable_depthtest::~Disable_depthtest() {
-		glEnable(GL_DEPTH_TEST);
+		render_state().option(Gl_option::depth_test, true);
 	}
 
 	Disable_depthwrite::Disable_depthwrite() {
-		glDepthMask(GL_FALSE);
+		render_state().option(Gl_option::depth_write, false);
 	}
 	Disable_depthwrite::~Disable_depthwrite() {
-		glDepthMask(GL_TRUE);
+		render_state().option(Gl_option::depth_write, true);
 	}
 
 	Disable_blend::Disable_blend() {
-		glDisable(GL_BLEND);
+		render_state().option(Gl_option::blend, false);
 	}
 	Disable_blend::~Disable_blend() {
-		glEnable(GL_BLEND);
+		render_state().option(Gl_option::blend, true);
 	}
 
 	Blend_add::Blend_add() {
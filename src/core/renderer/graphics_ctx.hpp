@@ -33,6 +33,7 @@ namespace renderer {
 		float supersampling = 1.0f;
 		float shadow_softness = 0.5f;
 		bool fast_lighting = false;
+		int text_cache_kb = 2048; //< geometry of static texts kept by Font::text()
 	};
 
 	extern auto default_settings(int display=0) -> Graphics_settings;
@@ -63,7 +64,7 @@ namespace renderer {
 			std::shared_ptr<const Graphics_settings> _settings;
 
 			std::unique_ptr<SDL_Window,void(*)(SDL_Window*)> _window;
-			SDL_GLContext _gl_ctx;
+			SDL_GLContext _gl_ctx = nullptr;
 			glm::vec3 _clear_color;
 			bool _clear_color_dirty = true;
 
@@ -0,0 +1,182 @@
+#include "image_data.hpp"
+
+#include <soil/stb_image_mt.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace lux {
+namespace renderer {
+
+	namespace {
+		constexpr auto compressed_rgba_dxt1 = 0x83F1u;
+		constexpr auto compressed_rgba_dxt3 = 0x83F2u;
+		constexpr auto compressed_rgba_dxt5 = 0x83F3u;
+
+		auto read_u32(const std::vector<uint8_t>& file, std::size_t offset) -> uint32_t {
+			if(offset+4 > file.size())
+				return 0;
+
+			return  uint32_t(file[offset])
+			     | (uint32_t(file[offset+1]) << 8)
+			     | (uint32_t(file[offset+2]) << 16)
+			     | (uint32_t(file[offset+3]) << 24);
+		}
+
+		constexpr auto four_cc(char a, char b, char c, char d) -> uint32_t {
+			return uint32_t(a) | (uint32_t(b) << 8) | (uint32_t(c) << 16) | (uint32_t(d) << 24);
+		}
+
+		auto starts_with(const std::vector<uint8_t>& file, const uint8_t* magic, std::size_t size) {
+			return file.size()>=size && std::memcmp(file.data(), magic, size)==0;
+		}
+
+
+		// DDS: 4 bytes magic + 124 bytes header; only DXT1/3/5 2D textures
+		constexpr uint8_t dds_magic[] = {'D','D','S',' '};
+		constexpr auto dds_data_offset = std::size_t(128);
+		constexpr auto dds_cubemap_flag = 0x200u;
+
+		auto dds_format(const std::vector<uint8_t>& file) -> unsigned int {
+			if(!starts_with(file, dds_magic, sizeof(dds_magic)) || file.size()<dds_data_offset)
+				return 0;
+
+			if(read_u32(file, 112) & dds_cubemap_flag)
+				return 0;
+
+			switch(read_u32(file, 84)) {
+				case four_cc('D','X','T','1'): return compressed_rgba_dxt1;
+				case four_cc('D','X','T','3'): return compressed_rgba_dxt3;
+				case four_cc('D','X','T','5'): return compressed_rgba_dxt5;
+				default: return 0;
+			}
+		}
+
+		auto decode_dds(const std::vector<uint8_t>& file, unsigned int format,
+		                Image_data& out, std::string& error) -> bool {
+			auto block_size = format==compressed_rgba_dxt1 ? 8u : 16u;
+
+			out.width = static_cast<int>(read_u32(file, 16));
+			out.height = static_cast<int>(read_u32(file, 12));
+			out.compressed_format = format;
+
+			auto level_count = std::max(1u, read_u32(file, 28));
+			auto offset = dds_data_offset;
+			auto w = out.width;
+			auto h = out.height;
+
+			for(auto i=0u; i<level_count; ++i) {
+				auto size = std::size_t(std::max(1, (w+3)/4)) * std::max(1, (h+3)/4) * block_size;
+				if(offset+size > file.size()) {
+					error = "DDS file is truncated";
+					return false;
+				}
+
+				out.levels.push_back(Image_data::Level{w, h, offset-dds_data_offset, size});
+				offset += size;
+				w = std::max(1, w/2);
+				h = std::max(1, h/2);
+			}
+
+			out.data.assign(file.begin()+dds_data_offset, file.begin()+offset);
+			return true;
+		}
+
+
+		// KTX 1.1: 12 bytes identifier + 52 bytes header + key/value data; only compressed 2D textures
+		constexpr uint8_t ktx_magic[] = {0xAB,'K','T','X',' ','1','1',0xBB,'\r','\n',0x1A,'\n'};
+		constexpr auto ktx_header_size = std::size_t(64);
+		constexpr auto ktx_native_endianness = 0x04030201u;
+
+		auto ktx_supported(const std::vector<uint8_t>& file) -> bool {
+			return starts_with(file, ktx_magic, sizeof(ktx_magic))
+			    && file.size()>=ktx_header_size
+			    && read_u32(file, 12)==ktx_native_endianness
+			    && read_u32(file, 16)==0   // glType: 0 = compressed
+			    && read_u32(file, 44)<=1   // pixelDepth
+			    && read_u32(file, 48)==0   // numberOfArrayElements
+			    && read_u32(file, 52)==1;  // numberOfFaces
+		}
+
+		auto decode_ktx(const std::vector<uint8_t>& file, Image_data& out, std::string& error) -> bool {
+			out.width = static_cast<int>(read_u32(file, 36));
+			out.height = static_cast<int>(std::max(1u, read_u32(file, 40)));
+			out.compressed_format = read_u32(file, 28);
+
+			auto level_count = std::max(1u, read_u32(file, 56));
+			auto offset = ktx_header_size + read_u32(file, 60);
+			auto w = out.width;
+			auto h = out.height;
+
+			for(auto i=0u; i<level_count; ++i) {
+				auto size = std::size_t(read_u32(file, offset));
+				offset += 4;
+				if(offset+size > file.size()) {
+					error = "KTX file is truncated";
+					return false;
+				}
+
+				out.levels.push_back(Image_data::Level{w, h, out.data.size(), size});
+				out.data.insert(out.data.end(), file.begin()+offset, file.begin()+offset+size);
+
+				offset += (size+3) & ~std::size_t(3);
+				w = std::max(1, w/2);
+				h = std::max(1, h/2);
+			}
+
+			return true;
+		}
+	}
+
+	auto image_info(const std::vector<uint8_t>& file, int& width, int& height) -> bool {
+		if(dds_format(file)!=0) {
+			width = static_cast<int>(read_u32(file, 16));
+			height = static_cast<int>(read_u32(file, 12));
+			return true;
+		}
+
+		if(ktx_supported(file)) {
+			width = static_cast<int>(read_u32(file, 36));
+			height = static_cast<int>(std::max(1u, read_u32(file, 40)));
+			return true;
+		}
+
+		// other DDS files are loaded by SOIL
+		if(starts_with(file, dds_magic, sizeof(dds_magic)))
+			return false;
+
+		auto components = 0;
+		return stbi_mt_info_from_memory(file.data(), static_cast<int>(file.size()),
+		                                &width, &height, &components) != 0;
+	}
+
+	auto decode_image(const std::vector<uint8_t>& file, Image_data& out, std::string& error) -> bool {
+		out = Image_data{};
+
+		auto dds = dds_format(file);
+		if(dds!=0)
+			return decode_dds(file, dds, out, error);
+
+		if(ktx_supported(file))
+			return decode_ktx(file, out, error);
+
+		auto components = 0;
+		auto pixels = stbi_mt_load_from_memory(file.data(), static_cast<int>(file.size()),
+		                                       &out.width, &out.height, &components, 4);
+		if(!pixels) {
+			// the instance used from worker threads doesn't track the reason
+			error = "corrupt image data";
+			return false;
+		}
+
+		auto size = std::size_t(out.width) * out.height * 4;
+		out.data.assign(pixels, pixels+size);
+		out.levels.push_back(Image_data::Level{out.width, out.height, 0, size});
+		stbi_mt_image_free(pixels);
+
+		return true;
+	}
+
+}
+}
@@ -0,0 +1,52 @@
+/** decoding of image files without an OpenGL context ************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+namespace lux {
+namespace renderer {
+
+	/// decoded (RGBA8) or pre-compressed pixel data, that is ready to be uploaded
+	struct Image_data {
+		struct Level {
+			int width;
+			int height;
+			std::size_t offset; //< into data
+			std::size_t size;
+		};
+
+		int width = 0;
+		int height = 0;
+		unsigned int compressed_format = 0; //< GL internal format of pre-compressed data, 0 for RGBA8
+		std::vector<uint8_t> data;
+		std::vector<Level> levels;
+
+		auto bytes()const noexcept {return data.size();}
+	};
+
+	/*
+	 * Reads the size of the image from its header.
+	 * Returns false if decode_image() doesn't support the format (e.g. DDS
+	 *   cubemaps or PVR), which then has to be loaded through SOIL directly.
+	 */
+	extern auto image_info(const std::vector<uint8_t>& file, int& width, int& height) -> bool;
+
+	/*
+	 * Decodes everything stb_image supports to RGBA8. DDS (DXT1/3/5) and KTX
+	 *   files with compressed data are only split into their mip levels.
+	 * Can be called from worker threads.
+	 */
+	extern auto decode_image(const std::vector<uint8_t>& file, Image_data& out,
+	                         std::string& error) -> bool;
+
+}
+}
@@ -47,6 +47,14 @@ namespace renderer {
 			cmd.order_dependent();
 	}
 
+	auto Material::same_textures(const Material& rhs)const noexcept -> bool {
+		return _alpha==rhs._alpha
+		    && _albedo->unsafe_low_level_handle()==rhs._albedo->unsafe_low_level_handle()
+		    && _normal->unsafe_low_level_handle()==rhs._normal->unsafe_low_level_handle()
+		    && _material->unsafe_low_level_handle()==rhs._material->unsafe_low_level_handle()
+		    && _height->unsafe_low_level_handle()==rhs._height->unsafe_low_level_handle();
+	}
+
 	void init_materials(asset::Asset_manager& assets) {
 		black = assets.load<Texture>("tex:black"_aid);
 		white = assets.load<Texture>("tex:white"_aid);
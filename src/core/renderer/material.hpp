@@ -33,6 +33,13 @@ namespace renderer {
 			}
 			auto alpha()const noexcept {return _alpha;}
 
+			/// materials whose textures are on the same atlas pages can be drawn in one batch
+			auto same_textures(const Material& rhs)const noexcept -> bool;
+			/// sorts materials that share their textures next to each other
+			auto batch_key()const noexcept -> unsigned int {
+				return _albedo->unsafe_low_level_handle();
+			}
+
 		private:
 			Texture_ptr _albedo;
 			Texture_ptr _normal;
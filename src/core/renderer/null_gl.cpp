@@ -0,0 +1,306 @@
+#ifdef HEADLESS
+
+#include "gl.hpp"
+#include "null_gl.hpp"
+
+#include <string>
+#include <algorithm>
+
+
+namespace lux {
+namespace renderer {
+
+	namespace {
+		struct Null_gl_state {
+			Null_gl_stats stats;
+			GLuint next_handle = 1;
+			GLint viewport[4] {0,0,0,0};
+			GLint unpack_alignment = 4;
+			std::unordered_map<GLuint, std::unordered_map<std::string, GLint>> uniform_locations;
+		};
+		auto state() -> Null_gl_state& {
+			static Null_gl_state s;
+			return s;
+		}
+
+		void record(const char* func) {
+			auto& stats = state().stats;
+			stats.calls[func]++;
+			stats.total_calls++;
+		}
+		void record_state_change(const char* func) {
+			record(func);
+			state().stats.state_changes++;
+		}
+		void record_draw(const char* func) {
+			record(func);
+			state().stats.draw_calls++;
+		}
+		void record_upload(const char* func, std::size_t bytes) {
+			record(func);
+			state().stats.bytes_uploaded += bytes;
+		}
+
+		void gen_handles(GLsizei n, GLuint* handles) {
+			for(auto i=0; i<n; ++i)
+				handles[i] = state().next_handle++;
+		}
+
+		auto pixel_size(GLenum format, GLenum type) -> std::size_t {
+			auto components = std::size_t(4);
+			switch(format) {
+				case GL_RED:
+				case GL_ALPHA:
+				case GL_LUMINANCE:
+				case GL_DEPTH_COMPONENT: components = 1; break;
+				case GL_LUMINANCE_ALPHA:
+				case GL_RG:              components = 2; break;
+				case GL_RGB:             components = 3; break;
+				default: break;
+			}
+
+			switch(type) {
+				case GL_UNSIGNED_SHORT:
+				case GL_SHORT:
+				case GL_HALF_FLOAT: return components*2;
+				case GL_UNSIGNED_INT:
+				case GL_INT:
+				case GL_FLOAT:      return components*4;
+				default:            return components;
+			}
+		}
+	}
+
+	auto null_gl_stats() -> const Null_gl_stats& {
+		return state().stats;
+	}
+	void reset_null_gl_stats() {
+		state().stats = Null_gl_stats{};
+	}
+
+}
+}
+
+using namespace lux::renderer;
+
+extern "C" {
+
+	// state
+	void GLAPIENTRY glEnable(GLenum) {record_state_change(__func__);}
+	void GLAPIENTRY glDisable(GLenum) {record_state_change(__func__);}
+	void GLAPIENTRY glBlendFunc(GLenum, GLenum) {record_state_change(__func__);}
+	void GLAPIENTRY glDepthFunc(GLenum) {record_state_change(__func__);}
+	void GLAPIENTRY glDepthMask(GLboolean) {record_state_change(__func__);}
+	void GLAPIENTRY glLineWidth(GLfloat) {record_state_change(__func__);}
+	void GLAPIENTRY glScissor(GLint, GLint, GLsizei, GLsizei) {record_state_change(__func__);}
+	void GLAPIENTRY glPixelStorei(GLenum pname, GLint param) {
+		record(__func__);
+		if(pname==GL_UNPACK_ALIGNMENT)
+			state().unpack_alignment = param;
+	}
+	void GLAPIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		record_state_change(__func__);
+		auto& vp = state().viewport;
+		vp[0] = x;
+		vp[1] = y;
+		vp[2] = width;
+		vp[3] = height;
+	}
+	void GLAPIENTRY glClearColor(GLclampf, GLclampf, GLclampf, GLclampf) {record(__func__);}
+	void GLAPIENTRY glClear(GLbitfield) {record(__func__);}
+	void APIENTRY glDebugMessageCallback(GLDEBUGPROC, const void*) {record(__func__);}
+
+	// queries
+	GLenum GLAPIENTRY glGetError(void) {
+		return GL_NO_ERROR;
+	}
+	const GLubyte* GLAPIENTRY glGetString(GLenum) {
+		record(__func__);
+		return reinterpret_cast<const GLubyte*>("");
+	}
+	void GLAPIENTRY glGetIntegerv(GLenum pname, GLint* params) {
+		record(__func__);
+		switch(pname) {
+			case GL_VIEWPORT:
+				std::copy(std::begin(state().viewport), std::end(state().viewport), params);
+				break;
+			case GL_MAX_TEXTURE_SIZE:
+			case GL_MAX_CUBE_MAP_TEXTURE_SIZE:
+				*params = 8192;
+				break;
+			case GL_UNPACK_ALIGNMENT:
+				*params = state().unpack_alignment;
+				break;
+			default:
+				*params = 0;
+				break;
+		}
+	}
+	void GLAPIENTRY glReadPixels(GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, GLvoid*) {record(__func__);}
+
+	// textures
+	void GLAPIENTRY glGenTextures(GLsizei n, GLuint* textures) {
+		record(__func__);
+		gen_handles(n, textures);
+	}
+	void GLAPIENTRY glDeleteTextures(GLsizei, const GLuint*) {record(__func__);}
+	void APIENTRY glActiveTexture(GLenum) {record_state_change(__func__);}
+	void GLAPIENTRY glBindTexture(GLenum, GLuint) {record_state_change(__func__);}
+	void GLAPIENTRY glTexParameteri(GLenum, GLenum, GLint) {record(__func__);}
+	void GLAPIENTRY glTexImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height,
+	                             GLint, GLenum format, GLenum type, const GLvoid* pixels) {
+		record_upload(__func__, pixels ? width*height*pixel_size(format, type) : 0);
+	}
+	void GLAPIENTRY glTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height,
+	                                GLenum format, GLenum type, const GLvoid* pixels) {
+		record_upload(__func__, pixels ? width*height*pixel_size(format, type) : 0);
+	}
+	void APIENTRY glCompressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint,
+	                                     GLsizei image_size, const void* data) {
+		record_upload(__func__, data ? image_size : 0);
+	}
+	void APIENTRY glGenerateMipmap(GLenum) {record(__func__);}
+
+	// framebuffers
+	void APIENTRY glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+		record(__func__);
+		gen_handles(n, framebuffers);
+	}
+	void APIENTRY glDeleteFramebuffers(GLsizei, const GLuint*) {record(__func__);}
+	void APIENTRY glBindFramebuffer(GLenum, GLuint) {record_state_change(__func__);}
+	void APIENTRY glFramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) {record(__func__);}
+	void APIENTRY glFramebufferRenderbuffer(GLenum, GLenum, GLenum, GLuint) {record(__func__);}
+	GLenum APIENTRY glCheckFramebufferStatus(GLenum) {
+		record(__func__);
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+	void APIENTRY glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+		record(__func__);
+		gen_handles(n, renderbuffers);
+	}
+	void APIENTRY glDeleteRenderbuffers(GLsizei, const GLuint*) {record(__func__);}
+	void APIENTRY glBindRenderbuffer(GLenum, GLuint) {record(__func__);}
+	void APIENTRY glRenderbufferStorage(GLenum, GLenum, GLsizei, GLsizei) {record(__func__);}
+
+	// shaders
+	GLuint APIENTRY glCreateShader(GLenum) {
+		record(__func__);
+		return state().next_handle++;
+	}
+	void APIENTRY glDeleteShader(GLuint) {record(__func__);}
+	void APIENTRY glShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) {record(__func__);}
+	void APIENTRY glCompileShader(GLuint) {record(__func__);}
+	void APIENTRY glGetShaderiv(GLuint, GLenum pname, GLint* params) {
+		record(__func__);
+		*params = pname==GL_INFO_LOG_LENGTH ? 0 : GL_TRUE;
+	}
+	void APIENTRY glGetShaderInfoLog(GLuint, GLsizei buf_size, GLsizei* length, GLchar* info_log) {
+		record(__func__);
+		if(length)
+			*length = 0;
+		if(buf_size>0)
+			info_log[0] = '\0';
+	}
+	GLuint APIENTRY glCreateProgram(void) {
+		record(__func__);
+		return state().next_handle++;
+	}
+	void APIENTRY glDeleteProgram(GLuint program) {
+		record(__func__);
+		state().uniform_locations.erase(program);
+	}
+	void APIENTRY glAttachShader(GLuint, GLuint) {record(__func__);}
+	void APIENTRY glDetachShader(GLuint, GLuint) {record(__func__);}
+	void APIENTRY glBindAttribLocation(GLuint, GLuint, const GLchar*) {record(__func__);}
+	void APIENTRY glLinkProgram(GLuint program) {
+		record(__func__);
+		state().uniform_locations.erase(program);
+	}
+	void APIENTRY glValidateProgram(GLuint) {record(__func__);}
+	void APIENTRY glGetProgramiv(GLuint, GLenum pname, GLint* params) {
+		record(__func__);
+		*params = pname==GL_INFO_LOG_LENGTH ? 0 : GL_TRUE;
+	}
+	void APIENTRY glGetProgramInfoLog(GLuint, GLsizei buf_size, GLsizei* length, GLchar* info_log) {
+		record(__func__);
+		if(length)
+			*length = 0;
+		if(buf_size>0)
+			info_log[0] = '\0';
+	}
+	void APIENTRY glUseProgram(GLuint) {record_state_change(__func__);}
+
+	// every name is a valid uniform, with dense locations per program
+	GLint APIENTRY glGetUniformLocation(GLuint program, const GLchar* name) {
+		record(__func__);
+		auto& locations = state().uniform_locations[program];
+		auto location = static_cast<GLint>(locations.size());
+		return locations.emplace(name, location).first->second;
+	}
+	void APIENTRY glUniform1i(GLint, GLint) {record_upload(__func__, sizeof(GLint));}
+	void APIENTRY glUniform1f(GLint, GLfloat) {record_upload(__func__, sizeof(GLfloat));}
+	void APIENTRY glUniform2fv(GLint, GLsizei count, const GLfloat*) {record_upload(__func__, count*2*sizeof(GLfloat));}
+	void APIENTRY glUniform3fv(GLint, GLsizei count, const GLfloat*) {record_upload(__func__, count*3*sizeof(GLfloat));}
+	void APIENTRY glUniform4fv(GLint, GLsizei count, const GLfloat*) {record_upload(__func__, count*4*sizeof(GLfloat));}
+	void APIENTRY glUniformMatrix2fv(GLint, GLsizei count, GLboolean, const GLfloat*) {
+		record_upload(__func__, count*4*sizeof(GLfloat));
+	}
+	void APIENTRY glUniformMatrix3fv(GLint, GLsizei count, GLboolean, const GLfloat*) {
+		record_upload(__func__, count*9*sizeof(GLfloat));
+	}
+	void APIENTRY glUniformMatrix4fv(GLint, GLsizei count, GLboolean, const GLfloat*) {
+		record_upload(__func__, count*16*sizeof(GLfloat));
+	}
+
+	// buffers & vertex arrays
+	void APIENTRY glGenBuffers(GLsizei n, GLuint* buffers) {
+		record(__func__);
+		gen_handles(n, buffers);
+	}
+	void APIENTRY glDeleteBuffers(GLsizei, const GLuint*) {record(__func__);}
+	void APIENTRY glBindBuffer(GLenum, GLuint) {record(__func__);}
+	void APIENTRY glBufferData(GLenum, GLsizeiptr size, const void* data, GLenum) {
+		record_upload(__func__, data ? size : 0);
+	}
+	void APIENTRY glBufferSubData(GLenum, GLintptr, GLsizeiptr size, const void*) {
+		record_upload(__func__, size);
+	}
+	void APIENTRY glGenVertexArrays(GLsizei n, GLuint* arrays) {
+		record(__func__);
+		gen_handles(n, arrays);
+	}
+	void APIENTRY glDeleteVertexArrays(GLsizei, const GLuint*) {record(__func__);}
+	void APIENTRY glBindVertexArray(GLuint) {record(__func__);}
+	void APIENTRY glEnableVertexAttribArray(GLuint) {record(__func__);}
+	void APIENTRY glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {record(__func__);}
+	void APIENTRY glVertexAttribDivisor(GLuint, GLuint) {record(__func__);}
+
+	// draw calls
+	void GLAPIENTRY glDrawArrays(GLenum, GLint first, GLsizei) {
+		record_draw(__func__);
+		auto& offsets = state().stats.draw_offsets;
+		if(offsets.size()<Null_gl_stats::max_logged_draws)
+			offsets.push_back(first);
+	}
+	void GLAPIENTRY glDrawElements(GLenum, GLsizei, GLenum, const GLvoid*) {record_draw(__func__);}
+	void APIENTRY glDrawArraysInstanced(GLenum, GLint, GLsizei, GLsizei) {record_draw(__func__);}
+	void APIENTRY glDrawElementsInstanced(GLenum, GLsizei, GLenum, const void*, GLsizei) {record_draw(__func__);}
+
+	// SOIL queries its extensions at runtime, unknown names are reported as unsupported
+	using Null_gl_proc = void (*)(void);
+	Null_gl_proc glXGetProcAddress(const GLubyte* name) {
+		record(__func__);
+		auto n = std::string(reinterpret_cast<const char*>(name));
+		if(n=="glCompressedTexImage2D")
+			return reinterpret_cast<Null_gl_proc>(&glCompressedTexImage2D);
+		if(n=="glGenerateMipmap")
+			return reinterpret_cast<Null_gl_proc>(&glGenerateMipmap);
+
+		return nullptr;
+	}
+	Null_gl_proc glXGetProcAddressARB(const GLubyte* name) {
+		return glXGetProcAddress(name);
+	}
+}
+
+#endif
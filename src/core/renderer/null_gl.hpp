@@ -0,0 +1,43 @@
+/** statistics of the OpenGL replacement used by HEADLESS builds *************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#ifdef HEADLESS
+
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+
+
+namespace lux {
+namespace renderer {
+
+	/*
+	 * HEADLESS builds link null_gl.cpp instead of libGL/GLEW. It implements
+	 *   all entry points used by the engine, without a context or GPU, and only
+	 *   records what would have been sent to the driver.
+	 * Used to run and measure the CPU side of the renderer on build machines.
+	 */
+	struct Null_gl_stats {
+		std::unordered_map<const char*, std::size_t> calls; //< per entry point (key is __func__)
+		std::size_t total_calls = 0;
+		std::size_t draw_calls = 0;
+		std::size_t state_changes = 0;  //< enable/disable, blend/depth functions, program & texture binds
+		std::size_t bytes_uploaded = 0; //< buffer, texture and uniform data
+		std::vector<int> draw_offsets;  //< first vertex of the glDrawArrays calls (up to max_logged_draws)
+
+		static constexpr std::size_t max_logged_draws = 1<<16;
+	};
+
+	extern auto null_gl_stats() -> const Null_gl_stats&;
+	extern void reset_null_gl_stats();
+
+}
+}
+
+#endif
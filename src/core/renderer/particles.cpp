@@ -7,6 +7,7 @@
 #include "vertex_object.hpp"
 
 #include "../utils/random.hpp"
+#include "../utils/thread_pool.hpp"
 #include "../utils/sf2_glm.hpp"
 
 #include <vector>
@@ -70,18 +71,12 @@ namespace renderer {
 	)
 
 	namespace {
-		struct Particle_draw {
-			glm::vec3 position;
-			glm::vec3 direction;
-			float rotation;
-			float frames;
-			float current_frame;
-			float size;
-
-			float alpha;
-			float opacity;
-			float hue_change_out;
-		};
+		constexpr auto min_emitters_per_thread = 4;
+		constexpr auto max_unused_emitters = 16; //< per type
+		constexpr auto max_step = 1.f/30; //< longer updates are split into multiple steps
+		/// movement speeds are defined per frame at this rate
+		constexpr auto reference_fps = 60.f;
+
 		Vertex_layout simple_particle_vertex_layout {
 			Vertex_layout::Mode::points,
 			vertex("position",      &Particle_draw::position),
@@ -95,59 +90,95 @@ namespace renderer {
 			vertex("hue_change_out",&Particle_draw::hue_change_out)
 		};
 
-		struct Particle_sim {
-			Time ttl;
-			Time lifetime;
-
-			float initial_alpha;
-			float final_alpha;
-			float initial_opacity;
-			float final_opacity;
-
-			float initial_size;
-			float final_size;
-
-			glm::quat source_direction;
-			glm::quat direction;
-			float initial_speed;
-			float final_speed;
-
-			glm::quat angular_speed_local;
-			glm::quat angular_speed_global;
+		/*
+		 * State of all particles of an emitter as a structure of arrays, so
+		 *   the per-frame loops only touch the fields they need and can be
+		 *   vectorized by the compiler.
+		 * Types that only rotate around the z axis are simulated with a single
+		 *   angle in the plane of the emitter (plane_u, plane_v), all others
+		 *   use a quaternion per particle.
+		 */
+		struct Particle_arrays {
+			bool planar = true;
+
+			std::vector<float> ttl, inv_lifetime;
+			std::vector<float> alpha, alpha_delta;     //< initial value and final-initial
+			std::vector<float> opacity, opacity_delta;
+			std::vector<float> size, size_delta;
+			std::vector<float> speed, speed_delta;
+			std::vector<float> x, y, z;
+			std::vector<float> velocity_x, velocity_y, velocity_z;
+			std::vector<float> dir_x, dir_y, dir_z;
+			std::vector<float> rotation, frame, hue_change_out;
+
+			// planar
+			std::vector<float> angle, angular_speed;
+			std::vector<float> plane_u_x, plane_u_y, plane_u_z;
+			std::vector<float> plane_v_x, plane_v_y, plane_v_z;
+
+			// spatial
+			std::vector<float> q_w, q_x, q_y, q_z;
+			std::vector<float> w_local_x, w_local_y, w_local_z;
+			std::vector<float> w_global_x, w_global_y, w_global_z;
+			std::vector<float> source_w, source_x, source_y, source_z;
+
+			auto count()const noexcept {return ttl.size();}
+
+			template<class F>
+			void each(F&& f) {
+				for(auto a : {&ttl, &inv_lifetime, &alpha, &alpha_delta, &opacity, &opacity_delta,
+				              &size, &size_delta, &speed, &speed_delta, &x, &y, &z,
+				              &velocity_x, &velocity_y, &velocity_z, &dir_x, &dir_y, &dir_z,
+				              &rotation, &frame, &hue_change_out}) {
+					f(*a);
+				}
 
-			glm::vec3 linear_speed;
+				if(planar) {
+					for(auto a : {&angle, &angular_speed, &plane_u_x, &plane_u_y, &plane_u_z,
+					              &plane_v_x, &plane_v_y, &plane_v_z}) {
+						f(*a);
+					}
+				} else {
+					for(auto a : {&q_w, &q_x, &q_y, &q_z, &w_local_x, &w_local_y, &w_local_z,
+					              &w_global_x, &w_global_y, &w_global_z,
+					              &source_w, &source_x, &source_y, &source_z}) {
+						f(*a);
+					}
+				}
+			}
 		};
 
-		glm::quat calculate_w(float pitch, float yaw, float roll) {
-			return glm::quat(0, roll, pitch, yaw);
+		auto is_zero(Float_range r) {
+			return r.min==0.f && r.max==0.f;
+		}
+		/// true if all particles of the type only rotate around the z axis
+		auto is_planar(const Particle_type& type) {
+			return is_zero(type.initial_pitch) && is_zero(type.initial_yaw)
+			    && is_zero(type.speed_pitch) && is_zero(type.speed_roll)
+			    && is_zero(type.speed_pitch_global) && is_zero(type.speed_roll_global);
 		}
 
-		auto rng = util::create_random_generator();
-
-		auto rand_val(Float_range r) {
-			return util::random_real(rng, r.min, r.max);
+		auto rand_val(Float_range r, float uniform) {
+			return r.min + (r.max-r.min)*uniform;
 		}
 	}
 
 
 	class Simple_particle_emitter : public Particle_emitter {
 		public:
-			Simple_particle_emitter(asset::Asset_manager& assets, const Particle_type& type)
-			    : Particle_emitter(type),
-			      _obj(simple_particle_vertex_layout,
-			           create_dynamic_buffer<Particle_draw>(type.max_particle_count)) {
+			Simple_particle_emitter(asset::Asset_manager& assets, const Particle_type& type, uint64_t id)
+			    : Particle_emitter(type, id),
+			      _rng(id ^ (uint64_t(type.id) << 1)) {
 
 				_texture = assets.load<Texture>(asset::AID{type.texture});
 
-				_particles_draw.reserve(type.max_particle_count * _scale);
-				_particles_sim.reserve(type.max_particle_count * _scale);
+				_particles.planar = is_planar(type);
+				_particles.each([&](auto& a) {a.reserve(type.max_particle_count * _scale);});
 			}
 
 			auto texture()const noexcept -> const Texture* override {return &*_texture;}
 
 			void update(Time dt) override {
-				INVARIANT(_particles_draw.size()==_particles_sim.size(), "Size mismatch in particle sim/draw buffer.");
-
 				if(!_last_position_set) {
 					_last_position_set = true;
 					_last_position = _position;
@@ -155,42 +186,73 @@ namespace renderer {
 
 				_dt_acc += dt;
 				auto count_scale = std::max(_scale, 0.01f);
-				auto spawn_now = util::random_int(rng,_type.emision_rate.min, _type.emision_rate.max) * count_scale;
-				_to_spawn = static_cast<decltype(_to_spawn)>(std::round(spawn_now * _dt_acc.value()));
-				_dt_acc-=Time(_to_spawn/spawn_now);
+				auto spawn_now = rand_val(_type.emision_rate, _rng.uniform()) * count_scale;
+				_to_spawn = particle_spawn_count(spawn_now, _dt_acc);
 				if(!_active) {
 					_to_spawn = 0;
 				}
 
 				_reap(dt);
-				_spawn();
+				_spawn(dt);
 
 				_simulation(dt);
 
-				if(!_particles_draw.empty())
-					_obj.buffer().set(_particles_draw);
-
 				_last_position = _position;
 			}
 
+			void reset(uint64_t id) override {
+				Particle_emitter::reset(id);
+				_rng.seed(id ^ (uint64_t(_type.id) << 1));
+				_particles.each([](auto& a) {a.clear();});
+				_to_spawn = 0;
+				_dt_acc = Time{0};
+				_last_position_set = false;
+			}
+
+			auto particle_count()const noexcept -> std::size_t override {
+				return _particles.count();
+			}
+
+			void write_vertices(Particle_draw* out)const override {
+				auto& p = _particles;
+				auto count = p.count();
+				auto frames = float(_type.animation_frames);
+
+				for(auto i=std::size_t(0); i<count; i++) {
+					auto a = 1.f - p.ttl[i]*p.inv_lifetime[i];
+					auto& d = out[i];
+					d.position       = glm::vec3(p.x[i], p.y[i], p.z[i]);
+					d.direction      = glm::vec3(p.dir_x[i], p.dir_y[i], p.dir_z[i]);
+					d.rotation       = p.rotation[i];
+					d.frames         = frames;
+					d.current_frame  = p.frame[i];
+					d.size           = p.size[i] + p.size_delta[i]*a;
+					d.alpha          = p.alpha[i] + p.alpha_delta[i]*a;
+					d.opacity        = p.opacity[i] + p.opacity_delta[i]*a;
+					d.hue_change_out = p.hue_change_out[i];
+				}
+			}
+
 			bool draw(Command& cmd)const override {
-				if(!_particles_draw.empty()) {
-					cmd.object(_obj).texture(Texture_unit::color, *_texture);
+				if(particle_count()>0) {
+					cmd.texture(Texture_unit::color, *_texture);
 					return true;
 				}
 				return false;
 			}
 
-			bool dead()const noexcept override {return !_active && _particles_draw.empty();}
+			bool dead()const noexcept override {return !_active && particle_count()==0;}
 
 		private:
+			util::Xoroshiro128 _rng;
+			std::vector<float> _random; //< scratch buffer for batches of random numbers
 			Texture_ptr _texture;
-			Object _obj;
 
-			std::vector<Particle_draw> _particles_draw;
-			std::vector<Particle_sim> _particles_sim;
+			Particle_arrays _particles;
+			std::vector<uint32_t> _dead;  //< scratch buffers of _reap()
+			std::vector<uint32_t> _moved;
 
-			int_fast32_t _to_spawn;
+			int_fast32_t _to_spawn = 0;
 			Time _dt_acc{0};
 
 			glm::vec3 _last_position;
@@ -198,132 +260,279 @@ namespace renderer {
 
 
 			void _reap(Time dt) {
-				auto to_spawn = _to_spawn;
-				auto new_end = int_fast32_t(_particles_sim.size());
-
-				for(auto i=0; i<new_end; i++) {
-					auto& curr = _particles_sim[i];
-					curr.ttl-=dt;
-					auto dead = curr.ttl<=0_s;
-
-					if(dead) {
-						if(to_spawn>0) {
-							_spawn_particle_at(i);
-							to_spawn--;
-						} else {
-							std::swap(_particles_sim[i], _particles_sim[new_end-1]);
-							std::swap(_particles_draw[i], _particles_draw[new_end-1]);
-							i--;
-							new_end--;
-						}
-					}
+				auto count = _particles.count();
+				auto ttl = _particles.ttl.data();
+				auto dt_v = dt.value();
+
+				for(auto i=std::size_t(0); i<count; i++) {
+					ttl[i] -= dt_v;
 				}
 
-				if(static_cast<std::size_t>(new_end) < _particles_sim.size()) {
-					_particles_sim.erase(_particles_sim.begin()+new_end,
-					                     _particles_sim.end());
-					_particles_draw.erase(_particles_draw.begin()+new_end,
-					                     _particles_draw.end());
+				_dead.clear();
+				for(auto i=std::size_t(0); i<count; i++) {
+					if(ttl[i]<=0.f)
+						_dead.push_back(static_cast<uint32_t>(i));
 				}
 
-				_to_spawn = to_spawn;
+				if(_dead.empty())
+					return;
+
+				// the holes in front of the new end are filled with the alive particles behind it,
+				//   so only as many particles are moved as have died (not all that follow them)
+				auto alive_count = count - _dead.size();
+				_moved.clear();
+				auto next_dead = _dead.begin();
+				for(auto i=alive_count; i<count; i++) {
+					while(next_dead!=_dead.end() && *next_dead<i)
+						++next_dead;
+					if(next_dead==_dead.end() || *next_dead!=i)
+						_moved.push_back(static_cast<uint32_t>(i));
+				}
+
+				auto holes = _dead.data();
+				auto sources = _moved.data();
+				auto moved_count = _moved.size(); //< the first moved_count entries of _dead are < alive_count
+				_particles.each([&](std::vector<float>& a) {
+					auto data = a.data();
+					for(auto i=std::size_t(0); i<moved_count; i++) {
+						data[holes[i]] = data[sources[i]];
+					}
+					a.resize(alive_count);
+				});
 			}
 
-			void _spawn() {
+			void _spawn(Time dt) {
 				using IT = decltype(_to_spawn);
 
 				auto count_scale = std::max(_scale, 0.01f);
-				auto max_spawn = static_cast<IT>(_type.max_particle_count * count_scale - _particles_sim.size());
-				_to_spawn = std::max(static_cast<IT>(0), std::min(_to_spawn, max_spawn));
+				auto max_spawn = static_cast<IT>(_type.max_particle_count * count_scale - _particles.count());
+				auto budget = static_cast<IT>(std::min<std::size_t>(_spawn_limit, std::numeric_limits<IT>::max()));
+				_to_spawn = std::max(static_cast<IT>(0), std::min({_to_spawn, max_spawn, budget}));
+
+				if(_to_spawn<=0)
+					return;
+
+				auto begin = _particles.count();
+				auto count = static_cast<std::size_t>(_to_spawn);
+				_spawn_limit -= count;
+				_particles.each([&](auto& a) {a.resize(begin + count);});
+				_spawn_particles(begin, count, dt);
+			}
 
-				for(auto i : util::range(_to_spawn)) {
-					(void)i;
+			/// fills the scratch buffer with n uniform floats per particle
+			auto _random_floats(std::size_t count, std::size_t per_particle) -> const float* {
+				_random.resize(count*per_particle);
+				_rng.fill(_random.data(), _random.size());
+				return _random.data();
+			}
 
-					_particles_sim.emplace_back();
-					_particles_draw.emplace_back();
-					_spawn_particle_at(_particles_sim.size()-1);
+			/// sets out[begin, begin+count) to values in the given range
+			void _spawn_range(std::vector<float>& out, std::size_t begin, std::size_t count, Float_range r) {
+				auto rnd = _random_floats(count, 1);
+				auto data = out.data() + begin;
+				for(auto i=std::size_t(0); i<count; i++) {
+					data[i] = rand_val(r, rnd[i]);
 				}
 			}
-			void _spawn_particle_at(int_fast32_t idx) {
-				Particle_sim& sim = _particles_sim[idx];
-				sim.ttl = sim.lifetime = rand_val(_type.lifetime) * second;
-				sim.initial_alpha = rand_val(_type.initial_alpha);
-				sim.final_alpha = rand_val(_type.final_alpha);
-				sim.initial_opacity = rand_val(_type.initial_opacity);
-				sim.final_opacity = rand_val(_type.final_opacity);
-				sim.initial_size = rand_val(_type.initial_size);
-				sim.final_size = rand_val(_type.final_size);
-				sim.initial_speed = rand_val(_type.initial_speed);
-				sim.final_speed = rand_val(_type.final_speed) ;
-
-				sim.angular_speed_local = calculate_w(
-					rand_val(_type.speed_pitch),
-					rand_val(_type.speed_yaw),
-					rand_val(_type.speed_roll)
-				);
-				sim.angular_speed_global = calculate_w(
-						rand_val(_type.speed_pitch_global),
-						rand_val(_type.speed_yaw_global),
-						rand_val(_type.speed_roll_global)
-				);
-				sim.source_direction = _direction;
-				sim.direction = glm::normalize(glm::quat(glm::vec3(
-					rand_val(_type.initial_pitch),
-					rand_val(_type.initial_yaw),
-					rand_val(_type.initial_roll)
-				)));
-				sim.linear_speed = (_position - _last_position) * _type.source_velocity_conservation;
-
-
-				Particle_draw& draw = _particles_draw[idx];
-				draw.position = glm::mix(_last_position, _position, util::random_real(rng, 0.f, 1.f))
-								+ glm::rotate(_direction, glm::vec3(
-					rand_val(_type.spawn_x) * _scale,
-					rand_val(_type.spawn_y) * _scale,
-					rand_val(_type.spawn_z)
-				));
-				draw.direction = glm::rotate(sim.direction, glm::vec3(1,0,0));
-				draw.rotation = rand_val(_type.rotation);
-				draw.frames = _type.animation_frames;
-				draw.current_frame = 0;
-				draw.size = sim.initial_size;
-				draw.alpha = sim.initial_alpha;
-				draw.opacity = sim.initial_opacity;
-				draw.hue_change_out = _hue_out / (360_deg).value();
+			void _spawn_range(std::vector<float>& initial, std::vector<float>& delta,
+			                  std::size_t begin, std::size_t count,
+			                  Float_range initial_r, Float_range final_r) {
+				_spawn_range(initial, begin, count, initial_r);
+				_spawn_range(delta, begin, count, final_r);
+				for(auto i=begin; i<begin+count; i++) {
+					delta[i] -= initial[i];
+				}
 			}
 
-			void _simulation(Time dt) {
-				for(std::size_t i=0; i<_particles_sim.size(); i++) {
-					Particle_sim& curr_sim = _particles_sim[i];
-					Particle_draw& curr_draw = _particles_draw[i];
+			/// initializes the particles [begin, begin+count), field by field
+			void _spawn_particles(std::size_t begin, std::size_t count, Time dt) {
+				auto& p = _particles;
+				auto end = begin + count;
 
-					auto a = 1.f - curr_sim.ttl/curr_sim.lifetime;
+				_spawn_range(p.ttl, begin, count, _type.lifetime);
+				for(auto i=begin; i<end; i++) {
+					p.inv_lifetime[i] = 1.f / p.ttl[i];
+				}
 
-					curr_draw.alpha = glm::mix(curr_sim.initial_alpha, curr_sim.final_alpha, a);
-					curr_draw.opacity = glm::mix(curr_sim.initial_opacity, curr_sim.final_opacity, a);
-					curr_draw.size = glm::mix(curr_sim.initial_size, curr_sim.final_size, a);
+				_spawn_range(p.alpha, p.alpha_delta, begin, count, _type.initial_alpha, _type.final_alpha);
+				_spawn_range(p.opacity, p.opacity_delta, begin, count, _type.initial_opacity, _type.final_opacity);
+				_spawn_range(p.size, p.size_delta, begin, count, _type.initial_size, _type.final_size);
+				_spawn_range(p.speed, p.speed_delta, begin, count, _type.initial_speed, _type.final_speed);
+				_spawn_range(p.rotation, begin, count, _type.rotation);
+
+				auto rnd = _random_floats(count, 4);
+				for(auto i=begin; i<end; i++, rnd+=4) {
+					auto position = glm::mix(_last_position, _position, rnd[0])
+					                + glm::rotate(_direction, glm::vec3(
+					                      rand_val(_type.spawn_x, rnd[1]) * _scale,
+					                      rand_val(_type.spawn_y, rnd[2]) * _scale,
+					                      rand_val(_type.spawn_z, rnd[3])
+					                  ));
+					p.x[i] = position.x;
+					p.y[i] = position.y;
+					p.z[i] = position.z;
+				}
 
-					if(_type.fps<0) {
-						curr_draw.current_frame = (curr_draw.frames-1.0)*a;
-					} else {
-						auto next_frame = curr_draw.current_frame + _type.fps*dt.value();
-						curr_draw.current_frame = std::fmod(next_frame, curr_draw.frames);
+				// distance the emitter moved per reference frame
+				auto frames = dt.value()*reference_fps;
+				auto velocity = frames<=0.f ? glm::vec3(0,0,0)
+				                            : (_position - _last_position) / frames * _type.source_velocity_conservation;
+				auto hue_change_out = _hue_out / (360_deg).value();
+				std::fill(p.velocity_x.begin()+begin, p.velocity_x.end(), velocity.x);
+				std::fill(p.velocity_y.begin()+begin, p.velocity_y.end(), velocity.y);
+				std::fill(p.velocity_z.begin()+begin, p.velocity_z.end(), velocity.z);
+				std::fill(p.frame.begin()+begin, p.frame.end(), 0.f);
+				std::fill(p.hue_change_out.begin()+begin, p.hue_change_out.end(), hue_change_out);
+
+				if(p.planar) {
+					// angular speeds are (roll, pitch, yaw) and the initial direction is (pitch, yaw, roll)
+					_spawn_range(p.angle, begin, count, _type.initial_roll);
+					_spawn_range(p.angular_speed, begin, count, _type.speed_yaw);
+
+					rnd = _random_floats(count, 1);
+					for(auto i=begin; i<end; i++) {
+						p.angular_speed[i] += rand_val(_type.speed_yaw_global, *rnd++);
 					}
 
-					auto speed = glm::mix(curr_sim.initial_speed, curr_sim.final_speed, a);
+					auto u = glm::rotate(_direction, glm::vec3(1,0,0));
+					auto v = glm::rotate(_direction, glm::vec3(0,1,0));
+					std::fill(p.plane_u_x.begin()+begin, p.plane_u_x.end(), u.x);
+					std::fill(p.plane_u_y.begin()+begin, p.plane_u_y.end(), u.y);
+					std::fill(p.plane_u_z.begin()+begin, p.plane_u_z.end(), u.z);
+					std::fill(p.plane_v_x.begin()+begin, p.plane_v_x.end(), v.x);
+					std::fill(p.plane_v_y.begin()+begin, p.plane_v_y.end(), v.y);
+					std::fill(p.plane_v_z.begin()+begin, p.plane_v_z.end(), v.z);
+
+				} else {
+					rnd = _random_floats(count, 3);
+					for(auto i=begin; i<end; i++, rnd+=3) {
+						auto q = glm::normalize(glm::quat(glm::vec3(
+							rand_val(_type.initial_pitch, rnd[0]),
+							rand_val(_type.initial_yaw, rnd[1]),
+							rand_val(_type.initial_roll, rnd[2])
+						)));
+						p.q_w[i] = q.w;
+						p.q_x[i] = q.x;
+						p.q_y[i] = q.y;
+						p.q_z[i] = q.z;
+					}
 
-					auto& q = curr_sim.direction;
-					q = glm::normalize(q + dt.value()*0.5f * q * curr_sim.angular_speed_local);
-					q = glm::normalize(q + dt.value()*0.5f * curr_sim.angular_speed_global * q);
+					_spawn_range(p.w_local_x, begin, count, _type.speed_roll);
+					_spawn_range(p.w_local_y, begin, count, _type.speed_pitch);
+					_spawn_range(p.w_local_z, begin, count, _type.speed_yaw);
+					_spawn_range(p.w_global_x, begin, count, _type.speed_roll_global);
+					_spawn_range(p.w_global_y, begin, count, _type.speed_pitch_global);
+					_spawn_range(p.w_global_z, begin, count, _type.speed_yaw_global);
+
+					std::fill(p.source_w.begin()+begin, p.source_w.end(), _direction.w);
+					std::fill(p.source_x.begin()+begin, p.source_x.end(), _direction.x);
+					std::fill(p.source_y.begin()+begin, p.source_y.end(), _direction.y);
+					std::fill(p.source_z.begin()+begin, p.source_z.end(), _direction.z);
+				}
+				// dir_x/y/z are calculated by the _simulation() that follows every spawn
+			}
 
-					// TODO: attractors
+			void _simulation(Time dt) {
+				auto& p = _particles;
+				auto count = p.count();
+				auto dt_v = dt.value();
+
+				if(_type.fps<0) {
+					auto last_frame = _type.animation_frames - 1.f;
+					for(auto i=std::size_t(0); i<count; i++) {
+						p.frame[i] = last_frame * (1.f - p.ttl[i]*p.inv_lifetime[i]);
+					}
+				} else {
+					auto frames = float(_type.animation_frames);
+					auto step = _type.fps*dt_v;
+					for(auto i=std::size_t(0); i<count; i++) {
+						auto next = p.frame[i] + step;
+						p.frame[i] = next - std::floor(next/frames)*frames;
+					}
+				}
 
-					auto final_direction = glm::normalize(curr_sim.source_direction * q);
-					auto dir = glm::rotate(final_direction, glm::vec3(1,0,0));
-					curr_draw.position += dir * speed;
-					curr_draw.position += curr_sim.linear_speed;
+				if(p.planar) {
+					_simulate_planar(dt_v);
+				} else {
+					_simulate_spatial(dt_v);
+				}
 
-					curr_draw.direction = dir;
+				// TODO: attractors
+
+				auto x = p.x.data(),  y = p.y.data(),  z = p.z.data();
+				auto dx = p.dir_x.data(), dy = p.dir_y.data(), dz = p.dir_z.data();
+				auto vx = p.velocity_x.data(), vy = p.velocity_y.data(), vz = p.velocity_z.data();
+				auto speed = p.speed.data(), speed_delta = p.speed_delta.data();
+				auto ttl = p.ttl.data(), inv_lifetime = p.inv_lifetime.data();
+
+				// speeds are per reference frame, so the result doesn't depend on the update rate
+				auto frames = dt_v*reference_fps;
+				for(auto i=std::size_t(0); i<count; i++) {
+					auto s = speed[i] + speed_delta[i]*(1.f - ttl[i]*inv_lifetime[i]);
+					x[i] += (dx[i]*s + vx[i]) * frames;
+					y[i] += (dy[i]*s + vy[i]) * frames;
+					z[i] += (dz[i]*s + vz[i]) * frames;
+				}
+			}
+			void _simulate_planar(float dt) {
+				auto& p = _particles;
+				auto count = p.count();
+				auto angle = p.angle.data();
+				auto angular_speed = p.angular_speed.data();
+
+				for(auto i=std::size_t(0); i<count; i++) {
+					angle[i] += angular_speed[i]*dt;
+				}
+
+				for(auto i=std::size_t(0); i<count; i++) {
+					auto c = std::cos(angle[i]);
+					auto s = std::sin(angle[i]);
+					p.dir_x[i] = c*p.plane_u_x[i] + s*p.plane_v_x[i];
+					p.dir_y[i] = c*p.plane_u_y[i] + s*p.plane_v_y[i];
+					p.dir_z[i] = c*p.plane_u_z[i] + s*p.plane_v_z[i];
+				}
+			}
+			void _simulate_spatial(float dt) {
+				auto& p = _particles;
+				auto count = p.count();
+				auto h = dt*0.5f;
+
+				for(auto i=std::size_t(0); i<count; i++) {
+					auto qw = p.q_w[i], qx = p.q_x[i], qy = p.q_y[i], qz = p.q_z[i];
+
+					// q = normalize(q + dt/2 * q * w_local)
+					auto lx = p.w_local_x[i], ly = p.w_local_y[i], lz = p.w_local_z[i];
+					auto nw = qw + h*(-qx*lx - qy*ly - qz*lz);
+					auto nx = qx + h*( qw*lx + qy*lz - qz*ly);
+					auto ny = qy + h*( qw*ly + qz*lx - qx*lz);
+					auto nz = qz + h*( qw*lz + qx*ly - qy*lx);
+					auto inv_len = 1.f / std::sqrt(nw*nw + nx*nx + ny*ny + nz*nz);
+					qw = nw*inv_len; qx = nx*inv_len; qy = ny*inv_len; qz = nz*inv_len;
+
+					// q = normalize(q + dt/2 * w_global * q)
+					auto gx = p.w_global_x[i], gy = p.w_global_y[i], gz = p.w_global_z[i];
+					nw = qw + h*(-gx*qx - gy*qy - gz*qz);
+					nx = qx + h*( gx*qw + gy*qz - gz*qy);
+					ny = qy + h*( gy*qw + gz*qx - gx*qz);
+					nz = qz + h*( gz*qw + gx*qy - gy*qx);
+					inv_len = 1.f / std::sqrt(nw*nw + nx*nx + ny*ny + nz*nz);
+					qw = nw*inv_len; qx = nx*inv_len; qy = ny*inv_len; qz = nz*inv_len;
+
+					p.q_w[i] = qw; p.q_x[i] = qx; p.q_y[i] = qy; p.q_z[i] = qz;
+
+					// f = normalize(source * q)
+					auto sw = p.source_w[i], sx = p.source_x[i], sy = p.source_y[i], sz = p.source_z[i];
+					auto fw = sw*qw - sx*qx - sy*qy - sz*qz;
+					auto fx = sw*qx + sx*qw + sy*qz - sz*qy;
+					auto fy = sw*qy - sx*qz + sy*qw + sz*qx;
+					auto fz = sw*qz + sx*qy - sy*qx + sz*qw;
+					inv_len = 1.f / std::sqrt(fw*fw + fx*fx + fy*fy + fz*fz);
+					fw*=inv_len; fx*=inv_len; fy*=inv_len; fz*=inv_len;
+
+					// rotate((1,0,0), f)
+					p.dir_x[i] = 1.f - 2.f*(fy*fy + fz*fz);
+					p.dir_y[i] = 2.f*(fx*fy + fw*fz);
+					p.dir_z[i] = 2.f*(fx*fz - fw*fy);
 				}
 			}
 	};
@@ -339,7 +548,8 @@ namespace renderer {
 		e.direction(euler_angles);
 	}
 
-	Particle_renderer::Particle_renderer(asset::Asset_manager& assets) {
+	Particle_renderer::Particle_renderer(asset::Asset_manager& assets, util::Thread_pool& threads)
+	    : _threads(threads), _vertices(simple_particle_vertex_layout, create_dynamic_buffer<Particle_draw>(1024)) {
 		_simple_shader.attach_shader(assets.load<Shader>("vert_shader:particles"_aid))
 		              .attach_shader(assets.load<Shader>("frag_shader:particles"_aid))
 		              .bind_all_attribute_locations(simple_particle_vertex_layout)
@@ -359,6 +569,47 @@ namespace renderer {
 		}
 	}
 
+	auto particle_lod(const Particle_lod_settings& s, float distance) -> Particle_lod {
+		if(distance<s.full_rate_distance)
+			return Particle_lod::full;
+		else if(distance<s.frozen_distance)
+			return Particle_lod::reduced;
+		else
+			return Particle_lod::frozen;
+	}
+
+	auto particle_spawn_limit(std::size_t remaining, float weight, float weight_sum) -> std::size_t {
+		if(weight_sum<=0.f || weight<=0.f)
+			return 0;
+
+		return static_cast<std::size_t>(std::floor(remaining * std::min(1.f, weight/weight_sum)));
+	}
+
+	auto particle_spawn_count(float rate, Time& accumulated) -> int {
+		if(rate<=0.f) {
+			// nothing is spawned, so there is also no remainder to carry over
+			accumulated = Time{0};
+			return 0;
+		}
+
+		auto count = static_cast<int>(std::round(rate * accumulated.value()));
+		accumulated -= Time(count/rate);
+		return count;
+	}
+
+	void Particle_emitter::reset(uint64_t id) {
+		_id = id;
+		_spawn_limit = ~std::size_t(0);
+		_released = false;
+		_lod_pending = Time{0};
+		_lod_skipped = 0;
+		_position = glm::vec3();
+		_direction = glm::quat();
+		_scale = 1.f;
+		_active = true;
+		_hue_out = Angle::from_degrees(300);
+	}
+
 	auto Particle_renderer::create_emiter(Particle_type_id id) -> Particle_emitter_ptr {
 		auto iter = _types.find(id);
 		if(iter==_types.end()) {
@@ -366,46 +617,195 @@ namespace renderer {
 			iter = _types.begin();
 		}
 
-		auto emiter = Particle_emitter_ptr{};
+		auto emiter = Emitter_ref{};
+
+		auto& unused = _unused_emitters[iter->first];
+		if(!unused.empty()) {
+			emiter = std::move(unused.back());
+			unused.pop_back();
+			emiter->reset(_next_emitter_id++);
 
-		if(iter->second->physics_simulation) {
+		} else if(iter->second->physics_simulation) {
 			FAIL("NOT IMPLEMENTED, YET!");
 		} else {
-			emiter = std::make_shared<Simple_particle_emitter>(iter->second.mgr(), *iter->second);
+			emiter = std::make_shared<Simple_particle_emitter>(iter->second.mgr(), *iter->second,
+			                                                   _next_emitter_id++);
 		}
 
 		_emitters.emplace_back(emiter);
 
-		return emiter;
+		return Particle_emitter_ptr{std::move(emiter)};
 	}
 
 	void Particle_renderer::update(Time dt) {
+		_plan_update(dt, true);
+		_simulate();
+		_recycle_dead();
+		_upload();
+	}
+	void Particle_renderer::warmup(Time duration) {
+		_plan_update(duration, false);
+		_simulate();
+		_recycle_dead();
+		_upload();
+	}
+
+	void Particle_renderer::_plan_update(Time dt, bool lod) {
+		auto spawn_weight = [](const Particle_emitter& e) {
+			return e.active() ? e._type.emision_rate.max * std::max(e._scale, 0.01f) : 0.f;
+		};
+
+		// divide the unused particle budget between the emitters, based on their emission rate
+		auto budget = _lod_settings.particle_budget;
+		auto remaining = budget>_particle_count ? budget-_particle_count : std::size_t(0);
+		auto weight_sum = 0.f;
 		for(auto& e : _emitters) {
-			if(e.use_count()<=1) {
-				e->disable();
+			weight_sum += spawn_weight(*e);
+		}
+
+		_emitter_dt.resize(_emitters.size());
+
+		for(auto i : util::range(_emitters.size())) {
+			auto& e = *_emitters[i];
+			e.spawn_limit(particle_spawn_limit(remaining, spawn_weight(e), weight_sum));
+
+			// inactive emitters are always updated, so they can die
+			auto level = Particle_lod::full;
+			if(lod && _lod_center_set && e.active()) {
+				level = particle_lod(_lod_settings, glm::length(glm::vec2(e._position) - _lod_center));
+			}
+
+			// particles only live for lifetime.max, so simulating more than that can be skipped
+			auto max_pending = Time(std::max(e._type.lifetime.max, dt.value()));
+			e._lod_pending = std::min(e._lod_pending + dt, max_pending);
+
+			// number of frames since the last update, that are simulated now
+			auto frames = 0;
+			switch(level) {
+				case Particle_lod::full:
+					frames = 1;
+					break;
+
+				case Particle_lod::reduced:
+					if(++e._lod_skipped >= _lod_settings.reduced_rate)
+						frames = e._lod_skipped;
+					break;
+
+				case Particle_lod::frozen:
+					break;
+			}
+
+			// anything that is pending beyond the skipped frames (i.e. after the emitter was frozen)
+			//   is caught up over the next updates, so unfreezing many emitters doesn't stall a frame
+			auto& emitter_dt = _emitter_dt[i];
+			emitter_dt = Time{0};
+			if(frames>0) {
+				auto max_dt = dt*float(frames) + Time(_lod_settings.max_catch_up);
+				emitter_dt = lod ? std::min(e._lod_pending, max_dt) : e._lod_pending;
+				e._lod_pending -= emitter_dt;
+				e._lod_skipped = 0;
 			}
-			e->update(dt);
 		}
+	}
 
-		_emitters.erase(std::remove_if(_emitters.begin(),_emitters.end(), [](auto& e){return e->dead();}), _emitters.end());
+	void Particle_renderer::_simulate() {
+		// emitters are independent of each other, so each thread can run all steps of its emitters
+		_threads.parallel_for(_emitters.size(), min_emitters_per_thread, [&](auto begin, auto end, auto) {
+			for(auto i=begin; i<end; i++) {
+				auto remaining = _emitter_dt[i];
+				while(remaining>Time{0}) {
+					auto step = std::min(remaining, Time(max_step));
+					_emitters[i]->update(step);
+					remaining -= step;
+				}
+			}
+		});
 	}
-	void Particle_renderer::draw(Command_queue& queue)const {
+
+	void Particle_renderer::_recycle_dead() {
 		for(auto& e : _emitters) {
-			auto cmd = create_command().shader(_simple_shader)
-					.require_not(Gl_option::depth_write)
-					.require(Gl_option::depth_test)
-					.require(Gl_option::blend)
-					.order_dependent();
+			if(!e->dead() || !e->_released)
+				continue;
+
+			auto& unused = _unused_emitters[e->type()];
+			if(unused.size()<max_unused_emitters)
+				unused.emplace_back(std::move(e));
+			else
+				e.reset();
+		}
+
+		_emitters.erase(std::remove(_emitters.begin(), _emitters.end(), nullptr), _emitters.end());
+	}
 
-			cmd.uniforms().emplace("hue_change_in", e->hue_change_in() / (360_deg).value());
+	void Particle_renderer::_upload() {
+		_ranges.resize(_emitters.size());
 
-			if(e->draw(cmd))
-				queue.push_back(cmd);
+		auto offset = 0;
+		for(auto i : util::range(_emitters.size())) {
+			auto count = static_cast<int>(_emitters[i]->particle_count());
+			_ranges[i] = Vertex_range{offset, count};
+			offset += count;
 		}
+
+		_particle_count = static_cast<std::size_t>(offset);
+		_staging.resize(_particle_count);
+
+		_threads.parallel_for(_emitters.size(), min_emitters_per_thread, [&](auto begin, auto end, auto) {
+			for(auto i=begin; i<end; i++) {
+				_emitters[i]->write_vertices(_staging.data() + _ranges[i].offset);
+			}
+		});
+
+		if(!_staging.empty())
+			_vertices.buffer().set(_staging);
+	}
+
+	void Particle_renderer::draw(Command_queue& queue)const {
+		// buffer 0 is left to the caller, the ranges are recorded into the following
+		//   buffers, so the emitters are still drawn in order after everything before
+		queue.reserve_buffers(_threads.size()+1);
+
+		// emitters created since the last update() are at the end and have nothing to draw, yet
+		_threads.parallel_for(std::min(_ranges.size(), _emitters.size()), min_emitters_per_thread,
+		                      [&](auto begin, auto end, auto batch) {
+			auto& buffer = queue.buffer(batch+1);
+
+			for(auto i=begin; i<end; ++i) {
+				auto& e = _emitters[i];
+				auto& range = _ranges[i];
+				if(range.count<=0)
+					continue;
+
+				auto cmd = create_command().shader(_simple_shader)
+						.object(_vertices, range.offset, range.count)
+						.require_not(Gl_option::depth_write)
+						.require(Gl_option::depth_test)
+						.require(Gl_option::blend)
+						.order_dependent();
+
+				cmd.uniforms().emplace("hue_change_in", e->hue_change_in() / (360_deg).value());
+
+				if(e->draw(cmd))
+					buffer.push_back(cmd);
+			}
+		});
 	}
 
 	void Particle_renderer::clear() {
-		_emitters.clear();
+		for(auto& e : _emitters) {
+			if(!e->_released)
+				continue;
+
+			auto& unused = _unused_emitters[e->type()];
+			if(unused.size()<max_unused_emitters)
+				unused.emplace_back(std::move(e));
+			else
+				e.reset();
+		}
+
+		_emitters.erase(std::remove(_emitters.begin(), _emitters.end(), nullptr), _emitters.end());
+		_ranges.clear();
+		_particle_count = 0;
 	}
 
 }
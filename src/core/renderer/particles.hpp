@@ -11,6 +11,7 @@
 #include "shader.hpp"
 
 #include "../units.hpp"
+#include "../utils/thread_pool.hpp"
 
 
 namespace lux {
@@ -83,10 +84,48 @@ namespace renderer {
 	};
 	using Particle_type_ptr = asset::Ptr<Particle_type>;
 
+	/// vertex of a single particle, as uploaded to the GPU
+	struct Particle_draw {
+		glm::vec3 position;
+		glm::vec3 direction;
+		float rotation;
+		float frames;
+		float current_frame;
+		float size;
+
+		float alpha;
+		float opacity;
+		float hue_change_out;
+	};
+
+	/*
+	 * Controls how much time is spent on emitters far away from the camera
+	 *   and how many particles may exist at the same time.
+	 */
+	struct Particle_lod_settings {
+		float full_rate_distance = 20.f; //< closer emitters are updated every frame
+		float frozen_distance = 50.f;    //< further emitters are not updated at all
+		int reduced_rate = 4;            //< emitters in between are updated every n-th frame
+		float max_catch_up = 0.1f;       //< seconds an unfrozen emitter may simulate per update, in addition to dt
+		std::size_t particle_budget = 20000;
+	};
+
+	enum class Particle_lod {
+		full, reduced, frozen
+	};
+	extern auto particle_lod(const Particle_lod_settings&, float distance) -> Particle_lod;
+
+	/// the part of 'remaining' (unused budget) emitter 'i' may spawn, based on its share of 'weights'
+	extern auto particle_spawn_limit(std::size_t remaining, float weight, float weight_sum) -> std::size_t;
+
+	/// particles to spawn at 'rate' per second in the 'accumulated' time; removes the spawned part from it
+	extern auto particle_spawn_count(float rate, Time& accumulated) -> int;
+
+
 	class Particle_emitter {
 	public:
-		Particle_emitter(const Particle_type& type)
-				: _type(type) {}
+		Particle_emitter(const Particle_type& type, uint64_t id)
+				: _type(type), _id(id) {}
 		virtual ~Particle_emitter() = default;
 
 		void position(glm::vec3 position) {
@@ -104,42 +143,158 @@ namespace renderer {
 		}
 
 		auto type()const noexcept {return _type.id;}
+		/// unique per Particle_renderer and assigned in creation order
+		auto id()const noexcept {return _id;}
 		virtual auto texture()const noexcept -> const Texture* = 0;
+
+		/// advances the simulation; may be called in parallel for different emitters
 		virtual void update(Time dt) = 0;
+		virtual auto particle_count()const noexcept -> std::size_t = 0;
+		/// writes particle_count() vertices to 'out'; may be called in parallel for different emitters
+		virtual void write_vertices(Particle_draw* out)const = 0;
+		/// sets everything except the object, returns false if there is nothing to draw
 		virtual bool draw(Command& cmd)const = 0;
 		virtual void disable() {_active = false;}
 		virtual bool dead()const noexcept {return !_active;}
 		auto hue_change_in()const noexcept {return _type.hue_change_in;}
 		auto hue_change_out()const noexcept {return _hue_out;}
+		auto active()const noexcept {return _active;}
+
+		/// upper bound for the number of particles spawned by the next update() calls
+		void spawn_limit(std::size_t limit) {_spawn_limit = limit;}
+
+		/// returns the emitter to its initial state but keeps its allocated memory
+		virtual void reset(uint64_t id);
 
 	protected:
+		friend class Particle_renderer;
+		friend class Particle_emitter_ptr;
+
 		const Particle_type& _type;
+		uint64_t _id;
+		std::size_t _spawn_limit = ~std::size_t(0);
+		bool _released = false; //< the handle has been destroyed, so it can be recycled once it's dead
+
+		// state of the Particle_renderer::update() LOD
+		Time _lod_pending {0}; //< time that has not been simulated, yet
+		int  _lod_skipped = 0;
 
 		glm::vec3 _position;
 		glm::quat _direction;
 		float _scale = 1.f;
 		bool _active = true;
 		Angle _hue_out = Angle::from_degrees(300);
+
+		void _release() {
+			disable();
+			_released = true;
+		}
+	};
+
+	/*
+	 * Unique handle to an emitter created by Particle_renderer::create_emiter().
+	 * Destroying or resetting the handle releases the emitter: it is disabled
+	 *   and returned to the pool of the renderer, once its last particle died.
+	 * The renderer only checks the explicit release and not the reference
+	 *   count, which just keeps the emitter alive if the handle outlives the renderer.
+	 */
+	class Particle_emitter_ptr {
+		public:
+			Particle_emitter_ptr() = default;
+			Particle_emitter_ptr(Particle_emitter_ptr&&)noexcept = default;
+			Particle_emitter_ptr& operator=(Particle_emitter_ptr&& rhs)noexcept {
+				if(this!=&rhs) {
+					reset();
+					_emitter = std::move(rhs._emitter);
+				}
+				return *this;
+			}
+			~Particle_emitter_ptr() {reset();}
+
+			void reset()noexcept {
+				if(_emitter) {
+					_emitter->_release();
+					_emitter.reset();
+				}
+			}
+
+			auto get()const noexcept {return _emitter.get();}
+			auto operator->()const noexcept {return _emitter.get();}
+			auto operator*()const noexcept -> Particle_emitter& {return *_emitter;}
+			explicit operator bool()const noexcept {return static_cast<bool>(_emitter);}
+
+			bool operator==(const Particle_emitter_ptr& rhs)const noexcept {return _emitter==rhs._emitter;}
+			bool operator!=(const Particle_emitter_ptr& rhs)const noexcept {return _emitter!=rhs._emitter;}
+
+		private:
+			friend class Particle_renderer;
+
+			std::shared_ptr<Particle_emitter> _emitter;
+
+			explicit Particle_emitter_ptr(std::shared_ptr<Particle_emitter> e) : _emitter(std::move(e)) {}
 	};
-	using Particle_emitter_ptr = std::shared_ptr<Particle_emitter>;
 
 
 	class Particle_renderer {
 		public:
-			Particle_renderer(asset::Asset_manager& assets);
+			/// the emitters are simulated and uploaded in parallel on 'threads'
+			Particle_renderer(asset::Asset_manager& assets,
+			                  util::Thread_pool& threads=util::default_thread_pool());
 
+			/// reuses emitters (and their memory) of the same type that are dead and released
 			auto create_emiter(Particle_type_id) -> Particle_emitter_ptr;
 
+			void lod_settings(const Particle_lod_settings& s) {_lod_settings = s;}
+			auto lod_settings()const noexcept -> auto& {return _lod_settings;}
+			/// position the distance for the LOD is measured from (e.g. the camera)
+			void lod_center(glm::vec2 center) {_lod_center = center; _lod_center_set = true;}
+
+			/*
+			 * Simulates all emitters in parallel on the thread pool and
+			 *   uploads the vertices of all emitters in one buffer.
+			 * Emitters far from the lod_center() are updated less often or frozen
+			 *   and fast-forwarded, once they come closer again. The fast-forward
+			 *   is spread over multiple updates (see max_catch_up).
+			 */
 			void update(Time dt);
+			/// simulates 'duration' without LOD and uploading intermediate results
+			void warmup(Time duration);
 			void draw(Command_queue&)const;
 
+			/// removes all released emitters, the ones that are still referenced by a handle are kept
 			void clear();
 
 		private:
+			/// part of _vertices that belongs to the emitter with the same index
+			struct Vertex_range {
+				int offset;
+				int count;
+			};
+
+			using Emitter_ref = std::shared_ptr<Particle_emitter>;
+
+			util::Thread_pool& _threads;
 			std::unordered_map<Particle_type_id, Particle_type_ptr> _types;
-			std::vector<Particle_emitter_ptr> _emitters;
+			std::vector<Emitter_ref> _emitters;
+			std::unordered_map<Particle_type_id, std::vector<Emitter_ref>> _unused_emitters;
+			uint64_t _next_emitter_id = 0;
+
+			Particle_lod_settings _lod_settings;
+			glm::vec2 _lod_center;
+			bool _lod_center_set = false;
+			std::size_t _particle_count = 0;
+			std::vector<Time> _emitter_dt; //< time each emitter is simulated in this update
+
+			std::vector<Particle_draw> _staging;
+			std::vector<Vertex_range> _ranges;
+			Object _vertices;
 
 			mutable Shader_program _simple_shader;
+
+			void _plan_update(Time dt, bool lod);
+			void _simulate();
+			void _recycle_dead();
+			void _upload();
 	};
 
 }
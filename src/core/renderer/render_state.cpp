@@ -0,0 +1,114 @@
+#include "gl.hpp"
+
+#include "render_state.hpp"
+
+#include "../utils/log.hpp"
+
+
+namespace lux {
+namespace renderer {
+
+	namespace {
+		GLenum option_to_gl(Gl_option option) {
+			switch(option) {
+				case Gl_option::blend:       return GL_BLEND;
+				case Gl_option::depth_test:  return GL_DEPTH_TEST;
+				default: FAIL("Unsupported Gl_option");
+				return 0;
+			}
+		}
+	}
+
+	auto render_state() -> Render_state& {
+		static Render_state state;
+		return state;
+	}
+
+	void Render_state::program(unsigned int handle) {
+		if(_program==handle) {
+			_current.skipped_changes++;
+			return;
+		}
+
+		glUseProgram(handle);
+		_program = handle;
+		_current.program_binds++;
+	}
+
+	void Render_state::texture(int unit, unsigned int target, unsigned int handle) {
+		INVARIANT(unit>=0 && unit<max_texture_units, "to many textures");
+
+		auto& binding = _textures[unit];
+		if(binding.handle==handle && binding.target==target) {
+			_current.skipped_changes++;
+			return;
+		}
+
+		if(_active_unit!=unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			_active_unit = unit;
+		}
+
+		glBindTexture(target, handle);
+		binding.target = target;
+		binding.handle = handle;
+		_current.texture_binds++;
+	}
+
+	void Render_state::gl_options(Gl_options options) {
+		option(Gl_option::blend,       options & Gl_option::blend);
+		option(Gl_option::depth_test,  options & Gl_option::depth_test);
+		option(Gl_option::depth_write, options & Gl_option::depth_write);
+	}
+
+	void Render_state::option(Gl_option option, bool enabled) {
+		auto mask = static_cast<Gl_options>(option);
+
+		if((_known_gl_options & option) && (_gl_options & option)==enabled) {
+			_current.skipped_changes++;
+			return;
+		}
+
+		if(option==Gl_option::depth_write) {
+			glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+
+		} else if(enabled) {
+			glEnable(option_to_gl(option));
+
+		} else {
+			glDisable(option_to_gl(option));
+		}
+
+		_known_gl_options |= mask;
+		_gl_options = enabled ? (_gl_options | mask) : (_gl_options & ~mask);
+		_current.state_changes++;
+	}
+
+	void Render_state::invalidate()noexcept {
+		_program = unknown;
+		_known_gl_options = 0;
+		invalidate_textures();
+	}
+	void Render_state::invalidate_textures()noexcept {
+		_active_unit = -1;
+		_textures.fill(Texture_binding{});
+	}
+
+	void Render_state::on_delete_program(unsigned int handle)noexcept {
+		if(_program==handle)
+			_program = unknown;
+	}
+	void Render_state::on_delete_texture(unsigned int handle)noexcept {
+		for(auto& binding : _textures) {
+			if(binding.handle==handle)
+				binding = Texture_binding{};
+		}
+	}
+
+	void Render_state::end_frame()noexcept {
+		_last_frame = _current;
+		_current = Render_stats{};
+	}
+
+}
+}
@@ -0,0 +1,108 @@
+/** cache of the bound OpenGL state to skip redundant changes ****************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <array>
+
+
+namespace lux {
+namespace renderer {
+
+	enum class Gl_option : unsigned int {
+		blend       = 0b001,
+		depth_test  = 0b010,
+		depth_write = 0b100
+	};
+	using Gl_options = unsigned int;
+
+	constexpr Gl_options operator|(Gl_option lhs, Gl_option rhs)noexcept {
+		return static_cast<Gl_options>(lhs) | static_cast<Gl_options>(rhs);
+	}
+	constexpr Gl_options operator|(Gl_options lhs, Gl_option rhs)noexcept {
+		return lhs | static_cast<Gl_options>(rhs);
+	}
+	constexpr bool operator&(Gl_options lhs, Gl_option rhs)noexcept {
+		return lhs & static_cast<Gl_options>(rhs);
+	}
+
+	constexpr auto default_gl_options = Gl_option::blend|Gl_option::depth_test|Gl_option::depth_write;
+
+
+	struct Render_stats {
+		int draw_calls = 0;
+		int state_changes = 0;   //< blend/depth options
+		int program_binds = 0;
+		int texture_binds = 0;
+		int uniform_uploads = 0;
+		int skipped_changes = 0; //< redundant changes that never reached OpenGL
+		int text_cache_hits = 0;
+		int text_cache_misses = 0;
+		int texture_uploads = 0;
+		std::size_t texture_upload_bytes = 0;
+	};
+
+	/*
+	 * Tracks the bound program, the textures per unit and the blend/depth
+	 *   options, so that only calls that change anything reach OpenGL.
+	 * All code that modifies this state has to go through here or call
+	 *   invalidate() afterwards (e.g. third party libraries like SOIL).
+	 */
+	class Render_state {
+		public:
+			static constexpr auto max_texture_units = 16;
+
+			void program(unsigned int handle);
+			void texture(int unit, unsigned int target, unsigned int handle);
+			void gl_options(Gl_options options);
+			void option(Gl_option option, bool enabled);
+
+			void count_draw_call()noexcept {_current.draw_calls++;}
+			void count_uniform_upload()noexcept {_current.uniform_uploads++;}
+			void count_texture_upload(std::size_t bytes)noexcept {
+				_current.texture_uploads++;
+				_current.texture_upload_bytes += bytes;
+			}
+			void count_text_cache(bool hit)noexcept {
+				if(hit) _current.text_cache_hits++;
+				else    _current.text_cache_misses++;
+			}
+
+			/// forget everything we know about the current state
+			void invalidate()noexcept;
+			void invalidate_textures()noexcept;
+
+			/// deleted handles may be reused by the driver, so they can't stay in the cache
+			void on_delete_program(unsigned int handle)noexcept;
+			void on_delete_texture(unsigned int handle)noexcept;
+
+			void end_frame()noexcept;
+			auto stats()const noexcept -> const Render_stats& {return _current;}
+			auto last_frame_stats()const noexcept -> const Render_stats& {return _last_frame;}
+
+		private:
+			static constexpr auto unknown = ~0u;
+
+			struct Texture_binding {
+				unsigned int target = unknown;
+				unsigned int handle = unknown;
+			};
+
+			unsigned int _program = unknown;
+			int _active_unit = -1;
+			std::array<Texture_binding, max_texture_units> _textures;
+			Gl_options _gl_options = 0;
+			Gl_options _known_gl_options = 0; //< mask of the options whose state we know
+
+			Render_stats _current;
+			Render_stats _last_frame;
+	};
+
+	extern auto render_state() -> Render_state&;
+
+}
+}
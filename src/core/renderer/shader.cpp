@@ -1,21 +1,19 @@
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include "gl.hpp"
 
 #include "shader.hpp"
 
 #include "vertex_object.hpp"
 
 #include "uniform_map.hpp"
+#include "render_state.hpp"
 
 #include "../utils/string_utils.hpp"
 #include "../utils/log.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstring>
+
 
 namespace lux {
 namespace renderer {
@@ -131,6 +129,7 @@ namespace renderer {
 	}
 	Shader_program::Prog_handle::~Prog_handle() {
 		if(v!=0) {
+			render_state().on_delete_program(v);
 			glDeleteProgram(v);
 		}
 	}
@@ -189,19 +188,16 @@ namespace renderer {
 			glDetachShader(_handle, s->_handle);
 
 		// clear uniform caches
-		_uniform_locations_int.clear();
-		_uniform_locations_float.clear();
-		_uniform_locations_vec2.clear();
-		_uniform_locations_vec3.clear();
-		_uniform_locations_vec4.clear();
-		_uniform_locations_mat2.clear();
-		_uniform_locations_mat3.clear();
-		_uniform_locations_mat4.clear();
+		static auto next_build_id = uint32_t(0);
+		_build_id = ++next_build_id;
+		_uniform_locations.clear();
+		_uniform_names.clear();
+		_uniform_values.clear();
 
 		if(_uniforms) {
-			glUseProgram(_handle);
+			render_state().program(_handle);
 			_uniforms->bind_all(*this);
-			glUseProgram(0);
+			render_state().program(0);
 		}
 
 		return *this;
@@ -210,7 +206,7 @@ namespace renderer {
 	Shader_program& Shader_program::uniforms(std::unique_ptr<IUniform_map>&& uniforms) {
 		_uniforms = std::move(uniforms);
 		if(_uniforms) {
-			glUseProgram(_handle);
+			render_state().program(_handle);
 			_uniforms->bind_all(*this);
 		}
 
@@ -228,114 +224,110 @@ namespace renderer {
 
 
 	Shader_program& Shader_program::bind() {
-		glUseProgram(_handle);
+		render_state().program(_handle);
 
 		return *this;
 	}
 	Shader_program& Shader_program::unbind() {
-		glUseProgram(0);
+		render_state().program(0);
 
 		return *this;
 	}
 
 
-	namespace {
-		template<class T, class V>
-		auto locate_uniform(const char* name, int shader_handle, T& cache, const V& value) {
-			using ET = typename T::mapped_type;
-
-			auto dirty = false;
-			auto it = cache.find(name);
-			if (it == cache.end()) {
-				it = cache.emplace(name,
-				                   ET{glGetUniformLocation(shader_handle, name), value}).first;
-				dirty = true;
-			} else if(it->second.last_value!=value) {
-				dirty = true;
-				it->second.last_value = value;
-			}
-
-			return std::make_pair(dirty, it->second.handle);
+	auto Shader_program::Name_hash::operator()(const char* str)const noexcept -> std::size_t {
+		// FNV-1a
+		auto hash = std::size_t(2166136261u);
+		for(; *str; ++str) {
+			hash = (hash ^ static_cast<unsigned char>(*str)) * 16777619u;
 		}
+		return hash;
+	}
+	bool Shader_program::Name_equal::operator()(const char* lhs, const char* rhs)const noexcept {
+		return lhs==rhs || std::strcmp(lhs, rhs)==0;
 	}
 
-	Shader_program& Shader_program::set_uniform(const char* name, int value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_int, value);
+	auto Shader_program::uniform_location(const char* name) -> int {
+		auto iter = _uniform_locations.find(name);
+		if(iter!=_uniform_locations.end())
+			return iter->second;
 
-		if(dirty)
-			glUniform1i(handle, value);
+		auto len = std::strlen(name);
+		auto name_copy = std::make_unique<char[]>(len+1);
+		std::memcpy(name_copy.get(), name, len+1);
 
-		return *this;
+		auto location = glGetUniformLocation(_handle, name);
+		_uniform_locations.emplace(name_copy.get(), location);
+		_uniform_names.emplace_back(std::move(name_copy));
+
+		return location;
 	}
-	Shader_program& Shader_program::set_uniform(const char* name, float value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_float, value);
 
-		if(dirty)
-			glUniform1f(handle, value);
+	template<class T>
+	bool Shader_program::_update_value(int location, const T& value) {
+		static_assert(sizeof(T)<=sizeof(Uniform_value::data), "Uniform type is too large");
 
-		return *this;
-	}
-	Shader_program& Shader_program::set_uniform(const char* name, const glm::vec2& value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_vec2, value);
+		if(location<0)
+			return false;
 
-		if(dirty)
-			glUniform2fv(handle, 1, glm::value_ptr(value));
+		if(static_cast<std::size_t>(location)>=_uniform_values.size())
+			_uniform_values.resize(location+1);
 
-		return *this;
+		auto& entry = _uniform_values[location];
+		if(entry.valid && std::memcmp(entry.data.data(), &value, sizeof(T))==0)
+			return false;
+
+		std::memcpy(entry.data.data(), &value, sizeof(T));
+		entry.valid = true;
+		render_state().count_uniform_upload();
+		return true;
 	}
-	Shader_program& Shader_program::set_uniform(const char* name, const glm::vec3& value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_vec3, value);
 
-		if(dirty)
-			glUniform3fv(handle, 1, glm::value_ptr(value));
+	Shader_program& Shader_program::set_uniform(int location, int value) {
+		if(_update_value(location, value))
+			glUniform1i(location, value);
 
 		return *this;
 	}
-	Shader_program& Shader_program::set_uniform(const char* name, const glm::vec4& value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_vec4, value);
-
-		if(dirty)
-			glUniform4fv(handle, 1, glm::value_ptr(value));
+	Shader_program& Shader_program::set_uniform(int location, float value) {
+		if(_update_value(location, value))
+			glUniform1f(location, value);
 
 		return *this;
 	}
-	Shader_program& Shader_program::set_uniform(const char* name, const glm::mat2& value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_mat2, value);
+	Shader_program& Shader_program::set_uniform(int location, const glm::vec2& value) {
+		if(_update_value(location, value))
+			glUniform2fv(location, 1, glm::value_ptr(value));
 
-		if(dirty)
-			glUniformMatrix2fv(handle, 1, GL_FALSE, glm::value_ptr(value));
+		return *this;
+	}
+	Shader_program& Shader_program::set_uniform(int location, const glm::vec3& value) {
+		if(_update_value(location, value))
+			glUniform3fv(location, 1, glm::value_ptr(value));
 
 		return *this;
 	}
-	Shader_program& Shader_program::set_uniform(const char* name, const glm::mat3& value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_mat3, value);
+	Shader_program& Shader_program::set_uniform(int location, const glm::vec4& value) {
+		if(_update_value(location, value))
+			glUniform4fv(location, 1, glm::value_ptr(value));
 
-		if(dirty)
-			glUniformMatrix3fv(handle, 1, GL_FALSE, glm::value_ptr(value));
+		return *this;
+	}
+	Shader_program& Shader_program::set_uniform(int location, const glm::mat2& value) {
+		if(_update_value(location, value))
+			glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value));
 
 		return *this;
 	}
-	Shader_program& Shader_program::set_uniform(const char* name, const glm::mat4& value) {
-		auto dirty = true;
-		auto handle = 0;
-		std::tie(dirty, handle) = locate_uniform(name, _handle, _uniform_locations_mat4, value);
+	Shader_program& Shader_program::set_uniform(int location, const glm::mat3& value) {
+		if(_update_value(location, value))
+			glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
 
-		if(dirty)
-			glUniformMatrix4fv(handle, 1, GL_FALSE, glm::value_ptr(value));
+		return *this;
+	}
+	Shader_program& Shader_program::set_uniform(int location, const glm::mat4& value) {
+		if(_update_value(location, value))
+			glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
 
 		return *this;
 	}
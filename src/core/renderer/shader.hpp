@@ -14,6 +14,7 @@
 #include <gsl.h>
 
 #include <string>
+#include <array>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -71,23 +72,38 @@ namespace renderer {
 			Shader_program& bind();
 			Shader_program& unbind();
 
-			Shader_program& set_uniform(const char* name, int value);
-			Shader_program& set_uniform(const char* name, float value);
-			Shader_program& set_uniform(const char* name, const glm::vec2& value);
-			Shader_program& set_uniform(const char* name, const glm::vec3& value);
-			Shader_program& set_uniform(const char* name, const glm::vec4& value);
-			Shader_program& set_uniform(const char* name, const glm::mat2& value);
-			Shader_program& set_uniform(const char* name, const glm::mat3& value);
-			Shader_program& set_uniform(const char* name, const glm::mat4& value);
+			/// unique for each successful build(), 0 if the program has not been build yet
+			auto build_id()const noexcept {return _build_id;}
+
+			/// cached, so only the first call for each name queries OpenGL
+			auto uniform_location(const char* name) -> int;
 
-		private:
 			template<class T>
-			struct Uniform_entry {
-				int handle;
-				T last_value;
+			Shader_program& set_uniform(const char* name, const T& value) {
+				return set_uniform(uniform_location(name), value);
+			}
+
+			// values that are equal to the last one uploaded to the location are skipped
+			Shader_program& set_uniform(int location, int value);
+			Shader_program& set_uniform(int location, float value);
+			Shader_program& set_uniform(int location, const glm::vec2& value);
+			Shader_program& set_uniform(int location, const glm::vec3& value);
+			Shader_program& set_uniform(int location, const glm::vec4& value);
+			Shader_program& set_uniform(int location, const glm::mat2& value);
+			Shader_program& set_uniform(int location, const glm::mat3& value);
+			Shader_program& set_uniform(int location, const glm::mat4& value);
+
+		private:
+			struct Name_hash {
+				auto operator()(const char* str)const noexcept -> std::size_t;
+			};
+			struct Name_equal {
+				bool operator()(const char* lhs, const char* rhs)const noexcept;
+			};
+			struct Uniform_value {
+				std::array<float, 4*4> data;
+				bool valid = false;
 			};
-			template<class T>
-			using Uniform_cache = std::unordered_map<std::string, Uniform_entry<T>>;
 
 			struct Prog_handle {
 				int v;
@@ -102,14 +118,15 @@ namespace renderer {
 			std::vector<std::shared_ptr<const Shader>> _attached_shaders;
 			std::unique_ptr<IUniform_map> _uniforms;
 
-			Uniform_cache<int> _uniform_locations_int;
-			Uniform_cache<float> _uniform_locations_float;
-			Uniform_cache<glm::vec2> _uniform_locations_vec2;
-			Uniform_cache<glm::vec3> _uniform_locations_vec3;
-			Uniform_cache<glm::vec4> _uniform_locations_vec4;
-			Uniform_cache<glm::mat2> _uniform_locations_mat2;
-			Uniform_cache<glm::mat3> _uniform_locations_mat3;
-			Uniform_cache<glm::mat4> _uniform_locations_mat4;
+			uint32_t _build_id = 0;
+
+			// the keys point into _uniform_names, so lookups don't have to construct a std::string
+			std::vector<std::unique_ptr<char[]>> _uniform_names;
+			std::unordered_map<const char*, int, Name_hash, Name_equal> _uniform_locations;
+			std::vector<Uniform_value> _uniform_values; //< indexed by location
+
+			template<class T>
+			bool _update_value(int location, const T& value);
 	};
 
 } /* namespace renderer */
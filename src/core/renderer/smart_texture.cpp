@@ -2,6 +2,8 @@
 
 #include "smart_texture.hpp"
 
+#include "triangulation.hpp"
+
 
 namespace lux {
 namespace renderer {
@@ -18,26 +20,33 @@ namespace renderer {
 		if(_points.size()>1) {
 			if(glm::distance2(_points.at(i>0?i-1:_points.size()-1),p)<0.01) {
 				_points.erase(_points.begin()+i);
+				_triangles_dirty = true;
 				return i-1;
 			}
 			if(glm::distance2(_points.at((i+1) % _points.size()),p)<0.01) {
 				_points.erase(_points.begin()+i);
+				_triangles_dirty = true;
 				return i;
 			}
 		}
 
 		_points.at(i) = p;
+		if(!_triangles_dirty)
+			_moved_points.push_back(i);
+
 		return util::nothing();
 	}
 
 	void Smart_texture::insert_point(std::size_t i, glm::vec2 p) {
 		_points.insert(_points.begin() + i, p);
 		_dirty = true;
+		_triangles_dirty = true;
 	}
 
 	void Smart_texture::erase_point(std::size_t i) {
 		_points.erase(_points.begin() + i);
 		_dirty = true;
+		_triangles_dirty = true;
 	}
 
 	void Smart_texture::draw(glm::vec3 position, Sprite_batch& batch) {
@@ -113,92 +122,23 @@ namespace renderer {
 		using namespace glm;
 		using namespace unit_literals;
 
-		auto is_convex(vec2 a, vec2 b, vec2 c) {
-			return ( ( a.x * ( c.y - b.y ) ) + ( b.x * ( a.y - c.y ) ) + ( c.x * ( b.y - a.y ) ) ) < 0.f;
-		}
-		auto sign(vec2 p1, vec2 p2, vec2 p3){
-			return (p1.x - p3.x) * (p2.y - p3.y) - (p2.x - p3.x) * (p1.y - p3.y);
-		}
-
-		auto is_in_triangle(vec2 pt, vec2 v1, vec2 v2, vec2 v3){
-			auto b1 = sign(pt, v1, v2) < 0.0f;
-			auto b2 = sign(pt, v2, v3) < 0.0f;
-			auto b3 = sign(pt, v3, v1) < 0.0f;
-
-			return b1 == b2 && b2 == b3;
-		}
-		auto is_ear(std::size_t a, std::size_t b, std::size_t c, const std::vector<vec2>& points) {
-			auto prev = points[a];
-			auto curr = points[b];
-			auto next = points[c];
-
-			for(auto i=0u; i<points.size(); i++) {
-				if(i!=a && i!=b && i!=c && is_in_triangle(points[i], prev, curr, next)) {
-					return false;
-				}
-			}
-
-			return true;
-		}
-
-		template<typename F1, typename F2>
-		void triangulate(std::vector<glm::vec2> points, F1&& add_vertex, F2&& error) {
-			int triangles_produced = 0;
-			do {
-				triangles_produced = 0;
-
-				for(auto i=0u; i<points.size() && points.size()>3; i++) {
-					auto pi = i>0 ? i-1 : points.size()-1;
-					auto ni = (i+1) % points.size();
-
-					auto prev = points[pi];
-					auto curr = points[i];
-					auto next = points[ni];
-
-					if(is_convex(prev, curr, next) && is_ear(pi,i,ni,points)) {
-						points.erase(points.begin()+i);
-						triangles_produced++;
-
-						// create triangle (prev, curr, next)
-						add_vertex(prev);
-						add_vertex(curr);
-						add_vertex(next);
-					}
-				}
-
-			} while(points.size()>3 && triangles_produced>0);
-
-			if(points.size()==3) {
-				add_vertex(points[0]);
-				add_vertex(points[1]);
-				add_vertex(points[2]);
-
-			} else {
-				error(points.size());
-			}
-		}
-
 		void triangulate_background(const std::vector<glm::vec2>& points,
+		                            const std::vector<uint32_t>& triangles,
 		                            std::vector<Sprite_vertex>& vertices,
 		                            bool shadowcaster, float decals_intensity,
 		                            const renderer::Material& mat) {
 
 			const auto pc = 2.0f / mat.albedo().width();
+			const auto uv_clip = vec4{pc, pc, 0.75f-pc, 0.75f-pc};
+			const auto hc = glm::vec2{0,0}; // hue_change. currently unused by smart_textures
 
-			auto add_vertex = [&](auto v) {
-				auto uv_clip = vec4{pc, pc, 0.75f-pc, 0.75f-pc};
+			for(auto i : triangles) {
+				auto v = points[i];
 				auto uv = vec2{v.x,-v.y}*0.5f;
-				auto hc = glm::vec2{0,0}; // hue_change. currently unused by smart_textures
 
 				vertices.emplace_back(vec3(v,-0.04f), vec2{}, uv, uv_clip, vec2{1.f,0.f}, hc,
 				                      shadowcaster ? 1.f : 0.f, decals_intensity, &mat);
-			};
-			auto error = [&](auto left) {
-				INFO("Polygon is not valid. "<<left<<" vertices left");
-				vertices.clear();
-			};
-
-			triangulate(points, add_vertex, error);
+			}
 		}
 		void triangulate_border(const std::vector<glm::vec2>& points,
 		                        std::vector<Sprite_vertex>& vertices,
@@ -493,24 +433,44 @@ namespace renderer {
 		}
 	}
 	void Smart_texture::_update_vertices() {
-		_vertices.clear();
+		// dragged points usually only affect the triangles around them
+		if(!_triangles_dirty) {
+			for(auto i : _moved_points) {
+				if(!retriangulate_after_move(_points, _triangles, i)) {
+					_triangles_dirty = true;
+					break;
+				}
+			}
+		}
+		_moved_points.clear();
 
-		triangulate_background(_points, _vertices, _shadowcaster, _decals_intensity, *_material);
+		if(_triangles_dirty) {
+			auto left = triangulate(_points, _triangles);
+			if(left>0) {
+				INFO("Polygon is not valid. "<<left<<" vertices left");
+				_triangles.clear();
+			} else {
+				_triangles_dirty = false;
+			}
+		}
+
+		_vertices.clear();
+		triangulate_background(_points, _triangles, _vertices, _shadowcaster, _decals_intensity, *_material);
 		triangulate_border(_points, _vertices, _shadowcaster, _decals_intensity, *_material);
 	}
 
 	auto Smart_texture::vertices()const -> std::vector<glm::vec2> {
-		auto ret = std::vector<glm::vec2>();
-		ret.reserve(_points.size());
-
-		auto add_vertex = [&](auto v) {
-			ret.emplace_back(v);
-		};
-		auto error = [&](auto left) {
+		auto triangles = std::vector<uint32_t>();
+		auto left = triangulate(_points, triangles);
+		if(left>0) {
 			INFO("Polygon is not valid. "<<left<<" vertices left");
-		};
+		}
 
-		triangulate(_points, add_vertex, error);
+		auto ret = std::vector<glm::vec2>();
+		ret.reserve(triangles.size());
+		for(auto i : triangles) {
+			ret.emplace_back(_points[i]);
+		}
 
 		return ret;
 	}
@@ -57,7 +57,7 @@ namespace renderer {
 			}
 
 			auto points()const -> auto& {return _points;}
-			void points(std::vector<glm::vec2> p) {_points=p; _dirty=true;}
+			void points(std::vector<glm::vec2> p) {_points=p; _dirty=true; _triangles_dirty=true;}
 			auto vertices()const -> std::vector<glm::vec2>;
 
 			auto move_point(std::size_t i, glm::vec2 p) -> util::maybe<std::size_t>;
@@ -79,6 +79,11 @@ namespace renderer {
 			std::vector<Sprite_vertex> _vertices;
 			bool _dirty;
 
+			std::vector<uint32_t> _triangles; //< indices into _points
+			bool _triangles_dirty = true;
+			/// points moved since the last update, that may not require a new triangulation
+			std::vector<std::size_t> _moved_points;
+
 			void _update_vertices();
 	};
 
@@ -52,6 +52,35 @@ namespace renderer {
 	}
 
 
+	bool draw_order_less(float lhs_z, const renderer::Material* lhs_material,
+	                     float rhs_z, const renderer::Material* rhs_material)noexcept {
+		auto lhs_alpha = lhs_material ? lhs_material->alpha() : false;
+		auto rhs_alpha = rhs_material ? rhs_material->alpha() : false;
+		auto lhs_zi = -std::floor(lhs_z*1000.f);
+		auto rhs_zi = -std::floor(rhs_z*1000.f);
+		auto lhs_key = lhs_material ? lhs_material->batch_key() : 0u;
+		auto rhs_key = rhs_material ? rhs_material->batch_key() : 0u;
+
+		if(lhs_alpha && !rhs_alpha) {
+			return false;
+		} else if(!lhs_alpha && rhs_alpha) {
+			return true;
+		} else if(lhs_alpha && rhs_alpha) {
+			return std::make_tuple(-lhs_zi, lhs_key, lhs_material) < std::make_tuple(-rhs_zi, rhs_key, rhs_material);
+		} else {
+			return std::tie(lhs_key, lhs_material, lhs_zi) < std::tie(rhs_key, rhs_material, rhs_zi);
+		}
+	}
+
+	bool same_batch(const renderer::Material* lhs, const renderer::Material* rhs)noexcept {
+		return lhs==rhs || (lhs && rhs && lhs->same_textures(*rhs));
+	}
+
+	bool Sprite_vertex::operator<(std::tuple<float, const renderer::Material*> rhs)const noexcept {
+		return draw_order_less(position.z, material, std::get<0>(rhs), std::get<1>(rhs));
+	}
+
+
 	void init_sprite_renderer(asset::Asset_manager& asset_manager) {
 		sprite_shader = std::make_unique<Shader_program>();
 		sprite_shader->attach_shader(asset_manager.load<Shader>("vert_shader:sprite"_aid))
@@ -62,10 +91,9 @@ namespace renderer {
 		                  "albedo_tex", int(Texture_unit::color),
 		                  "normal_tex", int(Texture_unit::normal),
 		                  "material_tex", int(Texture_unit::material),
-		                  "height_tex", int(Texture_unit::height),
 		                  "shadowmaps_tex", int(Texture_unit::shadowmaps),
+		                  "lights_tex", int(Texture_unit::lights),
 		                  "environment_tex", int(Texture_unit::environment),
-		                  "last_frame_tex", int(Texture_unit::last_frame),
 		                  "decals_tex", int(Texture_unit::decals)
 		              ));
 	}
@@ -82,37 +110,11 @@ namespace renderer {
 
 	auto Sprite_batch::_reserve_space(float z, const renderer::Material* material,
 	                                  std::size_t count) -> Vertex_iter {
-		// reserve enough space (first operation because of possible iterator invalidation)
-		auto initial_size = _vertices.size();
-		if(_vertices.capacity() < initial_size+count) {
-			constexpr auto extra_space = 16;
-			_vertices.reserve(initial_size + count + extra_space);
-		}
-
-		// locate the insertion point
-		auto ip = std::lower_bound(_vertices.begin(), _vertices.end(), std::tie(z,material));
-		auto ip_end = _vertices.end();
-		auto end_len = static_cast<std::size_t>(std::distance(ip,ip_end));
-		/* // FIXME: produces wrong results compared with the simpler/slower solution
-		if(end_len < count) {
-			// make enough room between ip and the new position of *ip for all new elements
-			_vertices.resize(_vertices.size() + (count-end_len));
-		}
-
-		auto begin_insert_part = end_len>=count ? ip+(end_len-count) : ip_end;
-
-		std::move(begin_insert_part, ip_end, std::back_inserter(_vertices));
-		std::move_backward(ip, begin_insert_part, ip_end);
+		auto begin = _vertices.size();
+		_vertices.resize(begin + count);
+		_groups.push_back(Group{z, material, static_cast<uint32_t>(begin), static_cast<uint32_t>(count)});
 
-		*/
-		_vertices.resize(_vertices.size() + count);
-		std::move_backward(ip, ip_end, _vertices.end());
-
-
-		INVARIANT(_vertices.size()==initial_size+count,
-		          "Resize error. "<<_vertices.size()<<" instead of "<<initial_size<<"+"<<count<<" with end_len="<<end_len);
-
-		return ip;
+		return _vertices.begin() + begin;
 	}
 	void Sprite_batch::insert(const Sprite& sprite) {
 		auto scale = vec3 {
@@ -175,32 +177,66 @@ namespace renderer {
 #endif
 	}
 
+	void Sprite_batch::merge(Sprite_batch& other) {
+		auto offset = static_cast<uint32_t>(_vertices.size());
+
+		_vertices.insert(_vertices.end(), other._vertices.begin(), other._vertices.end());
+
+		_groups.reserve(_groups.size() + other._groups.size());
+		for(auto& g : other._groups) {
+			_groups.push_back(Group{g.z, g.material, g.begin+offset, g.count});
+		}
+
+		other._vertices.clear();
+		other._groups.clear();
+	}
+
 	void Sprite_batch::flush(Command_queue& queue) {
+		_sort();
 		_draw(queue);
+		clear();
+	}
+	void Sprite_batch::clear() {
 		_vertices.clear();
+		_sorted_vertices.clear();
+		_groups.clear();
 		_free_obj = 0;
 	}
 
+	void Sprite_batch::_sort() {
+		// stable, so that sprites with the same z and material are drawn in insertion order
+		std::stable_sort(_groups.begin(), _groups.end(), [](const Group& lhs, const Group& rhs) {
+			return draw_order_less(lhs.z, lhs.material, rhs.z, rhs.material);
+		});
+
+		_sorted_vertices.clear();
+		_sorted_vertices.reserve(_vertices.size());
+		for(auto& g : _groups) {
+			auto begin = _vertices.begin() + g.begin;
+			_sorted_vertices.insert(_sorted_vertices.end(), begin, begin+g.count);
+		}
+	}
+
 	void Sprite_batch::_draw(Command_queue& queue) {
 		_reserve_objects();
 
 		// draw one batch for each partition
-		auto last = _vertices.begin();
-		for(auto current = _vertices.begin(); current!=_vertices.end(); ++current) {
-			if(current->material != last->material) {
+		auto last = _sorted_vertices.cbegin();
+		for(auto current = _sorted_vertices.cbegin(); current!=_sorted_vertices.cend(); ++current) {
+			if(!same_batch(current->material, last->material)) {
 				queue.push_back(_draw_part(last, current));
 				last = current;
 			}
 		}
 
-		if(last!=_vertices.end())
-			queue.push_back(_draw_part(last, _vertices.end()));
+		if(last!=_sorted_vertices.cend())
+			queue.push_back(_draw_part(last, _sorted_vertices.cend()));
 /*
-		if(!_vertices.empty()) {
+		if(!_sorted_vertices.empty()) {
 			DEBUG("draw");
-			float lastz = std::floor(_vertices.front().position.z*1000.f);
-			bool last_alpha = _vertices.front().material->alpha();
-			for(auto& v : _vertices) {
+			float lastz = std::floor(_sorted_vertices.front().position.z*1000.f);
+			bool last_alpha = _sorted_vertices.front().material->alpha();
+			for(auto& v : _sorted_vertices) {
 				auto z = std::floor(v.position.z*1000.f);
 				if(last_alpha)
 					INVARIANT(v.material->alpha(), "sort broken");
@@ -245,8 +281,8 @@ namespace renderer {
 		// reserve required objects
 		auto req_objs = 0u;
 		auto last_mat = static_cast<const Material*>(nullptr);
-		for(auto& v : _vertices) {
-			if(v.material!=last_mat) {
+		for(auto& v : _sorted_vertices) {
+			if(!same_batch(v.material, last_mat)) {
 				last_mat = v.material;
 				req_objs++;
 			}
@@ -59,33 +59,29 @@ namespace renderer {
 		              float shadow_resistence, float decals_intensity,
 		              const renderer::Material*);
 
-		bool operator<(std::tuple<float, const renderer::Material*> rhs)const noexcept {
-			auto lhs_alpha = material ? material->alpha() : false;
-			auto lhs_z = -std::floor(position.z*1000.f);
-			auto rhs_alpha = std::get<1>(rhs) ? std::get<1>(rhs)->alpha() : false;
-			auto rhs_z = -std::floor(std::get<0>(rhs)*1000.f);
-
-			if(lhs_alpha && !rhs_alpha) {
-				return false;
-			} else if(!lhs_alpha && rhs_alpha) {
-				return true;
-			} else if(lhs_alpha && rhs_alpha) {
-				return std::make_pair(-lhs_z, material) < std::make_pair(-rhs_z, std::get<1>(rhs));
-			} else {
-				return std::tie(lhs_alpha, material, lhs_z)
-					   < std::tie(rhs_alpha, std::get<1>(rhs), rhs_z);
-			}
-
-		}
+		bool operator<(std::tuple<float, const renderer::Material*> rhs)const noexcept;
 		bool operator<(const Sprite_vertex& rhs)const noexcept {
 			return *this < std::tie(rhs.position.z, rhs.material);
 		}
 	};
 
+	/// opaque sprites first (grouped by their textures), then alpha-blended sprites back to front
+	extern bool draw_order_less(float lhs_z, const renderer::Material* lhs_material,
+	                            float rhs_z, const renderer::Material* rhs_material)noexcept;
+	/// true if the sprites of both materials can be drawn with a single draw call
+	extern bool same_batch(const renderer::Material* lhs, const renderer::Material* rhs)noexcept;
+
 	extern Vertex_layout sprite_layout;
 
 	extern void init_sprite_renderer(asset::Asset_manager& asset_manager);
 
+	/*
+	 * Sprites are only appended by insert() and sorted by draw_order_less()
+	 *   during flush(), so inserting n sprites costs O(n log n) instead of the
+	 *   O(n^2) of a sorted insert.
+	 * Different threads can fill their own batches, which are then combined
+	 *   with merge() on the GL thread before the flush.
+	 */
 	class Sprite_batch {
 		public:
 			Sprite_batch(std::size_t expected_size=64);
@@ -94,18 +90,37 @@ namespace renderer {
 			void insert(const Sprite& sprite);
 			void insert(glm::vec3 position,
 			            const std::vector<Sprite_vertex>& vertices);
+
+			/// moves all sprites of 'other' into this batch, sprites with equal order keep 'this' first
+			void merge(Sprite_batch& other);
+
 			void flush(Command_queue&);
+			/// drops all sprites without drawing them
+			void clear();
+
+			auto size()const noexcept {return _vertices.size();}
 
 		private:
 			using Vertex_citer = std::vector<Sprite_vertex>::const_iterator;
 			using Vertex_iter = std::vector<Sprite_vertex>::iterator;
 
+			/// vertices of one insert() call, which have to stay together
+			struct Group {
+				float z;
+				const renderer::Material* material;
+				uint32_t begin;
+				uint32_t count;
+			};
+
 			Shader_program& _shader;
 
+			std::vector<Group>            _groups;
 			std::vector<Sprite_vertex>    _vertices;
+			std::vector<Sprite_vertex>    _sorted_vertices;
 			std::vector<renderer::Object> _objects;
 			std::size_t                   _free_obj = 0;
 
+			void _sort();
 			void _draw(Command_queue&);
 			auto _draw_part(Vertex_citer begin, Vertex_citer end) -> Command;
 			auto _reserve_space(float z, const renderer::Material* material, std::size_t count) -> Vertex_iter;
@@ -4,6 +4,7 @@
 
 #include "shader.hpp"
 #include "command_queue.hpp"
+#include "render_state.hpp"
 
 #include "../asset/asset_manager.hpp"
 
@@ -37,7 +38,7 @@ namespace renderer {
 			Text_char id = i;
 			stream>>id;
 
-			Glyph& g = _glyphs[id];
+			Glyph& g = _glyphs.add(id);
 			stream>> g.x >> g.y >> g.width >> g.height >> g.offset_x >> g.offset_y >> g.advance;
 		}
 
@@ -50,9 +51,11 @@ namespace renderer {
 				int val=0;
 				stream>> id >> prev >> val;
 
-				_glyphs[id].kerning[prev] = val;
+				_glyphs.add_kerning(id, prev, val);
 			}
 		}
+
+		_glyphs.finish();
 	}
 
 	using glm::vec2;
@@ -76,7 +79,7 @@ namespace renderer {
 
 		template<typename Func>
 		void parse(const std::string str, int height, int tex_width, int tex_height,
-		           const std::unordered_map<Text_char, Glyph>& glyphs, Func quad_callback,
+		           const Glyph_table& glyphs, Func quad_callback,
 		           bool monospace=false) {
 
 			glm::vec2 offset{0,-height};
@@ -85,15 +88,7 @@ namespace renderer {
 			auto tw = tex_width;
 			auto th = tex_height;
 
-			auto max_advance = 0.f;
-			auto sum_advance = 0.f;
-			if(monospace) {
-				for(auto& g : glyphs) {
-					max_advance = std::max(static_cast<float>(g.second.advance), max_advance);
-					sum_advance += g.second.advance;
-				}
-			}
-			float fixed_advance = max_advance*0.5f + sum_advance/glyphs.size()*0.5f;
+			auto fixed_advance = monospace ? glyphs.monospace_advance() : 0.f;
 
 			auto add_glyph = [&](Text_char c) {
 				if(c=='\n') {
@@ -102,15 +97,10 @@ namespace renderer {
 					return;
 				}
 
-				auto g = glyphs.find(c);
-				if(g==glyphs.end())
-					g=glyphs.begin();
+				auto& glyph = glyphs.find(c);
 
-				auto& glyph = g->second;
-
-				auto k = glyph.kerning.find(prev);
-				if(!monospace && k!=glyph.kerning.end())
-					offset.x+=k->second;
+				if(!monospace)
+					offset.x += glyphs.kerning(glyph, prev);
 
 				quad_callback(
 				            offset.x + glyph.offset_x,
@@ -191,15 +181,20 @@ namespace renderer {
 	}
 
 	auto Font::text(const std::string& str)const -> Text_ptr {
-		auto& entry =_cache[str];
+		auto& cache = text_cache();
 
-		if(entry)
-			return entry;
+		auto cached = cache.find(*this, str);
+		if(cached)
+			return cached;
 
 		std::vector<Simple_vertex> vertices;
 		calculate_vertices(str, vertices);
 
-		return entry=std::make_shared<Text>(shared_from_this(), vertices);
+		auto bytes = vertices.size()*sizeof(Simple_vertex);
+		auto text = std::make_shared<Text>(shared_from_this(), std::move(vertices));
+		cache.insert(*this, str, text, bytes);
+
+		return text;
 	}
 
 	auto Font::calculate_size(const std::string& str)const -> glm::vec2 {
@@ -221,6 +216,71 @@ namespace renderer {
 	}
 
 
+	auto text_cache() -> Text_cache& {
+		static Text_cache cache;
+		return cache;
+	}
+
+	namespace {
+		// rough size of the bookkeeping of an entry (list node, map node, shared_ptr control block)
+		constexpr auto text_cache_entry_overhead = std::size_t(128);
+	}
+
+	auto Text_cache::find(const Font& font, const std::string& str) -> Text_ptr {
+		auto iter = _entries.find(Key{&font, std::hash<std::string>()(str)});
+		if(iter==_entries.end() || iter->second->str!=str) {
+			render_state().count_text_cache(false);
+			return {};
+		}
+
+		_lru.splice(_lru.begin(), _lru, iter->second);
+		render_state().count_text_cache(true);
+		return iter->second->text;
+	}
+
+	void Text_cache::insert(const Font& font, const std::string& str, Text_ptr text, std::size_t bytes) {
+		auto key = Key{&font, std::hash<std::string>()(str)};
+
+		auto iter = _entries.find(key);
+		if(iter!=_entries.end()) {
+			_erase(iter->second);
+		}
+
+		bytes += str.size() + text_cache_entry_overhead;
+		if(bytes>_budget)
+			return;
+
+		_lru.push_front(Entry{key, str, std::move(text), bytes});
+		_entries.emplace(key, _lru.begin());
+		_bytes += bytes;
+
+		_shrink();
+	}
+
+	void Text_cache::budget(std::size_t bytes) {
+		_budget = bytes;
+		_shrink();
+	}
+
+	void Text_cache::clear() {
+		_entries.clear();
+		_lru.clear();
+		_bytes = 0;
+	}
+
+	void Text_cache::_erase(Lru::iterator entry) {
+		_bytes -= entry->bytes;
+		_entries.erase(entry->key);
+		_lru.erase(entry);
+	}
+
+	void Text_cache::_shrink() {
+		while(_bytes>_budget && !_lru.empty()) {
+			_erase(std::prev(_lru.end()));
+		}
+	}
+
+
 	Text::Text(Font_sptr font, std::vector<Simple_vertex> vertices)
 	    : _font(font), _obj(simple_vertex_layout, create_buffer(vertices)) {
 
@@ -299,6 +359,11 @@ namespace renderer {
 		           ));
 	}
 
+	void shutdown_font_renderer() {
+		text_cache().clear();
+		font_shader.reset();
+	}
+
 	void Text::draw(Command_queue& queue, glm::vec2 center,
 	                glm::vec4 color, float scale)const {
 		queue.push_back(create_text_draw_cmd(center, color, scale, size(), _obj, *_font->_texture));
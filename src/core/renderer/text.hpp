@@ -11,9 +11,12 @@
 #include "vertex_object.hpp"
 #include "shader.hpp"
 #include "primitives.hpp"
+#include "glyph_table.hpp"
 
 #include "../asset/asset_manager.hpp"
 
+#include <list>
+
 
 namespace lux {
 namespace renderer {
@@ -22,19 +25,6 @@ namespace renderer {
 	class Text;
 	using Text_ptr = std::shared_ptr<const Text>;
 
-	using Text_char = uint32_t;
-
-	struct Glyph {
-		int x = 0;
-		int y = 0;
-		int width = 0;
-		int height = 0;
-		int offset_x = 0;
-		int offset_y = 0;
-		int advance = 0;
-		std::unordered_map<Text_char, int> kerning;
-	};
-
 	/*
 	 * Format:
 	 * family
@@ -64,9 +54,7 @@ namespace renderer {
 			int _height = 0;
 			int _line_height = 0;
 			Texture_ptr _texture;
-			std::unordered_map<Text_char, Glyph> _glyphs;
-
-			mutable std::unordered_map<std::string, Text_ptr> _cache;
+			Glyph_table _glyphs;
 	};
 	using Font_ptr = asset::Ptr<Font>;
 	using Font_sptr = std::shared_ptr<const renderer::Font>;
@@ -105,7 +93,62 @@ namespace renderer {
 			glm::vec2 _size;
 	};
 
+	/*
+	 * Geometry of the static texts created by Font::text(), shared by all fonts.
+	 * Entries are keyed by the font and the hash of the string and the least
+	 *   recently requested ones are dropped when the byte budget is exceeded.
+	 * Hits and misses are counted in the Render_stats.
+	 * The budget is set from Graphics_settings::text_cache_kb.
+	 */
+	class Text_cache {
+		public:
+			static constexpr std::size_t default_budget = 2*1024*1024;
+
+			auto find(const Font& font, const std::string& str) -> Text_ptr;
+			void insert(const Font& font, const std::string& str, Text_ptr text, std::size_t bytes);
+
+			void budget(std::size_t bytes);
+			auto budget()const noexcept {return _budget;}
+			auto bytes()const noexcept {return _bytes;}
+			auto size()const noexcept {return _lru.size();}
+
+			void clear();
+
+		private:
+			struct Key {
+				const Font* font;
+				std::size_t hash;
+
+				bool operator==(const Key& rhs)const noexcept {
+					return font==rhs.font && hash==rhs.hash;
+				}
+			};
+			struct Key_hash {
+				auto operator()(const Key& k)const noexcept -> std::size_t {
+					return std::hash<const Font*>()(k.font) ^ (k.hash * 31);
+				}
+			};
+			struct Entry {
+				Key key;
+				std::string str; //< to detect hash collisions
+				Text_ptr text;
+				std::size_t bytes;
+			};
+			using Lru = std::list<Entry>; //< most recently used first
+
+			std::size_t _budget = default_budget;
+			std::size_t _bytes = 0;
+			Lru _lru;
+			std::unordered_map<Key, Lru::iterator, Key_hash> _entries;
+
+			void _erase(Lru::iterator entry);
+			void _shrink();
+	};
+	extern auto text_cache() -> Text_cache&;
+
 	extern void init_font_renderer(asset::Asset_manager&);
+	/// releases the shader and the Text_cache, has to be called before the GL context is destroyed
+	extern void shutdown_font_renderer();
 }
 
 namespace asset {
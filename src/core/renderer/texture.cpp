@@ -1,16 +1,22 @@
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include "gl.hpp"
 
 #include "texture.hpp"
 
+#include "render_state.hpp"
+#include "image_data.hpp"
+
+#include "../utils/thread_pool.hpp"
+
 #include <SDL2/SDL.h>
 #include <soil/SOIL2.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
 
 namespace lux {
 namespace renderer {
@@ -19,9 +25,26 @@ namespace renderer {
 
 #define CLAMP_TO_EDGE 0x812F
 
-	Texture::Texture(std::vector<uint8_t> buffer, bool cubemap) throw(Texture_loading_failed)
+	Texture::Texture(std::vector<uint8_t> buffer, bool cubemap,
+	                 const std::string& name) throw(Texture_loading_failed)
 	    : _cubemap(cubemap) {
 
+		if(!cubemap && image_info(buffer, _width, _height)) {
+			// the real content is decoded in the background and uploaded by texture_uploader()
+			const uint8_t placeholder[] = {0, 0, 0, 0};
+
+			glGenTextures(1, &_handle);
+			render_state().texture(0, GL_TEXTURE_2D, _handle);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+			texture_uploader().schedule(_handle, std::move(buffer), name);
+			return;
+		}
+
 		if(!cubemap) {
 			_handle = SOIL_load_OGL_texture_from_memory
 			(
@@ -45,8 +68,11 @@ namespace renderer {
 			);
 		}
 
+		// SOIL binds the new texture to whatever unit is currently active
+		render_state().invalidate_textures();
+
 		if(!_handle)
-			throw Texture_loading_failed(SOIL_last_result());
+			throw Texture_loading_failed("Couldn't load texture "+name+": "+SOIL_last_result());
 
 		auto tex_type = _cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
 
@@ -55,11 +81,11 @@ namespace renderer {
 		glTexParameteri(tex_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(tex_type, GL_TEXTURE_WRAP_S, CLAMP_TO_EDGE);
 		glTexParameteri(tex_type, GL_TEXTURE_WRAP_T, CLAMP_TO_EDGE);
-		glBindTexture(tex_type, 0);
+		render_state().texture(0, tex_type, 0);
 	}
 	Texture::Texture(int width, int height, int bpp) : _width(width), _height(height) {
 		glGenTextures( 1, &_handle );
-		glBindTexture( GL_TEXTURE_2D, _handle );
+		render_state().texture(0, GL_TEXTURE_2D, _handle);
 
 #if defined(EMSCRIPTEN) || defined(ANDROID)
 		glTexImage2D(GL_TEXTURE_2D, 0,GL_RGBA, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
@@ -101,13 +127,26 @@ namespace renderer {
 		auto gl_format = format==Texture_format::RGB ? GL_RGB : GL_RGBA;
 
 		glGenTextures(1, &_handle);
-		glBindTexture(GL_TEXTURE_2D, _handle);
+		render_state().texture(0, GL_TEXTURE_2D, _handle);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexImage2D(GL_TEXTURE_2D, 0, gl_format, width, height, 0,
 		             GLenum(gl_format), GL_UNSIGNED_BYTE, data);
 	}
 
+	Data_texture::Data_texture(int width, int height)
+	    : Texture(width, height, nullptr, Texture_format::RGBA) {
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, CLAMP_TO_EDGE);
+	}
+	void Data_texture::update(const uint8_t* data) {
+		render_state().texture(0, GL_TEXTURE_2D, _handle);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	}
+
 	void Texture::_update(const Texture& base, glm::vec4 clip) {
 		INVARIANT(!_owner, "_update is only supported for non-owning textures!");
 
@@ -118,8 +157,11 @@ namespace renderer {
 	}
 
 	Texture::~Texture()noexcept {
-		if(_handle!=0 && _owner)
+		if(_handle!=0 && _owner) {
+			texture_uploader().cancel(_handle);
+			render_state().on_delete_texture(_handle);
 			glDeleteTextures(1, &_handle);
+		}
 	}
 
 	Texture::Texture(Texture&& rhs)noexcept
@@ -129,8 +171,11 @@ namespace renderer {
 		rhs._handle = 0;
 	}
 	Texture& Texture::operator=(Texture&& s)noexcept {
-		if(_handle!=0 && _owner)
+		if(_handle!=0 && _owner) {
+			texture_uploader().cancel(_handle);
+			render_state().on_delete_texture(_handle);
 			glDeleteTextures(1, &_handle);
+		}
 
 		_cubemap = s._cubemap;
 		_owner = s._owner;
@@ -145,13 +190,149 @@ namespace renderer {
 	}
 
 	void Texture::bind(int index)const {
-		auto tex = GL_TEXTURE0+index;
-		INVARIANT(tex<GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, "to many textures");
+		render_state().texture(index, _cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, _handle);
+	}
+
+
+
+	// only touched by the worker thread until done is set
+	struct Texture_uploader::Job {
+		unsigned int handle;
+		std::vector<uint8_t> file;
+		std::string name;
+		Image_data image;
+		std::string error;
+		bool decoded = false;
+		double decode_time_ms = 0;
+		std::atomic<bool> done {false};
+
+		Job(unsigned int handle, std::vector<uint8_t> file, std::string name)
+		    : handle(handle), file(std::move(file)), name(std::move(name)) {}
+
+		void decode() {
+			auto start = std::chrono::steady_clock::now();
+			decoded = decode_image(file, image, error);
+			decode_time_ms = std::chrono::duration<double, std::milli>(
+			                     std::chrono::steady_clock::now() - start).count();
+
+			file.clear();
+			file.shrink_to_fit();
+			done.store(true, std::memory_order_release);
+		}
+	};
+
+	auto texture_uploader() -> Texture_uploader& {
+		static Texture_uploader uploader;
+		return uploader;
+	}
+
+	// the pool counts the thread calling parallel_for(), that doesn't exist here
+	Texture_uploader::Texture_uploader()
+	    : _decode_pool(std::make_unique<util::Thread_pool>(decode_threads+1)) {
+	}
+	Texture_uploader::~Texture_uploader() {
+		// jobs still held by a worker are kept alive by their own reference
+		_jobs.clear();
+	}
 
-		glActiveTexture(GL_TEXTURE0 + index);
-		glBindTexture(_cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, _handle);
+	void Texture_uploader::schedule(unsigned int handle, std::vector<uint8_t> file, std::string name) {
+		auto job = std::make_shared<Job>(handle, std::move(file), std::move(name));
+		_jobs.emplace_back(job);
+		_stats.pending = _jobs.size();
+
+		_decode_pool->post([job] {
+			job->decode();
+		});
+	}
+
+	void Texture_uploader::cancel(unsigned int handle) {
+		auto iter = std::find_if(_jobs.begin(), _jobs.end(), [&](auto& j){return j->handle==handle;});
+		if(iter!=_jobs.end()) {
+			_jobs.erase(iter);
+			_stats.pending = _jobs.size();
+		}
+	}
+
+	void Texture_uploader::update() {
+		auto uploaded = std::size_t(0);
+		auto first = true;
+
+		// the first decoded image is always uploaded, so large images can't stall the queue
+		auto iter = _jobs.begin();
+		while(iter!=_jobs.end() && (first || uploaded<_budget)) {
+			if(!(*iter)->done.load(std::memory_order_acquire)) {
+				++iter;
+				continue;
+			}
+
+			// removed first, so a failed job isn't reported again
+			auto job = std::move(*iter);
+			iter = _jobs.erase(iter);
+			_stats.pending = _jobs.size();
+
+			uploaded += _upload(*job);
+			first = false;
+		}
+	}
+
+	void Texture_uploader::flush() {
+		while(!_jobs.empty()) {
+			auto job = std::move(_jobs.front());
+			_jobs.erase(_jobs.begin());
+			_stats.pending = _jobs.size();
+
+			while(!job->done.load(std::memory_order_acquire))
+				std::this_thread::yield();
+
+			_upload(*job);
+		}
 	}
 
+	auto Texture_uploader::_upload(Job& job) -> std::size_t {
+		_stats.decode_time_ms += job.decode_time_ms;
+		_stats.max_decode_time_ms = std::max(_stats.max_decode_time_ms, job.decode_time_ms);
+
+		if(!job.decoded) {
+			_stats.failed++;
+			throw Texture_loading_failed("Couldn't decode texture "+job.name+": "+job.error);
+		}
+
+		auto& image = job.image;
+
+		render_state().texture(0, GL_TEXTURE_2D, job.handle);
+
+		if(image.compressed_format==0) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0,
+			             GL_RGBA, GL_UNSIGNED_BYTE, image.data.data());
+
+		} else {
+			for(auto i=0u; i<image.levels.size(); ++i) {
+				auto& level = image.levels[i];
+				glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), GLenum(image.compressed_format),
+				                       level.width, level.height, 0, GLsizei(level.size),
+				                       image.data.data()+level.offset);
+			}
+
+			// mipmapped filtering only if the file contains the complete chain
+			auto full_chain = image.levels.size() > std::size_t(std::log2(std::max(image.width, image.height)));
+			if(full_chain)
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+
+		if(glGetError()!=GL_NO_ERROR) {
+			_stats.failed++;
+			throw Texture_loading_failed("Couldn't upload texture "+job.name+" (format "
+			                             +std::to_string(image.compressed_format)+" not supported?)");
+		}
+
+		auto bytes = image.bytes();
+		_stats.uploaded++;
+		_stats.uploaded_bytes += bytes;
+		render_state().count_texture_upload(bytes);
+
+		image = Image_data{};
+		return bytes;
+	}
 
 
 	class Atlas_texture : public Texture {
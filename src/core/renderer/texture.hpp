@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <memory>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 
@@ -17,6 +18,10 @@
 #include "../asset/asset_manager.hpp"
 
 namespace lux {
+	namespace util {
+		class Thread_pool;
+	}
+
 namespace renderer {
 
 	struct Texture_loading_failed : public asset::Loading_failed {
@@ -29,7 +34,8 @@ namespace renderer {
 
 	class Texture {
 		public:
-			explicit Texture(std::vector<uint8_t> buffer, bool cubemap) throw(Texture_loading_failed);
+			explicit Texture(std::vector<uint8_t> buffer, bool cubemap,
+			                 const std::string& name="") throw(Texture_loading_failed);
 			Texture(int width, int height, const uint8_t* data, Texture_format format);
 			virtual ~Texture()noexcept;
 
@@ -63,6 +69,70 @@ namespace renderer {
 	};
 	using Texture_ptr = asset::Ptr<Texture>;
 
+
+	/*
+	 * Decodes image files on its own worker threads (so large images can't
+	 *   delay the parallel_for()s of the systems on util::default_thread_pool())
+	 *   and uploads the results on the render thread, when update() is called.
+	 * At least one image is uploaded per update(), more while the uploaded
+	 *   bytes stay below the budget. Until then the texture contains a single
+	 *   transparent pixel.
+	 * Images that can't be decoded or uploaded are reported by throwing a
+	 *   Texture_loading_failed from update() or flush().
+	 */
+	class Texture_uploader {
+		public:
+			static constexpr auto default_budget = std::size_t(4*1024*1024);
+			static constexpr auto decode_threads = 2;
+
+			struct Stats {
+				std::size_t pending = 0;        //< decoding or waiting for upload
+				std::size_t uploaded = 0;       //< in total
+				std::size_t uploaded_bytes = 0; //< in total
+				std::size_t failed = 0;
+				double decode_time_ms = 0;      //< sum over all decoded images
+				double max_decode_time_ms = 0;
+			};
+
+			Texture_uploader();
+			~Texture_uploader();
+
+			/// name is only used for error messages
+			void schedule(unsigned int handle, std::vector<uint8_t> file, std::string name);
+			/// has to be called before the texture is deleted
+			void cancel(unsigned int handle);
+
+			/// uploads decoded images within the budget; called once per frame
+			void update();
+			/// blocks until all scheduled images have been decoded and uploads them (e.g. after loading a level)
+			void flush();
+
+			void budget(std::size_t bytes_per_frame)noexcept {_budget = bytes_per_frame;}
+			auto budget()const noexcept {return _budget;}
+
+			auto stats()const noexcept {return _stats;}
+
+		private:
+			struct Job;
+
+			std::vector<std::shared_ptr<Job>> _jobs; //< in the order they were scheduled
+			std::size_t _budget = default_budget;
+			Stats _stats;
+			std::unique_ptr<util::Thread_pool> _decode_pool;
+
+			auto _upload(Job&) -> std::size_t;
+	};
+	extern auto texture_uploader() -> Texture_uploader&;
+
+	/// RGBA8 texture without filtering, used to pass small tables to shaders
+	class Data_texture : public Texture {
+		public:
+			Data_texture(int width, int height);
+
+			/// replaces the content; expects width*height*4 bytes
+			void update(const uint8_t* data);
+	};
+
 	class Atlas_texture;
 
 	class Texture_atlas : public std::enable_shared_from_this<Texture_atlas> {
@@ -132,7 +202,7 @@ namespace asset {
 
 		static RT load(istream in) throw(Loading_failed) {
 			constexpr auto cube_aid = util::Str_id{"tex_cube"};
-			return std::make_shared<renderer::Texture>(in.bytes(), in.aid().type()==cube_aid);
+			return std::make_shared<renderer::Texture>(in.bytes(), in.aid().type()==cube_aid, in.aid().str());
 		}
 
 		static void store(ostream out, const renderer::Texture& asset) throw(Loading_failed) {
@@ -0,0 +1,497 @@
+#include "triangulation.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace lux {
+namespace renderer {
+
+	namespace {
+		using glm::vec2;
+
+		/// > 0 if (a, b, c) is counter-clockwise
+		auto orientation(vec2 a, vec2 b, vec2 c) {
+			return (b.x-a.x)*(c.y-a.y) - (b.y-a.y)*(c.x-a.x);
+		}
+
+		/// 1 for counter-clockwise and -1 for clockwise polygons
+		auto winding(const std::vector<vec2>& polygon) {
+			auto area = 0.f;
+			for(auto i=std::size_t(0); i<polygon.size(); ++i) {
+				auto& p  = polygon[i];
+				auto& pn = polygon[(i+1) % polygon.size()];
+				area += p.x*pn.y - pn.x*p.y;
+			}
+			return area>=0.f ? 1.f : -1.f;
+		}
+
+		/// includes the edges, triangle has to be oriented like 'dir'
+		auto in_triangle(vec2 p, vec2 a, vec2 b, vec2 c, float dir) {
+			return orientation(a,b,p)*dir>=0.f
+			    && orientation(b,c,p)*dir>=0.f
+			    && orientation(c,a,p)*dir>=0.f;
+		}
+
+		/// true if the segments cross, touching endpoints are ignored
+		auto segments_cross(vec2 a, vec2 b, vec2 c, vec2 d) {
+			auto o1 = orientation(a,b,c);
+			auto o2 = orientation(a,b,d);
+			auto o3 = orientation(c,d,a);
+			auto o4 = orientation(c,d,b);
+			return ((o1>0.f && o2<0.f) || (o1<0.f && o2>0.f))
+			    && ((o3>0.f && o4<0.f) || (o3<0.f && o4>0.f));
+		}
+
+		/// how often the re-triangulated area around a moved vertex is grown, before giving up
+		constexpr auto max_region_growth = 4;
+		constexpr auto max_region_triangles = std::size_t(256);
+
+		auto edge_key(uint32_t from, uint32_t to) {
+			return (uint64_t(from) << 32) | to;
+		}
+
+		class Point_grid {
+			public:
+				Point_grid(const std::vector<vec2>& points, const std::vector<uint8_t>& include) {
+					_min = _max = points.front();
+					for(auto& p : points) {
+						_min = glm::min(_min, p);
+						_max = glm::max(_max, p);
+					}
+
+					auto cells = std::max(1, static_cast<int>(std::sqrt(float(points.size()))));
+					_columns = _rows = cells;
+					auto size = glm::max(_max-_min, vec2(0.0001f, 0.0001f));
+					_scale = vec2(_columns, _rows) / size;
+
+					// counting sort into one flat array
+					_cell_begin.assign(std::size_t(_columns*_rows + 1), 0);
+					for(auto i=std::size_t(0); i<points.size(); ++i) {
+						if(include[i])
+							_cell_begin[_cell(points[i])+1]++;
+					}
+					for(auto i=std::size_t(1); i<_cell_begin.size(); ++i) {
+						_cell_begin[i] += _cell_begin[i-1];
+					}
+
+					_indices.resize(_cell_begin.back());
+					auto fill = _cell_begin;
+					for(auto i=std::size_t(0); i<points.size(); ++i) {
+						if(include[i])
+							_indices[fill[_cell(points[i])]++] = static_cast<uint32_t>(i);
+					}
+				}
+
+				/// calls f(index) for all points in cells that overlap the rect, until f returns true
+				template<typename F>
+				auto any(vec2 min, vec2 max, F&& f)const -> bool {
+					auto x0 = _column(min.x), x1 = _column(max.x);
+					auto y0 = _row(min.y),    y1 = _row(max.y);
+
+					for(auto y=y0; y<=y1; ++y) {
+						for(auto x=x0; x<=x1; ++x) {
+							auto cell = std::size_t(y*_columns + x);
+							for(auto i=_cell_begin[cell]; i<_cell_begin[cell+1]; ++i) {
+								if(f(_indices[i]))
+									return true;
+							}
+						}
+					}
+
+					return false;
+				}
+
+			private:
+				vec2 _min, _max, _scale;
+				int _columns, _rows;
+				std::vector<uint32_t> _cell_begin;
+				std::vector<uint32_t> _indices;
+
+				auto _column(float x)const {
+					return glm::clamp(static_cast<int>((x-_min.x)*_scale.x), 0, _columns-1);
+				}
+				auto _row(float y)const {
+					return glm::clamp(static_cast<int>((y-_min.y)*_scale.y), 0, _rows-1);
+				}
+				auto _cell(vec2 p)const -> std::size_t {
+					return std::size_t(_row(p.y)*_columns + _column(p.x));
+				}
+		};
+	}
+
+	auto triangulate(const std::vector<vec2>& points, std::vector<uint32_t>& triangles) -> std::size_t {
+		triangles.clear();
+
+		auto n = points.size();
+		if(n<3)
+			return n;
+
+		triangles.reserve((n-2)*3);
+
+		auto dir = winding(points);
+
+		// circular doubly linked list of the remaining vertices
+		auto prev = std::vector<uint32_t>(n);
+		auto next = std::vector<uint32_t>(n);
+		for(auto i=std::size_t(0); i<n; ++i) {
+			prev[i] = static_cast<uint32_t>(i>0 ? i-1 : n-1);
+			next[i] = static_cast<uint32_t>((i+1) % n);
+		}
+
+		auto convexity = [&](uint32_t i) {
+			return orientation(points[prev[i]], points[i], points[next[i]]) * dir;
+		};
+
+		// vertices only change from reflex to convex while ears are clipped
+		auto reflex = std::vector<uint8_t>(n);
+		for(auto i=uint32_t(0); i<n; ++i) {
+			reflex[i] = convexity(i)<0.f;
+		}
+		auto removed = std::vector<uint8_t>(n, 0);
+
+		auto grid = Point_grid(points, reflex);
+
+		auto is_ear = [&](uint32_t i) {
+			auto a = points[prev[i]];
+			auto b = points[i];
+			auto c = points[next[i]];
+
+			return !grid.any(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)), [&](uint32_t r) {
+				if(!reflex[r] || removed[r] || r==prev[i] || r==i || r==next[i])
+					return false;
+
+				auto& p = points[r];
+				// duplicates of the corners don't block the ear
+				if(p==a || p==b || p==c)
+					return false;
+
+				return in_triangle(p, a, b, c, dir);
+			});
+		};
+
+		auto remove = [&](uint32_t i) {
+			auto p = prev[i];
+			auto nx = next[i];
+			next[p] = nx;
+			prev[nx] = p;
+			removed[i] = true;
+			reflex[p] = reflex[p] && convexity(p)<0.f;
+			reflex[nx] = reflex[nx] && convexity(nx)<0.f;
+		};
+
+		auto remaining = n;
+		auto i = uint32_t(0);
+		auto stalled = std::size_t(0);
+		while(remaining>3 && stalled<=remaining) {
+			auto c = convexity(i);
+
+			if(c==0.f) {
+				// collinear or duplicate => removing it doesn't change the area
+				auto nx = next[i];
+				remove(i);
+				remaining--;
+				i = nx;
+				stalled = 0;
+
+			} else if(c>0.f && is_ear(i)) {
+				triangles.push_back(prev[i]);
+				triangles.push_back(i);
+				triangles.push_back(next[i]);
+
+				auto nx = next[i];
+				remove(i);
+				remaining--;
+				i = nx;
+				stalled = 0;
+
+			} else {
+				i = next[i];
+				stalled++;
+			}
+		}
+
+		if(remaining==3) {
+			if(convexity(i)!=0.f) {
+				triangles.push_back(prev[i]);
+				triangles.push_back(i);
+				triangles.push_back(next[i]);
+			}
+			return 0;
+		}
+
+		return remaining;
+	}
+
+	auto triangulation_valid_after_move(const std::vector<vec2>& points,
+	                                    const std::vector<uint32_t>& triangles,
+	                                    std::size_t vertex) -> bool {
+		auto n = points.size();
+		if(n<3 || triangles.empty() || vertex>=n)
+			return false;
+
+		auto dir = winding(points);
+		auto v = static_cast<uint32_t>(vertex);
+		auto& vp = points[v];
+
+		auto fan = std::vector<std::size_t>();
+		auto other = triangles.size(); //< any triangle not touching v
+		for(auto t=std::size_t(0); t<triangles.size(); t+=3) {
+			if(triangles[t]==v || triangles[t+1]==v || triangles[t+2]==v)
+				fan.push_back(t);
+			else if(other==triangles.size())
+				other = t;
+		}
+
+		if(fan.empty())
+			return false;
+
+		// the rest of the triangulation has to match the (possibly changed) winding of the polygon
+		if(other<triangles.size()
+		   && orientation(points[triangles[other]], points[triangles[other+1]], points[triangles[other+2]])*dir<=0.f)
+			return false;
+
+		// no triangle of the fan may flip and together they may not wrap around v
+		auto angle_sum = 0.f;
+		for(auto t : fan) {
+			auto& a = points[triangles[t]];
+			auto& b = points[triangles[t+1]];
+			auto& c = points[triangles[t+2]];
+			if(orientation(a,b,c)*dir<=0.f)
+				return false;
+
+			auto corner = triangles[t]==v ? 0 : (triangles[t+1]==v ? 1 : 2);
+			auto e1 = points[triangles[t + (corner+1)%3]] - vp;
+			auto e2 = points[triangles[t + (corner+2)%3]] - vp;
+			angle_sum += std::atan2(std::abs(e1.x*e2.y - e1.y*e2.x), glm::dot(e1, e2));
+		}
+		if(angle_sum >= 2.f*glm::pi<float>())
+			return false;
+
+		// no other vertex may lie inside of the fan
+		for(auto t : fan) {
+			auto& a = points[triangles[t]];
+			auto& b = points[triangles[t+1]];
+			auto& c = points[triangles[t+2]];
+
+			for(auto u=uint32_t(0); u<n; ++u) {
+				if(u==triangles[t] || u==triangles[t+1] || u==triangles[t+2])
+					continue;
+
+				auto& p = points[u];
+				if(p!=a && p!=b && p!=c && in_triangle(p, a, b, c, dir))
+					return false;
+			}
+		}
+
+		// and the moved edges may not cross any other edge
+		auto pv = static_cast<uint32_t>(v>0 ? v-1 : n-1);
+		auto nv = static_cast<uint32_t>((v+1) % n);
+		for(auto j=uint32_t(0); j<n; ++j) {
+			auto jn = static_cast<uint32_t>((j+1) % n);
+			auto& a = points[j];
+			auto& b = points[jn];
+
+			if(j!=pv && jn!=pv && j!=v && jn!=v && segments_cross(points[pv], vp, a, b))
+				return false;
+			if(j!=v && jn!=v && j!=nv && jn!=nv && segments_cross(vp, points[nv], a, b))
+				return false;
+		}
+
+		return true;
+	}
+
+	auto retriangulate_after_move(const std::vector<vec2>& points, std::vector<uint32_t>& triangles,
+	                              std::size_t vertex) -> bool {
+		if(triangulation_valid_after_move(points, triangles, vertex))
+			return true;
+
+		auto n = points.size();
+		if(n<4 || triangles.size()!=(n-2)*3 || vertex>=n)
+			return false;
+
+		auto dir = winding(points);
+		auto v = static_cast<uint32_t>(vertex);
+		auto pv = static_cast<uint32_t>(v>0 ? v-1 : n-1);
+		auto nv = static_cast<uint32_t>((v+1) % n);
+
+		// the polygon itself has to stay simple
+		for(auto j=uint32_t(0); j<n; ++j) {
+			auto jn = static_cast<uint32_t>((j+1) % n);
+			if(segments_cross(points[pv], points[v], points[j], points[jn])
+			   || segments_cross(points[v], points[nv], points[j], points[jn]))
+				return false;
+		}
+
+		auto triangle_count = triangles.size() / 3;
+		auto in_region = std::vector<uint8_t>(triangle_count, 0);
+		for(auto t=std::size_t(0); t<triangle_count; ++t) {
+			auto tri = &triangles[t*3];
+			in_region[t] = tri[0]==v || tri[1]==v || tri[2]==v;
+		}
+
+		auto edges = std::vector<uint64_t>();
+		auto next = std::vector<uint32_t>(n);
+		auto outgoing = std::vector<uint8_t>(n);
+		auto on_boundary = std::vector<uint8_t>(n);
+		auto boundary = std::vector<uint32_t>();
+		auto sub_points = std::vector<vec2>();
+		auto sub_triangles = std::vector<uint32_t>();
+
+		for(auto growth=0; growth<=max_region_growth; ++growth) {
+			// all directed edges of the region, the boundary edges are those without a twin
+			edges.clear();
+			for(auto t=std::size_t(0); t<triangle_count; ++t) {
+				if(!in_region[t])
+					continue;
+
+				auto tri = &triangles[t*3];
+				for(auto e=0; e<3; ++e) {
+					edges.push_back(edge_key(tri[e], tri[(e+1)%3]));
+				}
+			}
+			if(edges.size()/3 > max_region_triangles)
+				return false;
+
+			std::sort(edges.begin(), edges.end());
+			auto is_boundary = [&](uint32_t from, uint32_t to) {
+				return !std::binary_search(edges.begin(), edges.end(), edge_key(to, from));
+			};
+
+			// the boundary has to be a single cycle without touching itself
+			auto boundary_edges = std::size_t(0);
+			auto simple = true;
+			for(auto e : edges) {
+				auto from = static_cast<uint32_t>(e >> 32);
+				auto to = static_cast<uint32_t>(e);
+				if(!is_boundary(from, to))
+					continue;
+
+				simple &= !outgoing[from];
+				outgoing[from] = true;
+				next[from] = to;
+				boundary_edges++;
+			}
+
+			boundary.clear();
+			if(simple && outgoing[v]) {
+				auto i = v;
+				do {
+					boundary.push_back(i);
+					i = next[i];
+				} while(i!=v && boundary.size()<=boundary_edges);
+				simple = i==v && boundary.size()==boundary_edges;
+			}
+			for(auto e : edges) {
+				outgoing[e >> 32] = false;
+			}
+
+			auto valid = simple && !boundary.empty();
+
+			if(valid) {
+				sub_points.clear();
+				for(auto i : boundary) {
+					sub_points.push_back(points[i]);
+					on_boundary[i] = true;
+				}
+				auto m = sub_points.size();
+
+				// neither inverted nor self intersecting
+				valid = winding(sub_points)==dir;
+				for(auto a=std::size_t(0); valid && a<m; ++a) {
+					for(auto b=a+2; valid && b<m; ++b) {
+						if(a==0 && b==m-1)
+							continue;
+
+						valid = !segments_cross(sub_points[a], sub_points[(a+1)%m],
+						                        sub_points[b], sub_points[(b+1)%m]);
+					}
+				}
+
+				valid = valid && triangulate(sub_points, sub_triangles)==0
+				        && sub_triangles.size()==(m-2)*3;
+
+				// the new triangles may not overlap the rest of the triangulation
+				for(auto t=std::size_t(0); valid && t<sub_triangles.size(); t+=3) {
+					auto& a = sub_points[sub_triangles[t]];
+					auto& b = sub_points[sub_triangles[t+1]];
+					auto& c = sub_points[sub_triangles[t+2]];
+					if(orientation(a,b,c)*dir<=0.f) {
+						valid = false;
+						break;
+					}
+
+					for(auto u=uint32_t(0); u<n; ++u) {
+						if(!on_boundary[u] && in_triangle(points[u], a, b, c, dir)) {
+							valid = false;
+							break;
+						}
+					}
+				}
+				for(auto t=std::size_t(0); valid && t<triangle_count; ++t) {
+					if(in_region[t])
+						continue;
+
+					auto tri = &triangles[t*3];
+					if(in_triangle(points[v], points[tri[0]], points[tri[1]], points[tri[2]], dir)) {
+						valid = false;
+						break;
+					}
+					for(auto e=0; e<3; ++e) {
+						auto& a = points[tri[e]];
+						auto& b = points[tri[(e+1)%3]];
+						if(segments_cross(points[pv], points[v], a, b)
+						   || segments_cross(points[v], points[nv], a, b)) {
+							valid = false;
+							break;
+						}
+					}
+				}
+
+				for(auto i : boundary) {
+					on_boundary[i] = false;
+				}
+			}
+
+			if(valid) {
+				auto out = std::size_t(0);
+				for(auto t=std::size_t(0); t<triangle_count; ++t) {
+					if(!in_region[t]) {
+						std::copy_n(triangles.begin()+t*3, 3, triangles.begin()+out);
+						out += 3;
+					}
+				}
+				triangles.resize(out);
+				for(auto i : sub_triangles) {
+					triangles.push_back(boundary[i]);
+				}
+				return true;
+			}
+
+			// grow the region by all triangles that share an edge with it
+			auto grown = false;
+			for(auto t=std::size_t(0); t<triangle_count; ++t) {
+				if(in_region[t])
+					continue;
+
+				auto tri = &triangles[t*3];
+				for(auto e=0; e<3; ++e) {
+					if(std::binary_search(edges.begin(), edges.end(), edge_key(tri[(e+1)%3], tri[e]))) {
+						in_region[t] = true;
+						grown = true;
+						break;
+					}
+				}
+			}
+			if(!grown)
+				return false;
+		}
+
+		return false;
+	}
+
+}
+}
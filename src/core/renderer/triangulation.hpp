@@ -0,0 +1,53 @@
+/** triangulation of simple polygons *****************************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <vector>
+#include <cstdint>
+
+
+namespace lux {
+namespace renderer {
+
+	/*
+	 * Triangulates a simple polygon (clockwise or counter-clockwise) by ear
+	 *   clipping and writes three indices per triangle into 'triangles'.
+	 * Only reflex vertices can lie inside of an ear, so they are kept in a
+	 *   uniform grid and each ear test only checks the cells its bounds overlap.
+	 * Collinear and duplicate points are removed without creating triangles.
+	 * Returns the number of vertices that couldn't be clipped, i.e. 0 on success.
+	 */
+	extern auto triangulate(const std::vector<glm::vec2>& polygon,
+	                        std::vector<uint32_t>& triangles) -> std::size_t;
+
+	/*
+	 * Checks if 'triangles' (created by triangulate()) are still a valid
+	 *   triangulation after polygon[vertex] has been moved.
+	 * That's the case if the fan of triangles around the vertex didn't fold
+	 *   over and neither contains other vertices nor crosses other edges.
+	 */
+	extern auto triangulation_valid_after_move(const std::vector<glm::vec2>& polygon,
+	                                           const std::vector<uint32_t>& triangles,
+	                                           std::size_t vertex) -> bool;
+
+	/*
+	 * Updates 'triangles' (created by triangulate()) after polygon[vertex] has
+	 *   been moved, without re-triangulating the whole polygon.
+	 * Only the triangles around the vertex are replaced. If the moved vertex left
+	 *   their area, it's grown by the neighbouring triangles a few times.
+	 * Returns false (and leaves 'triangles' unchanged) if no local update was
+	 *   possible, in which case triangulate() has to be called.
+	 */
+	extern auto retriangulate_after_move(const std::vector<glm::vec2>& polygon,
+	                                     std::vector<uint32_t>& triangles,
+	                                     std::size_t vertex) -> bool;
+
+}
+}
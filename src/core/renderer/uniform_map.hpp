@@ -16,6 +16,8 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <array>
+#include <algorithm>
+#include <cstring>
 
 
 namespace lux {
@@ -35,6 +37,12 @@ namespace renderer {
 		return static_cast<unsigned int>(type) >> 4;
 	}
 
+	namespace detail {
+		constexpr auto next_pow2(std::size_t v, std::size_t p=1) -> std::size_t {
+			return p>=v ? p : next_pow2(v, p*2);
+		}
+	}
+
 	struct IUniform_map {
 		virtual ~IUniform_map() = default;
 
@@ -53,11 +61,14 @@ namespace renderer {
 	};
 
 	/// provies enough slots for up to 'max_size' uniforms and storage for
-	/// a combined size of 'max_size'*'average_size'
-	template<std::size_t max_slots, std::size_t average_size=sizeof(float)*4>
+	/// a combined size of 'max_size'*'average_size'.
+	/// The uniform locations for the last 'cached_programs' programs it has been
+	/// bound to are cached, so bind_all only has to look up names once per program.
+	template<std::size_t max_slots, std::size_t average_size=sizeof(float)*4,
+	         std::size_t cached_programs=1>
 	class Uniform_map : public IUniform_map {
 		public:
-			using this_t = Uniform_map<max_slots, average_size>;
+			using this_t = Uniform_map<max_slots, average_size, cached_programs>;
 
 			auto emplace(const char* name,       float      val) -> this_t& override final;
 			auto emplace(const char* name,       int        val) -> this_t& override final;
@@ -75,6 +86,13 @@ namespace renderer {
 			struct Uniform {
 				const char* name;
 				Uniform_type type;
+				unsigned int offset; //< into _data
+				std::size_t hash;
+			};
+			struct Location_cache {
+				uint32_t build_id = 0;
+				unsigned int slots = 0; //< number of slots that have already been resolved
+				std::array<int, max_slots> locations;
 			};
 
 			std::array<Uniform, max_slots> _metadata;
@@ -82,6 +100,14 @@ namespace renderer {
 			unsigned int _next_metadata = 0;
 			unsigned int _next_data = 0;
 
+			/// open addressing table of (index into _metadata)+1 or 0 for empty buckets
+			std::array<uint16_t, detail::next_pow2(max_slots*2)> _index {};
+
+			mutable std::array<Location_cache, cached_programs> _location_caches;
+			mutable unsigned int _next_location_cache = 0;
+
+			auto _locations(Shader_program&)const -> const Location_cache&;
+
 			template<Uniform_type type>
 			int _get_slot(const char* name)noexcept;
 
@@ -94,6 +120,15 @@ namespace renderer {
 
 
 	namespace detail {
+		// FNV-1a
+		inline auto hash_uniform_name(const char* str)noexcept -> std::size_t {
+			auto hash = std::size_t(2166136261u);
+			for(; *str; ++str) {
+				hash = (hash ^ static_cast<unsigned char>(*str)) * 16777619u;
+			}
+			return hash;
+		}
+
 		constexpr auto sum() -> std::size_t {
 			return 0;
 		}
@@ -132,60 +167,60 @@ namespace renderer {
 
 
 	// impl
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, float val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, float val) -> this_t& {
 		_data.at(_get_slot<Uniform_type::floating_point>(name)) = val;
 		return *this;
 	}
 
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, int val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, int val) -> this_t& {
 		_data.at(_get_slot<Uniform_type::integer>(name)) = static_cast<float>(val);
 		return *this;
 	}
 
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, glm::vec2 val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, glm::vec2 val) -> this_t& {
 		auto index = _get_slot<Uniform_type::fvec2>(name);
 		std::memcpy(&_data.at(index), glm::value_ptr(val), 2*sizeof(float));
 		return *this;
 	}
 
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, glm::vec3 val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, glm::vec3 val) -> this_t& {
 		auto index = _get_slot<Uniform_type::fvec3>(name);
 		std::memcpy(&_data.at(index), glm::value_ptr(val), 3*sizeof(float));
 		return *this;
 	}
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, glm::vec4 val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, glm::vec4 val) -> this_t& {
 		auto index = _get_slot<Uniform_type::fvec4>(name);
 		std::memcpy(&_data.at(index), glm::value_ptr(val), 4*sizeof(float));
 		return *this;
 	}
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, const glm::mat2& val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, const glm::mat2& val) -> this_t& {
 		auto index = _get_slot<Uniform_type::fmat2>(name);
 		std::memcpy(&_data.at(index), glm::value_ptr(val), 2*2*sizeof(float));
 		return *this;
 	}
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, const glm::mat3& val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, const glm::mat3& val) -> this_t& {
 		auto index = _get_slot<Uniform_type::fmat3>(name);
 		std::memcpy(&_data.at(index), glm::value_ptr(val), 3*3*sizeof(float));
 		return *this;
 	}
-	template<std::size_t max_slots, std::size_t average_size>
-	auto Uniform_map<max_slots,average_size>::emplace(const char* name, const glm::mat4& val) -> this_t& {
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::emplace(const char* name, const glm::mat4& val) -> this_t& {
 		auto index = _get_slot<Uniform_type::fmat4>(name);
 		std::memcpy(&_data.at(index), glm::value_ptr(val), 4*4*sizeof(float));
 		return *this;
 	}
 
 
-	template<std::size_t max_slots, std::size_t average_size>
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
 	template<Uniform_type type>
-	int Uniform_map<max_slots,average_size>::_get_slot(const char* name)noexcept {
+	int Uniform_map<max_slots,average_size,cached_programs>::_get_slot(const char* name)noexcept {
 		int slot = _find_existing<type>(name);
 		if(slot>=0)
 			return slot;
@@ -193,9 +228,9 @@ namespace renderer {
 		else return _reserve<type>(name);
 	}
 
-	template<std::size_t max_slots, std::size_t average_size>
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
 	template<Uniform_type type>
-	int Uniform_map<max_slots,average_size>::_reserve(const char* name)noexcept {
+	int Uniform_map<max_slots,average_size,cached_programs>::_reserve(const char* name)noexcept {
 		constexpr auto size = uniform_size(type) / sizeof(float);
 
 		INVARIANT(_next_data+size<=_data.size(), "Not enough space in uniform map");
@@ -204,93 +239,113 @@ namespace renderer {
 		auto& metadata = _metadata.at(_next_metadata++);
 		metadata.name = name;
 		metadata.type = type;
+		metadata.offset = _next_data;
+		metadata.hash = detail::hash_uniform_name(name);
+
+		for(auto i=metadata.hash; ; ++i) {
+			auto& index = _index[i & (_index.size()-1)];
+			if(index==0) {
+				index = static_cast<uint16_t>(_next_metadata);
+				break;
+			}
+		}
 
 		auto start_idx = _next_data;
 		_next_data += size;
 		return start_idx;
 	}
 
-	template<std::size_t max_slots, std::size_t average_size>
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
 	template<Uniform_type type>
-	int Uniform_map<max_slots,average_size>::_find_existing(const char* name)noexcept {
-		auto search = [&](auto&& comp) {
-			auto data_idx = 0;
+	int Uniform_map<max_slots,average_size,cached_programs>::_find_existing(const char* name)noexcept {
+		auto hash = detail::hash_uniform_name(name);
+
+		for(auto i=hash; ; ++i) {
+			auto slot = _index[i & (_index.size()-1)];
+			if(slot==0)
+				return -1;
+
+			auto& metadata = _metadata[slot-1];
+			if(metadata.name==name || (metadata.hash==hash && std::strcmp(name, metadata.name)==0)) {
+				INVARIANT(metadata.type==type, "Found uniform with same name but different type: "<<((int)metadata.type)<<" vs "<<((int)type));
+				return static_cast<int>(metadata.offset);
+			}
+		}
+	}
 
-			for(auto i=0u; i<_next_metadata; ++i) {
-				if(comp(name, _metadata[i].name)) {
-					INVARIANT(_metadata[i].type==type, "Found uniform with same name but different type: "<<((int)_metadata[i].type)<<" vs "<<((int)type));
-					return data_idx;
-				}
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	void Uniform_map<max_slots,average_size,cached_programs>::clear() {
+		_next_data = 0;
+		_next_metadata = 0;
+		_index.fill(0);
 
-				data_idx+=uniform_size(_metadata[i].type) / sizeof(float);
-			}
+		for(auto& cache : _location_caches)
+			cache.slots = 0;
+	}
 
-			return -1;
-		};
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	auto Uniform_map<max_slots,average_size,cached_programs>::_locations(Shader_program& prog)const
+	        -> const Location_cache& {
+		auto build_id = prog.build_id();
 
-		// search by address
-		auto data_idx = search([](auto a, auto b){return a==b;});
+		auto cache = std::find_if(_location_caches.begin(), _location_caches.end(),
+		                          [&](auto& c){return c.build_id==build_id;});
 
-		// search by value
-		if(data_idx<0)
-			data_idx = search([](auto a, auto b){return std::strcmp(a,b)==0;});
+		if(cache==_location_caches.end()) {
+			cache = _location_caches.begin() + _next_location_cache;
+			_next_location_cache = (_next_location_cache+1) % cached_programs;
+			cache->build_id = build_id;
+			cache->slots = 0;
+		}
 
-		return data_idx;
-	}
+		// resolve all slots that have been added since the last bind
+		for(; cache->slots<_next_metadata; cache->slots++) {
+			cache->locations[cache->slots] = prog.uniform_location(_metadata[cache->slots].name);
+		}
 
-	template<std::size_t max_slots, std::size_t average_size>
-	void Uniform_map<max_slots,average_size>::clear() {
-		_next_data = 0;
-		_next_metadata = 0;
+		return *cache;
 	}
 
-	template<std::size_t max_slots, std::size_t average_size>
-	void Uniform_map<max_slots,average_size>::bind_all(Shader_program& prog)const {
-		auto i=0u;
-		auto data_idx=0u;
-		for(auto& metadata : _metadata) {
-			if(i++ >=_next_metadata)
-				break;
+	template<std::size_t max_slots, std::size_t average_size, std::size_t cached_programs>
+	void Uniform_map<max_slots,average_size,cached_programs>::bind_all(Shader_program& prog)const {
+		auto& locations = _locations(prog).locations;
+
+		for(auto i=0u; i<_next_metadata; ++i) {
+			auto& metadata = _metadata[i];
+			auto location = locations[i];
+			auto data = &_data[metadata.offset];
 
 			switch(metadata.type) {
 				case Uniform_type::integer:
-					prog.set_uniform(metadata.name, static_cast<int>(_data.at(data_idx)));
-					data_idx += 1;
+					prog.set_uniform(location, static_cast<int>(*data));
 					break;
 
 				case Uniform_type::floating_point:
-					prog.set_uniform(metadata.name, static_cast<float>(_data.at(data_idx)));
-					data_idx += 1;
+					prog.set_uniform(location, *data);
 					break;
 
 				case Uniform_type::fvec2:
-					prog.set_uniform(metadata.name, glm::make_vec2(&_data.at(data_idx)));
-					data_idx += 2;
+					prog.set_uniform(location, glm::make_vec2(data));
 					break;
 
 				case Uniform_type::fvec3:
-					prog.set_uniform(metadata.name, glm::make_vec3(&_data.at(data_idx)));
-					data_idx += 3;
+					prog.set_uniform(location, glm::make_vec3(data));
 					break;
 
 				case Uniform_type::fvec4:
-					prog.set_uniform(metadata.name, glm::make_vec4(&_data.at(data_idx)));
-					data_idx += 4;
+					prog.set_uniform(location, glm::make_vec4(data));
 					break;
 
 				case Uniform_type::fmat2:
-					prog.set_uniform(metadata.name, glm::make_mat2(&_data.at(data_idx)));
-					data_idx += 2*2;
+					prog.set_uniform(location, glm::make_mat2(data));
 					break;
 
 				case Uniform_type::fmat3:
-					prog.set_uniform(metadata.name, glm::make_mat3(&_data.at(data_idx)));
-					data_idx += 3*3;
+					prog.set_uniform(location, glm::make_mat3(data));
 					break;
 
 				case Uniform_type::fmat4:
-					prog.set_uniform(metadata.name, glm::make_mat4(&_data.at(data_idx)));
-					data_idx += 4*4;
+					prog.set_uniform(location, glm::make_mat4(data));
 					break;
 
 				default: FAIL("Unexpected Uniform_type: "<<(int)metadata.type);
@@ -1,15 +1,11 @@
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include "gl.hpp"
 
 #include "vertex_object.hpp"
 
 #include "../utils/log.hpp"
 
 #include "shader.hpp"
+#include "render_state.hpp"
 
 namespace lux {
 namespace renderer {
@@ -198,6 +194,7 @@ namespace renderer {
 
 		_index_buffer.process([](auto& b){b._bind();});
 		_layout->_build(_data);
+		render_state().count_draw_call();
 
 		if(_index_buffer.is_some()) {
 			if(count<=0) count = static_cast<int>(ibo.size());
@@ -245,6 +242,7 @@ namespace renderer {
 		}
 
 		glBindVertexArray(_vao_id);
+		render_state().count_draw_call();
 
 		if(_index_buffer.is_some()) {
 			auto& ibo = _index_buffer.get_or_throw();
@@ -32,8 +32,13 @@ namespace util {
 			return buf;
 		}
 
+		std::string& log_dir() {
+			static std::string dir;
+			return dir;
+		}
+
 		std::ostream& get_logfile() {
-			static std::ofstream file("all_"+get_now_short()+".log", std::ofstream::app);
+			static std::ofstream file(log_dir()+"all_"+get_now_short()+".log", std::ofstream::app);
 			static bool first = true;
 			if(first) {
 				file<<std::endl<<std::endl<<"================"<<std::endl;
@@ -44,6 +49,10 @@ namespace util {
 		}
 	}
 
+	void log_directory(const std::string& dir) {
+		log_dir() = dir.empty() || dir.back()=='/' ? dir : dir+"/";
+	}
+
 	struct stacktrace_log_target : log_target {
 		stacktrace_log_target(std::initializer_list<std::ostream*> s) : log_target(s) {}
 
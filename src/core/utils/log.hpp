@@ -8,6 +8,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace lux {
@@ -53,6 +54,9 @@ namespace util {
 	extern log_target& fail (const char* func="", const char* file="", int32_t line=-1)noexcept;
 	extern log_target& crash_report()noexcept;
 
+	/// directory of the all_<date>.log file (default: working directory), has to be set before the first message
+	extern void log_directory(const std::string& dir);
+
 }
 }
 
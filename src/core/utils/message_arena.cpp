@@ -0,0 +1,134 @@
+#include "message_arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace lux {
+namespace util {
+
+	namespace details {
+		// zeroed, so that the first unused entry has a size of 0
+		Arena_page::Arena_page(std::size_t capacity)
+		    : capacity(capacity), data(new char[capacity]()) {}
+	}
+
+	constexpr std::size_t Message_arena::page_size;
+
+	Message_arena::Message_arena() : _active(std::make_unique<details::Arena_generation>()) {
+		_current.store(_active.get());
+	}
+	Message_arena::~Message_arena() {
+		// handles that are still alive at this point would be dangling anyway
+		_free(*_active);
+		for(auto& g : _retired)
+			_free(*g);
+	}
+
+	void Message_arena::_add_page(details::Arena_generation& generation,
+	                              details::Arena_page* full, std::size_t min_size) {
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// another thread has been faster
+		if(generation.pages.load()!=full)
+			return;
+
+		auto capacity = std::max(page_size, min_size);
+		auto page = static_cast<details::Arena_page*>(nullptr);
+
+		if(capacity==page_size && !_free_pages.empty()) {
+			page = _free_pages.back();
+			_free_pages.pop_back();
+		} else {
+			_pages.emplace_back(std::make_unique<details::Arena_page>(capacity));
+			page = _pages.back().get();
+			_pages_allocated++;
+		}
+
+		page->next = full;
+		generation.pages.store(page);
+	}
+
+	auto Message_arena::begin_generation() -> bool {
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if(_active->pages.load()==nullptr)
+			return false;
+
+		_retired.emplace_back(std::move(_active));
+
+		if(!_free_generations.empty()) {
+			_active = std::move(_free_generations.back());
+			_free_generations.pop_back();
+		} else {
+			_active = std::make_unique<details::Arena_generation>();
+		}
+
+		_current.store(_active.get());
+		return true;
+	}
+
+	void Message_arena::reclaim() {
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto done = std::partition(_retired.begin(), _retired.end(), [](auto& g) {
+			return g->refs.load(std::memory_order_acquire)>0;
+		});
+
+		for(auto iter=done; iter!=_retired.end(); ++iter) {
+			_free(**iter);
+			_free_generations.emplace_back(std::move(*iter));
+		}
+		_retired.erase(done, _retired.end());
+	}
+
+	void Message_arena::_free(details::Arena_generation& generation) {
+		auto page = generation.pages.exchange(nullptr);
+
+		while(page) {
+			auto end = std::min(page->used.load(), page->capacity);
+
+			for(auto offset=std::size_t(0); offset<end;) {
+				auto entry = reinterpret_cast<details::Arena_entry*>(page->data.get() + offset);
+				if(entry->size==0)
+					break;
+
+				if(entry->destroy)
+					entry->destroy(entry+1);
+
+				offset += entry->size;
+			}
+
+			std::memset(page->data.get(), 0, end);
+			page->used.store(0);
+
+			auto next = page->next;
+			page->next = nullptr;
+
+			if(page->capacity==page_size) {
+				_free_pages.push_back(page);
+			} else {
+				// oversized pages are not reused
+				auto iter = std::find_if(_pages.begin(), _pages.end(), [&](auto& p){return p.get()==page;});
+				_pages.erase(iter);
+			}
+
+			page = next;
+		}
+
+		generation.refs.store(0);
+	}
+
+	auto Message_arena::stats() -> Stats {
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto s = Stats{};
+		s.messages = _messages.load(std::memory_order_relaxed);
+		s.pages_allocated = _pages_allocated;
+		s.pages_in_use = _pages.size() - _free_pages.size();
+		s.generations_pending = _retired.size();
+		return s;
+	}
+
+}
+}
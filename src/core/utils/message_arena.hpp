@@ -0,0 +1,186 @@
+/** per-frame storage for messages that are shared by all receivers **********
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+
+namespace lux {
+namespace util {
+
+	/*
+	 * Specialize as std::true_type for messages that are large or expensive
+	 *   to copy (e.g. contain shared_ptrs). They are constructed once per send
+	 *   in the Message_arena of the bus and mailboxes only receive an
+	 *   Arena_msg<T> handle, so all receivers share the same instance.
+	 */
+	template<class T>
+	struct is_arena_message : std::false_type {};
+
+	namespace details {
+		struct Arena_page {
+			std::atomic<std::size_t> used {0};
+			std::size_t capacity;
+			Arena_page* next = nullptr;
+			std::unique_ptr<char[]> data;
+
+			explicit Arena_page(std::size_t capacity);
+		};
+
+		/// all messages allocated between two calls of Message_arena::begin_generation()
+		struct Arena_generation {
+			std::atomic<int> refs {0}; //< number of living Arena_msg handles
+			std::atomic<Arena_page*> pages {nullptr};
+		};
+
+		/// stored in front of each message
+		struct Arena_entry {
+			void (*destroy)(void*);
+			std::size_t size; //< including this header; 0 marks the end of a page
+		};
+	}
+
+	/// handle to a message in a Message_arena, that keeps its generation alive
+	template<class T>
+	class Arena_msg {
+		public:
+			Arena_msg()noexcept = default;
+			/// takes over a reference that has already been added to the generation
+			Arena_msg(T* msg, details::Arena_generation* generation)noexcept
+			    : _msg(msg), _generation(generation) {}
+			Arena_msg(const Arena_msg& rhs)noexcept : _msg(rhs._msg), _generation(rhs._generation) {
+				if(_generation)
+					_generation->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+			Arena_msg(Arena_msg&& rhs)noexcept : _msg(rhs._msg), _generation(rhs._generation) {
+				rhs._msg = nullptr;
+				rhs._generation = nullptr;
+			}
+			~Arena_msg() {
+				if(_generation)
+					_generation->refs.fetch_sub(1, std::memory_order_acq_rel);
+			}
+
+			Arena_msg& operator=(Arena_msg rhs)noexcept {
+				std::swap(_msg, rhs._msg);
+				std::swap(_generation, rhs._generation);
+				return *this;
+			}
+
+			auto operator*()const noexcept -> T& {return *_msg;}
+			auto operator->()const noexcept -> T* {return _msg;}
+
+		private:
+			T* _msg = nullptr;
+			details::Arena_generation* _generation = nullptr;
+	};
+
+	/*
+	 * Bump allocator for arena messages, that hands out pages of page_size.
+	 * create() is lock-free (except when a new page is required) and may be
+	 *   called from any thread.
+	 * The messages of a generation are destroyed and its pages reused by
+	 *   reclaim(), after the generation has been ended by begin_generation()
+	 *   and all handles to its messages have been dropped (i.e. all mailboxes
+	 *   have been drained).
+	 */
+	class Message_arena {
+		public:
+			static constexpr auto page_size = std::size_t(16*1024);
+
+			struct Stats {
+				std::size_t messages = 0;         //< in total
+				std::size_t pages_allocated = 0;  //< heap allocations in total
+				std::size_t pages_in_use = 0;
+				std::size_t generations_pending = 0; //< ended but still referenced
+			};
+
+			Message_arena();
+			~Message_arena();
+
+			template<class T, class... Args>
+			auto create(Args&&... args) -> Arena_msg<T>;
+
+			/*
+			 * Ends the current generation. The caller has to make sure that no
+			 *   create() call, that started before, is still running when
+			 *   reclaim() is called.
+			 * Returns false (and does nothing) if the generation is empty.
+			 */
+			auto begin_generation() -> bool;
+			void reclaim();
+
+			auto stats() -> Stats;
+
+			Message_arena(const Message_arena&) = delete;
+			Message_arena& operator=(const Message_arena&) = delete;
+
+		private:
+			using Generation_ptr = std::unique_ptr<details::Arena_generation>;
+
+			std::atomic<details::Arena_generation*> _current;
+			std::atomic<std::size_t> _messages {0};
+
+			std::mutex _mutex;
+			Generation_ptr _active;
+			std::vector<Generation_ptr> _retired;
+			std::vector<Generation_ptr> _free_generations;
+			std::vector<std::unique_ptr<details::Arena_page>> _pages; //< owns all pages
+			std::vector<details::Arena_page*> _free_pages;
+			std::size_t _pages_allocated = 0;
+
+			void _add_page(details::Arena_generation&, details::Arena_page* full, std::size_t min_size);
+			void _free(details::Arena_generation&);
+	};
+
+
+	template<class T, class... Args>
+	auto Message_arena::create(Args&&... args) -> Arena_msg<T> {
+		constexpr auto alignment = alignof(std::max_align_t);
+		static_assert(alignof(T) <= alignment, "Over-aligned messages are not supported");
+		static_assert(sizeof(details::Arena_entry) % alignment == 0, "Arena_entry breaks the alignment");
+
+		constexpr auto size = sizeof(details::Arena_entry) + (sizeof(T)+alignment-1) / alignment * alignment;
+
+		auto generation = _current.load();
+
+		while(true) {
+			auto page = generation->pages.load();
+			if(page) {
+				auto offset = page->used.fetch_add(size);
+				if(offset+size <= page->capacity) {
+					// the entry is valid (but skipped) if the constructor throws
+					auto entry = reinterpret_cast<details::Arena_entry*>(page->data.get() + offset);
+					entry->destroy = nullptr;
+					entry->size = size;
+
+					auto msg = new (entry+1) T{std::forward<Args>(args)...};
+					if(!std::is_trivially_destructible<T>::value) {
+						entry->destroy = +[](void* m) {
+							static_cast<T*>(m)->~T();
+						};
+					}
+
+					generation->refs.fetch_add(1, std::memory_order_relaxed);
+					_messages.fetch_add(1, std::memory_order_relaxed);
+					return Arena_msg<T>{msg, generation};
+				}
+			}
+
+			_add_page(*generation, page, size);
+		}
+	}
+
+}
+}
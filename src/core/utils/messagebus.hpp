@@ -11,6 +11,8 @@
 #include "log.hpp"
 #include "maybe.hpp"
 #include "template_utils.hpp"
+#include "message_arena.hpp"
+#include "messagebus_stats.hpp"
 
 #include <moodycamel/concurrentqueue.hpp>
 
@@ -21,6 +23,9 @@
 #include <algorithm>
 #include <utility>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 
 namespace lux {
@@ -31,8 +36,14 @@ namespace util {
 	constexpr auto default_mailbox_size = 128;
 	constexpr auto default_msg_batch_size = 4;
 
+	/// type of the messages in the mailboxes for T
+	template<class T>
+	using mailbox_msg_t = std::conditional_t<is_arena_message<T>::value, Arena_msg<T>, T>;
+
 	template<class T>
 	class Mailbox {
+		static_assert(!is_arena_message<T>::value, "Arena messages are received through Mailbox<Arena_msg<T>>");
+
 		public:
 			Mailbox(Message_bus& bus, std::size_t size=default_msg_batch_size);
 			Mailbox(Message_bus&&) = delete;
@@ -42,6 +53,9 @@ namespace util {
 			auto receive() -> maybe<T>;
 			template<std::size_t Size>
 			auto receive(T (&target)[Size]) -> std::size_t;
+			/// passes up to max messages directly from the queue to the handler
+			template<typename Func>
+			auto receive(Func& handler, std::size_t max) -> std::size_t;
 
 			auto empty()const noexcept -> bool;
 
@@ -56,6 +70,9 @@ namespace util {
 			moodycamel::ConcurrentQueue<T> _queue;
 			Message_bus& _bus;
 			std::atomic<bool> _active {true};
+
+			// not conditional, so the layout doesn't depend on MESSAGEBUS_STATS
+			details::Mailbox_counters* _counters = nullptr;
 	};
 
 	class Mailbox_collection {
@@ -85,9 +102,7 @@ namespace util {
 				send<Msg>(util::typeuid_of<void>(), std::forward<Arg>(arg)...);
 			}
 			template<typename Msg, typename... Arg>
-			void send(Typeuid self, Arg&&... arg) {
-				send_msg(Msg{std::forward<Arg>(arg)...}, self);
-			}
+			void send(Typeuid self, Arg&&... arg);
 
 			template<typename Msg>
 			void send_msg(const Msg& msg, Typeuid self);
@@ -96,29 +111,44 @@ namespace util {
 			void disable();
 
 		private:
+			// the type specific parts are instances of templated trampolines
 			struct Sub {
+				Typeuid type;
 				std::shared_ptr<void> box;
-				std::function<void(Sub&)> handler;
-				std::function<void(Sub&, bool)> activator;
+				std::shared_ptr<void> handler;
+				void (*receive)(void* box, void* handler);
+				void (*activate)(void* box, bool active);
 			};
 
 			Message_bus& _bus;
-			std::unordered_map<Typeuid, Sub> _boxes;
+			std::vector<Sub> _boxes; //< sorted by type
+
+			auto _find(Typeuid type) -> std::vector<Sub>::iterator;
 	};
 
 
+	/*
+	 * The mailboxes are stored in an immutable table, that is replaced
+	 *   (copy-on-write) whenever a mailbox is (un)registered. So send() can be
+	 *   called from any thread without locking, while (un)registration only
+	 *   serializes with each other.
+	 * Old tables are freed after all sends that might still use them have
+	 *   finished: at the latest in update() or immediately in
+	 *   unregister_mailbox(), which has to make sure that the mailbox is no
+	 *   longer used when it returns.
+	 */
 	class Message_bus {
 		public:
 			Message_bus();
-			Message_bus(Message_bus&&) = default;
 			~Message_bus();
-			auto create_child() -> Message_bus;
+			auto create_child() -> std::unique_ptr<Message_bus>;
 
 			template<typename T>
 			void register_mailbox(Mailbox<T>& mailbox, Typeuid self=0);
 			template<typename T>
 			void unregister_mailbox(Mailbox<T>& mailbox);
 
+			/// frees old versions of the mailbox table; called once per frame
 			void update();
 
 			template<typename Msg, typename... Arg>
@@ -127,21 +157,26 @@ namespace util {
 			}
 			template<typename Msg, typename... Arg>
 			void send_others(Typeuid self, Arg&&... arg) {
-				send_msg(Msg{std::forward<Arg>(arg)...}, self);
+				_send<Msg>(is_arena_message<Msg>{}, self, std::forward<Arg>(arg)...);
 			}
 
 			template<typename Msg>
-			void send_msg(const Msg& msg, Typeuid self);
+			void send_msg(const Msg& msg, Typeuid self) {
+				_send<Msg>(is_arena_message<Msg>{}, self, msg);
+			}
+
+			/// allocations of arena messages (shared by the whole bus hierarchy)
+			auto arena_stats() {return _root->_arena->stats();}
+
+			Message_bus(const Message_bus&) = delete;
+			Message_bus& operator=(const Message_bus&) = delete;
 
 		private:
-			Message_bus(Message_bus* parent);
+			explicit Message_bus(Message_bus* parent);
 
 			struct Mailbox_ref {
 				template<typename T>
-				Mailbox_ref(Mailbox<T>& mailbox, Typeuid self=0) ;
-
-				template<typename T>
-				void exec_send(const T& m, Typeuid self);
+				Mailbox_ref(Mailbox<T>& mailbox, Typeuid self=0);
 
 				bool operator==(const Mailbox_ref& rhs)const noexcept {
 					return _type==rhs._type && _mailbox==rhs._mailbox;
@@ -150,25 +185,52 @@ namespace util {
 				Typeuid _self;
 				Typeuid _type;
 				void* _mailbox;
-				std::function<void(void*, const void*)> _send;
-				bool _deleted = false;
+				void (*_send)(void* mailbox, const void* msg);
 			};
 
-			auto& group(Typeuid id) {
-				if(std::size_t(id)>=_mb_groups.size()) {
-					_mb_groups.resize(id+1);
-					_mb_groups.back().reserve(4);
-				}
-				return _mb_groups[id];
-			}
+			struct Table {
+				std::vector<std::vector<Mailbox_ref>> groups; //< indexed by typeuid
+				std::vector<Message_bus*> children;
+			};
+
+			// marks a send, that may be using the current table
+			class Read_guard {
+				public:
+					Read_guard(Message_bus& bus);
+					~Read_guard();
+
+				private:
+					Message_bus& _bus;
+					int _epoch;
+			};
 
 			Message_bus* _parent;
-			std::vector<Message_bus*> _children;
+			Message_bus* _root;
+			std::unique_ptr<Message_arena> _arena; //< only used by the root
+
+			std::atomic<const Table*> _table;
+			std::atomic<int> _epoch {0};
+			std::atomic<int> _readers[2];
 
-			std::vector<std::vector<Mailbox_ref>> _mb_groups;
+			std::mutex _write_mutex;
+			std::vector<std::unique_ptr<const Table>> _retired;
+
+			template<typename Msg, typename... Arg>
+			void _send(std::false_type, Typeuid self, Arg&&... arg);
+			template<typename Msg>
+			void _send(std::false_type, Typeuid self, const Msg& msg);
+			template<typename Msg, typename... Arg>
+			void _send(std::true_type, Typeuid self, Arg&&... arg);
+
+			/// passes the message to all matching mailboxes of this bus and its children
+			template<typename Msg>
+			auto _deliver(const Msg& msg, Typeuid self) -> std::size_t;
 
-			std::vector<Mailbox_ref> _add_queue;
-			std::vector<Mailbox_ref> _remove_queue;
+			/// publishes a modified copy of the current table; has to be called with _write_mutex
+			template<typename F>
+			void _modify(F&& f);
+			/// waits until no send is using a retired table; has to be called with _write_mutex
+			void _synchronize();
 	};
 
 }
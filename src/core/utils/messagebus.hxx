@@ -6,24 +6,38 @@
 
 #include "reflection.hpp"
 
+#ifdef MESSAGEBUS_STATS
+	#include <chrono>
+#endif
+
 
 namespace lux {
 namespace util {
 
 	template<class T>
 	Mailbox<T>::Mailbox(Message_bus& bus, std::size_t size) : _queue(size,0,4), _bus(bus) {
+#ifdef MESSAGEBUS_STATS
+		_counters = details::register_mailbox(details::msg_type_counters<T>());
+#endif
 		_bus.register_mailbox(*this);
 	}
 
 	template<class T>
 	Mailbox<T>::~Mailbox() {
 		_bus.unregister_mailbox(*this);
+#ifdef MESSAGEBUS_STATS
+		details::unregister_mailbox(_counters);
+#endif
 	}
 
 	template<class T>
 	void Mailbox<T>::send(const T& v) {
-		if(_active.load())
+		if(_active.load()) {
 			_queue.enqueue(v);
+#ifdef MESSAGEBUS_STATS
+			details::update_max(_counters->max_queue_depth, _queue.size_approx());
+#endif
+		}
 	}
 
 	template<class T>
@@ -42,6 +56,35 @@ namespace util {
 		return _queue.try_dequeue_bulk(target, Size);
 	}
 
+	namespace details {
+		/// output iterator that passes each dequeued message directly to a handler
+		template<class T, typename Func>
+		struct Handler_iterator {
+			Func* handler;
+
+			auto& operator*()noexcept {return *this;}
+			auto& operator++()noexcept {return *this;}
+			auto& operator++(int)noexcept {return *this;}
+
+			// not noexcept, so the queue cleans up its block if the handler throws
+			auto& operator=(T&& msg) {
+				(*handler)(unwrap(msg));
+				return *this;
+			}
+
+			template<class M>
+			static auto& unwrap(M& msg)noexcept {return msg;}
+			template<class M>
+			static auto& unwrap(Arena_msg<M>& msg)noexcept {return *msg;}
+		};
+	}
+
+	template<class T>
+	template<typename Func>
+	auto Mailbox<T>::receive(Func& handler, std::size_t max) -> std::size_t {
+		return _queue.try_dequeue_bulk(details::Handler_iterator<T, Func>{&handler}, max);
+	}
+
 	template<class T>
 	auto Mailbox<T>::empty()const noexcept -> bool {
 		return _queue.size_approx() <= 0;
@@ -54,40 +97,68 @@ namespace util {
 	namespace details {
 		template<class T, std::size_t size, typename Func>
 		void receive_bulk(void* box, Func& handler) {
-			using namespace std;
-
 			INVARIANT(box, "No subscription for given type");
 
-			T msg[size];
-			auto& cbox = *static_cast<Mailbox<T>*>(box);
+			// a partial batch means the queue was empty
+			auto& cbox = *static_cast<Mailbox<mailbox_msg_t<T>>*>(box);
 
+#ifdef MESSAGEBUS_STATS
+			auto start = std::chrono::steady_clock::now();
+			auto handled = std::size_t(0);
 			auto count = std::size_t(0);
 			do {
-				count = cbox.receive(msg);
+				count = cbox.receive(handler, size);
+				handled += count;
+			} while(count==size);
+
+			if(handled>0) {
+				auto& counters = msg_type_counters<T>();
+				auto time = std::chrono::steady_clock::now() - start;
+				counters.handled += handled;
+				counters.handler_time_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+			}
+#else
+			while(cbox.receive(handler, size)==size) {
+			}
+#endif
+		}
+
+		template<class T, std::size_t size, typename Func>
+		void receive_trampoline(void* box, void* handler) {
+			receive_bulk<T, size>(box, *static_cast<Func*>(handler));
+		}
 
-				for_each(begin(msg), begin(msg)+count, handler);
-			} while(count>0);
+		template<class T>
+		void activate_trampoline(void* box, bool active) {
+			auto mb = static_cast<Mailbox<mailbox_msg_t<T>>*>(box);
+			if(active)
+				mb->enable();
+			else
+				mb->disable();
 		}
 	}
 
+	inline auto Mailbox_collection::_find(Typeuid type) -> std::vector<Sub>::iterator {
+		return std::lower_bound(_boxes.begin(), _boxes.end(), type, [](const Sub& s, Typeuid t) {
+			return s.type<t;
+		});
+	}
+
 	template<class T, std::size_t bulk_size, typename Func>
 	void Mailbox_collection::subscribe(std::size_t queue_size, Func handler) {
 		using namespace std;
 
-		INVARIANT(_boxes.find(typeuid_of<T>())==_boxes.end(), "Listener already registered!");
-
-		auto& box = _boxes[typeuid_of<T>()];
-		box.box = make_shared<Mailbox<T>>(_bus, queue_size);
-		box.handler = [handler](Sub& s) {
-			details::receive_bulk<T, bulk_size>(s.box.get(), handler);
-		};
-		box.activator = [](Sub& s, bool active) {
-			auto mb = static_cast<Mailbox<T>*>(s.box.get());
-			if(active)
-				mb->enable();
-			else
-				mb->disable();
-		};
+		auto type = typeuid_of<T>();
+		auto iter = _find(type);
+		INVARIANT(iter==_boxes.end() || iter->type!=type, "Listener already registered!");
+
+		_boxes.insert(iter, Sub{
+			type,
+			make_shared<Mailbox<mailbox_msg_t<T>>>(_bus, queue_size),
+			make_shared<Func>(std::move(handler)),
+			&details::receive_trampoline<T, bulk_size, Func>,
+			&details::activate_trampoline<T>
+		});
 	}
 	template<std::size_t bulk_size,
 	         std::size_t queue_size,
@@ -102,19 +173,29 @@ namespace util {
 
 	template<class T>
 	void Mailbox_collection::unsubscribe() {
-		_boxes.erase(typeuid_of<T>());
+		auto type = typeuid_of<T>();
+		auto iter = _find(type);
+		if(iter!=_boxes.end() && iter->type==type)
+			_boxes.erase(iter);
 	}
 
 	template<class T, std::size_t size, typename Func>
 	void Mailbox_collection::receive(Func handler) {
-		auto& box = _boxes[typeuid_of<T>()];
-		details::receive_bulk<size>(box.box.get(), handler);
+		auto type = typeuid_of<T>();
+		auto iter = _find(type);
+		INVARIANT(iter!=_boxes.end() && iter->type==type, "No subscription for given type");
+
+		details::receive_bulk<T, size>(iter->box.get(), handler);
 	}
 
 	inline void Mailbox_collection::update_subscriptions() {
 		for(auto& b : _boxes)
-			if(b.second.handler)
-				b.second.handler(b.second);
+			b.receive(b.box.get(), b.handler.get());
+	}
+
+	template<typename Msg, typename... Arg>
+	void Mailbox_collection::send(Typeuid self, Arg&&... arg) {
+		_bus.send_others<Msg>(self, std::forward<Arg>(arg)...);
 	}
 
 	template<typename Msg>
@@ -124,13 +205,13 @@ namespace util {
 
 	inline void Mailbox_collection::enable() {
 		for(auto& b : _boxes) {
-			b.second.activator(b.second, true);
+			b.activate(b.box.get(), true);
 		}
 	}
 
 	inline void Mailbox_collection::disable() {
 		for(auto& b : _boxes) {
-			b.second.activator(b.second, false);
+			b.activate(b.box.get(), false);
 		}
 	}
 
@@ -144,94 +225,190 @@ namespace util {
 		}) {
 	}
 
-	template<typename T>
-	void Message_bus::Mailbox_ref::exec_send(const T& m, Typeuid self) {
-		if(_deleted)
-			return;
+	/*
+	 * Sends count themselves in one of two counters (selected by _epoch).
+	 * _synchronize() switches the epoch and waits for the old counter to
+	 *   drain. Sends that see a different epoch after incrementing the counter
+	 *   retry, so every counted send has loaded a table that was current
+	 *   during its epoch.
+	 */
+	inline Message_bus::Read_guard::Read_guard(Message_bus& bus) : _bus(bus) {
+		while(true) {
+			_epoch = _bus._epoch.load();
+			_bus._readers[_epoch].fetch_add(1);
+			if(_bus._epoch.load()==_epoch)
+				break;
+
+			_bus._readers[_epoch].fetch_sub(1);
+		}
+	}
+	inline Message_bus::Read_guard::~Read_guard() {
+		_bus._readers[_epoch].fetch_sub(1);
+	}
 
-		assert(_type==typeuid_of<T>() && "Types don't match");
+	template<typename F>
+	void Message_bus::_modify(F&& f) {
+		auto current = _table.load();
+		auto next = std::make_unique<Table>(*current);
+		f(*next);
 
-		if(_self!=0 && self==_self) {
-			return;
-		}
+		_table.store(next.release());
+		_retired.emplace_back(current);
+	}
+
+	inline void Message_bus::_synchronize() {
+		auto epoch = _epoch.load();
+		_epoch.store(1-epoch);
 
-		_send(_mailbox, static_cast<const void*>(&m));
+		while(_readers[epoch].load()!=0)
+			std::this_thread::yield();
 	}
 
 	template<typename T>
 	void Message_bus::register_mailbox(Mailbox<T>& mailbox, Typeuid self) {
-		// TODO: mutex
-		_add_queue.emplace_back(mailbox, self);
+		std::lock_guard<std::mutex> lock(_write_mutex);
+
+		_modify([&](Table& table) {
+			auto id = std::size_t(typeuid_of<T>());
+			if(id>=table.groups.size())
+				table.groups.resize(id+1);
+
+			table.groups[id].emplace_back(mailbox, self);
+		});
 	}
 
 	template<typename T>
 	void Message_bus::unregister_mailbox(Mailbox<T>& mailbox) {
-		// TODO: mutex
-		_remove_queue.emplace_back(mailbox);
-
-		// required to avoid segfaults, caused by events during shutdown
-		auto& groups = group(typeuid_of<T>());
-		auto mb = std::find(groups.begin(), groups.end(), Mailbox_ref{mailbox});
-		if(mb!=groups.end()) {
-			mb->_deleted = true;
-		} else {
-			//ERROR("Tried to unregister nonexistent mailbox for "<<typeName<T>());
-		}
+		std::lock_guard<std::mutex> lock(_write_mutex);
+
+		_modify([&](Table& table) {
+			auto id = std::size_t(typeuid_of<T>());
+			if(id<table.groups.size())
+				util::erase_fast(table.groups[id], Mailbox_ref{mailbox});
+		});
+
+		// the mailbox is destroyed after this call
+		_synchronize();
+		_retired.clear();
 	}
 
 	inline void Message_bus::update() {
-		for(auto& m : _add_queue) {
-			group(m._type).emplace_back(std::move(m));
-		}
-		_add_queue.clear();
+		{
+			std::lock_guard<std::mutex> lock(_write_mutex);
+
+			// arena messages are only allocated inside a Read_guard of the root
+			auto arena_generation_ended = _arena && _arena->begin_generation();
 
-		for(auto& m : _remove_queue) {
-			util::erase_fast(group(m._type), m);
+			if(!_retired.empty() || arena_generation_ended) {
+				_synchronize();
+				_retired.clear();
+			}
+
+			if(_arena)
+				_arena->reclaim();
 		}
-		_remove_queue.clear();
 
-		for(auto& c : _children)
+		Read_guard guard{*this};
+		for(auto& c : _table.load()->children)
 			c->update();
 	}
 
 
+	namespace details {
+		template<typename Msg>
+		void count_send(std::size_t fan_out, std::size_t bytes) {
+#ifdef MESSAGEBUS_STATS
+			auto& counters = msg_type_counters<Msg>();
+			counters.sent++;
+			counters.bytes += bytes + fan_out*sizeof(mailbox_msg_t<Msg>);
+			counters.delivered += fan_out;
+			update_max(counters.max_fan_out, fan_out);
+#else
+			(void) fan_out;
+			(void) bytes;
+#endif
+		}
+	}
+
+	template<typename Msg, typename... Arg>
+	void Message_bus::_send(std::false_type, Typeuid self, Arg&&... arg) {
+		auto fan_out = _deliver(Msg{std::forward<Arg>(arg)...}, self);
+		details::count_send<Msg>(fan_out, 0);
+	}
 	template<typename Msg>
-	void Message_bus::send_msg(const Msg& msg, Typeuid self) {
-		auto id = typeuid_of<Msg>();
+	void Message_bus::_send(std::false_type, Typeuid self, const Msg& msg) {
+		auto fan_out = _deliver(msg, self);
+		details::count_send<Msg>(fan_out, 0);
+	}
+	template<typename Msg, typename... Arg>
+	void Message_bus::_send(std::true_type, Typeuid self, Arg&&... arg) {
+		auto msg = [&] {
+			Read_guard guard{*_root};
+			return _root->_arena->template create<Msg>(std::forward<Arg>(arg)...);
+		}();
+
+		// only the handle is copied into the mailboxes
+		auto fan_out = _deliver(msg, self);
+		details::count_send<Msg>(fan_out, sizeof(Msg));
+	}
 
-		if(std::size_t(id) <_mb_groups.size()) {
-			for(auto& mb : _mb_groups[id]) {
-				mb.exec_send(msg, self);
+	template<typename Msg>
+	auto Message_bus::_deliver(const Msg& msg, Typeuid self) -> std::size_t {
+		auto id = std::size_t(typeuid_of<Msg>());
+		auto fan_out = std::size_t(0);
+
+		Read_guard guard{*this};
+		auto& table = *_table.load();
+
+		if(id<table.groups.size()) {
+			for(auto& mb : table.groups[id]) {
+				if(mb._self==0 || self!=mb._self) {
+					mb._send(mb._mailbox, static_cast<const void*>(&msg));
+					fan_out++;
+				}
 			}
 		}
 
-		for(auto& c : _children)
-			c->send_msg(msg, self);
+		for(auto& c : table.children)
+			fan_out += c->_deliver(msg, self);
+
+		return fan_out;
 	}
 
-	inline Message_bus::Message_bus() : _parent(nullptr) {
+	inline Message_bus::Message_bus() : Message_bus(nullptr) {
 	}
-	inline Message_bus::Message_bus(Message_bus* parent) : _parent(parent) {
-		_parent->_children.push_back(this);
+	inline Message_bus::Message_bus(Message_bus* parent)
+	    : _parent(parent), _root(parent ? parent->_root : this),
+	      _arena(parent ? nullptr : std::make_unique<Message_arena>()),
+	      _table(new Table()) {
+		_readers[0].store(0);
+		_readers[1].store(0);
+
+		if(_parent) {
+			std::lock_guard<std::mutex> lock(_parent->_write_mutex);
+			_parent->_modify([&](Table& table) {
+				table.children.push_back(this);
+			});
+		}
 	}
 	inline Message_bus::~Message_bus() {
 		if(_parent) {
-			util::erase_fast(_parent->_children, this);
-		}
-
-		for(auto& m : _remove_queue) {
-			util::erase_fast(group(m._type), m);
+			std::lock_guard<std::mutex> lock(_parent->_write_mutex);
+			_parent->_modify([&](Table& table) {
+				util::erase_fast(table.children, this);
+			});
+			_parent->_synchronize();
+			_parent->_retired.clear();
 		}
 
-		int i=0;
-		for(auto& group : _mb_groups) {
-			INVARIANT(group.empty(), "Mailboxes leaked for "<<group.at(i)._type<<", "<<group.size()<<"left");
-			i++;
+		auto table = std::unique_ptr<const Table>(_table.load());
+		for(auto i=std::size_t(0); i<table->groups.size(); i++) {
+			INVARIANT(table->groups[i].empty(), "Mailboxes leaked for type "<<i<<", "<<table->groups[i].size()<<" left");
 		}
 	}
 
-	inline auto Message_bus::create_child() -> Message_bus {
-		return Message_bus(this);
+	inline auto Message_bus::create_child() -> std::unique_ptr<Message_bus> {
+		return std::unique_ptr<Message_bus>(new Message_bus(this));
 	}
 
 }
@@ -0,0 +1,160 @@
+#include "messagebus_stats.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+
+namespace lux {
+namespace util {
+
+	namespace {
+		struct Registry {
+			std::mutex mutex;
+			std::deque<details::Msg_type_counters> types;
+			std::vector<std::unique_ptr<details::Mailbox_counters>> mailboxes;
+			uint64_t next_mailbox_id = 0;
+		};
+		auto registry() -> Registry& {
+			static Registry r;
+			return r;
+		}
+
+		void write_string(std::ostream& out, const std::string& str) {
+			out<<'"';
+			for(auto c : str) {
+				if(c=='"' || c=='\\')
+					out<<'\\';
+				out<<c;
+			}
+			out<<'"';
+		}
+	}
+
+	namespace details {
+		auto register_msg_type(std::string name) -> Msg_type_counters& {
+			auto& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.types.emplace_back(std::move(name));
+			return r.types.back();
+		}
+
+		auto register_mailbox(Msg_type_counters& type) -> Mailbox_counters* {
+			auto& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.mailboxes.emplace_back(std::make_unique<Mailbox_counters>(type, r.next_mailbox_id++));
+			return r.mailboxes.back().get();
+		}
+
+		void unregister_mailbox(Mailbox_counters* mailbox) {
+			auto& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+
+			update_max(mailbox->type.max_queue_depth, mailbox->max_queue_depth.load());
+
+			auto iter = std::find_if(r.mailboxes.begin(), r.mailboxes.end(), [&](auto& m) {
+				return m.get()==mailbox;
+			});
+			if(iter!=r.mailboxes.end())
+				r.mailboxes.erase(iter);
+		}
+	}
+
+	auto message_type_stats() -> std::vector<Message_type_stats> {
+		auto& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+
+		auto stats = std::vector<Message_type_stats>();
+		stats.reserve(r.types.size());
+
+		for(auto& t : r.types) {
+			auto s = Message_type_stats{};
+			s.type = t.type;
+			s.sent = t.sent.load();
+			s.bytes = t.bytes.load();
+			s.delivered = t.delivered.load();
+			s.max_fan_out = t.max_fan_out.load();
+			s.handled = t.handled.load();
+			s.handler_time_ms = t.handler_time_ns.load() / 1000000.0;
+			s.max_queue_depth = t.max_queue_depth.load();
+			stats.emplace_back(std::move(s));
+		}
+
+		for(auto& m : r.mailboxes) {
+			auto type = std::find_if(r.types.begin(), r.types.end(), [&](auto& t){return &t==&m->type;});
+			auto& s = stats.at(std::size_t(type - r.types.begin()));
+			s.max_queue_depth = std::max(s.max_queue_depth, m->max_queue_depth.load());
+		}
+
+		return stats;
+	}
+
+	auto mailbox_stats() -> std::vector<Mailbox_stats> {
+		auto& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+
+		auto stats = std::vector<Mailbox_stats>();
+		stats.reserve(r.mailboxes.size());
+
+		for(auto& m : r.mailboxes) {
+			stats.push_back(Mailbox_stats{m->type.type, m->id, m->max_queue_depth.load()});
+		}
+
+		return stats;
+	}
+
+	void reset_message_bus_stats() {
+		auto& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+
+		for(auto& t : r.types) {
+			t.sent = 0;
+			t.bytes = 0;
+			t.delivered = 0;
+			t.max_fan_out = 0;
+			t.handled = 0;
+			t.handler_time_ns = 0;
+			t.max_queue_depth = 0;
+		}
+		for(auto& m : r.mailboxes) {
+			m->max_queue_depth = 0;
+		}
+	}
+
+	void write_message_bus_stats(std::ostream& out) {
+		auto types = message_type_stats();
+		auto mailboxes = mailbox_stats();
+
+		out<<"{\n\t\"types\": [";
+		auto first = true;
+		for(auto& t : types) {
+			out<<(first ? "\n" : ",\n")<<"\t\t{\"type\": ";
+			write_string(out, t.type);
+			out<<", \"sent\": "<<t.sent<<", \"bytes\": "<<t.bytes
+			   <<", \"delivered\": "<<t.delivered<<", \"max_fan_out\": "<<t.max_fan_out
+			   <<", \"handled\": "<<t.handled<<", \"handler_time_ms\": "<<t.handler_time_ms
+			   <<", \"max_queue_depth\": "<<t.max_queue_depth<<"}";
+			first = false;
+		}
+
+		out<<"\n\t],\n\t\"mailboxes\": [";
+		first = true;
+		for(auto& m : mailboxes) {
+			out<<(first ? "\n" : ",\n")<<"\t\t{\"type\": ";
+			write_string(out, m.type);
+			out<<", \"id\": "<<m.id<<", \"max_queue_depth\": "<<m.max_queue_depth<<"}";
+			first = false;
+		}
+		out<<"\n\t]\n}\n";
+	}
+
+	void write_message_bus_stats(const std::string& path) {
+		std::ofstream out(path);
+		write_message_bus_stats(out);
+	}
+
+}
+}
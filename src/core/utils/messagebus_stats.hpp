@@ -0,0 +1,105 @@
+/** optional statistics of the message bus ***********************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include "message_arena.hpp"
+#include "reflection.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+namespace lux {
+namespace util {
+
+	/*
+	 * The counters are only recorded if MESSAGEBUS_STATS is defined (debug
+	 *   builds by default). Otherwise all hooks in the Message_bus are removed
+	 *   at compile time and the results are empty.
+	 */
+
+	struct Message_type_stats {
+		std::string type;
+		uint64_t sent = 0;
+		uint64_t bytes = 0;           //< copied into mailboxes (and the arena)
+		uint64_t delivered = 0;       //< sum of the fan-out of all sends
+		uint64_t max_fan_out = 0;
+		uint64_t handled = 0;         //< by Mailbox_collection handlers
+		double handler_time_ms = 0;
+		uint64_t max_queue_depth = 0; //< over all mailboxes, including destroyed ones
+	};
+
+	struct Mailbox_stats {
+		std::string type;
+		uint64_t id;                  //< in order of creation
+		uint64_t max_queue_depth;
+	};
+
+	extern auto message_type_stats() -> std::vector<Message_type_stats>;
+	/// only mailboxes that currently exist
+	extern auto mailbox_stats() -> std::vector<Mailbox_stats>;
+	extern void reset_message_bus_stats();
+	/// writes all counters as JSON
+	extern void write_message_bus_stats(std::ostream&);
+	extern void write_message_bus_stats(const std::string& path);
+
+
+	namespace details {
+		struct Msg_type_counters {
+			const std::string type;
+			std::atomic<uint64_t> sent {0};
+			std::atomic<uint64_t> bytes {0};
+			std::atomic<uint64_t> delivered {0};
+			std::atomic<uint64_t> max_fan_out {0};
+			std::atomic<uint64_t> handled {0};
+			std::atomic<uint64_t> handler_time_ns {0};
+			std::atomic<uint64_t> max_queue_depth {0};
+
+			explicit Msg_type_counters(std::string type) : type(std::move(type)) {}
+		};
+
+		struct Mailbox_counters {
+			Msg_type_counters& type;
+			const uint64_t id;
+			std::atomic<uint64_t> max_queue_depth {0};
+
+			Mailbox_counters(Msg_type_counters& type, uint64_t id) : type(type), id(id) {}
+		};
+
+		extern auto register_msg_type(std::string name) -> Msg_type_counters&;
+		extern auto register_mailbox(Msg_type_counters&) -> Mailbox_counters*;
+		extern void unregister_mailbox(Mailbox_counters*);
+
+		/// arena messages are counted as the message they point to
+		template<class T>
+		struct msg_stats_type {using type = T;};
+		template<class T>
+		struct msg_stats_type<Arena_msg<T>> {using type = T;};
+
+		template<class T>
+		auto msg_type_counters_of() -> Msg_type_counters& {
+			static auto& counters = register_msg_type(typeName<T>());
+			return counters;
+		}
+		template<class T>
+		auto msg_type_counters() -> Msg_type_counters& {
+			return msg_type_counters_of<typename msg_stats_type<T>::type>();
+		}
+
+		inline void update_max(std::atomic<uint64_t>& max, uint64_t value) {
+			auto current = max.load(std::memory_order_relaxed);
+			while(value>current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+			}
+		}
+	}
+
+}
+}
@@ -0,0 +1,81 @@
+/** LSD radix sort for integer keys ******************************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+
+namespace lux {
+namespace util {
+
+	/*
+	 * Stable sort of 'data' by the unsigned integer returned from 'key(element)'.
+	 * Sorts 8 bits per pass and skips all passes in which every key has the
+	 *   same digit (e.g. unused high bits), so most inputs need far less than
+	 *   sizeof(Key) passes. 'tmp' is a scratch buffer that is only kept as a
+	 *   parameter so its capacity can be reused between calls.
+	 */
+	template<class T, class KeyFunc>
+	void radix_sort(std::vector<T>& data, std::vector<T>& tmp, KeyFunc&& key) {
+		using Key = decltype(key(data.front()));
+		constexpr auto digit_bits = 8;
+		constexpr auto buckets = 1 << digit_bits;
+		constexpr auto passes = sizeof(Key)*8 / digit_bits;
+
+		if(data.size()<=1)
+			return;
+
+		// below ~2000 elements the histogram setup costs more than it saves
+		//   (see command_queue_bench)
+		if(data.size()<1024) {
+			std::stable_sort(data.begin(), data.end(), [&](auto& a, auto& b){
+				return key(a) < key(b);
+			});
+			return;
+		}
+
+		// build the histograms for all digits in a single pass
+		std::array<std::array<std::size_t, buckets>, passes> histograms{};
+		for(auto& e : data) {
+			auto k = key(e);
+			for(auto p=0u; p<passes; ++p) {
+				histograms[p][(k >> (p*digit_bits)) & (buckets-1)]++;
+			}
+		}
+
+		tmp.resize(data.size());
+
+		for(auto p=0u; p<passes; ++p) {
+			auto& histogram = histograms[p];
+			auto shift = p*digit_bits;
+
+			// all keys share this digit => order wouldn't change
+			auto first_key_digit = (key(data.front()) >> shift) & (buckets-1);
+			if(histogram[first_key_digit]==data.size())
+				continue;
+
+			auto offset = std::size_t(0);
+			for(auto& count : histogram) {
+				auto c = count;
+				count = offset;
+				offset += c;
+			}
+
+			for(auto& e : data) {
+				tmp[histogram[(key(e) >> shift) & (buckets-1)]++] = e;
+			}
+
+			data.swap(tmp);
+		}
+	}
+
+}
+}
@@ -9,6 +9,7 @@
 
 #include <random>
 #include <ctime>
+#include <cstdint>
 
 namespace lux {
 namespace util {
@@ -79,6 +80,67 @@ namespace util {
 		return v;
 	}
 
+	/*
+	 * xoroshiro128+ (Blackman & Vigna): 16 bytes of state and much cheaper than
+	 *   the mt19937, but not suited for anything security related.
+	 * Usable with random_real()/random_int() or directly through uniform()/fill().
+	 */
+	class Xoroshiro128 {
+		public:
+			using result_type = uint64_t;
+			static constexpr auto min() -> result_type {return 0;}
+			static constexpr auto max() -> result_type {return ~result_type(0);}
+
+			explicit Xoroshiro128(uint64_t seed=0) {
+				this->seed(seed);
+			}
+
+			/// expands the seed with splitmix64, so similar seeds yield unrelated sequences
+			void seed(uint64_t seed) {
+				auto splitmix = [&] {
+					auto z = (seed += 0x9e3779b97f4a7c15ull);
+					z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+					z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+					return z ^ (z >> 31);
+				};
+				_s0 = splitmix();
+				_s1 = splitmix();
+			}
+
+			auto operator()() -> result_type {
+				auto s0 = _s0;
+				auto s1 = _s1;
+				auto result = s0 + s1;
+
+				s1 ^= s0;
+				_s0 = rotl(s0, 55) ^ s1 ^ (s1 << 14);
+				_s1 = rotl(s1, 36);
+
+				return result;
+			}
+
+			/// uniform float in [0,1)
+			auto uniform() -> float {
+				// the upper 24 bits are the best ones and fill the mantissa exactly
+				return static_cast<float>(operator()() >> 40) * (1.f / 16777216.f);
+			}
+
+			/// fills [out, out+count) with uniform floats in [0,1)
+			void fill(float* out, std::size_t count) {
+				for(auto i=std::size_t(0); i<count; ++i) {
+					out[i] = uniform();
+				}
+			}
+
+		private:
+			uint64_t _s0;
+			uint64_t _s1;
+
+			static auto rotl(uint64_t x, int k) -> uint64_t {
+				return (x << k) | (x >> (64 - k));
+			}
+	};
+
 	/*bernoulli_distribution*/
 	template<class Generator>
 	auto random_bool(Generator& gen, float prop) {
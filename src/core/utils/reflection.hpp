@@ -10,6 +10,7 @@
 #include <string>
 #include <typeinfo>
 #include <type_traits>
+#include <atomic>
 
 namespace lux {
 namespace util {
@@ -29,8 +30,9 @@ namespace util {
 		struct Typeuid_gen_base {
 			protected:
 				static auto next_uid()noexcept {
-					static auto idc = Typeuid(1);
-					return idc++;
+					// types may be used for the first time by different threads
+					static std::atomic<Typeuid> idc {1};
+					return idc.fetch_add(1);
 				}
 		};
 		template<typename T>
@@ -0,0 +1,104 @@
+#include "thread_pool.hpp"
+
+#include "log.hpp"
+
+
+namespace lux {
+namespace util {
+
+	namespace {
+		constexpr auto max_default_threads = 8;
+
+		auto default_thread_count() -> int {
+#ifdef EMSCRIPTEN
+			return 1;
+#else
+			auto hw = static_cast<int>(std::thread::hardware_concurrency());
+			return std::max(1, std::min(hw, max_default_threads));
+#endif
+		}
+	}
+
+	auto default_thread_pool() -> Thread_pool& {
+		static Thread_pool pool;
+		return pool;
+	}
+
+	Thread_pool::Thread_pool(int threads) {
+		if(threads<=0)
+			threads = default_thread_count();
+
+#ifndef EMSCRIPTEN
+		_workers.reserve(threads-1);
+		for(auto i=1; i<threads; ++i) {
+			_workers.emplace_back([this]{_worker_loop();});
+		}
+#endif
+
+		INFO("Started thread pool with "<<size()<<" threads");
+	}
+
+	Thread_pool::~Thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_task_added.notify_all();
+
+		for(auto& w : _workers)
+			w.join();
+	}
+
+	void Thread_pool::post(std::function<void()> task) {
+		if(_workers.empty()) {
+			task();
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.emplace_back(std::move(task));
+		}
+		_task_added.notify_one();
+	}
+
+	void Thread_pool::_post_batches(std::size_t helpers, const std::function<void()>& helper) {
+		if(_workers.empty())
+			return;
+
+		helpers = std::min(helpers, _workers.size());
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for(auto i=std::size_t(0); i<helpers; ++i)
+				_batches.emplace_back(helper);
+		}
+		_task_added.notify_all();
+	}
+
+	void Thread_pool::_worker_loop() {
+		while(true) {
+			std::function<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_task_added.wait(lock, [&]{return _quit || !_batches.empty() || !_tasks.empty();});
+
+				if(!_batches.empty()) {
+					task = std::move(_batches.front());
+					_batches.pop_front();
+
+				} else if(!_tasks.empty()) {
+					task = std::move(_tasks.front());
+					_tasks.pop_front();
+
+				} else {
+					return; // _quit is set and nothing left to do
+				}
+			}
+
+			task();
+		}
+	}
+
+}
+}
@@ -0,0 +1,147 @@
+/** simple pool of worker threads *********************************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include "template_utils.hpp"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+
+namespace lux {
+namespace util {
+
+	/*
+	 * Fixed number of worker threads that execute queued tasks.
+	 * The thread calling parallel_for() participates in the work, so a pool
+	 *   of size 1 has no worker threads at all and executes everything inline
+	 *   (always the case for EMSCRIPTEN, which has no threads).
+	 * The batches of parallel_for() are queued in front of post()ed tasks and
+	 *   the caller processes every batch that hasn't been picked up by a
+	 *   worker itself, so it never waits for unrelated tasks.
+	 */
+	class Thread_pool : util::no_copy_move {
+		public:
+			/// threads<=0 uses one thread per hardware thread
+			explicit Thread_pool(int threads=0);
+			~Thread_pool();
+
+			/// number of threads working on a parallel_for (including the caller)
+			auto size()const noexcept -> std::size_t {return _workers.size()+1;}
+
+			/*
+			 * Splits [0, count) into at most size() contiguous ranges of at least
+			 *   min_batch elements and calls f(begin, end, worker_index) for each.
+			 * worker_index is in [0, size()) and unique per call, so it can be used to
+			 *   index per-thread data. Blocks until all ranges have been processed
+			 *   and rethrows the first exception thrown by f.
+			 */
+			template<class F>
+			void parallel_for(std::size_t count, std::size_t min_batch, F&& f);
+
+			/// executes the task on some worker thread (or inline if there is none)
+			void post(std::function<void()> task);
+
+		private:
+			std::vector<std::thread> _workers;
+			std::deque<std::function<void()>> _batches; //< of parallel_for(), processed first
+			std::deque<std::function<void()>> _tasks;
+			std::mutex _mutex;
+			std::condition_variable _task_added;
+			bool _quit = false;
+
+			void _worker_loop();
+			void _post_batches(std::size_t helpers, const std::function<void()>& helper);
+	};
+
+	extern auto default_thread_pool() -> Thread_pool&;
+
+
+	namespace details {
+		struct Parallel_for_state {
+			std::size_t count;
+			std::size_t batches;
+			std::size_t batch_size;
+			std::atomic<std::size_t> next_batch {0};
+
+			std::mutex mutex;
+			std::condition_variable done_cv;
+			std::size_t done_batches = 0;
+			std::exception_ptr error;
+
+			/// claims and processes batches until there are none left
+			template<class F>
+			void process(F& f) {
+				while(true) {
+					auto batch = next_batch.fetch_add(1);
+					if(batch>=batches)
+						return;
+
+					auto begin = batch*batch_size;
+					auto end = std::min(count, begin+batch_size);
+
+					std::exception_ptr e;
+					try {
+						if(begin<end)
+							f(begin, end, batch);
+					} catch(...) {
+						e = std::current_exception();
+					}
+
+					std::lock_guard<std::mutex> lock(mutex);
+					if(e && !error)
+						error = e;
+					if(++done_batches==batches)
+						done_cv.notify_all();
+				}
+			}
+		};
+	}
+
+	template<class F>
+	void Thread_pool::parallel_for(std::size_t count, std::size_t min_batch, F&& f) {
+		if(count==0)
+			return;
+
+		auto batches = std::min(size(), std::max<std::size_t>(1, count/std::max<std::size_t>(1, min_batch)));
+		if(batches<=1) {
+			f(std::size_t(0), count, std::size_t(0));
+			return;
+		}
+
+		// shared with the helpers, that might only be executed after this call returned
+		auto state = std::make_shared<details::Parallel_for_state>();
+		state->count = count;
+		state->batches = batches;
+		state->batch_size = (count + batches-1) / batches;
+
+		// f is only called for claimed batches, which are all done before we return
+		auto fp = &f;
+		_post_batches(batches-1, [state, fp] {
+			state->process(*fp);
+		});
+
+		state->process(f);
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->done_cv.wait(lock, [&]{return state->done_batches==state->batches;});
+
+		if(state->error)
+			std::rethrow_exception(state->error);
+	}
+
+}
+}
@@ -13,6 +13,7 @@
 
 #include <core/input/events.hpp>
 #include <core/input/input_manager.hpp>
+#include <core/utils/random.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -30,7 +31,8 @@ namespace lux {
 		const auto fadeout_sun = Rgb{1.8, 1.75, 0.78} *4.f;
 	}
 
-	Game_screen::Game_screen(Engine& engine, const std::string& level_id, bool add_to_highscore)
+	Game_screen::Game_screen(Engine& engine, const std::string& level_id, bool add_to_highscore,
+	                         const std::string& record_file)
 	    : Screen(engine),
 	      _mailbox(engine.bus()),
 	      _systems(engine),
@@ -74,6 +76,13 @@ namespace lux {
 
 		auto metadata = _systems.load_level(level_id);
 		_music_aid = metadata.music_id;
+
+		if(!record_file.empty()) {
+			auto seed = util::create_random_generator()();
+			_systems.gameplay.seed(seed);
+			_recorder = std::make_unique<Replay_recorder>(engine, record_file, level_id, seed);
+			INFO("Recording replay to "<<record_file);
+		}
 	}
 	Game_screen::~Game_screen()noexcept {
 		_engine.audio_ctx().stop_sounds();
@@ -113,6 +122,8 @@ namespace lux {
 			_fadeout = false;
 			_fadeout_fadetimer = 0_s;
 			_systems.gameplay.reset();
+			if(_recorder)
+				_recorder->reset();
 		}
 
 
@@ -129,11 +140,24 @@ namespace lux {
 				_selection_movement = 0.f;
 		}
 
-		if(_fadeout) {
-			_systems.update(dt, Update::animations | Update::movements | Update::gameplay);
-		} else {
+		auto mask = _fadeout ? Update::animations | Update::movements | Update::gameplay
+		                     : update_all;
+		if(!_fadeout) {
 			_time_acc+=dt;
-			_systems.update(dt, update_all);
+		}
+
+		if(_recorder) {
+			// replays can only be reproduced with fixed ticks
+			_record_tick_acc+=dt;
+			while(_record_tick_acc>=Time{replay_tick}) {
+				_record_tick_acc-=Time{replay_tick};
+				_recorder->begin_tick(mask);
+				_systems.update(Time{replay_tick}, mask);
+				_recorder->end_tick(_systems);
+			}
+
+		} else {
+			_systems.update(dt, mask);
 		}
 
 		if(_systems.gameplay.game_time()>0.0_s) {
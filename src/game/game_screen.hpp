@@ -8,6 +8,7 @@
 #pragma once
 
 #include "meta_system.hpp"
+#include "replay.hpp"
 
 #include <core/renderer/camera.hpp>
 #include <core/renderer/command_queue.hpp>
@@ -20,7 +21,9 @@ namespace lux {
 
 	class Game_screen : public Screen {
 		public:
-			Game_screen(Engine& game_engine, const std::string& level_id, bool add_to_highscore=false);
+			/// a replay of the session is written to record_file, if it's not empty
+			Game_screen(Engine& game_engine, const std::string& level_id, bool add_to_highscore=false,
+			            const std::string& record_file="");
 			~Game_screen()noexcept;
 
 		protected:
@@ -64,6 +67,9 @@ namespace lux {
 
 			Time _time_acc {0};
 
+			std::unique_ptr<Replay_recorder> _recorder;
+			Time _record_tick_acc {0};
+
 			auto _draw_orb(glm::vec2 pos, float scale, ecs::Entity&) -> renderer::Command;
 			void _draw_orbs(sys::gameplay::Player_tag_comp::Pool::iterator selected,
 			                bool left_side, int count, glm::vec2 hud_pos);
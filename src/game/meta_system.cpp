@@ -19,8 +19,12 @@ namespace lux {
 		constexpr auto global_uniforms_size = 6*(4*4)+sys::light::light_uniforms_size;
 		constexpr auto global_uniforms_avg_size = (int)(global_uniforms_size/global_uniforms + 0.5f);
 
+		// bound to every program used in the main and shadowcaster queues
+		constexpr auto global_uniforms_programs = 8;
+
 		using Global_uniform_map = renderer::Uniform_map<global_uniforms,
-		                                                 global_uniforms_avg_size*sizeof(float)>;
+		                                                 global_uniforms_avg_size*sizeof(float),
+		                                                 global_uniforms_programs>;
 
 		auto shadowbuffer_size(Engine& engine) {
 			return glm::vec2{
@@ -263,6 +267,9 @@ namespace lux {
 
 		renderer.post_load();
 
+		// the first frame of the level shouldn't show placeholders
+		texture_uploader().flush();
+
 		return level_meta_data;
 	}
 
@@ -305,7 +312,7 @@ namespace lux {
 		uniforms->emplace("fast_lighting", fast_lighting);
 
 		if(!fast_lighting) {
-			renderer.draw_shadowcaster(lights.shadowcaster_batch(), cam);
+			renderer.draw_shadowcaster(lights.shadowcaster_batch(), cam, lights.shadow_cache());
 		}
 		lights.prepare_draw(queue, cam, !fast_lighting);
 
@@ -0,0 +1,327 @@
+#include "replay.hpp"
+
+#include "sys/physics/physics_comp.hpp"
+#include "sys/physics/transform_comp.hpp"
+
+#include <core/input/input_manager.hpp>
+
+#include <cstring>
+
+
+namespace lux {
+
+	namespace {
+		constexpr char magic[4] = {'L','X','R','P'};
+		constexpr uint16_t version = 1;
+
+		enum class Record_tag : uint8_t {
+			end              = 0, // varint: total number of ticks
+			advance          = 1, // varint: number of ticks to advance
+			once             = 2, // varint: action, i8: source
+			continuous_begin = 3, // varint: action, i8: source
+			continuous_end   = 4, // varint: action, i8: source
+			range            = 5, // varint: action, i8: source, 4xf32: rel, abs
+			pointer          = 6, // 2xf32: world position of the first pointer
+			mask             = 7, // u8: Update_mask of the following ticks
+			hash             = 8, // u64: state_hash() after this tick
+			reset            = 9  // -: Gameplay_system::reset() before this tick
+		};
+
+		auto action_id(uint64_t v) -> input::Action_id {
+			static_assert(sizeof(input::Action_id)==sizeof(v), "Str_id is not a plain uint64_t");
+			auto id = input::Action_id{};
+			std::memcpy(static_cast<void*>(&id), &v, sizeof(v));
+			return id;
+		}
+
+		/// FNV-1a
+		struct Hasher {
+			uint64_t hash = 14695981039346656037ull;
+
+			void add(const void* data, std::size_t size) {
+				auto bytes = static_cast<const uint8_t*>(data);
+				for(auto i=std::size_t(0); i<size; i++) {
+					hash = (hash ^ bytes[i]) * 1099511628211ull;
+				}
+			}
+			void add(float v) {
+				// -0 and 0 are equal states
+				if(v==0.f)
+					v = 0.f;
+				add(&v, sizeof(v));
+			}
+			void add(glm::vec2 v) {
+				add(v.x);
+				add(v.y);
+			}
+			void add(bool v) {
+				add(&v, sizeof(v));
+			}
+		};
+	}
+
+	auto state_hash(Meta_system& systems) -> uint64_t {
+		auto hasher = Hasher{};
+
+		for(auto& transform : systems.entity_manager.list<sys::physics::Transform_comp>()) {
+			auto pos = remove_units(transform.position());
+			hasher.add(pos.x);
+			hasher.add(pos.y);
+			hasher.add(pos.z);
+			hasher.add(transform.rotation().value());
+			hasher.add(transform.scale());
+		}
+
+		for(auto& body : systems.entity_manager.list<sys::physics::Dynamic_body_comp>()) {
+			hasher.add(body.velocity());
+			hasher.add(body.grounded());
+			hasher.add(body.ground_normal());
+		}
+
+		return hasher.hash;
+	}
+
+
+	Replay_recorder::Replay_recorder(Engine& engine, const std::string& path,
+	                                 const std::string& level_id, uint64_t seed, int hash_interval)
+	    : _engine(engine), _mailbox(engine.bus()), _out(path, std::ios::binary),
+	      _seed(seed), _hash_interval(hash_interval) {
+
+		INVARIANT(_out, "Couldn't open replay file: "<<path);
+		INVARIANT(level_id.size()<256, "Level id is too long: "<<level_id);
+
+		_out.write(magic, sizeof(magic));
+		_out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		auto interval = static_cast<uint16_t>(hash_interval);
+		_out.write(reinterpret_cast<const char*>(&interval), sizeof(interval));
+		_out.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+		_write_float(replay_tick);
+		_out.put(static_cast<char>(level_id.size()));
+		_out.write(level_id.data(), static_cast<std::streamsize>(level_id.size()));
+
+		_mailbox.subscribe_to([this](input::Once_action& e) {
+			_tag(static_cast<uint8_t>(Record_tag::once));
+			_write_varint(e.id);
+			_out.put(static_cast<char>(e.src));
+		});
+		_mailbox.subscribe_to([this](input::Continuous_action& e) {
+			_tag(static_cast<uint8_t>(e.begin ? Record_tag::continuous_begin
+			                                : Record_tag::continuous_end));
+			_write_varint(e.id);
+			_out.put(static_cast<char>(e.src));
+		});
+		_mailbox.subscribe_to([this](input::Range_action& e) {
+			_tag(static_cast<uint8_t>(Record_tag::range));
+			_write_varint(e.id);
+			_out.put(static_cast<char>(e.src));
+			_write_float(e.rel.x);
+			_write_float(e.rel.y);
+			_write_float(e.abs.x);
+			_write_float(e.abs.y);
+		});
+	}
+	Replay_recorder::~Replay_recorder() {
+		_tag(static_cast<uint8_t>(Record_tag::end));
+		_write_varint(_tick);
+	}
+
+	void Replay_recorder::begin_tick(Update_mask mask) {
+		// all actions that have been sent since the last tick
+		_mailbox.update_subscriptions();
+
+		// read directly by the Controller_system for mouse look
+		auto pointer = _engine.input().last_pointer_world_position(0);
+		if(pointer!=_pointer) {
+			_pointer = pointer;
+			_tag(static_cast<uint8_t>(Record_tag::pointer));
+			_write_float(pointer.x);
+			_write_float(pointer.y);
+		}
+
+		if(mask!=_mask) {
+			_mask = mask;
+			_tag(static_cast<uint8_t>(Record_tag::mask));
+			_out.put(static_cast<char>(mask));
+		}
+	}
+
+	void Replay_recorder::reset() {
+		_tag(static_cast<uint8_t>(Record_tag::reset));
+	}
+
+	void Replay_recorder::end_tick(Meta_system& systems) {
+		if(_hash_interval>0 && (_tick+1)%_hash_interval == 0) {
+			auto hash = state_hash(systems);
+			_tag(static_cast<uint8_t>(Record_tag::hash));
+			_out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+		}
+
+		_tick++;
+	}
+
+	void Replay_recorder::_tag(uint8_t tag) {
+		if(_written_tick!=_tick) {
+			_out.put(static_cast<char>(Record_tag::advance));
+			_write_varint(_tick - _written_tick);
+			_written_tick = _tick;
+		}
+
+		_out.put(static_cast<char>(tag));
+	}
+	void Replay_recorder::_write_varint(uint64_t v) {
+		do {
+			auto byte = static_cast<uint8_t>(v & 0x7f);
+			v >>= 7;
+			if(v)
+				byte |= 0x80;
+			_out.put(static_cast<char>(byte));
+		} while(v);
+	}
+	void Replay_recorder::_write_float(float v) {
+		_out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+	}
+
+
+	Replay_player::Replay_player(Engine& engine, const std::string& path)
+	    : _engine(engine), _in(path, std::ios::binary) {
+
+		INVARIANT(_in, "Couldn't open replay file: "<<path);
+
+		char file_magic[sizeof(magic)];
+		_in.read(file_magic, sizeof(file_magic));
+		INVARIANT(_in && std::memcmp(file_magic, magic, sizeof(magic))==0, "Not a replay file: "<<path);
+
+		auto file_version = uint16_t(0);
+		_in.read(reinterpret_cast<char*>(&file_version), sizeof(file_version));
+		INVARIANT(_in, "Replay file is truncated: "<<path);
+		INVARIANT(file_version==version, "Unsupported replay version "<<file_version<<" in "<<path);
+
+		auto hash_interval = uint16_t(0);
+		_in.read(reinterpret_cast<char*>(&hash_interval), sizeof(hash_interval));
+		_in.read(reinterpret_cast<char*>(&_seed), sizeof(_seed));
+		INVARIANT(_in, "Replay file is truncated: "<<path);
+
+		auto tick = _read_float();
+		INVARIANT(tick==replay_tick, "Replay "<<path<<" has been recorded with a tick of "<<tick<<"s");
+
+		_level_id.resize(_read_u8());
+		_in.read(&_level_id[0], static_cast<std::streamsize>(_level_id.size()));
+		INVARIANT(_in, "Replay file is truncated: "<<path);
+	}
+
+	auto Replay_player::begin_tick(Meta_system& systems) -> Update_mask {
+		auto& bus = _engine.bus();
+
+		while(!_finished && _next_record_tick==_tick) {
+			auto tag = static_cast<Record_tag>(_read_u8());
+			switch(tag) {
+				case Record_tag::end:
+					_end_tick = static_cast<uint32_t>(_read_varint());
+					_finished = true;
+					break;
+
+				case Record_tag::advance:
+					_next_record_tick += static_cast<uint32_t>(_read_varint());
+					break;
+
+				case Record_tag::once: {
+					auto id = action_id(_read_varint());
+					auto src = static_cast<input::Input_source>(_read_u8());
+					bus.send<input::Once_action>(id, src);
+					break;
+				}
+
+				case Record_tag::continuous_begin:
+				case Record_tag::continuous_end: {
+					auto id = action_id(_read_varint());
+					auto src = static_cast<input::Input_source>(_read_u8());
+					bus.send<input::Continuous_action>(id, src, tag==Record_tag::continuous_begin);
+					break;
+				}
+
+				case Record_tag::range: {
+					auto id = action_id(_read_varint());
+					auto src = static_cast<input::Input_source>(_read_u8());
+					auto rel = glm::vec2{};
+					rel.x = _read_float();
+					rel.y = _read_float();
+					auto abs = glm::vec2{};
+					abs.x = _read_float();
+					abs.y = _read_float();
+					bus.send<input::Range_action>(id, src, rel, abs);
+					break;
+				}
+
+				case Record_tag::pointer: {
+					_pointer.x = _read_float();
+					_pointer.y = _read_float();
+					break;
+				}
+
+				case Record_tag::mask:
+					_mask = _read_u8();
+					break;
+
+				case Record_tag::hash:
+					_in.read(reinterpret_cast<char*>(&_expected_hash), sizeof(_expected_hash));
+					INVARIANT(_in, "Replay file is truncated at tick "<<_tick);
+					_expected_hash_valid = true;
+					break;
+
+				case Record_tag::reset:
+					systems.gameplay.reset();
+					break;
+
+				default:
+					FAIL("Invalid record "<<int(tag)<<" in replay at tick "<<_tick);
+			}
+		}
+
+		// reapplied every tick, because the real mouse would overwrite it
+		_engine.input().last_pointer_world_position(_pointer);
+
+		return _mask;
+	}
+
+	auto Replay_player::end_tick(Meta_system& systems) -> bool {
+		auto valid = true;
+
+		if(_expected_hash_valid) {
+			_expected_hash_valid = false;
+
+			auto hash = state_hash(systems);
+			if(hash!=_expected_hash) {
+				WARN("Replay diverged at tick "<<_tick<<": state hash "<<hash
+				     <<" != "<<_expected_hash);
+				valid = false;
+			}
+		}
+
+		_tick++;
+		return valid;
+	}
+
+	auto Replay_player::_read_u8() -> uint8_t {
+		// get() returns eof() instead of throwing, which would be read as a record 0xFF
+		auto c = _in.get();
+		INVARIANT(c!=std::ifstream::traits_type::eof(), "Replay file is truncated at tick "<<_tick);
+		return static_cast<uint8_t>(c);
+	}
+	auto Replay_player::_read_varint() -> uint64_t {
+		auto v = uint64_t(0);
+		for(auto shift=0; shift<64; shift+=7) {
+			auto byte = _read_u8();
+			v |= uint64_t(byte & 0x7f) << shift;
+			if(!(byte & 0x80))
+				break;
+		}
+		return v;
+	}
+	auto Replay_player::_read_float() -> float {
+		auto v = 0.f;
+		_in.read(reinterpret_cast<char*>(&v), sizeof(v));
+		INVARIANT(_in, "Replay file is truncated at tick "<<_tick);
+		return v;
+	}
+
+}
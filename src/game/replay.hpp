@@ -0,0 +1,112 @@
+/** deterministic recording and replay of play sessions **********************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include "meta_system.hpp"
+
+#include <core/engine.hpp>
+#include <core/input/events.hpp>
+#include <core/utils/messagebus.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+
+namespace lux {
+
+	/// sessions are recorded and replayed in fixed ticks of this length
+	constexpr auto replay_tick = 1.f / 60;
+
+	/// hash of all transforms and body states, used to detect diverging replays
+	extern auto state_hash(Meta_system&) -> uint64_t;
+
+	/*
+	 * Writes the seed, level id and the input actions (and pointer position)
+	 *   of each tick to a compact binary file. The systems have to be updated
+	 *   exactly once per tick with replay_tick:
+	 *     recorder.begin_tick(mask);
+	 *     systems.update(Time{replay_tick}, mask);
+	 *     recorder.end_tick(systems);
+	 *
+	 * File layout (little endian, varint = LEB128):
+	 *   header: "LXRP" u16:version u16:hash_interval u64:seed f32:tick u8:length level_id
+	 *   records: u8:tag followed by its payload (see Record_tag in replay.cpp)
+	 */
+	class Replay_recorder {
+		public:
+			Replay_recorder(Engine&, const std::string& path, const std::string& level_id,
+			                uint64_t seed, int hash_interval=60);
+			~Replay_recorder();
+
+			void begin_tick(Update_mask mask);
+			void end_tick(Meta_system&);
+			/// has to be called (before begin_tick) when the gameplay is reset outside of a tick
+			void reset();
+
+			auto seed()const noexcept {return _seed;}
+
+		private:
+			Engine& _engine;
+			util::Mailbox_collection _mailbox;
+			std::ofstream _out;
+			uint64_t _seed;
+			int _hash_interval;
+
+			uint32_t _tick = 0;
+			uint32_t _written_tick = 0; //< the tick a reader would be at
+			Update_mask _mask = update_all;
+			glm::vec2 _pointer{};
+
+			void _tag(uint8_t tag);
+			void _write_varint(uint64_t v);
+			void _write_float(float v);
+	};
+
+	/*
+	 * Reads a file written by Replay_recorder and sends the recorded input
+	 *   actions through the bus, tick by tick.
+	 * Throws if the file can't be read or is truncated.
+	 */
+	class Replay_player {
+		public:
+			Replay_player(Engine&, const std::string& path);
+
+			auto level_id()const -> const std::string& {return _level_id;}
+			auto seed()const noexcept {return _seed;}
+			auto tick()const noexcept {return _tick;}
+			auto finished()const noexcept {return _finished && _tick>=_end_tick;}
+
+			/// sends the actions of the next tick, reapplies recorded resets
+			///   and returns the update mask to use
+			auto begin_tick(Meta_system&) -> Update_mask;
+			/// returns false if the state differs from the recording
+			auto end_tick(Meta_system&) -> bool;
+
+		private:
+			Engine& _engine;
+			std::ifstream _in;
+			std::string _level_id;
+			uint64_t _seed = 0;
+
+			uint32_t _tick = 0;
+			uint32_t _next_record_tick = 0;
+			uint32_t _end_tick = 0;
+			bool _finished = false;
+			Update_mask _mask = update_all;
+			glm::vec2 _pointer{}; //< last recorded pointer position
+
+			bool _expected_hash_valid = false;
+			uint64_t _expected_hash = 0;
+
+			auto _read_u8() -> uint8_t;
+			auto _read_varint() -> uint64_t;
+			auto _read_float() -> float;
+	};
+
+}
@@ -0,0 +1,93 @@
+#include "replay_screen.hpp"
+
+#include <core/input/events.hpp>
+#include <core/input/input_manager.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+
+namespace lux {
+	using namespace unit_literals;
+
+	namespace {
+		// wall time per frame, after which control is returned to the engine
+		constexpr auto frame_budget = std::chrono::milliseconds(100);
+	}
+
+	Replay_screen::Replay_screen(Engine& engine, const std::string& replay_file, bool draw)
+	    : Screen(engine),
+	      _mailbox(engine.bus()),
+	      _player(engine, replay_file),
+	      _systems(engine),
+	      _draw_enabled(draw)
+	{
+		// only live input can abort the replay, the replayed actions are
+		//   dropped by disabling the mailbox during the ticks (see _update)
+		_mailbox.subscribe_to([&](input::Once_action& e){
+			switch(e.id) {
+				case "back"_strid:
+					_finish();
+					break;
+			}
+		});
+
+		_systems.load_level(_player.level_id());
+		_systems.gameplay.seed(_player.seed());
+
+		INFO("Replaying "<<replay_file<<" (level "<<_player.level_id()<<")");
+	}
+
+	void Replay_screen::_on_enter(util::maybe<Screen&> prev) {
+		// no live input, except for aborting the replay
+		_engine.input().enable_context("replay"_strid);
+	}
+
+	void Replay_screen::_update(Time) {
+		_mailbox.update_subscriptions();
+		if(!_engine.running())
+			return;
+
+		using namespace std::chrono;
+		auto frame_start = steady_clock::now();
+
+		_mailbox.disable();
+		do {
+			auto mask = _player.begin_tick(_systems);
+			if(_player.finished()) {
+				_mailbox.enable();
+				_finish();
+				return;
+			}
+
+			auto start = steady_clock::now();
+			_systems.update(Time{replay_tick}, mask);
+			auto time = duration<double, std::milli>(steady_clock::now() - start).count();
+
+			_update_time_sum += time;
+			_update_time_max = std::max(_update_time_max, time);
+
+			if(!_player.end_tick(_systems))
+				_divergences++;
+
+		} while(!_draw_enabled && steady_clock::now()-frame_start < frame_budget);
+		_mailbox.enable();
+	}
+
+	void Replay_screen::_draw() {
+		if(_draw_enabled)
+			_systems.draw();
+	}
+
+	void Replay_screen::_finish() {
+		auto ticks = _player.tick();
+
+		INFO("Replay finished after "<<ticks<<" ticks:\n"
+		     <<"  update avg: "<<(ticks>0 ? _update_time_sum/ticks : 0.0)<<" ms\n"
+		     <<"  update max: "<<_update_time_max<<" ms\n"
+		     <<"  diverged:   "<<_divergences<<" state hashes");
+
+		_engine.exit();
+	}
+
+}
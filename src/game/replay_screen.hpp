@@ -0,0 +1,51 @@
+/** replays a recorded session as a deterministic benchmark ******************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include "meta_system.hpp"
+#include "replay.hpp"
+
+#include <core/engine.hpp>
+
+
+namespace lux {
+
+	/*
+	 * Runs the ticks of a replay as fast as possible (and without rendering,
+	 *   unless draw is set), measures the time spent in Meta_system::update
+	 *   and exits the engine after the last tick.
+	 */
+	class Replay_screen : public Screen {
+		public:
+			Replay_screen(Engine& game_engine, const std::string& replay_file, bool draw=false);
+			~Replay_screen()noexcept = default;
+
+		protected:
+			void _update(Time delta_time)override;
+			void _draw()override;
+
+			void _on_enter(util::maybe<Screen&> prev) override;
+
+			auto _prev_screen_policy()const noexcept -> Prev_screen_policy override {
+				return Prev_screen_policy::discard;
+			}
+
+		private:
+			util::Mailbox_collection _mailbox;
+			Replay_player _player;
+			Meta_system _systems;
+			bool _draw_enabled;
+
+			double _update_time_sum = 0; //< ms
+			double _update_time_max = 0; //< ms
+			int _divergences = 0;
+
+			void _finish();
+	};
+
+}
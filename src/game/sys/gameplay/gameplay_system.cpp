@@ -69,15 +69,17 @@ namespace gameplay {
 		ecs.register_component_type<Finish_marker_comp>();
 		ecs.register_component_type<Reset_comp>();
 
-		_mailbox.subscribe_to([&](sys::physics::Collision& c) {
-			if(!_level_finished) {
-				this->_on_collision(c);
-			}
-		});
-		_mailbox.subscribe_to([&](sys::physics::Contact& c) {
-			if(!_level_finished) {
-				this->_on_contact(c);
-			}
+		_mailbox.subscribe_to([&](sys::physics::Contact_batch& batch) {
+			batch.process_collisions([&](auto c) {
+				if(!_level_finished) {
+					this->_on_collision(c);
+				}
+			});
+			batch.process_contacts([&](auto c) {
+				if(!_level_finished) {
+					this->_on_contact(c);
+				}
+			});
 		});
 		_mailbox.subscribe_to([&](Animation_event& e){
 			_on_animation_event(e);
@@ -395,7 +397,7 @@ namespace gameplay {
 
 		auto try_smash = [&](ecs::Entity* e) {
 			return e && e->get<Enlightened_comp>().process(false, [&](auto& elc) {
-				ecs::Entity* other = (c.a.get()==&elc.owner()) ? c.b.get() : c.a.get();
+				ecs::Entity* other = (c.a==&elc.owner()) ? c.b : c.a;
 				auto deadly = other && other->has<Deadly_comp>();
 				if((elc._final_booster_left>0_s && c.impact>=elc._smash_force*0.1f) || c.impact>=elc._smash_force || deadly) {
 					return elc.smash();
@@ -408,8 +410,8 @@ namespace gameplay {
 			});
 		};
 
-		try_smash(c.a.get());
-		try_smash(c.b.get());
+		try_smash(c.a);
+		try_smash(c.b);
 	}
 	void Gameplay_system::_on_smashed(ecs::Entity& e) {
 		e.get<Enlightened_comp>().process([&](auto& e) {
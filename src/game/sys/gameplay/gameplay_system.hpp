@@ -51,6 +51,9 @@ namespace gameplay {
 
 			auto game_time()const {return _game_timer;}
 
+			/// makes random effects reproducible (e.g. for replays)
+			void seed(uint64_t s) {_rng.seed(s);}
+
 			void reset();
 
 		private:
@@ -6,6 +6,9 @@
 
 #include <core/units.hpp>
 #include <core/renderer/command_queue.hpp>
+#include <core/utils/thread_pool.hpp>
+
+#include <functional>
 
 
 namespace lux {
@@ -17,6 +20,15 @@ namespace graphic {
 
 	namespace {
 		constexpr auto background_boundary = -10.f;
+		constexpr auto min_sprites_per_thread = 128;
+
+		/// 'type' distinguishes shadowcasting components of the same entity
+		auto occluder_id(const ecs::Entity& owner, uint64_t type) -> uint64_t {
+			return uint64_t(reinterpret_cast<std::uintptr_t>(&owner)) * 4 + type;
+		}
+		auto combine_version(uint64_t version, float v) -> uint64_t {
+			return version ^ (std::hash<float>{}(v) + 0x9e3779b97f4a7c15ull + (version<<6) + (version>>2));
+		}
 
 		auto build_background_shader(asset::Asset_manager& asset_manager) -> Shader_program {
 			Shader_program prog;
@@ -65,96 +77,137 @@ namespace graphic {
 		entity_manager.register_component_type<Terrain_comp>();
 		entity_manager.register_component_type<Terrain_data_comp>();
 
+		auto threads = util::default_thread_pool().size();
+		_worker_batches.reserve(threads-1);
+		for(auto i=1u; i<threads; ++i) {
+			_worker_batches.emplace_back(Sprite_batch(128), Sprite_batch(_background_shader, 64));
+		}
+
 		_mailbox.subscribe_to<16, 128>([&](const State_change& e) {
 			this->_on_state_change(e);
 		});
 	}
 
 	void Graphic_system::draw(renderer::Command_queue& queue, const renderer::Camera& camera)const {
-		for(Sprite_comp& sprite : _sprites) {
-			auto& trans = sprite.owner().get<physics::Transform_comp>().get_or_throw();
-
-			auto decal_offset = glm::vec2{};
-			if(sprite._decals_sticky) {
-				decal_offset.x = sprite._decals_position.x - trans.position().x.value();
-				decal_offset.y = sprite._decals_position.y - trans.position().y.value();
+		_view_center = glm::vec2(camera.eye_position());
+		_view_center_set = true;
+
+		auto& threads = util::default_thread_pool();
+		INVARIANT(_worker_batches.size()+1 >= threads.size(), "Not enough Sprite_batches for all threads");
+
+		// one index space over all pools, so each thread gets a contiguous part of the serial order
+		auto sprites      = _sprites.size();
+		auto anim_sprites = _anim_sprites.size();
+		auto terrains     = _terrains.size();
+
+		threads.parallel_for(sprites+anim_sprites+terrains, min_sprites_per_thread,
+		                     [&](auto begin, auto end, auto worker) {
+			auto& batch = worker==0 ? _sprite_batch    : _worker_batches[worker-1].first;
+			auto& bg    = worker==0 ? _sprite_batch_bg : _worker_batches[worker-1].second;
+
+			for(auto i=begin; i<end; ++i) {
+				if(i<sprites)
+					this->_draw_sprite(_sprites[i], batch, bg);
+				else if(i<sprites+anim_sprites)
+					this->_draw_sprite(_anim_sprites[i-sprites], batch, bg);
+				else
+					this->_draw_terrain(_terrains[i-sprites-anim_sprites], batch, bg);
 			}
+		});
 
-			auto position = remove_units(trans.position());
-			auto sprite_data = renderer::Sprite{
-			                   position, trans.rotation(),
-			                   sprite._size*trans.scale(),
-			                   flip(glm::vec4{0,0,1,1}, trans.flip_vertical(), trans.flip_horizontal()),
-			                   sprite._shadowcaster ? 1.0f : 1.f-sprite._shadow_receiver,
-			                   sprite._decals_intensity, *sprite._material, decal_offset};
-
-			sprite_data.hue_change = {
-			    sprite._hue_change_target / 360_deg,
-			    sprite._hue_change_replacement / 360_deg
-			};
-
-			if(position.z<background_boundary) {
-				_sprite_batch_bg.insert(sprite_data);
-			} else {
-				_sprite_batch.insert(sprite_data);
-			}
+		// merged in thread order, so the result doesn't depend on the number of threads
+		for(auto& worker_batch : _worker_batches) {
+			_sprite_batch.merge(worker_batch.first);
+			_sprite_batch_bg.merge(worker_batch.second);
 		}
 
-		for(Anim_sprite_comp& sprite : _anim_sprites) {
-			auto& trans = sprite.owner().get<physics::Transform_comp>().get_or_throw();
-
-			auto decal_offset = glm::vec2{};
-			if(sprite._decals_sticky) {
-				decal_offset.x = sprite._decals_position.x - trans.position().x.value();
-				decal_offset.y = sprite._decals_position.y - trans.position().y.value();
-			}
+		_sprite_batch.flush(queue);
+		_sprite_batch_bg.flush(queue);
 
-			auto position = remove_units(trans.position());
-			auto sprite_data = renderer::Sprite{
-			                   position, trans.rotation(),
-			                   sprite._size*trans.scale(),
-			                   flip(sprite.state().uv_rect(), trans.flip_vertical(), trans.flip_horizontal()),
-			                   sprite._shadowcaster ? 1.0f : 1.f-sprite._shadow_receiver,
-			                   sprite._decals_intensity, sprite.state().material(), decal_offset};
-
-			sprite_data.hue_change = {
-			    sprite._hue_change_target / 360_deg,
-			    sprite._hue_change_replacement / 360_deg
-			};
+		_particle_renderer.draw(queue);
+	}
+	void Graphic_system::_draw_sprite(Sprite_comp& sprite, Sprite_batch& batch, Sprite_batch& bg)const {
+		auto& trans = sprite.owner().get<physics::Transform_comp>().get_or_throw();
 
-			if(position.z<background_boundary) {
-				_sprite_batch_bg.insert(sprite_data);
-			} else {
-				_sprite_batch.insert(sprite_data);
-			}
+		auto decal_offset = glm::vec2{};
+		if(sprite._decals_sticky) {
+			decal_offset.x = sprite._decals_position.x - trans.position().x.value();
+			decal_offset.y = sprite._decals_position.y - trans.position().y.value();
 		}
 
-		for(Terrain_comp& terrain : _terrains) {
-			auto& trans = terrain.owner().get<physics::Transform_comp>().get_or_throw();
-			auto position = remove_units(trans.position());
+		auto position = remove_units(trans.position());
+		auto sprite_data = renderer::Sprite{
+		                   position, trans.rotation(),
+		                   sprite._size*trans.scale(),
+		                   flip(glm::vec4{0,0,1,1}, trans.flip_vertical(), trans.flip_horizontal()),
+		                   sprite._shadowcaster ? 1.0f : 1.f-sprite._shadow_receiver,
+		                   sprite._decals_intensity, *sprite._material, decal_offset};
+
+		sprite_data.hue_change = {
+		    sprite._hue_change_target / 360_deg,
+		    sprite._hue_change_replacement / 360_deg
+		};
 
-			if(position.z<background_boundary) {
-				terrain._smart_texture.draw(position, _sprite_batch_bg);
-			} else {
-				terrain._smart_texture.draw(position, _sprite_batch);
-			}
+		if(position.z<background_boundary) {
+			bg.insert(sprite_data);
+		} else {
+			batch.insert(sprite_data);
 		}
+	}
+	void Graphic_system::_draw_sprite(Anim_sprite_comp& sprite, Sprite_batch& batch, Sprite_batch& bg)const {
+		auto& trans = sprite.owner().get<physics::Transform_comp>().get_or_throw();
 
-		_sprite_batch.flush(queue);
-		_sprite_batch_bg.flush(queue);
+		auto decal_offset = glm::vec2{};
+		if(sprite._decals_sticky) {
+			decal_offset.x = sprite._decals_position.x - trans.position().x.value();
+			decal_offset.y = sprite._decals_position.y - trans.position().y.value();
+		}
 
-		_particle_renderer.draw(queue);
+		auto position = remove_units(trans.position());
+		auto sprite_data = renderer::Sprite{
+		                   position, trans.rotation(),
+		                   sprite._size*trans.scale(),
+		                   flip(sprite.state().uv_rect(), trans.flip_vertical(), trans.flip_horizontal()),
+		                   sprite._shadowcaster ? 1.0f : 1.f-sprite._shadow_receiver,
+		                   sprite._decals_intensity, sprite.state().material(), decal_offset};
+
+		sprite_data.hue_change = {
+		    sprite._hue_change_target / 360_deg,
+		    sprite._hue_change_replacement / 360_deg
+		};
+
+		if(position.z<background_boundary) {
+			bg.insert(sprite_data);
+		} else {
+			batch.insert(sprite_data);
+		}
 	}
+	void Graphic_system::_draw_terrain(Terrain_comp& terrain, Sprite_batch& batch, Sprite_batch& bg)const {
+		auto& trans = terrain.owner().get<physics::Transform_comp>().get_or_throw();
+		auto position = remove_units(trans.position());
+
+		if(position.z<background_boundary) {
+			terrain._smart_texture.draw(position, bg);
+		} else {
+			terrain._smart_texture.draw(position, batch);
+		}
+	}
+
 	void Graphic_system::draw_shadowcaster(renderer::Sprite_batch& batch,
-	                                       const renderer::Camera&)const {
+	                                       const renderer::Camera&,
+	                                       light::Shadow_cache& cache)const {
 		for(Sprite_comp& sprite : _sprites) {
 			auto& trans = sprite.owner().get<physics::Transform_comp>().get_or_throw();
 
 			auto position = remove_units(trans.position());
 
 			if(sprite._shadowcaster && std::abs(position.z) < 1.0f) {
+				auto size = sprite._size*trans.scale();
+				cache.occluder(occluder_id(sprite.owner(), 0), trans.revision(),
+				               position.xy(), glm::length(size)/2.f);
+
 				batch.insert(renderer::Sprite{position, trans.rotation(),
-				             sprite._size*trans.scale(),
+				             size,
 				             flip(glm::vec4{0,0,1,1}, trans.flip_vertical(), trans.flip_horizontal()),
 				             sprite._shadowcaster ? 1.0f : 0.0f,
 				             sprite._decals_intensity, *sprite._material});
@@ -167,9 +220,20 @@ namespace graphic {
 			auto position = remove_units(trans.position());
 
 			if(sprite._shadowcaster && std::abs(position.z) < 1.0f) {
+				auto size = sprite._size*trans.scale();
+				auto uv_rect = sprite.state().uv_rect();
+
+				// the silhouette changes with every frame of the animation
+				auto version = uint64_t(trans.revision());
+				for(auto i : util::range(4)) {
+					version = combine_version(version, uv_rect[i]);
+				}
+				cache.occluder(occluder_id(sprite.owner(), 1), version,
+				               position.xy(), glm::length(size)/2.f);
+
 				batch.insert(renderer::Sprite{position, trans.rotation(),
-				             sprite._size*trans.scale(),
-				             flip(sprite.state().uv_rect(), trans.flip_vertical(), trans.flip_horizontal()),
+				             size,
+				             flip(uv_rect, trans.flip_vertical(), trans.flip_horizontal()),
 				             sprite._shadowcaster ? 1.0f : 0.0f,
 				             sprite._decals_intensity, sprite.state().material()});
 			}
@@ -180,6 +244,16 @@ namespace graphic {
 			auto position = remove_units(trans.position());
 
 			if(terrain._smart_texture.shadowcaster() && std::abs(position.z) < 1.0f) {
+				// points may be modified by the editor
+				auto version = uint64_t(trans.revision());
+				auto radius = 0.f;
+				for(auto& p : terrain._smart_texture.points()) {
+					version = combine_version(combine_version(version, p.x), p.y);
+					radius = std::max(radius, glm::length(p));
+				}
+				cache.occluder(occluder_id(terrain.owner(), 2), version,
+				               position.xy(), radius);
+
 				terrain._smart_texture.draw(position, batch);
 			}
 		}
@@ -252,6 +326,9 @@ namespace graphic {
 			}
 		}
 
+		if(_view_center_set)
+			_particle_renderer.lod_center(_view_center);
+
 		_particle_renderer.update(dt);
 	}
 
@@ -262,11 +339,7 @@ namespace graphic {
 		_update_particles(0_s);
 
 		// warmup emiters
-		for(auto i : util::range(4*30.f)) {
-			(void)i;
-
-			_particle_renderer.update(1_s/30.f);
-		}
+		_particle_renderer.warmup(4_s);
 	}
 
 	void Graphic_system::_on_state_change(const State_change& s) {
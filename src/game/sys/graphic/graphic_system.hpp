@@ -13,6 +13,7 @@
 #include "decal_comp.hpp"
 
 #include "../../entity_events.hpp"
+#include "../light/shadow_cache.hpp"
 
 #include <core/renderer/camera.hpp>
 #include <core/renderer/sprite_batch.hpp>
@@ -32,7 +33,9 @@ namespace graphic {
 			               asset::Asset_manager& asset_manager);
 
 			void draw(renderer::Command_queue&, const renderer::Camera& camera)const;
-			void draw_shadowcaster(renderer::Sprite_batch&, const renderer::Camera& camera)const;
+			/// also reports all shadowcasters to the cache, so it can detect changes
+			void draw_shadowcaster(renderer::Sprite_batch&, const renderer::Camera& camera,
+			                       light::Shadow_cache& cache)const;
 			void draw_decals(renderer::Command_queue&,
 			                 const renderer::Camera& camera)const;
 			void update(Time dt);
@@ -54,9 +57,18 @@ namespace graphic {
 			renderer::Particle_renderer _particle_renderer;
 			mutable renderer::Sprite_batch _sprite_batch;
 			mutable renderer::Sprite_batch _sprite_batch_bg;
+			/// foreground/background batches of the additional worker threads
+			mutable std::vector<std::pair<renderer::Sprite_batch, renderer::Sprite_batch>> _worker_batches;
 			mutable renderer::Texture_batch _decal_batch;
+			/// position of the last drawn camera, used to throttle distant particle emitters
+			mutable glm::vec2 _view_center;
+			mutable bool _view_center_set = false;
 
 			void _update_particles(Time dt);
+
+			void _draw_sprite(Sprite_comp&, renderer::Sprite_batch&, renderer::Sprite_batch& bg)const;
+			void _draw_sprite(Anim_sprite_comp&, renderer::Sprite_batch&, renderer::Sprite_batch& bg)const;
+			void _draw_terrain(Terrain_comp&, renderer::Sprite_batch&, renderer::Sprite_batch& bg)const;
 	};
 
 }
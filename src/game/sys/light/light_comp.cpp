@@ -66,6 +66,7 @@ namespace light {
 		_direction = direction * 1_deg;
 		_angle = angle * 1_deg;
 		_radius = radius * 1_m;
+		_revision++;
 	}
 
 	void Light_comp::save(sf2::JsonSerializer& state)const {
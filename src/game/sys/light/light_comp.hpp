@@ -24,13 +24,16 @@ namespace light {
 
 			Light_comp(ecs::Entity& owner);
 
-			auto color(Rgb color)noexcept {_color=color;}
+			auto color(Rgb color)noexcept {_color=color; _revision++;}
 			auto color()const noexcept {return _color*_color_factor;}
 			auto radius()const noexcept {return _radius;}
 			auto offset()const noexcept {return _offset;}
-			auto brightness_factor(float f) {_color_factor = f;}
+			auto brightness_factor(float f) {_color_factor = f; _revision++;}
 			auto shadowcaster()const noexcept {return _shadowcaster;}
 
+			/// incremented by every modification (setters and load), so caches can detect changes
+			auto revision()const noexcept {return _revision;}
+
 		private:
 			friend class Light_system;
 
@@ -44,6 +47,7 @@ namespace light {
 			bool _radius_based;
 			Distance _radius;
 			glm::vec3 _offset;
+			uint_fast32_t _revision = 1;
 	};
 
 }
@@ -0,0 +1,164 @@
+#define GLM_SWIZZLE
+
+#include "light_index.hpp"
+
+#include "../physics/transform_comp.hpp"
+
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace lux {
+namespace sys {
+namespace light {
+
+	namespace {
+		constexpr auto cell_size = 8.f;
+
+		auto cell_coord(float v) -> int32_t {
+			return static_cast<int32_t>(std::floor(v / cell_size));
+		}
+		auto cell_key(int32_t x, int32_t y) -> uint64_t {
+			return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+		}
+	}
+
+	Light_index::Light_index(Light_comp::Pool& lights) : _lights(lights) {
+	}
+
+	void Light_index::update() {
+		auto count = static_cast<uint32_t>(_lights.size());
+
+		// pool shrunk => the last slots are gone
+		for(auto i=count; i<_cache.size(); ++i) {
+			_move_to_cell(i, no_cell);
+		}
+		_cache.resize(count);
+
+		for(auto i=0u; i<count; ++i) {
+			auto& light = _lights[i];
+			auto& cached = _cache[i];
+			auto& trans = light.owner().get<physics::Transform_comp>().get_or_throw();
+
+			// pointers are only valid for this frame, because the pools may be reordered
+			cached.light = &light;
+			cached.transform = &trans;
+
+			if(cached.owner==&light.owner() && cached.revision==trans.revision()
+			   && cached.light_revision==light.revision())
+				continue;
+
+			cached.owner = &light.owner();
+			cached.revision = trans.revision();
+			cached.light_revision = light.revision();
+			// the position the light is actually rendered at, i.e. including its offset
+			auto position = remove_units(trans.position()) + trans.resolve_relative(light.offset());
+			cached.position = position.xy();
+			cached.radius = light.radius().value();
+			_max_radius = std::max(_max_radius, cached.radius);
+
+			_move_to_cell(i, cell_key(cell_coord(cached.position.x), cell_coord(cached.position.y)));
+		}
+	}
+
+	void Light_index::_move_to_cell(uint32_t index, Cell_key cell) {
+		auto& cached = _cache[index];
+		if(cached.cell==cell)
+			return;
+
+		if(cached.cell!=no_cell) {
+			auto iter = _cells.find(cached.cell);
+			if(iter!=_cells.end()) {
+				auto& members = iter->second;
+				auto member = std::find(members.begin(), members.end(), index);
+				if(member!=members.end()) {
+					*member = members.back();
+					members.pop_back();
+				}
+				if(members.empty())
+					_cells.erase(iter);
+			}
+		}
+
+		cached.cell = cell;
+		if(cell!=no_cell)
+			_cells[cell].push_back(index);
+	}
+
+	void Light_index::select(glm::vec4 area, glm::vec2 center, gsl::span<Light_info> out)const {
+		auto k = static_cast<std::size_t>(out.size());
+		if(k==0)
+			return;
+
+		// min-heap of the best k lights found so far
+		auto heap_order = [](auto& lhs, auto& rhs) {return lhs.first > rhs.first;};
+		_heap.clear();
+
+		auto consider = [&](uint32_t index) {
+			auto& cached = _cache[index];
+
+			// lights can only reach the area if their center is within radius
+			if(cached.position.x+cached.radius < area.x || cached.position.x-cached.radius > area.z ||
+			   cached.position.y+cached.radius < area.y || cached.position.y-cached.radius > area.w)
+				return;
+
+			auto intensity = glm::length2(cached.light->color());
+			auto dist2 = glm::distance2(cached.position, center);
+			auto radius2 = std::max(cached.radius*cached.radius, 0.0001f);
+			auto score = intensity / (1.f + dist2/radius2);
+
+			if(_heap.size()<k) {
+				_heap.emplace_back(score, index);
+				std::push_heap(_heap.begin(), _heap.end(), heap_order);
+
+			} else if(score > _heap.front().first) {
+				std::pop_heap(_heap.begin(), _heap.end(), heap_order);
+				_heap.back() = {score, index};
+				std::push_heap(_heap.begin(), _heap.end(), heap_order);
+			}
+		};
+
+		auto min_x = cell_coord(area.x - _max_radius);
+		auto min_y = cell_coord(area.y - _max_radius);
+		auto max_x = cell_coord(area.z + _max_radius);
+		auto max_y = cell_coord(area.w + _max_radius);
+		auto query_cells = (int64_t(max_x)-min_x+1) * (int64_t(max_y)-min_y+1);
+
+		if(query_cells > static_cast<int64_t>(_cells.size())) {
+			// zoomed out far enough that walking the occupied cells is cheaper
+			for(auto& cell : _cells)
+				for(auto index : cell.second)
+					consider(index);
+
+		} else {
+			for(auto x=min_x; x<=max_x; ++x) {
+				for(auto y=min_y; y<=max_y; ++y) {
+					auto iter = _cells.find(cell_key(x,y));
+					if(iter!=_cells.end()) {
+						for(auto index : iter->second)
+							consider(index);
+					}
+				}
+			}
+		}
+
+		std::sort_heap(_heap.begin(), _heap.end(), heap_order); // => descending score
+
+		for(auto i=0u; i<k; ++i) {
+			if(i<_heap.size()) {
+				auto& cached = _cache[_heap[i].second];
+				out[i].transform = cached.transform;
+				out[i].light = cached.light;
+				out[i].score = _heap[i].first;
+				out[i].shadowcaster = cached.light->shadowcaster();
+			} else {
+				out[i] = Light_info{};
+			}
+		}
+	}
+
+}
+}
+}
@@ -0,0 +1,91 @@
+/** spatial index for the selection of visible lights ************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include "light_comp.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <gsl.h>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace lux {
+namespace sys {
+namespace physics {
+	class Transform_comp;
+}
+namespace light {
+
+	struct Light_info {
+		const physics::Transform_comp* transform = nullptr;
+		const Light_comp* light = nullptr;
+		float score = 0.f;
+		glm::vec2 flat_pos;
+		bool shadowcaster = true;
+
+		bool operator<(const Light_info& rhs)const noexcept {
+			return score>rhs.score;
+		}
+	};
+
+	/*
+	 * Caches the position and radius of all lights in a flat array (index
+	 *   aligned with the Light_comp pool) and sorts them into a uniform grid
+	 *   by their center (the position of the entity plus the offset of the light).
+	 * The cache of a light is only refreshed if the revision() of its
+	 *   Transform_comp or Light_comp changed or another light took its pool slot.
+	 */
+	class Light_index {
+		public:
+			Light_index(Light_comp::Pool& lights);
+
+			/// has to be called once per frame before select()
+			void update();
+
+			/*
+			 * Fills 'out' with the best lights (highest score first) that may
+			 *   reach the given area (x1,y1,x2,y2) and clears the remaining entries.
+			 * The score of a light is its intensity, reduced by its distance to 'center'
+			 *   relative to its radius.
+			 */
+			void select(glm::vec4 area, glm::vec2 center, gsl::span<Light_info> out)const;
+
+			auto max_radius()const noexcept {return _max_radius;}
+
+		private:
+			using Cell_key = uint64_t;
+			static constexpr auto no_cell = ~Cell_key(0);
+
+			struct Cached_light {
+				const ecs::Entity* owner = nullptr;
+				const Light_comp* light = nullptr;
+				const physics::Transform_comp* transform = nullptr;
+				uint_fast32_t revision = 0;       //< of the Transform_comp
+				uint_fast32_t light_revision = 0; //< of the Light_comp
+				glm::vec2 position;
+				float radius = 0.f;
+				Cell_key cell = no_cell;
+			};
+
+			Light_comp::Pool& _lights;
+			std::vector<Cached_light> _cache;
+			std::unordered_map<Cell_key, std::vector<uint32_t>> _cells;
+			float _max_radius = 0.f;
+
+			mutable std::vector<std::pair<float, uint32_t>> _heap;
+
+			void _move_to_cell(uint32_t index, Cell_key cell);
+	};
+
+}
+}
+}
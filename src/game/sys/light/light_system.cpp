@@ -1,9 +1,4 @@
-#ifndef ANDROID
-	#include <GL/glew.h>
-	#include <GL/gl.h>
-#else
-	#include <GLES2/gl2.h>
-#endif
+#include <core/renderer/gl.hpp>
 
 #define GLM_SWIZZLE
 
@@ -16,8 +11,8 @@
 #include <core/renderer/texture_batch.hpp>
 #include <core/renderer/graphics_ctx.hpp>
 
+#include <limits>
 
-#define NUM_LIGHTS_MACRO 8
 
 namespace lux {
 namespace sys {
@@ -26,11 +21,9 @@ namespace light {
 	using namespace renderer;
 
 	namespace {
-		static_assert(NUM_LIGHTS_MACRO==max_lights, "Update the NUM_LIGHTS_MACRO macro!");
-
-		constexpr auto shadowed_lights = 2;
 		constexpr auto shadowmap_size = 1024.f;
-		constexpr auto shadowmap_rows = shadowed_lights;
+		constexpr auto shadowmap_slots = 4; //< rows of the atlas, more than shadowed_lights to keep recently used lights
+		constexpr auto tile_size = 32.f; //< in screen pixels
 	}
 
 	Light_system::Light_system(
@@ -45,11 +38,14 @@ namespace light {
 	    : _mailbox(bus),
 	      _graphics_ctx(graphics_ctx),
 	      _lights(entity_manager.list<Light_comp>()),
+	      _light_index(_lights),
 	      _shadowcaster_queue(1),
 	      _shadowcaster_batch(_shadowcaster_shader, 64),
 	      _occlusion_map    {Framebuffer(shadowmap_size,shadowmap_size, false, false),
 	                         Framebuffer(shadowmap_size,shadowmap_size, false, false)},
-	      _shadow_map       (shadowmap_size/2.f,shadowmap_rows, false, true),
+	      _shadow_map       (shadowmap_size/2.f,shadowmap_slots, false, true),
+	      _shadow_cache     (shadowmap_slots),
+	      _texture          (1,1),
 	      _sun_light(sun_light),
 	      _sun_dir(glm::normalize(sun_dir)),
 	      _ambient_brightness(ambient_brightness),
@@ -58,6 +54,8 @@ namespace light {
 
 		entity_manager.register_component_type<Light_comp>();
 
+		_final_slots.fill(-1);
+
 		_shadowcaster_shader.attach_shader(asset_manager.load<Shader>("vert_shader:sprite"_aid))
 		            .attach_shader(asset_manager.load<Shader>("frag_shader:sprite_shadow"_aid))
 		            .bind_all_attribute_locations(renderer::sprite_layout)
@@ -96,69 +94,92 @@ namespace light {
 	}
 
 
-	struct Light_info {
-		const physics::Transform_comp* transform = nullptr;
-		const Light_comp* light = nullptr;
-		float score = 0.f;
-		glm::vec2 flat_pos;
-		bool shadowcaster = true;
-
-		bool operator<(const Light_info& rhs)const noexcept {
-			return score>rhs.score;
-		}
-	};
-
 	namespace {
-		void fill_with_relevant_lights(const renderer::Camera& camera,
-		                               Light_comp::Pool& lights,
-		                               std::array<Light_info, max_lights>& out) {
-			auto eye_pos = camera.eye_position();
-
-			static glm::vec3 last_ep;
-			if(glm::length2(eye_pos-last_ep)>2.f) {
-				last_ep=eye_pos;
+		/// area of the z=0 plane visible through the camera (x1,y1,x2,y2)
+		auto visible_area(const renderer::Camera& camera) -> glm::vec4 {
+			auto& vp = camera.viewport();
+			auto plane = glm::vec3(camera.eye_position().xy(), 0.f);
+
+			auto area = glm::vec4(std::numeric_limits<float>::max(),  std::numeric_limits<float>::max(),
+			                      std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+
+			for(auto corner : {glm::vec2(vp.x, vp.y),        glm::vec2(vp.x+vp.z, vp.y),
+			                   glm::vec2(vp.x, vp.y+vp.w),   glm::vec2(vp.x+vp.z, vp.y+vp.w)}) {
+				auto p = camera.screen_to_world(corner, plane).xy();
+				area.x = std::min(area.x, p.x);
+				area.y = std::min(area.y, p.y);
+				area.z = std::max(area.z, p.x);
+				area.w = std::max(area.w, p.y);
 			}
 
-			auto index = 0;
-
-			for(Light_comp& light : lights) {
-				auto& trans = light.owner().get<physics::Transform_comp>().get_or_throw();
-
-				auto r = light.radius().value();
-				auto dist = glm::distance2(remove_units(trans.position()).xy(), eye_pos.xy());
-
-				auto score = 1.f/dist;
-				if(dist<10.f)
-					score += glm::clamp(r/2.f + glm::length2(light.color())/4.f, -0.001f, 0.001f) + (light.shadowcaster() ? 0.1f : 0.f);
+			return area;
+		}
 
-				if(index<max_lights) {
-					out[index].transform = &trans;
-					out[index].light = &light;
-					out[index].score = score;
-					out[index].shadowcaster = light.shadowcaster();
-					index++;
+		/// names of the light array uniforms, build once because the uniform maps
+		///   only store the pointers
+		struct Light_uniform_names {
+			std::string pos;
+			std::string dir;
+			std::string angle;
+			std::string color;
+			std::string factors;
+			std::string flat_position;
+			std::string slot;
+		};
+		const auto light_uniform_names = [] {
+			auto names = std::array<Light_uniform_names, std::max(shadowed_lights, background_lights)>{};
+			for(auto i : util::range(int(names.size()))) {
+				auto idx = "["+util::to_string(i)+"]";
+				names[i].pos           = "light"+idx+".pos";
+				names[i].dir           = "light"+idx+".dir";
+				names[i].angle         = "light"+idx+".angle";
+				names[i].color         = "light"+idx+".color";
+				names[i].factors       = "light"+idx+".factors";
+				names[i].flat_position = "light_positions"+idx;
+				names[i].slot          = "light_slots"+idx;
+			}
+			return names;
+		}();
+
+		/// screen-space rect [0,1] of all points within 'radius' around 'pos'
+		auto screen_bounds(const glm::mat4& vp, glm::vec3 pos, float radius) -> Tile_light {
+			auto bounds = Tile_light{glm::vec2(std::numeric_limits<float>::max()),
+			                         glm::vec2(std::numeric_limits<float>::lowest())};
+
+			for(auto i : util::range(8)) {
+				auto corner = pos + radius*glm::vec3(i&1 ? 1.f : -1.f,
+				                                     i&2 ? 1.f : -1.f,
+				                                     i&4 ? 1.f : -1.f);
+				auto p = vp * glm::vec4(corner, 1.f);
+				if(p.w<=0.0001f) // behind the camera
+					return Tile_light{glm::vec2(0,0), glm::vec2(1,1)};
+
+				auto screen = p.xy() / p.w * 0.5f + 0.5f;
+				bounds.min = glm::min(bounds.min, screen);
+				bounds.max = glm::max(bounds.max, screen);
+			}
 
-				} else { // too many lights => select brightest/closest
-					auto min = std::min_element(out.begin(), out.end(),
-												[](auto& a, auto& b){return a.score<b.score;});
+			return bounds;
+		}
 
-					if(score>min->score) {
-						min->transform = &trans;
-						min->light = &light;
-						min->score = score;
-						min->shadowcaster = light.shadowcaster();
-					}
-				}
-			}
+		auto process_angle(Angle a) -> float {
+			return (a.value() + glm::smoothstep(1.8f*glm::pi<float>(), 2.0f*PI, a.value())*1.0f) / 2.0f;
+		}
 
-			std::sort(out.begin(), out.end());
+		/// true if 'a' only moves points (on planes parallel to the screen) by a constant offset
+		///   compared to 'b', i.e. distances in screen-space are the same
+		auto only_translated(const glm::mat4& a, const glm::mat4& b) -> bool {
+			return a[0]==b[0] && a[1]==b[1] && a[2]==b[2] && a[3][3]==b[3][3]
+			        && a[0][3]==0.f && a[1][3]==0.f;
 		}
 
-		void bind_light_positions(renderer::Shader_program& prog, gsl::span<Light_info> lights) {
-#define SET_LIGHT_UNIFORM(I) prog.set_uniform("light_positions["#I"]", lights[I].flat_pos);\
-			                 prog.set_uniform("light_shadow["#I"]", lights[I].shadowcaster ? 1.f : 0.f);
-			M_REPEAT(NUM_LIGHTS_MACRO, SET_LIGHT_UNIFORM);
-#undef SET_LIGHT_UNIFORM
+		/// key of the light in the Shadow_cache
+		auto shadow_light(const Light_info& l) -> Shadow_light {
+			auto pos = remove_units(l.transform->position())
+			           + l.transform->resolve_relative(l.light->offset());
+
+			return Shadow_light{uint64_t(reinterpret_cast<std::uintptr_t>(&l.light->owner())),
+			                    l.transform->revision(), pos.xy(), remove_unit(l.light->radius())};
 		}
 	}
 	void Light_system::prepare_draw(renderer::Command_queue& queue,
@@ -166,34 +187,94 @@ namespace light {
 	                                bool shadows) {
 
 		std::array<Light_info, max_lights> lights{};
-		fill_with_relevant_lights(camera, _lights, lights);
+		auto area = visible_area(camera);
+		_light_index.update();
+		_light_index.select(area, camera.eye_position().xy(), lights);
 
 		auto uniforms = queue.shared_uniforms();
-		_setup_uniforms(*uniforms, camera, lights);
+		auto vp = _setup_uniforms(*uniforms, camera, lights);
 
 		if(shadows) {
+			_draw_shadows(uniforms, vp, area, lights);
+			_occlusion_map[0].bind((int) Texture_unit::shadowmaps);
+
+		} else {
+			_shadow_cache.reset();
+			_final_slots.fill(-1);
+			_shadow_softness = -1.f;
+		}
+
+		_shadow_cache.end_frame();
+	}
+	void Light_system::_draw_shadows(std::shared_ptr<IUniform_map> uniforms, const glm::mat4& vp,
+	                                 glm::vec4 area, gsl::span<Light_info> lights) {
+		// the shadow maps are distances in screen-space around the light, that don't change if
+		//   the view is only moved. Changes of the projection (e.g. zoom) invalidate all of them.
+		auto softness = _graphics_ctx.settings().shadow_softness;
+		if(!only_translated(vp, _shadow_vp) || softness!=_shadow_softness) {
+			_shadow_softness = softness;
+			_shadow_cache.invalidate_all();
+		}
+		_shadow_cache.view(area);
+
+		// the composed result is in screen-space and has to follow the view
+		if(vp!=_shadow_vp) {
+			_shadow_vp = vp;
+			_final_slots.fill(-1);
+		}
+
+		auto slots = std::array<int, shadowed_lights>();
+		auto outdated = false;
+		for(auto i : util::range(shadowed_lights)) {
+			auto& l = lights[i];
+			slots[i] = l.light && l.shadowcaster ? _shadow_cache.acquire(shadow_light(l)) : -1;
+			outdated |= slots[i]>=0 && !_shadow_cache.valid(slots[i]);
+		}
+
+		if(outdated) {
 			_draw_occlusion_map(uniforms);
-			_draw_shadow_map(lights);
-			_draw_final(lights);
-			_blur_shadows();
 
-			_occlusion_map[0].bind((int) Texture_unit::shadowmaps);
+			for(auto i : util::range(shadowed_lights)) {
+				if(slots[i]>=0 && !_shadow_cache.valid(slots[i])) {
+					_draw_shadow_map(slots[i], lights[i].flat_pos);
+					_shadow_cache.rendered(slots[i]);
+				}
+			}
+
+		} else {
+			_shadowcaster_batch.clear();
+		}
+
+		// _occlusion_map[0] holds the composed shadows, which have to be rebuilt if
+		//   _draw_occlusion_map() overwrote them, other slots are used or the view moved
+		if(outdated || slots!=_final_slots) {
+			_draw_final(lights, slots);
+			_blur_shadows();
+			_final_slots = slots;
 		}
 	}
-	void Light_system::_draw_shadow_map(gsl::span<Light_info> lights) {
+	void Light_system::_draw_shadow_map(int slot, glm::vec2 light_position) {
 		_shadowmap_shader.bind();
-
-		bind_light_positions(_shadowmap_shader, lights);
+		_shadowmap_shader.set_uniform("light_position", light_position);
 
 		auto fbo_cleanup = Framebuffer_binder{_shadow_map};
-		_shadow_map.clear();
+		auto depth_cleanup = renderer::Disable_depthtest{};
+		auto blend_cleanup = renderer::Disable_blend{};
+
+		// only overwrite the row of this slot, the others are still valid
+		glViewport(0, slot, _shadow_map.width(), 1);
 
 		renderer::draw_fullscreen_quad(_occlusion_map[0]);
 	}
 
-	void Light_system::_draw_final(gsl::span<Light_info> lights) {
+	void Light_system::_draw_final(gsl::span<Light_info> lights, gsl::span<const int> slots) {
 		_finalize_shader.bind();
-		bind_light_positions(_finalize_shader, lights);
+		for(auto i : util::range(shadowed_lights)) {
+			auto& names = light_uniform_names[i];
+			_finalize_shader.set_uniform(names.flat_position.c_str(), lights[i].flat_pos);
+			_finalize_shader.set_uniform(names.slot.c_str(), slots[i]<0 ? -1.f
+			                             : (slots[i]+0.5f) / shadowmap_slots);
+		}
 
 		auto fbo_cleanup = Framebuffer_binder{_occlusion_map[0]};
 		auto depth_cleanup = renderer::Disable_depthtest{};
@@ -236,8 +317,53 @@ namespace light {
 		_shadowcaster_queue.flush();
 	}
 
-	void Light_system::_setup_uniforms(IUniform_map& uniforms, const renderer::Camera& camera,
+	void Light_system::_update_texture(const renderer::Camera& camera, const glm::mat4& vp,
 	                                   gsl::span<Light_info> lights) {
+		auto& viewport = camera.viewport();
+		auto columns = std::max(1, static_cast<int>(std::ceil(viewport.z / tile_size)));
+		auto rows    = std::max(1, static_cast<int>(std::ceil(viewport.w / tile_size)));
+
+		if(columns!=_tiles.columns() || rows!=_tiles.rows()) {
+			_tiles.resize(columns, rows);
+			_texture_data.resize(columns, rows);
+			_texture = Data_texture(_texture_data.width(), _texture_data.height());
+		}
+
+		_tile_lights.clear();
+		_packed_lights.clear();
+		for(Light_info& l : lights) {
+			if(!l.light) {
+				_tile_lights.emplace_back(); // empty bounds => not in any tile
+				_tile_lights.back().min = glm::vec2(-1,-1);
+				_tile_lights.back().max = glm::vec2(-1,-1);
+				continue;
+			}
+
+			auto pos = remove_units(l.transform->position())
+			           + l.transform->resolve_relative(l.light->offset());
+			_tile_lights.emplace_back(screen_bounds(vp, pos, remove_unit(l.light->radius())));
+			_tile_lights.back().score = l.score;
+
+			// the selected lights are a prefix of 'lights', so the index is also the id in the texture
+			auto packed = Packed_light{};
+			packed.pos = pos;
+			packed.dir = -l.transform->rotation().value() + l.light->_direction.value();
+			packed.angle = process_angle(l.light->_angle);
+			packed.color = l.light->color();
+			packed.factors = l.light->_factors;
+			_packed_lights.emplace_back(packed);
+		}
+
+		_tiles.bin(_tile_lights);
+		_texture_data.write_lights(_packed_lights);
+		_texture_data.write_tiles(_tiles);
+
+		_texture.update(_texture_data.data());
+		_texture.bind(int(Texture_unit::lights));
+	}
+
+	auto Light_system::_setup_uniforms(IUniform_map& uniforms, const renderer::Camera& camera,
+	                                   gsl::span<Light_info> lights) -> glm::mat4 {
 
 
 		auto view = camera.view();
@@ -256,6 +382,12 @@ namespace light {
 		uniforms.emplace("light_sun.dir",   _sun_dir);
 		uniforms.emplace("background_tint", _background_tint);
 
+		_update_texture(camera, vp, lights);
+		uniforms.emplace("light_tiles", glm::vec4(_tiles.columns(), _tiles.rows(),
+		                                          _texture_data.width(), _texture_data.height()));
+		uniforms.emplace("light_pos_origin", _texture_data.pos_origin());
+		uniforms.emplace("light_pos_extent", _texture_data.pos_extent());
+
 		for(Light_info& l : lights) {
 			if(!l.transform) {
 				l.flat_pos = glm::vec2(1000,1000);
@@ -268,27 +400,25 @@ namespace light {
 			l.flat_pos = p.xy() / p.w;
 		}
 
-		auto process_angle = [&](auto a) {
-			return (a.value() + glm::smoothstep(1.8f*glm::pi<float>(), 2.0f*PI, a.value())*1.0f) / 2.0f;
-		};
-
 		// TODO: fade out light color, when they left the screen
-#define SET_LIGHT_UNIFORMS(N) \
-		if(lights[N].light) {\
-			uniforms.emplace("light["#N"].pos", remove_units(lights[N].transform->position())+lights[N].transform->resolve_relative(lights[N].light->offset()));\
-\
-			uniforms.emplace("light["#N"].dir", -lights[N].transform->rotation().value()\
-			                                               + lights[N].light->_direction.value());\
-\
-			uniforms.emplace("light["#N"].angle", process_angle(lights[N].light->_angle));\
-			uniforms.emplace("light["#N"].color", lights[N].light->color()); \
-			uniforms.emplace("light["#N"].factors", lights[N].light->_factors);\
-		} else {\
-			uniforms.emplace("light["#N"].color", glm::vec3(0,0,0));\
+		for(auto i : util::range(background_lights)) {
+			auto& names = light_uniform_names[i];
+			auto& l = lights[i];
+
+			if(l.light) {
+				uniforms.emplace(names.pos.c_str(), remove_units(l.transform->position())
+				                                    + l.transform->resolve_relative(l.light->offset()));
+				uniforms.emplace(names.dir.c_str(), -l.transform->rotation().value()
+				                                    + l.light->_direction.value());
+				uniforms.emplace(names.angle.c_str(), process_angle(l.light->_angle));
+				uniforms.emplace(names.color.c_str(), l.light->color());
+				uniforms.emplace(names.factors.c_str(), l.light->_factors);
+			} else {
+				uniforms.emplace(names.color.c_str(), glm::vec3(0,0,0));
+			}
 		}
 
-		M_REPEAT(NUM_LIGHTS_MACRO, SET_LIGHT_UNIFORMS);
-#undef SET_LIGHT_UNIFORMS
+		return vp;
 	}
 
 }
@@ -8,6 +8,9 @@
 #pragma once
 
 #include "light_comp.hpp"
+#include "light_index.hpp"
+#include "light_tiles.hpp"
+#include "shadow_cache.hpp"
 
 #include "../../entity_events.hpp"
 
@@ -19,16 +22,20 @@
 
 #include <gsl.h>
 
+#include <array>
+
 
 namespace lux {
 namespace sys {
 namespace light {
 
-	constexpr auto max_lights = 8;
-	constexpr auto light_uniforms = 3+6*max_lights;
-	constexpr auto light_uniforms_size = 3+1+3+(3+3+1+1+3+1)*max_lights;
-
-	struct Light_info;
+	/// lights that may contribute to a frame; each tile only evaluates the
+	///   lights that overlap it (see Light_tiles)
+	constexpr auto max_lights = Light_tiles::max_lights;
+	constexpr auto shadowed_lights = 2; //< the first lights in the selection cast shadows
+	constexpr auto background_lights = 2; //< also passed as uniforms, for the background shader
+	constexpr auto light_uniforms = 3+6*background_lights+3;
+	constexpr auto light_uniforms_size = 3+1+3+(3+3+1+1+3+1)*background_lights+4+3+3;
 
 	class Light_system {
 		public:
@@ -54,6 +61,7 @@ namespace light {
 			auto background_tint()const noexcept {return _background_tint;}
 
 			auto shadowcaster_batch() -> auto& {return _shadowcaster_batch;}
+			auto shadow_cache() -> auto& {return _shadow_cache;}
 			void prepare_draw(renderer::Command_queue&, const renderer::Camera& camera,
 			                  bool shadows=true);
 			void update(Time dt);
@@ -62,14 +70,24 @@ namespace light {
 			util::Mailbox_collection _mailbox;
 			renderer::Graphics_ctx&  _graphics_ctx;
 			Light_comp::Pool& _lights;
+			Light_index _light_index;
 			renderer::Command_queue  _shadowcaster_queue;
 			renderer::Sprite_batch   _shadowcaster_batch;
 			renderer::Framebuffer    _occlusion_map[2];
-			renderer::Framebuffer    _shadow_map;
+			renderer::Framebuffer    _shadow_map; //< atlas with one row per Shadow_cache slot
+			Shadow_cache             _shadow_cache;
+			glm::mat4                _shadow_vp;
+			float                    _shadow_softness = -1.f;
+			std::array<int, shadowed_lights> _final_slots; //< slots used to build _occlusion_map[0]
 			renderer::Shader_program _shadowcaster_shader;
 			renderer::Shader_program _shadowmap_shader;
 			renderer::Shader_program _finalize_shader;
 			renderer::Shader_program _blur_shader;
+			Light_tiles              _tiles;
+			Light_texture_data       _texture_data;
+			renderer::Data_texture   _texture;
+			std::vector<Tile_light>  _tile_lights;
+			std::vector<Packed_light> _packed_lights;
 
 			Rgb _sun_light;
 			glm::vec3 _sun_dir;
@@ -78,11 +96,15 @@ namespace light {
 			Rgba _background_tint;
 
 
-			void _setup_uniforms(renderer::IUniform_map& uniforms, const renderer::Camera& camera,
-			                     gsl::span<Light_info>);
+			auto _setup_uniforms(renderer::IUniform_map& uniforms, const renderer::Camera& camera,
+			                     gsl::span<Light_info>) -> glm::mat4;
+			void _draw_shadows(std::shared_ptr<renderer::IUniform_map> uniforms, const glm::mat4& vp,
+			                   glm::vec4 area, gsl::span<Light_info> lights);
+			void _update_texture(const renderer::Camera& camera, const glm::mat4& vp,
+			                     gsl::span<Light_info> lights);
 			void _draw_occlusion_map(std::shared_ptr<renderer::IUniform_map> uniforms);
-			void _draw_shadow_map(gsl::span<Light_info> lights);
-			void _draw_final(gsl::span<Light_info> lights);
+			void _draw_shadow_map(int slot, glm::vec2 light_position);
+			void _draw_final(gsl::span<Light_info> lights, gsl::span<const int> slots);
 			void _blur_shadows();
 	};
 
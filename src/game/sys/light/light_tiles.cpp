@@ -0,0 +1,172 @@
+#include "light_tiles.hpp"
+
+#include <core/utils/log.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace lux {
+namespace sys {
+namespace light {
+
+	namespace {
+		auto to_tile(float v, int tiles) -> int {
+			return std::max(0, std::min(tiles-1, static_cast<int>(std::floor(v*tiles))));
+		}
+	}
+
+	Light_tiles::Light_tiles(int columns, int rows) {
+		resize(columns, rows);
+	}
+
+	void Light_tiles::resize(int columns, int rows) {
+		INVARIANT(columns>0 && rows>0, "Invalid tile count "<<columns<<"x"<<rows);
+
+		_columns = columns;
+		_rows = rows;
+
+		auto tiles = static_cast<std::size_t>(columns*rows);
+		_counts.assign(tiles, 0);
+		_ids.resize(tiles*max_lights_per_tile);
+		_scores.resize(tiles*max_lights_per_tile);
+	}
+
+	void Light_tiles::bin(gsl::span<const Tile_light> lights) {
+		INVARIANT(lights.size()<=max_lights, "Too many lights for the tile index: "<<lights.size());
+
+		std::fill(_counts.begin(), _counts.end(), 0);
+
+		for(auto id=std::ptrdiff_t(0); id<lights.size(); ++id) {
+			auto& l = lights[id];
+			if(l.max.x<0.f || l.max.y<0.f || l.min.x>1.f || l.min.y>1.f)
+				continue;
+
+			auto x_begin = to_tile(l.min.x, _columns);
+			auto x_end   = to_tile(l.max.x, _columns);
+			auto y_begin = to_tile(l.min.y, _rows);
+			auto y_end   = to_tile(l.max.y, _rows);
+
+			for(auto y=y_begin; y<=y_end; ++y) {
+				for(auto x=x_begin; x<=x_end; ++x) {
+					auto tile = static_cast<std::size_t>(y*_columns + x);
+					auto first = tile*max_lights_per_tile;
+					auto& count = _counts[tile];
+
+					if(count<max_lights_per_tile) {
+						_ids[first+count] = static_cast<uint8_t>(id);
+						_scores[first+count] = l.score;
+						count++;
+						continue;
+					}
+
+					// tile is full => replace the weakest light, if it's weaker than us
+					auto scores_begin = _scores.begin()+first;
+					auto weakest = std::min_element(scores_begin, scores_begin+max_lights_per_tile);
+					if(*weakest<l.score) {
+						*weakest = l.score;
+						_ids[first + (weakest-scores_begin)] = static_cast<uint8_t>(id);
+					}
+				}
+			}
+		}
+	}
+
+	auto Light_tiles::lights(int x, int y)const -> gsl::span<const uint8_t> {
+		auto tile = static_cast<std::size_t>(y*_columns + x);
+		return {_ids.data() + tile*max_lights_per_tile, _counts[tile]};
+	}
+
+	namespace {
+		void write16(uint8_t* out, float v) {
+			auto u = static_cast<uint16_t>(std::round(glm::clamp(v, 0.f, 1.f) * 65535.f));
+			out[0] = static_cast<uint8_t>(u >> 8);
+			out[1] = static_cast<uint8_t>(u);
+		}
+		/// 0 is stored as 0, everything else as log2(v) mapped to [1, 65535]
+		auto log_scale(float v) -> float {
+			constexpr auto range = Light_texture_data::log_range;
+			if(v<=0.f)
+				return 0.f;
+
+			return std::max(1.f/65535.f, (std::log2(v)+range) / (2.f*range));
+		}
+	}
+
+	void Light_texture_data::resize(int tile_columns, int tile_rows) {
+		_width = std::max(Light_tiles::max_lights, tile_columns*tile_texels);
+		_height = light_rows + tile_rows;
+		_data.assign(static_cast<std::size_t>(_width*_height*4), 0);
+	}
+
+	auto Light_texture_data::_texel(int x, int y) -> uint8_t* {
+		return _data.data() + (y*_width + x)*4;
+	}
+
+	void Light_texture_data::write_lights(gsl::span<const Packed_light> lights) {
+		INVARIANT(lights.size()<=Light_tiles::max_lights, "Too many lights: "<<lights.size());
+		INVARIANT(_width>0, "Light_texture_data::resize() has not been called");
+
+		// 16 bit relative to the bounds of all lights => ~1/65000 of the visible area
+		auto min = glm::vec3(std::numeric_limits<float>::max());
+		auto max = glm::vec3(std::numeric_limits<float>::lowest());
+		for(auto& l : lights) {
+			min = glm::min(min, l.pos);
+			max = glm::max(max, l.pos);
+		}
+		if(lights.size()==0) {
+			min = max = glm::vec3(0,0,0);
+		}
+		_pos_origin = min;
+		_pos_extent = glm::max(max-min, glm::vec3(0.001f));
+
+		constexpr auto two_pi = 2.f*3.14159265358979f;
+
+		for(auto i=0; i<static_cast<int>(lights.size()); ++i) {
+			auto& l = lights[i];
+			auto pos = (l.pos-_pos_origin) / _pos_extent;
+			auto dir = l.dir/two_pi;
+
+			write16(_texel(i,0),   pos.x);
+			write16(_texel(i,0)+2, pos.y);
+			write16(_texel(i,1),   pos.z);
+			write16(_texel(i,1)+2, dir-std::floor(dir));
+			write16(_texel(i,2),   l.angle/two_pi);
+			write16(_texel(i,2)+2, log_scale(l.color.r));
+			write16(_texel(i,3),   log_scale(l.color.g));
+			write16(_texel(i,3)+2, log_scale(l.color.b));
+			write16(_texel(i,4),   log_scale(l.factors.x));
+			write16(_texel(i,4)+2, log_scale(l.factors.y));
+			write16(_texel(i,5),   log_scale(l.factors.z));
+			write16(_texel(i,5)+2, 0.f);
+		}
+
+		// unused slots are black
+		for(auto i=static_cast<int>(lights.size()); i<Light_tiles::max_lights; ++i) {
+			for(auto row=0; row<light_rows; ++row)
+				std::fill(_texel(i,row), _texel(i,row)+4, 0);
+		}
+	}
+
+	void Light_texture_data::write_tiles(const Light_tiles& tiles) {
+		INVARIANT(tiles.columns()*tile_texels<=_width && light_rows+tiles.rows()<=_height,
+		          "Light_texture_data is too small for "<<tiles.columns()<<"x"<<tiles.rows()<<" tiles");
+
+		for(auto y=0; y<tiles.rows(); ++y) {
+			for(auto x=0; x<tiles.columns(); ++x) {
+				auto out = _texel(x*tile_texels, light_rows+y);
+				auto ids = tiles.lights(x, y);
+
+				out[0] = static_cast<uint8_t>(ids.size());
+				std::copy(ids.begin(), ids.end(), out+1);
+				std::fill(out+1+ids.size(), out+tile_texels*4, 0);
+			}
+		}
+	}
+
+}
+}
+}
@@ -0,0 +1,110 @@
+/** assigns lights to the screen-space tiles they may reach ******************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <gsl.h>
+
+#include <vector>
+#include <cstdint>
+
+
+namespace lux {
+namespace sys {
+namespace light {
+
+	/// screen-space bounds of a light in [0,1] (y-up, like gl_FragCoord)
+	struct Tile_light {
+		glm::vec2 min;
+		glm::vec2 max;
+		float score = 0.f;
+	};
+
+	/*
+	 * Splits the screen into columns x rows tiles and stores for each tile the
+	 *   ids of the lights that overlap it.
+	 * A tile keeps at most max_lights_per_tile lights. If more overlap it, the
+	 *   ones with the lowest score are dropped.
+	 * Doesn't depend on OpenGL, the lists are packed by the Light_texture_data.
+	 */
+	class Light_tiles {
+		public:
+			static constexpr auto max_lights_per_tile = 15; //< + count = 4 RGBA8 texels
+			static constexpr auto max_lights = 256;
+
+			Light_tiles(int columns=1, int rows=1);
+
+			void resize(int columns, int rows);
+			auto columns()const noexcept {return _columns;}
+			auto rows()const noexcept {return _rows;}
+
+			/// replaces the current assignment; index in 'lights' is the light id
+			void bin(gsl::span<const Tile_light> lights);
+
+			/// ids of all lights that overlap the given tile
+			auto lights(int x, int y)const -> gsl::span<const uint8_t>;
+
+		private:
+			int _columns;
+			int _rows;
+			std::vector<uint8_t> _counts;
+			std::vector<uint8_t> _ids;    //< max_lights_per_tile entries per tile
+			std::vector<float>   _scores; //< index aligned with _ids
+	};
+
+	/// parameters of a point light, as they are evaluated by sprite.frag
+	struct Packed_light {
+		glm::vec3 pos;
+		float dir = 0.f;   //< rad
+		float angle = 0.f; //< rad, [0, 2PI]
+		glm::vec3 color;
+		glm::vec3 factors;
+	};
+
+	/*
+	 * Content of the RGBA8 texture that passes the lights to the shaders, because
+	 *   GLES2/WebGL only guarantee 16 fragment uniform vectors and 8 samplers.
+	 * The first light_rows rows contain the parameters of light i in column i,
+	 *   as two 16 bit values per texel (pos.x|pos.y, pos.z|dir, angle|color.r,
+	 *   color.g|color.b, factors.x|factors.y, factors.z|-).
+	 * The positions are stored relative to pos_origin()/pos_extent(), colors and
+	 *   factors logarithmic (0 or 2^-12 to 2^12).
+	 * The remaining rows contain 4 texels per tile (bottom row first): the number
+	 *   of lights in the tile, followed by their ids.
+	 */
+	class Light_texture_data {
+		public:
+			static constexpr auto light_rows = 6;
+			static constexpr auto tile_texels = (1+Light_tiles::max_lights_per_tile) / 4;
+			static constexpr auto log_range = 12.f;
+
+			void resize(int tile_columns, int tile_rows);
+			auto width()const noexcept {return _width;}
+			auto height()const noexcept {return _height;}
+			auto data()const noexcept {return _data.data();}
+
+			void write_lights(gsl::span<const Packed_light> lights);
+			void write_tiles(const Light_tiles& tiles);
+
+			auto pos_origin()const noexcept {return _pos_origin;}
+			auto pos_extent()const noexcept {return _pos_extent;}
+
+		private:
+			int _width = 0;
+			int _height = 0;
+			std::vector<uint8_t> _data;
+			glm::vec3 _pos_origin;
+			glm::vec3 _pos_extent {1,1,1};
+
+			auto _texel(int x, int y) -> uint8_t*;
+	};
+
+}
+}
+}
@@ -0,0 +1,150 @@
+#include "shadow_cache.hpp"
+
+#include <core/utils/log.hpp>
+
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+
+
+namespace lux {
+namespace sys {
+namespace light {
+
+	Shadow_cache::Shadow_cache(int slots) : _slots(slots) {
+		INVARIANT(slots>0, "A shadow cache without slots is useless");
+	}
+
+	void Shadow_cache::occluder(uint64_t id, uint64_t version, glm::vec2 position, float radius) {
+		auto iter = _occluders.find(id);
+		if(iter==_occluders.end()) {
+			_occluders.emplace(id, Occluder{version, position, radius, _frame});
+			_invalidate(position, radius);
+			_current.occluders_changed++;
+			return;
+		}
+
+		auto& o = iter->second;
+		o.last_seen = _frame;
+
+		if(o.version!=version || o.position!=position || o.radius!=radius) {
+			_invalidate(o.position, o.radius);
+			_invalidate(position, radius);
+			o.version = version;
+			o.position = position;
+			o.radius = radius;
+			_current.occluders_changed++;
+		}
+	}
+
+	auto Shadow_cache::acquire(const Shadow_light& light) -> int {
+		INVARIANT(light.id!=0, "0 is not a valid light id");
+
+		// all shadowcasters have been reported at this point
+		if(!_stale_occluders_removed) {
+			_remove_stale_occluders();
+		}
+
+		auto slot = std::find_if(_slots.begin(), _slots.end(), [&](auto& s) {
+			return s.light_id==light.id;
+		});
+
+		if(slot==_slots.end()) {
+			slot = std::min_element(_slots.begin(), _slots.end(), [](auto& lhs, auto& rhs) {
+				return lhs.last_used < rhs.last_used;
+			});
+			INVARIANT(slot->last_used!=_frame, "More lights acquired than slots available");
+
+			slot->light_id = light.id;
+			slot->valid = false;
+		}
+
+		if(slot->version!=light.version || slot->position!=light.position || slot->radius!=light.radius) {
+			slot->version = light.version;
+			slot->position = light.position;
+			slot->radius = light.radius;
+			slot->valid = false;
+		}
+
+		if(slot->valid && slot->last_used!=_frame)
+			_current.slots_reused++;
+
+		slot->last_used = _frame;
+		return static_cast<int>(slot - _slots.begin());
+	}
+
+	auto Shadow_cache::valid(int slot)const -> bool {
+		return _slots.at(slot).valid;
+	}
+
+	void Shadow_cache::rendered(int slot) {
+		auto& s = _slots.at(slot);
+		s.valid = true;
+		s.complete = _in_view(s);
+		_current.slots_rendered++;
+	}
+
+	void Shadow_cache::view(glm::vec4 area) {
+		if(area==_area)
+			return;
+
+		_area = area;
+		for(auto& s : _slots) {
+			if(s.valid && (!s.complete || !_in_view(s))) {
+				s.valid = false;
+			}
+		}
+	}
+
+	void Shadow_cache::invalidate_all() {
+		for(auto& s : _slots) {
+			s.valid = false;
+		}
+	}
+
+	void Shadow_cache::reset() {
+		std::fill(_slots.begin(), _slots.end(), Slot{});
+		_occluders.clear();
+	}
+
+	void Shadow_cache::end_frame() {
+		_frame++;
+		_stale_occluders_removed = false;
+		_last_frame = _current;
+		_current = Shadow_cache_stats{};
+	}
+
+	void Shadow_cache::_invalidate(glm::vec2 position, float radius) {
+		for(auto& s : _slots) {
+			if(s.light_id==0 || !s.valid)
+				continue;
+
+			auto reach = s.radius + radius;
+			if(glm::distance2(s.position, position) < reach*reach) {
+				s.valid = false;
+			}
+		}
+	}
+
+	auto Shadow_cache::_in_view(const Slot& s)const -> bool {
+		return s.position.x-s.radius >= _area.x && s.position.x+s.radius <= _area.z &&
+		       s.position.y-s.radius >= _area.y && s.position.y+s.radius <= _area.w;
+	}
+
+	void Shadow_cache::_remove_stale_occluders() {
+		_stale_occluders_removed = true;
+
+		for(auto iter=_occluders.begin(); iter!=_occluders.end();) {
+			if(iter->second.last_seen!=_frame) {
+				_invalidate(iter->second.position, iter->second.radius);
+				_current.occluders_changed++;
+				iter = _occluders.erase(iter);
+			} else {
+				++iter;
+			}
+		}
+	}
+
+}
+}
+}
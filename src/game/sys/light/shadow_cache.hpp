@@ -0,0 +1,113 @@
+/** decides which shadow map slots have to be re-rendered ********************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace lux {
+namespace sys {
+namespace light {
+
+	/// key of a light whose shadows are cached; the slot is reused as long as nothing changed
+	struct Shadow_light {
+		uint64_t id;        //< unique per light (e.g. the address of its entity)
+		uint64_t version;   //< has to change if the light moved (e.g. Transform_comp::revision())
+		glm::vec2 position;
+		float radius;
+	};
+
+	struct Shadow_cache_stats {
+		int slots_rendered = 0;
+		int slots_reused = 0;
+		int occluders_changed = 0;
+	};
+
+	/*
+	 * Assigns the shadowed lights to the slots of the shadow map atlas and
+	 *   tracks whether the content of a slot is still up to date.
+	 * A slot is invalidated if its light moved or any shadowcaster within the
+	 *   radius of the light has been added, removed or changed its version.
+	 * The shadow maps are rendered from the visible shadowcasters, so a slot is
+	 *   only complete if the radius of its light was inside the view. If the
+	 *   view is moved, complete slots of lights that are still inside of it
+	 *   stay valid and all others are invalidated.
+	 * Lights that are not acquired in a frame keep their slot (least recently
+	 *   used is replaced first), so lights that flicker in and out of the
+	 *   selection don't have to be re-rendered.
+	 *
+	 * Per frame:
+	 *   1. occluder() for every shadowcaster
+	 *   2. view(), acquire() for every shadowed light and render all slots that are
+	 *        not valid(), followed by rendered(slot)
+	 *   3. end_frame()
+	 */
+	class Shadow_cache {
+		public:
+			explicit Shadow_cache(int slots);
+
+			auto slots()const noexcept {return static_cast<int>(_slots.size());}
+
+			void occluder(uint64_t id, uint64_t version, glm::vec2 position, float radius);
+
+			/// returns the slot of the light; at most slots() lights per frame
+			auto acquire(const Shadow_light& light) -> int;
+			auto valid(int slot)const -> bool;
+			void rendered(int slot);
+
+			/// the visible area (x1,y1,x2,y2) in the coordinates of the lights
+			void view(glm::vec4 area);
+			/// e.g. the projection changed, but lights keep their slots
+			void invalidate_all();
+			/// forget all slots and shadowcasters, e.g. because shadows have been disabled
+			void reset();
+
+			void end_frame();
+
+			auto stats()const noexcept -> const Shadow_cache_stats& {return _current;}
+			auto last_frame_stats()const noexcept -> const Shadow_cache_stats& {return _last_frame;}
+
+		private:
+			struct Slot {
+				uint64_t light_id = 0; //< 0 = unused
+				uint64_t version = 0;
+				glm::vec2 position;
+				float radius = 0.f;
+				uint64_t last_used = 0;
+				bool valid = false;
+				bool complete = false; //< radius was inside of the view when rendered
+			};
+			struct Occluder {
+				uint64_t version;
+				glm::vec2 position;
+				float radius;
+				uint64_t last_seen;
+			};
+
+			std::vector<Slot> _slots;
+			std::unordered_map<uint64_t, Occluder> _occluders;
+			glm::vec4 _area;
+			uint64_t _frame = 1;
+			bool _stale_occluders_removed = false;
+
+			Shadow_cache_stats _current;
+			Shadow_cache_stats _last_frame;
+
+			void _invalidate(glm::vec2 position, float radius);
+			auto _in_view(const Slot&)const -> bool;
+			void _remove_stale_occluders();
+	};
+
+}
+}
+}
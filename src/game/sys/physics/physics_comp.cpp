@@ -214,6 +214,7 @@ namespace physics {
 	                             asset::Asset_manager&) {
 		state.read(_def);
 		_dirty = true;
+		_changes.add(owner());
 	}
 	void Dynamic_body_comp::save(sf2::JsonSerializer& state)const {
 		if(_body) {
@@ -234,7 +235,6 @@ namespace physics {
 
 		velocity(_def.velocity);
 
-		_last_body_position = glm::vec2{_body->GetPosition().x, _body->GetPosition().y};
 		_initial_position = glm::vec2{_body->GetPosition().x, _body->GetPosition().y};
 
 		_dirty = false;
@@ -271,6 +271,7 @@ namespace physics {
 	void Dynamic_body_comp::apply_force(glm::vec2 f) {
 		if(_body) {
 			_body->ApplyForceToCenter(b2Vec2{f.x,f.y}, true);
+			_changes.add(owner()); // woken up
 		}
 	}
 	void Dynamic_body_comp::foot_friction(bool enable) {
@@ -294,42 +295,53 @@ namespace physics {
 	void Dynamic_body_comp::velocity(glm::vec2 v)const {
 		if(_body) {
 			_body->SetLinearVelocity(b2Vec2{v.x,v.y});
+			_changes.add(owner()); // woken up
 		}
 	}
 	auto Dynamic_body_comp::mass()const -> float {
 		if(!_body) return 1.f;
 		return _body->GetMass();
 	}
-	void Dynamic_body_comp::_update_ground_info(Physics_system& world) {
+	auto Dynamic_body_comp::_ground_rays(glm::vec2 pos, Ray* out)const -> bool {
 		using namespace glm;
 
-		if(_def.shape==Body_shape::humanoid && _body) {
-			auto pos = remove_units(owner().get<Transform_comp>().get_or_throw().position()).xy();
-			INVARIANT(!std::isnan(pos.x) && !std::isnan(pos.y), "Position is nan");
-			INVARIANT(!std::isnan(_size.x) && !std::isnan(_size.y), "Size is nan");
+		if(_def.shape!=Body_shape::humanoid || !_body)
+			return false;
 
-			auto ground = world.raycast(pos, vec2{0,-1}, 20.f, owner());
-			auto ground_dist   = ground.process(999.f, [](auto& m) {return m.distance;});
-			_ground_normal = ground.process(vec2{0,1}, [](auto& m) {return m.normal;});
-			_grounded = ground_dist*ground_dist < glm::length2(_size/2.f);
+		INVARIANT(!std::isnan(pos.x) && !std::isnan(pos.y), "Position is nan");
+		INVARIANT(!std::isnan(_size.x) && !std::isnan(_size.y), "Size is nan");
 
-			if(!_grounded) {
-				// check left/right side, too
+		// center, left and right side
+		out[0] = Ray{pos, vec2{0,-1}, 20.f, &owner()};
+		out[1] = Ray{pos-vec2{_size.x/2.f,0}, vec2{0,-1}, 20.f, &owner()};
+		out[2] = Ray{pos+vec2{_size.x/2.f,0}, vec2{0,-1}, 20.f, &owner()};
+		return true;
+	}
+	void Dynamic_body_comp::_update_ground_info(const Raycast_result* hits) {
+		using namespace glm;
 
-				auto ground_l = world.raycast(pos-vec2{_size.x/2.f,0}, vec2{0,-1}, 20.f, owner());
-				auto ground_l_dist   = ground_l.process(999.f, [](auto& m) {return m.distance;});
+		auto dist = [](auto& hit) {return hit.entity ? hit.distance : 999.f;};
 
-				auto ground_r = world.raycast(pos+vec2{_size.x/2.f,0}, vec2{0,-1}, 20.f, owner());
-				auto ground_r_dist   = ground_r.process(999.f, [](auto& m) {return m.distance;});
+		auto& ground = hits[0];
+		auto ground_dist = dist(ground);
+		_ground_normal = ground.entity ? ground.normal : vec2{0,1};
+		_grounded = ground_dist*ground_dist < glm::length2(_size/2.f);
 
-				if(ground_l_dist<ground_dist && ground_l_dist<=ground_r_dist) {
-					_grounded = ground_l_dist*ground_l_dist < glm::length2(_size/2.f);
-					_ground_normal = ground_l.get_or_throw().normal;
+		if(!_grounded) {
+			// check left/right side, too
+			auto& ground_l = hits[1];
+			auto ground_l_dist = dist(ground_l);
 
-				} else if(ground_r_dist<ground_dist && ground_r_dist<=ground_l_dist) {
-					_grounded = ground_r_dist*ground_r_dist < glm::length2(_size/2.f);
-					_ground_normal = ground_r.get_or_throw().normal;
-				}
+			auto& ground_r = hits[2];
+			auto ground_r_dist = dist(ground_r);
+
+			if(ground_l_dist<ground_dist && ground_l_dist<=ground_r_dist) {
+				_grounded = ground_l_dist*ground_l_dist < glm::length2(_size/2.f);
+				_ground_normal = ground_l.normal;
+
+			} else if(ground_r_dist<ground_dist && ground_r_dist<=ground_l_dist) {
+				_grounded = ground_r_dist*ground_r_dist < glm::length2(_size/2.f);
+				_ground_normal = ground_r.normal;
 			}
 		}
 	}
@@ -338,6 +350,7 @@ namespace physics {
 	                            asset::Asset_manager& asset_mgr) {
 		state.read(_def);
 		_dirty = true;
+		_changes.add(owner());
 	}
 	void Static_body_comp::save(sf2::JsonSerializer& state)const {
 		state.write(_def);
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "transform_comp.hpp"
+
 #include <core/engine.hpp>
 #include <core/units.hpp>
 #include <core/ecs/ecs.hpp>
@@ -22,6 +24,8 @@ namespace sys {
 namespace physics {
 
 	class Physics_system;
+	struct Ray;
+	struct Raycast_result;
 
 	enum class Body_shape {
 		polygon, //< vertices are based on the graphical representation
@@ -60,8 +64,8 @@ namespace physics {
 			void apply_force(glm::vec2 f);
 			void foot_friction(bool enable);//< only for humanoids
 			bool has_ground_contact()const;
-			void active(bool e) {_def.active = e;}
-			void kinematic(bool e) {_dirty|=_def.kinematic!=e; _def.kinematic=e;}
+			void active(bool e) {_def.active = e; _changes.add(owner());}
+			void kinematic(bool e) {_dirty|=_def.kinematic!=e; _def.kinematic=e; _changes.add(owner());}
 			auto kinematic()const noexcept {return _def.kinematic;}
 
 			auto velocity()const -> glm::vec2;
@@ -85,12 +89,17 @@ namespace physics {
 			glm::vec2 _size;
 			bool _grounded = true;
 			glm::vec2 _ground_normal{0,1};
-			glm::vec2 _last_body_position;
 			uint_fast32_t _transform_revision = 0;
 			glm::vec2 _initial_position;
+			uint32_t _slot = ~uint32_t(0); //< in Physics_system::_states, if it's up to date
+			mutable details::Change_log_ref _changes; //< velocity(v) is const
+
+			static constexpr auto ground_ray_count = 3;
 
 			void _update_body(b2World& world);
-			void _update_ground_info(Physics_system&);
+			/// returns false if the ground doesn't have to be checked
+			auto _ground_rays(glm::vec2 position, Ray* out)const -> bool;
+			void _update_ground_info(const Raycast_result* hits);
 	};
 
 	class Static_body_comp : public ecs::Component<Static_body_comp> {
@@ -111,6 +120,7 @@ namespace physics {
 			std::unique_ptr<b2Body, void(*)(b2Body*)> _body;
 			bool _dirty = true;
 			uint_fast32_t _transform_revision = 0;
+			details::Change_log_ref _changes;
 
 			void _update_body(b2World& world);
 	};
@@ -7,34 +7,11 @@
 #include <Box2D/Box2D.h>
 #include <glm/gtx/norm.hpp>
 
-#include <unordered_set>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
 
 
-namespace lux {
-	struct Contact_key {
-		ecs::Entity* a;
-		ecs::Entity* b;
-		Contact_key() : a(nullptr), b(nullptr) {}
-		Contact_key(ecs::Entity* a, ecs::Entity* b) : a(std::min(a,b)), b(std::max(a,b)){}
-
-		auto operator<(const Contact_key& rhs)const noexcept {
-			return std::tie(a,b) < std::tie(rhs.a, rhs.b);
-		}
-		auto operator==(const Contact_key& rhs)const noexcept {
-			return std::tie(a,b) == std::tie(rhs.a, rhs.b);
-		}
-	};
-}
-
-namespace std {
-	template<>
-	struct hash<lux::Contact_key> {
-		size_t operator()(const lux::Contact_key& x) const {
-			return reinterpret_cast<size_t>(x.a) * 31 + reinterpret_cast<size_t>(x.b);
-		}
-	};
-}
-
 namespace lux {
 namespace sys {
 namespace physics {
@@ -50,61 +27,306 @@ namespace physics {
 		constexpr auto position_iterations = 6;
 
 		constexpr auto max_depth_offset = 2.f;
+
+		// Physics_system::Body_states::flags
+		constexpr uint8_t body_tracked = 1 << 0; //< in Body_states::awake during this update
+		constexpr uint8_t body_settled = 1 << 1; //< asleep and its transform matches the body
+
+		inline auto to_glm(const b2Vec2& v) -> glm::vec2 {
+			return {v.x, v.y};
+		}
+
+		inline auto hash_ptr(const void* p) -> uint64_t {
+			return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p));
+		}
+
+		struct Contact_key {
+			ecs::Entity* a;
+			ecs::Entity* b;
+			Contact_key() : a(nullptr), b(nullptr) {}
+			Contact_key(ecs::Entity* a, ecs::Entity* b)
+			    : a(std::min(a,b, std::less<ecs::Entity*>())), b(std::max(a,b, std::less<ecs::Entity*>())) {}
+
+			auto operator==(const Contact_key& rhs)const noexcept {
+				return a==rhs.a && b==rhs.b;
+			}
+			auto hash()const noexcept -> uint64_t {
+				return hash_ptr(a) * 31 + hash_ptr(b);
+			}
+		};
+
+		/*
+		 * Hash table with open addressing (linear probing) for small, trivially
+		 *   copyable keys and values, that provide a hash() and operator==.
+		 * References to values are invalidated by get() and erase().
+		 */
+		template<class Key, class Value>
+		class Open_table {
+			public:
+				auto find(const Key& key) -> Value* {
+					if(_slots.empty())
+						return nullptr;
+
+					for(auto i=_home(key); _slots[i].used; i=(i+1)&_mask()) {
+						if(_slots[i].key==key)
+							return &_slots[i].value;
+					}
+					return nullptr;
+				}
+
+				/// inserts a default constructed value if the key doesn't exist
+				auto get(const Key& key) -> Value& {
+					if((_size+1)*2 > _slots.size())
+						_grow();
+
+					auto i = _home(key);
+					for(; _slots[i].used; i=(i+1)&_mask()) {
+						if(_slots[i].key==key)
+							return _slots[i].value;
+					}
+
+					_size++;
+					_slots[i] = Slot{key, Value{}, true};
+					return _slots[i].value;
+				}
+
+				void erase(const Key& key) {
+					if(_slots.empty())
+						return;
+
+					auto i = _home(key);
+					for(; _slots[i].used; i=(i+1)&_mask()) {
+						if(_slots[i].key==key)
+							break;
+					}
+					if(!_slots[i].used)
+						return;
+
+					// shift the following entries back, so that no tombstones are required
+					_slots[i].used = false;
+					_size--;
+					for(auto j=(i+1)&_mask(); _slots[j].used; j=(j+1)&_mask()) {
+						auto home = _home(_slots[j].key);
+						auto stays = i<=j ? (i<home && home<=j) : (i<home || home<=j);
+						if(!stays) {
+							_slots[i] = _slots[j];
+							_slots[j].used = false;
+							i = j;
+						}
+					}
+				}
+
+				void clear() {
+					if(_size>0) {
+						for(auto& s : _slots)
+							s.used = false;
+						_size = 0;
+					}
+				}
+
+				auto size()const noexcept {return _size;}
+
+			private:
+				struct Slot {
+					Key key;
+					Value value;
+					bool used;
+				};
+
+				std::vector<Slot> _slots; //< size is a power of two
+				std::size_t _size = 0;
+				int _bits = 0;
+
+				auto _mask()const noexcept {return _slots.size()-1;}
+				auto _home(const Key& key)const noexcept -> std::size_t {
+					// fibonacci hashing
+					return static_cast<std::size_t>((key.hash() * 11400714819323198485ull) >> (64-_bits));
+				}
+
+				void _grow() {
+					auto old = std::move(_slots);
+					_bits = std::max(_bits+1, 4);
+					_slots = std::vector<Slot>(std::size_t(1)<<_bits, Slot{Key{}, Value{}, false});
+					_size = 0;
+
+					for(auto& s : old) {
+						if(s.used)
+							get(s.key) = s.value;
+					}
+				}
+		};
+
+		struct Entity_key {
+			ecs::Entity* entity = nullptr;
+
+			auto operator==(const Entity_key& rhs)const noexcept {return entity==rhs.entity;}
+			auto hash()const noexcept -> uint64_t {return hash_ptr(entity);}
+		};
+
+		struct Pair_state {
+			int fixture_contacts = 0;
+			uint32_t step = 0;  //< of the last entry
+			uint32_t entry = 0; //< index into the batch, iff step is the current step
+		};
 	}
 
+	/*
+	 * Collects all contact events of a step into a Contact_batch, that is
+	 *   sent by flush(). Each entity is only referenced once per batch and
+	 *   each pair of bodies has at most one entry.
+	 */
 	struct Physics_system::Contact_listener : public b2ContactListener {
 
 		util::Message_bus& bus;
-		std::unordered_map<Contact_key, int> _contacts;
+		Open_table<Contact_key, Pair_state> _pairs;
+		Open_table<Entity_key, uint32_t> _entity_indices;
+		Contact_batch _batch;
+		uint32_t _step = 1;
 
-		Contact_listener(Engine& e) : bus(e.bus()) {}
+		/// Box2D wakes bodies when their contacts are destroyed, after which they can't be found through them
+		std::vector<b2Body*> woken;
+
+		Contact_listener(util::Message_bus& bus) : bus(bus) {
+			_batch.entities.emplace_back();
+		}
 
 		void BeginContact(b2Contact* contact) override {
-			auto a = static_cast<ecs::Entity*>(contact->GetFixtureA()->GetBody()->GetUserData());
-			auto b = static_cast<ecs::Entity*>(contact->GetFixtureB()->GetBody()->GetUserData());
+			auto fa = contact->GetFixtureA();
+			auto fb = contact->GetFixtureB();
+			auto a = static_cast<ecs::Entity*>(fa->GetBody()->GetUserData());
+			auto b = static_cast<ecs::Entity*>(fb->GetBody()->GetUserData());
+			if(!a && !b)
+				return;
+
+			auto key = Contact_key{a,b};
+			auto& pair = _pairs.get(key);
+			if(pair.fixture_contacts++ == 0) {
+				auto& entry = _entry(pair, a, b);
+
+				// ended and started again during the same step
+				if(entry.flags & Contact_batch::end)
+					entry.flags &= ~Contact_batch::end;
+				else
+					entry.flags |= Contact_batch::begin;
 
-			auto& count = _contacts[Contact_key{a,b}];
-			if(count++ == 0) {
-				bus.send<Contact>(a ? a->shared_from_this() : ecs::Entity_ptr{},
-				                  b ? b->shared_from_this() : ecs::Entity_ptr{}, true);
+				if(_batch.entity(entry.a)!=a)
+					std::swap(fa, fb);
+				if(fa->IsSensor()) entry.flags |= Contact_batch::sensor_a;
+				if(fb->IsSensor()) entry.flags |= Contact_batch::sensor_b;
 			}
 		}
 		void EndContact(b2Contact* contact) override {
+			woken.push_back(contact->GetFixtureA()->GetBody());
+			woken.push_back(contact->GetFixtureB()->GetBody());
+
 			auto a = static_cast<ecs::Entity*>(contact->GetFixtureA()->GetBody()->GetUserData());
 			auto b = static_cast<ecs::Entity*>(contact->GetFixtureB()->GetBody()->GetUserData());
 
-			auto& count = _contacts[Contact_key{a,b}];
-			if(count-- == 1) {
-				bus.send<Contact>(a ? a->shared_from_this() : ecs::Entity_ptr{},
-				                  b ? b->shared_from_this() : ecs::Entity_ptr{}, false);
-				_contacts.erase(Contact_key{a,b});
+			auto key = Contact_key{a,b};
+			auto pair = _pairs.find(key);
+			if(pair && --pair->fixture_contacts == 0) {
+				// the pair is removed in flush(), because it might start again during this step
+				_entry(*pair, a, b).flags |= Contact_batch::end;
 			}
 		}
 
 		void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override {
 			auto a = static_cast<ecs::Entity*>(contact->GetFixtureA()->GetBody()->GetUserData());
 			auto b = static_cast<ecs::Entity*>(contact->GetFixtureB()->GetBody()->GetUserData());
+			if(a==nullptr || b==nullptr)
+				return;
+
+			auto key = Contact_key{a,b};
+			auto pair = _pairs.find(key);
+			if(!pair)
+				return;
+
+			auto impact = 0.f;
+			for(auto i=0; i<impulse->count; ++i) {
+				impact+=impulse->normalImpulses[i];
+			}
+
+			auto& entry = _entry(*pair, a, b);
+			if(!(entry.flags & Contact_batch::collision) || impact>entry.impact) {
+				entry.flags |= Contact_batch::collision;
+				entry.impact = impact;
+
+				b2WorldManifold manifold;
+				contact->GetWorldManifold(&manifold);
+				auto normal = glm::vec2{manifold.normal.x, manifold.normal.y};
+				entry.normal = _batch.entity(entry.a)==a ? normal : -normal;
+			}
+		}
 
-			if(a!=nullptr && b!=nullptr) {
-				auto impact = 0.f;
-				for(auto i=0; i<impulse->count; ++i) {
-					impact+=impulse->normalImpulses[i];
+		/// sends all events since the last call
+		void flush() {
+			if(!_batch.entries.empty()) {
+				for(auto& e : _batch.entries) {
+					if(e.flags & Contact_batch::end) {
+						auto key = Contact_key{_batch.entity(e.a), _batch.entity(e.b)};
+						auto pair = _pairs.find(key);
+						if(pair && pair->fixture_contacts==0)
+							_pairs.erase(key);
+					}
 				}
 
-				bus.send<Collision>(a ? a->shared_from_this() : ecs::Entity_ptr{},
-				                    b ? b->shared_from_this() : ecs::Entity_ptr{}, impact);
+				auto entries = _batch.entries.size();
+				auto entities = _batch.entities.size();
+				bus.send<Contact_batch>(std::move(_batch));
+
+				_batch = Contact_batch{};
+				_batch.entries.reserve(entries);
+				_batch.entities.reserve(entities);
+				_batch.entities.emplace_back();
+				_entity_indices.clear();
+			}
+
+			_step++;
+		}
+
+		auto _entity_index(ecs::Entity* e) -> uint32_t {
+			if(!e)
+				return 0;
+
+			auto& index = _entity_indices.get(Entity_key{e});
+			if(index==0) {
+				index = static_cast<uint32_t>(_batch.entities.size());
+				_batch.entities.emplace_back(e->shared_from_this());
 			}
+			return index;
+		}
+
+		/// a and b are only used for new entries, whose order matches the fixtures of the b2Contact
+		auto _entry(Pair_state& pair, ecs::Entity* a, ecs::Entity* b) -> Contact_batch::Entry& {
+			if(pair.step!=_step) {
+				pair.step = _step;
+				pair.entry = static_cast<uint32_t>(_batch.entries.size());
+
+				// the order of the key depends on the addresses and isn't deterministic
+				_batch.entries.push_back(Contact_batch::Entry{_entity_index(a), _entity_index(b),
+				                                              0, 0.f, glm::vec2{}});
+			}
+
+			return _batch.entries[pair.entry];
 		}
 	};
 
 	Physics_system::Physics_system(Engine& engine, ecs::Entity_manager& ecs)
+	    : Physics_system(engine.bus(), ecs) {
+	}
+	Physics_system::Physics_system(util::Message_bus& bus, ecs::Entity_manager& ecs)
 	    : _bodies_dynamic(ecs.list<Dynamic_body_comp>()),
 	      _bodies_static(ecs.list<Static_body_comp>()),
-	      _listener(std::make_unique<Contact_listener>(engine)),
-	      _world(std::make_unique<b2World>(b2Vec2{gravity_x,gravity_y})) {
+	      _listener(std::make_unique<Contact_listener>(bus)),
+	      _world(std::make_unique<b2World>(b2Vec2{gravity_x,gravity_y})),
+	      _changes(std::make_shared<std::vector<ecs::Entity*>>()),
+	      _body_events(&Physics_system::_on_body_event, this) {
 
 		_world->SetContactListener(_listener.get());
 		_world->SetAutoClearForces(false);
+
+		_body_events.connect(_bodies_dynamic);
+		_body_events.connect(_bodies_static);
 	}
 	Physics_system::~Physics_system() {}
 
@@ -114,13 +336,16 @@ namespace physics {
 		auto steps = static_cast<int>(_dt_acc / time_step);
 		_dt_acc -= steps*time_step;
 
-		_get_positions();
+		_sync_bodies();
 
 		if(steps>0) {
 			for(auto i=0; i<steps; ++i) {
-				_reset_smooth_state();
+				_begin_step();
 
 				_world->Step(time_step, velocity_iterations, position_iterations);
+				_listener->flush();
+
+				_track_woken_bodies();
 			}
 		}
 
@@ -128,87 +353,298 @@ namespace physics {
 		_smooth_positions(_dt_acc / time_step);
 	}
 
-	void Physics_system::_get_positions() {
-		for(auto& comp : _bodies_dynamic) {
-			if(!comp._body || comp._dirty) {
-				this->update_body_shape(comp);
+	void Physics_system::_sync_bodies() {
+		auto& s = _states;
+
+		if(_bodies_changed || _bodies_dynamic.size()!=s.bodies.size())
+			_sync_all_bodies();
+		else
+			_sync_changed_bodies();
+
+		// entries added by the sync itself (e.g. new bodies) are already up to date
+		_changes->clear();
+
+		for(auto slot : s.keep_position) {
+			auto body = s.bodies[slot];
+			body->ApplyForceToCenter(-1 * body->GetMass() * _world->GetGravity(), true);
+			_track(slot, s.transforms[slot]);
+		}
+	}
+
+	void Physics_system::_sync_all_bodies() {
+		auto& s = _states;
+		auto count = _bodies_dynamic.size();
+		s.bodies.resize(count);
+		s.transforms.resize(count);
+		s.last_positions.resize(count);
+		s.flags.resize(count);
+		s.awake.clear();
+		s.keep_position.clear();
+
+		// might contain bodies, that have been destroyed since the last step
+		_listener->woken.clear();
+
+		for(auto i=std::size_t(0); i<count; i++) {
+			_sync_body(static_cast<uint32_t>(i));
+		}
+
+		for(auto& comp : _bodies_static) {
+			_sync_body(comp);
+		}
+
+		_bodies_changed = false;
+	}
+
+	void Physics_system::_sync_changed_bodies() {
+		auto& s = _states;
+
+		// the bodies that were awake or haven't settled during the last update
+		auto kept = std::size_t(0);
+		for(auto slot : s.awake) {
+			if(s.bodies[slot]->IsAwake() || !(s.flags[slot] & body_settled)) {
+				s.flags[slot] |= body_tracked;
+				s.transforms[slot] = &_bodies_dynamic[slot].owner().get<Transform_comp>().get_or_throw();
+				s.awake[kept++] = slot;
 			}
+		}
+		s.awake.resize(kept);
+
+		// and the ones that have been modified from outside (which might log themselves again)
+		for(auto i=std::size_t(0); i<_changes->size(); i++) {
+			auto entity = (*_changes)[i];
+			entity->get<Dynamic_body_comp>().process([&](auto& comp) {
+				if(comp._slot<s.bodies.size())
+					this->_sync_body(comp._slot);
+			});
+			entity->get<Static_body_comp>().process([&](auto& comp) {
+				this->_sync_body(comp);
+			});
+		}
+	}
+
+	namespace {
+		void watch(details::Change_log_ref& ref, const std::shared_ptr<std::vector<ecs::Entity*>>& log) {
+			if(ref.log!=log)
+				ref.log = log;
+			ref.logged = false;
+		}
+	}
+
+	void Physics_system::_sync_body(uint32_t slot) {
+		auto& s = _states;
+		auto& comp = _bodies_dynamic[slot];
+
+		if(!comp._body || comp._dirty) {
+			this->update_body_shape(comp);
+		}
+
+		auto body = comp._body.get();
+		auto& transform = comp.owner().get<Transform_comp>().get_or_throw();
+		s.bodies[slot] = body;
+		s.transforms[slot] = &transform;
+		watch(comp._changes, _changes);
+		watch(transform._changes, _changes);
+
+		auto flags = uint8_t(s.flags[slot] & body_tracked);
+		if(comp._slot==slot) {
+			flags |= s.flags[slot] & body_settled;
+		} else {
+			// new or moved by the pool
+			comp._slot = slot;
+			s.last_positions[slot] = to_glm(body->GetPosition());
+		}
+
+		auto pos = remove_units(transform.position());
+
+		auto active = comp._def.active && std::abs(pos.z) <= max_depth_offset;
+
+		if(transform.changed_since(comp._transform_revision) || body->IsActive()!=active) {
+			comp._transform_revision = transform.revision();
+
+			auto rot = comp._def.fixed_rotation ? 0.f : transform.rotation().value();
+			body->SetTransform(b2Vec2{pos.x, pos.y}, rot);
+			body->SetActive(active);
+			comp._initial_position = pos.xy();
+			s.last_positions[slot] = pos.xy();
+			flags &= ~body_settled;
+		}
+
+		auto keep = std::find(s.keep_position.begin(), s.keep_position.end(), slot);
+		if(comp._def.keep_position_force>0.f) {
+			if(keep==s.keep_position.end())
+				s.keep_position.push_back(slot);
+		} else if(keep!=s.keep_position.end()) {
+			s.keep_position.erase(keep);
+		}
+
+		s.flags[slot] = flags;
+		if(body->IsAwake() || !(flags & body_settled)) {
+			_track(slot, &transform);
+		}
+	}
+
+	void Physics_system::_sync_body(Static_body_comp& comp) {
+		if(!comp._body || comp._dirty) {
+			this->update_body_shape(comp);
+		}
+
+		auto& transform = comp.owner().get<Transform_comp>().get_or_throw();
+		watch(comp._changes, _changes);
+		watch(transform._changes, _changes);
+
+		if(transform.changed_since(comp._transform_revision)) {
+			comp._transform_revision = transform.revision();
 
-			auto& transform = comp.owner().get<Transform_comp>().get_or_throw();
 			auto pos = remove_units(transform.position());
+			comp._body->SetTransform(b2Vec2{pos.x, pos.y}, transform.rotation().value());
+			comp._body->SetActive(comp._def.active && std::abs(pos.z) <= max_depth_offset);
+			_check_all_bodies = true;
+		}
+	}
 
-			auto active = comp._def.active && std::abs(pos.z) <= max_depth_offset;
+	/// adds the slot to the bodies, that are stepped and written back during this update
+	void Physics_system::_track(uint32_t slot, Transform_comp* transform) {
+		auto& s = _states;
+		if(!(s.flags[slot] & body_tracked)) {
+			s.flags[slot] |= body_tracked;
+			s.transforms[slot] = transform ? transform
+			                               : &_bodies_dynamic[slot].owner().get<Transform_comp>().get_or_throw();
+			s.awake.push_back(slot);
+		}
+	}
 
-			if(transform.changed_since(comp._transform_revision) || comp._body->IsActive()!=active) {
-				comp._transform_revision = transform.revision();
+	void Physics_system::_on_body_event(ecs::Component_event e) {
+		_bodies_changed = true;
 
-				auto rot = comp._def.fixed_rotation ? 0.f : transform.rotation().value();
-				comp._body->SetTransform(b2Vec2{pos.x, pos.y}, rot);
-				comp._body->SetActive(active);
-				comp._initial_position = pos.xy();
-			}
+		// the entity might outlive its body
+		if(e.type==ecs::Component_event_type::freed) {
+			e.handle.get<Transform_comp>().process([](auto& transform) {
+				transform._changes = {};
+			});
+		}
+	}
 
-			if(comp._def.keep_position_force>0.f) {
-				comp._body->ApplyForceToCenter(-1 * comp._body->GetMass() * _world->GetGravity(), true);
-			}
+	void Physics_system::_begin_step() {
+		auto& s = _states;
+
+		for(auto slot : s.awake) {
+			s.last_positions[slot] = to_glm(s.bodies[slot]->GetPosition());
 		}
 
-		for(auto& comp : _bodies_static) {
-			if(!comp._body || comp._dirty) {
-				this->update_body_shape(comp);
+		for(auto slot : s.keep_position) {
+			auto& comp = _bodies_dynamic[slot];
+			auto body = s.bodies[slot];
+
+			auto diff = to_glm(body->GetPosition()) - comp._initial_position;
+			auto diff_len = glm::length(diff);
+			if(diff_len>0.2f) {
+				diff/=diff_len;
+				auto resp = -diff * comp._def.keep_position_force * glm::clamp(diff_len/10.f, 0.1f, 1.0f);
+				body->ApplyLinearImpulse(b2Vec2{resp.x, resp.y}, body->GetWorldCenter(), true);
 			}
+		}
+	}
+
+	void Physics_system::_track_woken_bodies() {
+		auto& s = _states;
 
-			auto& transform = comp.owner().get<Transform_comp>().get_or_throw();
-			if(transform.changed_since(comp._transform_revision)) {
-				comp._transform_revision = transform.revision();
+		auto track = [&](b2Body* body) {
+			if(body->GetType()==b2_staticBody || !body->IsAwake())
+				return;
 
-				auto& transform = comp.owner().get<Transform_comp>().get_or_throw();
-				auto pos = remove_units(transform.position());
-				comp._body->SetTransform(b2Vec2{pos.x, pos.y}, transform.rotation().value());
-				comp._body->SetActive(comp._def.active && std::abs(pos.z) <= max_depth_offset);
+			auto entity = static_cast<ecs::Entity*>(body->GetUserData());
+			entity->get<Dynamic_body_comp>().process([&](auto& comp) {
+				auto slot = comp._slot;
+				if(slot<s.flags.size() && s.bodies[slot]==body)
+					this->_track(slot);
+			});
+		};
+
+		for(auto body : _listener->woken)
+			track(body);
+		_listener->woken.clear();
+
+		// the new contacts of a moved static body wake bodies, that don't touch any tracked body
+		if(_check_all_bodies) {
+			_check_all_bodies = false;
+			for(auto slot=uint32_t(0); slot<s.bodies.size(); slot++) {
+				if(s.bodies[slot]->IsAwake())
+					_track(slot);
 			}
 		}
-	}
-	void Physics_system::_reset_smooth_state() {
-		for(auto& comp : _bodies_dynamic) {
-			auto b2_pos = comp._body->GetPosition();
-			comp._last_body_position = glm::vec2{b2_pos.x, b2_pos.y};
-
-			if(comp._def.keep_position_force>0.f) {
-				auto diff = comp._last_body_position - comp._initial_position;
-				auto diff_len = glm::length(diff);
-				if(diff_len>0.2f) {
-					diff/=diff_len;
-					auto resp = -diff * comp._def.keep_position_force * glm::clamp(diff_len/10.f, 0.1f, 1.0f);
-					comp._body->ApplyLinearImpulse(b2Vec2{resp.x, resp.y}, comp._body->GetWorldCenter(), true);
-				}
+
+		// Box2D wakes whole islands and both bodies of new contacts, so every
+		//   other body that has been woken by the step shares a contact with
+		//   a tracked body (directly or through other woken bodies)
+		for(auto i=std::size_t(0); i<s.awake.size(); i++) {
+			auto body = s.bodies[s.awake[i]];
+
+			for(auto edge=body->GetContactList(); edge; edge=edge->next) {
+				track(edge->other);
 			}
 		}
 	}
 
 	void Physics_system::_smooth_positions(float alpha) {
-		for(Dynamic_body_comp& comp : _bodies_dynamic) {
-			auto& transform = comp.owner().get<Transform_comp>().get_or_throw();
-
-			auto b2_pos = comp._body->GetPosition();
-			auto pos = glm::vec2{b2_pos.x, b2_pos.y};
-			pos = glm::mix(comp._last_body_position, pos, alpha);
-			transform.position({pos.x*1_m, pos.y*1_m, transform.position().z});
-			if(!comp._def.fixed_rotation) {
-				transform.rotation(Angle{comp._body->GetAngle()});
+		auto& s = _states;
+
+		for(auto slot : s.awake) {
+			auto& comp = _bodies_dynamic[slot];
+			auto& transform = *s.transforms[slot];
+			auto body = s.bodies[slot];
+
+			auto last_pos = s.last_positions[slot];
+			auto body_pos = to_glm(body->GetPosition());
+			auto pos = glm::mix(last_pos, body_pos, alpha);
+
+			// only write changes, to keep the revision (and caches that depend on it) valid
+			auto transform_pos = transform.position();
+			if(transform_pos.x.value()!=pos.x || transform_pos.y.value()!=pos.y) {
+				transform._simulated_position({pos.x*1_m, pos.y*1_m, transform_pos.z});
+			}
+			if(!comp._def.fixed_rotation && transform.rotation().value()!=body->GetAngle()) {
+				transform.rotation(Angle{body->GetAngle()});
 			}
 
 			comp._transform_revision = transform.revision();
-			comp._update_ground_info(*this);
+
+			// asleep and the transform matches the body
+			auto settled = !body->IsAwake() && last_pos==body_pos;
+			s.flags[slot] = settled ? body_settled : 0;
+
+			auto first_ray = _ground_rays.size();
+			_ground_rays.resize(first_ray + Dynamic_body_comp::ground_ray_count);
+			if(comp._ground_rays(pos, &_ground_rays[first_ray]))
+				_ground_bodies.push_back(&comp);
+			else
+				_ground_rays.resize(first_ray);
 		}
+
+		_ground_hits.resize(_ground_rays.size());
+		raycast_batch(_ground_rays.data(), _ground_rays.size(), _ground_hits.data());
+		for(auto i=std::size_t(0); i<_ground_bodies.size(); i++) {
+			_ground_bodies[i]->_update_ground_info(&_ground_hits[i*Dynamic_body_comp::ground_ray_count]);
+		}
+
+		_ground_bodies.clear();
+		_ground_rays.clear();
 	}
 
 	void Physics_system::update_body_shape(Dynamic_body_comp& comp) {
 		comp._update_body(*_world);
+
+		// the body has been moved and woken up
+		auto slot = comp._slot;
+		if(slot<_states.bodies.size() && _states.bodies[slot]==comp._body.get()) {
+			_states.last_positions[slot] = to_glm(comp._body->GetPosition());
+			_states.flags[slot] &= ~body_settled;
+		}
+		comp._changes.add(comp.owner());
 	}
 
 	void Physics_system::update_body_shape(Static_body_comp& comp) {
 		comp._update_body(*_world);
+		_check_all_bodies = true;
 	}
 
 	namespace {
@@ -322,6 +758,292 @@ namespace physics {
 		return callback.result;
 	}
 
+	namespace {
+		constexpr auto max_group_size = std::size_t(64);
+
+		auto bounds(const Ray& ray) -> b2AABB {
+			auto target = ray.position + ray.dir*ray.max_dist;
+			b2AABB aabb;
+			aabb.lowerBound = b2Vec2{std::min(ray.position.x, target.x), std::min(ray.position.y, target.y)};
+			aabb.upperBound = b2Vec2{std::max(ray.position.x, target.x), std::max(ray.position.y, target.y)};
+			return aabb;
+		}
+		auto bounds(const Aabb& box) -> b2AABB {
+			b2AABB aabb;
+			aabb.lowerBound = b2Vec2{box.lower.x-b2_polygonRadius, box.lower.y-b2_polygonRadius};
+			aabb.upperBound = b2Vec2{box.upper.x+b2_polygonRadius, box.upper.y+b2_polygonRadius};
+			return aabb;
+		}
+
+		auto area(const b2AABB& aabb) {
+			auto size = aabb.upperBound - aabb.lowerBound;
+			return (size.x+1.f) * (size.y+1.f);
+		}
+
+		auto spread_bits(uint32_t v) -> uint32_t {
+			v = (v | (v << 8)) & 0x00FF00FF;
+			v = (v | (v << 4)) & 0x0F0F0F0F;
+			v = (v | (v << 2)) & 0x33333333;
+			v = (v | (v << 1)) & 0x55555555;
+			return v;
+		}
+
+		/*
+		 * Sorts the queries along a Z-order curve and splits them into groups
+		 *   of nearby queries, whose combined bounds aren't much larger than
+		 *   the bounds of their members.
+		 * Calls f(const b2AABB& group_bounds, const uint32_t* indices, std::size_t count)
+		 */
+		template<class T, class F>
+		void process_groups(const T* queries, std::size_t count, F&& f) {
+			if(count==0)
+				return;
+
+			auto query_bounds = std::vector<b2AABB>();
+			query_bounds.reserve(count);
+			for(auto i=std::size_t(0); i<count; i++) {
+				query_bounds.push_back(bounds(queries[i]));
+			}
+
+			auto total = query_bounds[0];
+			for(auto& b : query_bounds) {
+				total.Combine(b);
+			}
+
+			auto order = std::vector<std::pair<uint32_t, uint32_t>>(); // morton code, index
+			order.reserve(count);
+			auto extent = total.upperBound - total.lowerBound;
+			auto scale = b2Vec2{extent.x>0.f ? 65535.f/extent.x : 0.f, extent.y>0.f ? 65535.f/extent.y : 0.f};
+			for(auto i=std::size_t(0); i<count; i++) {
+				auto center = query_bounds[i].GetCenter() - total.lowerBound;
+				auto x = static_cast<uint32_t>(center.x * scale.x);
+				auto y = static_cast<uint32_t>(center.y * scale.y);
+				order.emplace_back(spread_bits(x) | (spread_bits(y) << 1), static_cast<uint32_t>(i));
+			}
+			std::sort(order.begin(), order.end());
+
+			auto indices = std::vector<uint32_t>();
+			indices.reserve(max_group_size);
+
+			auto group = b2AABB{};
+			auto member_area = 0.f;
+			for(auto& o : order) {
+				auto& b = query_bounds[o.second];
+
+				if(!indices.empty()) {
+					auto combined = group;
+					combined.Combine(b);
+					if(indices.size()<max_group_size && area(combined) <= 2.f*(member_area+area(b))) {
+						group = combined;
+						member_area += area(b);
+						indices.push_back(o.second);
+						continue;
+					}
+
+					f(group, indices.data(), indices.size());
+					indices.clear();
+				}
+
+				group = b;
+				member_area = area(b);
+				indices.push_back(o.second);
+			}
+
+			f(group, indices.data(), indices.size());
+		}
+
+		/// the broadphase proxies of a group, in a structure of arrays layout
+		struct Candidates {
+			std::vector<float> lower_x, lower_y, upper_x, upper_y;
+			std::vector<const b2FixtureProxy*> proxies;
+
+			const b2BroadPhase* broadphase = nullptr;
+
+			void clear() {
+				lower_x.clear();
+				lower_y.clear();
+				upper_x.clear();
+				upper_y.clear();
+				proxies.clear();
+			}
+			auto size()const noexcept {return proxies.size();}
+
+			/// callback of b2BroadPhase::Query
+			bool QueryCallback(int32 proxy_id) {
+				auto proxy = static_cast<const b2FixtureProxy*>(broadphase->GetUserData(proxy_id));
+				lower_x.push_back(proxy->aabb.lowerBound.x);
+				lower_y.push_back(proxy->aabb.lowerBound.y);
+				upper_x.push_back(proxy->aabb.upperBound.x);
+				upper_y.push_back(proxy->aabb.upperBound.y);
+				proxies.push_back(proxy);
+				return true;
+			}
+		};
+
+		auto entity_of(const b2FixtureProxy* proxy) {
+			return static_cast<ecs::Entity*>(proxy->fixture->GetBody()->GetUserData());
+		}
+
+		void raycast_grouped(const b2World& world, const Ray* rays, std::size_t count, Raycast_result* out,
+		                   details::Query_filter filter, void* filter_ctx) {
+			auto candidates = Candidates{};
+			candidates.broadphase = &world.GetContactManager().m_broadPhase;
+			auto t_min = std::vector<float>();
+
+			process_groups(rays, count, [&](const b2AABB& group, const uint32_t* indices, std::size_t group_size) {
+				candidates.clear();
+				candidates.broadphase->Query(&candidates, group);
+
+				auto candidate_count = candidates.size();
+				t_min.resize(candidate_count);
+
+				for(auto i=std::size_t(0); i<group_size; i++) {
+					auto& ray = rays[indices[i]];
+					auto& result = out[indices[i]];
+					result = Raycast_result{glm::vec2{0,0}, ray.max_dist, nullptr};
+
+					auto d = ray.dir * ray.max_dist;
+					if(!(glm::length2(d)>0.f))
+						continue;
+
+					// slab test against all candidates (t in [0,1] along d, >1 for misses)
+					auto inv_x = d.x!=0.f ? 1.f/d.x : 1e30f;
+					auto inv_y = d.y!=0.f ? 1.f/d.y : 1e30f;
+					auto o_x = ray.position.x;
+					auto o_y = ray.position.y;
+					auto lx = candidates.lower_x.data();
+					auto ly = candidates.lower_y.data();
+					auto ux = candidates.upper_x.data();
+					auto uy = candidates.upper_y.data();
+					auto tm = t_min.data();
+					for(auto c=std::size_t(0); c<candidate_count; c++) {
+						auto tx1 = (lx[c]-o_x)*inv_x;
+						auto tx2 = (ux[c]-o_x)*inv_x;
+						auto ty1 = (ly[c]-o_y)*inv_y;
+						auto ty2 = (uy[c]-o_y)*inv_y;
+						auto enter = std::max(std::max(std::min(tx1,tx2), std::min(ty1,ty2)), 0.f);
+						auto exit  = std::min(std::min(std::max(tx1,tx2), std::max(ty1,ty2)), 1.f);
+						tm[c] = enter<=exit ? enter : 2.f;
+					}
+
+					auto input = b2RayCastInput{};
+					input.p1 = b2Vec2{ray.position.x, ray.position.y};
+					input.p2 = b2Vec2{ray.position.x+d.x, ray.position.y+d.y};
+					input.maxFraction = 1.f;
+
+					for(auto c=std::size_t(0); c<candidate_count; c++) {
+						if(tm[c]>input.maxFraction)
+							continue;
+
+						auto proxy = candidates.proxies[c];
+						auto entity = entity_of(proxy);
+						if(entity==ray.exclude)
+							continue;
+
+						auto output = b2RayCastOutput{};
+						if(!proxy->fixture->RayCast(&output, input, proxy->childIndex))
+							continue;
+
+						if(entity && !filter(filter_ctx, *entity))
+							continue;
+
+						input.maxFraction = output.fraction;
+						result = Raycast_result{glm::vec2{output.normal.x, output.normal.y},
+						                        output.fraction*ray.max_dist, entity};
+					}
+				}
+			});
+		}
+
+		void query_grouped(const b2World& world, const Aabb* boxes, std::size_t count, Aabb_query_result& out,
+		                 details::Query_filter filter, void* filter_ctx) {
+			auto candidates = Candidates{};
+			candidates.broadphase = &world.GetContactManager().m_broadPhase;
+			auto overlaps = std::vector<uint8_t>();
+
+			// results of each box, until they can be written in order
+			auto box_begin = std::vector<uint32_t>(count);
+			auto box_end = std::vector<uint32_t>(count);
+			auto entities = std::vector<ecs::Entity*>();
+
+			process_groups(boxes, count, [&](const b2AABB& group, const uint32_t* indices, std::size_t group_size) {
+				candidates.clear();
+				candidates.broadphase->Query(&candidates, group);
+
+				auto candidate_count = candidates.size();
+				overlaps.resize(candidate_count);
+
+				for(auto i=std::size_t(0); i<group_size; i++) {
+					auto& box = boxes[indices[i]];
+					box_begin[indices[i]] = static_cast<uint32_t>(entities.size());
+
+					// b2TestOverlap() includes the skin of the polygon
+					auto lower = box.lower - b2_polygonRadius;
+					auto upper = box.upper + b2_polygonRadius;
+
+					auto lx = candidates.lower_x.data();
+					auto ly = candidates.lower_y.data();
+					auto ux = candidates.upper_x.data();
+					auto uy = candidates.upper_y.data();
+					auto o = overlaps.data();
+					for(auto c=std::size_t(0); c<candidate_count; c++) {
+						o[c] = lx[c]<=upper.x && ux[c]>=lower.x
+						    && ly[c]<=upper.y && uy[c]>=lower.y;
+					}
+
+					auto shape = b2PolygonShape{};
+					auto half_size = (box.upper-box.lower) / 2.f;
+					auto center = box.lower + half_size;
+					shape.SetAsBox(std::max(half_size.x, b2_linearSlop), std::max(half_size.y, b2_linearSlop),
+					               b2Vec2{center.x, center.y}, 0.f);
+					auto identity = b2Transform{};
+					identity.SetIdentity();
+
+					for(auto c=std::size_t(0); c<candidate_count; c++) {
+						if(!o[c])
+							continue;
+
+						auto proxy = candidates.proxies[c];
+						auto entity = entity_of(proxy);
+						if(!entity)
+							continue;
+
+						auto duplicate = std::find(entities.begin()+box_begin[indices[i]], entities.end(), entity)
+						                 != entities.end();
+						if(duplicate)
+							continue;
+
+						auto body = proxy->fixture->GetBody();
+						if(b2TestOverlap(&shape, 0, proxy->fixture->GetShape(), proxy->childIndex,
+						                 identity, body->GetTransform()) && filter(filter_ctx, *entity)) {
+							entities.push_back(entity);
+						}
+					}
+
+					box_end[indices[i]] = static_cast<uint32_t>(entities.size());
+				}
+			});
+
+			out.offsets.clear();
+			out.entities.clear();
+			out.offsets.reserve(count+1);
+			out.entities.reserve(entities.size());
+			out.offsets.push_back(0);
+			for(auto i=std::size_t(0); i<count; i++) {
+				out.entities.insert(out.entities.end(), entities.begin()+box_begin[i], entities.begin()+box_end[i]);
+				out.offsets.push_back(static_cast<uint32_t>(out.entities.size()));
+			}
+		}
+	}
+	void Physics_system::_raycast_batch(const Ray* rays, std::size_t count, Raycast_result* out,
+	                                    details::Query_filter filter, void* filter_ctx)const {
+		raycast_grouped(*_world, rays, count, out, filter, filter_ctx);
+	}
+	void Physics_system::_query_batch(const Aabb* boxes, std::size_t count, Aabb_query_result& out,
+	                                  details::Query_filter filter, void* filter_ctx)const {
+		query_grouped(*_world, boxes, count, out, filter, filter_ctx);
+	}
+
 }
 }
 }
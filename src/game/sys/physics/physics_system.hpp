@@ -10,44 +10,142 @@
 #include "physics_comp.hpp"
 
 #include <core/utils/maybe.hpp>
+#include <core/utils/events.hpp>
 #include <core/engine.hpp>
 #include <core/units.hpp>
 #include <core/ecs/ecs.hpp>
 
 #include <functional>
+#include <memory>
+#include <vector>
+#include <cstdint>
 
 
 class b2World;
+class b2Body;
 
 namespace lux {
 namespace sys {
 namespace physics {
 
+	class Transform_comp;
+
 	struct Raycast_result {
 		glm::vec2 normal;
 		float distance;
 		ecs::Entity* entity=nullptr;
 	};
 
+	/// input of Physics_system::raycast_batch()
+	struct Ray {
+		glm::vec2 position;
+		glm::vec2 dir; //< normalized
+		float max_dist;
+		ecs::Entity* exclude = nullptr;
+	};
+
+	/// input of Physics_system::query_batch()
+	struct Aabb {
+		glm::vec2 lower;
+		glm::vec2 upper;
+	};
+
+	/// the entities overlapping box i are entities[offsets[i]] ... entities[offsets[i+1]-1]
+	struct Aabb_query_result {
+		std::vector<uint32_t> offsets;
+		std::vector<ecs::Entity*> entities;
+	};
+
+	struct Accept_all {
+		bool operator()(ecs::Entity&)const noexcept {return true;}
+	};
+
+	namespace details {
+		using Query_filter = bool(*)(void*, ecs::Entity&);
+
+		template<class Filter>
+		bool query_filter_trampoline(void* filter, ecs::Entity& e) {
+			return (*static_cast<Filter*>(filter))(e);
+		}
+	}
+
+	/// begin/end of a contact between two bodies, see Contact_batch
 	struct Contact {
-		ecs::Entity_ptr a;
-		ecs::Entity_ptr b;
+		ecs::Entity* a = nullptr;
+		ecs::Entity* b = nullptr;
 		bool begin = true;
-		Contact()=default;
-		Contact(ecs::Entity_ptr a, ecs::Entity_ptr b, bool begin) : a(a), b(b), begin(begin) {}
 	};
 
+	/// collision between two entities, see Contact_batch
 	struct Collision {
-		ecs::Entity_ptr a;
-		ecs::Entity_ptr b;
+		ecs::Entity* a = nullptr;
+		ecs::Entity* b = nullptr;
 		float impact = 0.f;
-		Collision()=default;
-		Collision(ecs::Entity_ptr a, ecs::Entity_ptr b, float impact) : a(a), b(b), impact(impact) {}
+		glm::vec2 normal; //< pointing from a to b
+	};
+
+	/*
+	 * All contact events of one physics step, deduplicated per pair of bodies
+	 *   and sent as a single message after each step.
+	 * The entities are referenced by their index into 'entities', which keeps
+	 *   them alive until all receivers have processed the batch.
+	 */
+	struct Contact_batch {
+		enum Flags : uint8_t {
+			begin     = 1<<0, //< started touching during the step
+			end       = 1<<1, //< stopped touching (after begin, if both are set)
+			collision = 1<<2, //< impact and normal are valid
+			sensor_a  = 1<<3,
+			sensor_b  = 1<<4
+		};
+
+		struct Entry {
+			uint32_t a;
+			uint32_t b;
+			uint8_t flags;
+			float impact;     //< strongest impulse (summed over all points of a manifold)
+			glm::vec2 normal; //< of the strongest impulse, pointing from a to b
+		};
+
+		std::vector<ecs::Entity_ptr> entities; //< [0] is empty, for bodies without an entity
+		std::vector<Entry> entries;
+
+		auto entity(uint32_t index)const noexcept -> ecs::Entity* {return entities[index].get();}
+
+		/// calls f(const Entry&) for all entries that have any of the flags set
+		template<class F>
+		void process(uint8_t flags, F&& f)const {
+			for(auto& e : entries) {
+				if(e.flags & flags)
+					f(e);
+			}
+		}
+
+		/// calls f(Contact) for each begin and end
+		template<class F>
+		void process_contacts(F&& f)const {
+			process(begin | end, [&](const Entry& e) {
+				if(e.flags & begin)
+					f(Contact{entity(e.a), entity(e.b), true});
+				if(e.flags & end)
+					f(Contact{entity(e.a), entity(e.b), false});
+			});
+		}
+
+		/// calls f(Collision) for each collision between two entities
+		template<class F>
+		void process_collisions(F&& f)const {
+			process(collision, [&](const Entry& e) {
+				f(Collision{entity(e.a), entity(e.b), e.impact, e.normal});
+			});
+		}
 	};
 
 	class Physics_system {
 		public:
 			Physics_system(Engine&, ecs::Entity_manager&);
+			/// contacts are sent to the given bus, instead of the one of the engine
+			Physics_system(util::Message_bus&, ecs::Entity_manager&);
 			~Physics_system();
 
 			void update(Time);
@@ -61,6 +159,26 @@ namespace physics {
 			auto query_intersection(Dynamic_body_comp&,
 			                        std::function<bool(ecs::Entity&)> filter) -> util::maybe<ecs::Entity&>;
 
+			/*
+			 * Batched queries: nearby rays/boxes are grouped (sorted by their
+			 *   Morton code) and each group shares one broadphase traversal.
+			 * filter(ecs::Entity&)->bool decides which entities can be hit.
+			 * They don't modify the world and can be called concurrently (e.g.
+			 *   from worker threads) until the next update().
+			 */
+			/// out[i] is the closest hit of rays[i] (entity is nullptr if there is none)
+			template<class Filter=Accept_all>
+			void raycast_batch(const Ray* rays, std::size_t count, Raycast_result* out,
+			                   Filter filter=Filter{})const {
+				_raycast_batch(rays, count, out, &details::query_filter_trampoline<Filter>, &filter);
+			}
+			/// all entities whose shapes overlap the boxes
+			template<class Filter=Accept_all>
+			void query_batch(const Aabb* boxes, std::size_t count, Aabb_query_result& out,
+			                 Filter filter=Filter{})const {
+				_query_batch(boxes, count, out, &details::query_filter_trampoline<Filter>, &filter);
+			}
+
 		private:
 			struct Contact_listener;
 
@@ -71,11 +189,56 @@ namespace physics {
 			std::unique_ptr<b2World> _world;
 			float _dt_acc = 0.f;
 
-			void _get_positions();
-			void _reset_smooth_state();
+			/*
+			 * Packed state of the dynamic bodies, indexed by their position in
+			 *   _bodies_dynamic (their slot). Only the slots in awake are
+			 *   stepped, interpolated and written back to their transforms.
+			 * The other (sleeping) slots are only visited again if their
+			 *   entity appears in _changes or a body has been created or freed.
+			 */
+			struct Body_states {
+				std::vector<b2Body*> bodies;
+				std::vector<Transform_comp*> transforms; //< only valid during update(), for awake slots
+				std::vector<glm::vec2> last_positions;   //< before the last step
+				std::vector<uint8_t> flags;
+
+				std::vector<uint32_t> awake;         //< slots that have been awake during the last update()
+				std::vector<uint32_t> keep_position; //< slots with a keep_position_force
+			};
+			Body_states _states;
+
+			std::shared_ptr<std::vector<ecs::Entity*>> _changes; //< see details::Change_log_ref
+			util::slot<ecs::Component_event> _body_events;
+			bool _bodies_changed = true; //< the pools have been modified, all slots have to be synced
+			bool _check_all_bodies = false; //< a static body has been moved, that might have woken others
+
+			std::vector<Dynamic_body_comp*> _ground_bodies;
+			std::vector<Ray> _ground_rays;
+			std::vector<Raycast_result> _ground_hits;
+
+			void _sync_bodies();
+			void _sync_all_bodies();
+			void _sync_changed_bodies();
+			void _sync_body(uint32_t slot);
+			void _sync_body(Static_body_comp&);
+			void _track(uint32_t slot, Transform_comp* transform=nullptr);
+			void _on_body_event(ecs::Component_event);
+			void _begin_step();
+			void _track_woken_bodies();
 			void _smooth_positions(float alpha);
+
+			void _raycast_batch(const Ray*, std::size_t count, Raycast_result* out,
+			                    details::Query_filter, void* filter)const;
+			void _query_batch(const Aabb*, std::size_t count, Aabb_query_result& out,
+			                  details::Query_filter, void* filter)const;
 	};
 
 }
 }
+
+namespace util {
+	// large and received by multiple systems
+	template<>
+	struct is_arena_message<sys::physics::Contact_batch> : std::true_type {};
+}
 }
@@ -41,6 +41,7 @@ namespace physics {
 	void Transform_comp::position(Position pos)noexcept {
 		_position=pos;
 		_revision++;
+		_changes.add(owner());
 	}
 	void Transform_comp::rotation(Angle a)noexcept {
 		if(!_rotation_fixed) {
@@ -51,12 +52,14 @@ namespace physics {
 		if(_flip_horizontal!=f) {
 			_flip_horizontal = f;
 			_revision++;
+			_changes.add(owner());
 		}
 	}
 	void Transform_comp::flip_vertical(bool f)noexcept {
 		if(_flip_vertical!=f) {
 			_flip_vertical = f;
 			_revision++;
+			_changes.add(owner());
 		}
 	}
 
@@ -10,12 +10,37 @@
 #include <core/ecs/ecs.hpp>
 #include <core/units.hpp>
 
+#include <memory>
+#include <vector>
+
 
 namespace lux {
 namespace sys {
 namespace physics {
 
 	class Transform_system;
+	class Physics_system;
+
+	namespace details {
+		/*
+		 * Entities whose transform or body has been modified outside of the
+		 *   Physics_system since its last update, so it doesn't have to check
+		 *   all sleeping bodies for changes.
+		 * Components are only logged (once per update) after the
+		 *   Physics_system has started to watch them.
+		 */
+		struct Change_log_ref {
+			std::shared_ptr<std::vector<ecs::Entity*>> log;
+			bool logged = false;
+
+			void add(ecs::Entity& e) {
+				if(log && !logged) {
+					logged = true;
+					log->push_back(&e);
+				}
+			}
+		};
+	}
 
 	class Transform_comp : public ecs::Component<Transform_comp> {
 		public:
@@ -52,6 +77,8 @@ namespace physics {
 			friend struct Persisted_state;
 
 		private:
+			friend class Physics_system;
+
 			Position _position;
 			float _scale = 1.f;
 			Angle _rotation;
@@ -59,6 +86,13 @@ namespace physics {
 			bool _flip_horizontal = false;
 			bool _flip_vertical = false;
 			uint_fast32_t _revision = 1;
+			details::Change_log_ref _changes;
+
+			/// the simulated position, that isn't logged as an external change
+			void _simulated_position(Position pos)noexcept {
+				_position = pos;
+				_revision++;
+			}
 	};
 
 }
@@ -15,7 +15,9 @@
 #include "game/game_engine.hpp"
 
 #include "game/editor_screen.hpp"
+#include "game/game_screen.hpp"
 #include "game/main_menu_screen.hpp"
+#include "game/replay_screen.hpp"
 #include "game/world_map_screen.hpp"
 
 #include "info.hpp"
@@ -117,6 +119,10 @@ namespace {
 				engine->screens().enter<World_map_screen>("jungle");
 			else if(argc>2 && argv[1]=="editor"s)
 				engine->screens().enter<Editor_screen>(argv[2]);
+			else if(argc>3 && argv[1]=="record"s)
+				engine->screens().enter<Game_screen>(argv[2], false, argv[3]);
+			else if(argc>2 && argv[1]=="replay"s)
+				engine->screens().enter<Replay_screen>(argv[2], argc>3 && argv[3]=="draw"s);
 			else
 				engine->screens().enter<Main_menu_screen>(); // TODO: intro screen ?
 
@@ -0,0 +1,47 @@
+/** timing helper for the benchmark executables ******************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <string>
+
+
+namespace lux {
+namespace test {
+
+	/// calls f() iterations times and prints the average and the fastest run in ms
+	template<class F>
+	void benchmark(const std::string& name, int iterations, F&& f) {
+		using namespace std::chrono;
+
+		auto sum = 0.0;
+		auto min = 0.0;
+
+		for(auto i=0; i<iterations; i++) {
+			auto start = steady_clock::now();
+			f();
+			auto time = duration<double, std::milli>(steady_clock::now() - start).count();
+
+			sum += time;
+			min = i==0 ? time : std::min(min, time);
+		}
+
+		std::cout<<name<<": avg "<<(sum/iterations)<<" ms, min "<<min<<" ms ("
+		         <<iterations<<" runs)"<<std::endl;
+	}
+
+	/// prevents the optimizer from removing computations whose result is unused
+	template<class T>
+	void do_not_optimize(const T& v) {
+		asm volatile("" : : "g"(&v) : "memory");
+	}
+
+}
+}
@@ -0,0 +1,135 @@
+#include "benchmark.hpp"
+
+#include <core/utils/radix_sort.hpp>
+
+#ifdef HEADLESS
+#include <core/renderer/command_queue.hpp>
+#include <core/renderer/primitives.hpp>
+#include <core/renderer/texture.hpp>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+using namespace lux;
+
+namespace {
+	/// same layout as Command_queue::Sort_key
+	struct Sort_key {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	/*
+	 * Keys with the same distribution of states as a typical frame:
+	 *   few gl_options and shaders, more texture sets and objects and
+	 *   about 5% order dependent commands (particles, HUD).
+	 */
+	auto generate_keys(std::size_t count, std::mt19937& rand) -> std::vector<Sort_key> {
+		auto gl_options   = std::uniform_int_distribution<uint64_t>{0, 7};
+		auto shader       = std::uniform_int_distribution<uint64_t>{0, 15};
+		auto texture_set  = std::uniform_int_distribution<uint64_t>{0, count/8};
+		auto ext_uniforms = std::uniform_int_distribution<uint64_t>{0, 31};
+		auto order_dep    = std::uniform_int_distribution<int>{0, 19};
+
+		auto keys = std::vector<Sort_key>();
+		keys.reserve(count);
+		auto order_dependent_count = uint64_t(0);
+		for(auto i=0u; i<count; ++i) {
+			auto key = uint64_t(0);
+			if(order_dep(rand)==0) {
+				key = (uint64_t(1)<<63) | order_dependent_count++;
+			} else {
+				key = gl_options(rand);
+				key = (key << 9)  | shader(rand);
+				key = (key << 16) | texture_set(rand);
+				key = (key << 11) | ext_uniforms(rand);
+				key = (key << 24) | i;
+			}
+			keys.push_back(Sort_key{key, i});
+		}
+		return keys;
+	}
+
+	void bench_sort(std::size_t count, int iterations) {
+		auto rand = std::mt19937{42};
+		auto keys = generate_keys(count, rand);
+		auto data = std::vector<Sort_key>();
+		auto tmp = std::vector<Sort_key>();
+		auto n = std::to_string(count);
+
+		test::benchmark("radix_sort, "+n+" keys", iterations, [&] {
+			data = keys;
+			util::radix_sort(data, tmp, [](const Sort_key& k){return k.key;});
+			test::do_not_optimize(data);
+		});
+		test::benchmark("std::sort, "+n+" keys", iterations, [&] {
+			data = keys;
+			std::sort(data.begin(), data.end(), [](auto& a, auto& b){return a.key<b.key;});
+			test::do_not_optimize(data);
+		});
+		test::benchmark("std::stable_sort, "+n+" keys", iterations, [&] {
+			data = keys;
+			std::stable_sort(data.begin(), data.end(), [](auto& a, auto& b){return a.key<b.key;});
+			test::do_not_optimize(data);
+		});
+		test::benchmark("copy only, "+n+" keys", iterations, [&] {
+			data = keys;
+			test::do_not_optimize(data);
+		});
+	}
+
+#ifdef HEADLESS
+	/// push_back() and flush() of a whole frame against the null OpenGL implementation
+	void bench_flush(std::size_t count, int iterations) {
+		using namespace renderer;
+
+		auto rand = std::mt19937{42};
+		auto pick = std::uniform_int_distribution<std::size_t>{};
+
+		auto shaders = std::vector<Shader_program>(16);
+		auto textures = std::vector<std::unique_ptr<Texture>>();
+		auto pixel = std::array<uint8_t, 4>{{255, 255, 255, 255}};
+		for(auto i=0; i<64; i++)
+			textures.emplace_back(std::make_unique<Texture>(1, 1, pixel.data(), RGBA));
+		auto objects = std::vector<Object>();
+		for(auto i=0; i<256; i++)
+			objects.emplace_back(simple_vertex_layout, create_dynamic_buffer<Simple_vertex>(4));
+
+		auto commands = std::vector<Command>();
+		for(auto i=0u; i<count; i++) {
+			auto cmd = create_command()
+			        .shader(shaders[pick(rand)%shaders.size()])
+			        .texture(Texture_unit::color, *textures[pick(rand)%textures.size()])
+			        .object(objects[pick(rand)%objects.size()]);
+			cmd.uniforms().emplace("model", float(i));
+			if(pick(rand)%20==0)
+				cmd.order_dependent();
+			commands.push_back(cmd);
+		}
+
+		Command_queue queue(count);
+		test::benchmark("push_back+flush, "+std::to_string(count)+" commands", iterations, [&] {
+			for(auto& cmd : commands)
+				queue.push_back(cmd);
+			queue.flush();
+		});
+	}
+#endif
+}
+
+int main() {
+	bench_sort(256, 2000);
+	bench_sort(1000, 1000);
+	bench_sort(4000, 500);
+	bench_sort(10000, 200);
+	bench_sort(100000, 20);
+
+#ifdef HEADLESS
+	bench_flush(1000, 200);
+	bench_flush(10000, 20);
+#endif
+}
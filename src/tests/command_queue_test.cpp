@@ -0,0 +1,120 @@
+#include "test.hpp"
+
+#include <core/renderer/command_queue.hpp>
+#include <core/renderer/null_gl.hpp>
+#include <core/renderer/primitives.hpp>
+#include <core/utils/thread_pool.hpp>
+
+#include <random>
+#include <vector>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	constexpr auto command_count = 2000;
+
+	/*
+	 * Every command draws one vertex of the same object at its own offset, so
+	 *   the offsets logged by the null OpenGL implementation are the order in
+	 *   which the queue executed the commands.
+	 */
+	struct Fixture {
+		std::vector<Shader_program> shaders = std::vector<Shader_program>(4);
+		Object object{simple_vertex_layout, create_buffer(
+		                  std::vector<Simple_vertex>(command_count, Simple_vertex{{0,0}, {0,0}}))};
+		std::vector<Command> commands;
+
+		Fixture() {
+			auto rand = std::mt19937{42};
+			auto pick = std::uniform_int_distribution<int>{0, 99};
+
+			for(auto i=0; i<command_count; i++) {
+				auto cmd = create_command()
+				        .shader(shaders[pick(rand)%shaders.size()])
+				        .object(object, i, 1);
+				if(pick(rand)<30)
+					cmd.require(Gl_option::blend);
+				if(pick(rand)<10)
+					cmd.order_dependent();
+				commands.push_back(cmd);
+			}
+		}
+
+		auto draw_order(Command_queue& queue) -> std::vector<int> {
+			reset_null_gl_stats();
+			queue.flush();
+			return null_gl_stats().draw_offsets;
+		}
+
+		/// the reference: all commands recorded by a single thread into a single buffer
+		auto serial_order() -> std::vector<int> {
+			Command_queue queue;
+			for(auto& cmd : commands)
+				queue.push_back(cmd);
+			return draw_order(queue);
+		}
+	};
+}
+
+TEST_CASE(parallel_recording_matches_single_threaded_order) {
+	Fixture f;
+	auto expected = f.serial_order();
+	CHECK_EQ(expected.size(), std::size_t(command_count));
+
+	util::Thread_pool threads(4);
+	Command_queue queue;
+	queue.reserve_buffers(threads.size());
+
+	threads.parallel_for(f.commands.size(), 16, [&](auto begin, auto end, auto batch) {
+		auto& buffer = queue.buffer(batch);
+		for(auto i=begin; i<end; ++i)
+			buffer.push_back(f.commands[i]);
+	});
+
+	CHECK(f.draw_order(queue)==expected);
+}
+
+TEST_CASE(buffers_are_ordered_by_index) {
+	Fixture f;
+	auto expected = f.serial_order();
+
+	// filled in reverse, executed as if recorded from buffer 0 to buffer 3
+	Command_queue queue;
+	queue.reserve_buffers(4);
+	auto per_buffer = f.commands.size()/4;
+	for(auto b=4; b-->0;) {
+		for(auto i=b*per_buffer; i<(b+1)*per_buffer; ++i) {
+			if(b==0)
+				queue.push_back(f.commands[i]);
+			else
+				queue.buffer(b).push_back(f.commands[i]);
+		}
+	}
+	CHECK_EQ(queue.buffer(1).size(), per_buffer);
+
+	CHECK(f.draw_order(queue)==expected);
+}
+
+TEST_CASE(flush_clears_all_buffers) {
+	Fixture f;
+	auto expected = f.serial_order();
+
+	Command_queue queue;
+	queue.reserve_buffers(2);
+	for(auto frame=0; frame<3; frame++) {
+		for(auto i=0u; i<f.commands.size(); ++i)
+			queue.buffer(i*2/f.commands.size()).push_back(f.commands[i]);
+
+		CHECK(f.draw_order(queue)==expected);
+		CHECK_EQ(queue.buffer(0).size(), 0u);
+		CHECK_EQ(queue.buffer(1).size(), 0u);
+	}
+}
+
+TEST_CASE(unreserved_buffers_are_rejected) {
+	Command_queue queue;
+	CHECK_EQ(queue.buffers(), 1u);
+	CHECK_THROWS(queue.buffer(1), util::Error);
+}
@@ -0,0 +1,41 @@
+/** entity manager for tests of single systems *******************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <core/asset/asset_manager.hpp>
+#include <core/ecs/ecs.hpp>
+
+#include <sf2/sf2.hpp>
+
+#include <sstream>
+
+
+namespace lux {
+namespace test {
+
+	/*
+	 * An Entity_manager without an Engine (no window, no GL). The components
+	 *   that are required by a test have to be registered by it.
+	 */
+	struct Ecs_fixture {
+		asset::Asset_manager assets;
+		ecs::Entity_manager ecs;
+
+		Ecs_fixture(const std::string& name) : assets(name, name), ecs(assets) {}
+
+		/// loads the properties of a component from a JSON object, like a blueprint would
+		template<class T>
+		void load(T& comp, const std::string& json) {
+			auto in = std::istringstream{json};
+			auto deserializer = sf2::JsonDeserializer{sf2::format::Json_reader{in}};
+			comp.load(deserializer, assets);
+		}
+	};
+
+}
+}
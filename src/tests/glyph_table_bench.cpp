@@ -0,0 +1,85 @@
+#include "benchmark.hpp"
+
+#include <core/renderer/glyph_table.hpp>
+
+#include <random>
+#include <unordered_map>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	/// the previous implementation: one hash map for the glyphs and one per glyph for its kerning
+	struct Hashed_glyph {
+		int advance = 0;
+		std::unordered_map<Text_char, int> kerning;
+	};
+
+	constexpr auto text_length = 10000;
+}
+
+int main() {
+	// Latin-1, Cyrillic, some CJK and emoji, with kerning for the ASCII letters
+	auto chars = std::vector<Text_char>();
+	for(auto c=Text_char(32); c<256; c++)
+		chars.push_back(c);
+	for(auto c=Text_char(0x400); c<0x500; c++)
+		chars.push_back(c);
+	for(auto c=Text_char(0x4E00); c<0x5E00; c++)
+		chars.push_back(c);
+	for(auto c=Text_char(0x1F600); c<0x1F650; c++)
+		chars.push_back(c);
+
+	auto rand = std::mt19937{42};
+	auto letter = std::uniform_int_distribution<Text_char>{'A', 'z'};
+
+	auto table = Glyph_table{};
+	auto hashed = std::unordered_map<Text_char, Hashed_glyph>();
+	table.reserve(chars.size());
+	for(auto c : chars) {
+		table.add(c).advance = static_cast<int>(c%13);
+		hashed[c].advance = static_cast<int>(c%13);
+	}
+	for(auto i=0; i<2000; i++) {
+		auto c = letter(rand);
+		auto prev = letter(rand);
+		table.add_kerning(c, prev, -1);
+		hashed[c].kerning[prev] = -1;
+	}
+	table.finish();
+
+	// mostly ASCII, like the UI and level texts
+	auto text = std::vector<Text_char>();
+	auto any = std::uniform_int_distribution<std::size_t>{0, chars.size()-1};
+	for(auto i=0; i<text_length; i++)
+		text.push_back(i%10==0 ? chars[any(rand)] : letter(rand));
+
+	test::benchmark("glyph_table, 10k chars", 1000, [&] {
+		auto x = 0;
+		auto prev = Text_char(0);
+		for(auto c : text) {
+			auto& g = table.find(c);
+			x += g.advance + table.kerning(g, prev);
+			prev = c;
+		}
+		test::do_not_optimize(x);
+	});
+
+	test::benchmark("hashed, 10k chars", 1000, [&] {
+		auto x = 0;
+		auto prev = Text_char(0);
+		for(auto c : text) {
+			auto g = hashed.find(c);
+			if(g==hashed.end())
+				g = hashed.begin();
+
+			x += g->second.advance;
+			auto k = g->second.kerning.find(prev);
+			if(k!=g->second.kerning.end())
+				x += k->second;
+			prev = c;
+		}
+		test::do_not_optimize(x);
+	});
+}
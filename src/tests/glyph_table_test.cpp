@@ -0,0 +1,82 @@
+#include "test.hpp"
+
+#include <core/renderer/glyph_table.hpp>
+
+
+using namespace lux::renderer;
+
+TEST_CASE(find_bmp_and_sparse_glyphs) {
+	auto t = Glyph_table{};
+	t.add('A').advance = 5;
+	t.add(0x4E00).advance = 3;
+	t.add(0x1F600).advance = 7;
+	t.finish();
+
+	CHECK_EQ(t.size(), 3u);
+	CHECK_EQ(t.find('A').advance, 5);
+	CHECK_EQ(t.find(0x4E00).advance, 3);
+	CHECK_EQ(t.find(0x1F600).advance, 7);
+	CHECK(t.contains(0x1F600));
+	CHECK(!t.contains('B'));
+	CHECK(!t.contains(0x1F601));
+}
+
+TEST_CASE(missing_glyphs_fall_back_to_the_first) {
+	auto t = Glyph_table{};
+	t.add('?').advance = 4;
+	t.add('A').advance = 5;
+	t.finish();
+
+	CHECK_EQ(t.find('Z').advance, 4);
+	CHECK_EQ(t.find(0x10FFFF).advance, 4);
+}
+
+TEST_CASE(kerning_pairs) {
+	auto t = Glyph_table{};
+	t.add('A').advance = 5;
+	t.add_kerning('A', 'V', -2);
+	t.add_kerning('A', 'T', -1);
+	t.add_kerning('A', 'V', -3); // the last definition wins
+	t.add_kerning(0x1F600, 'A', 4);
+	t.finish();
+
+	CHECK_EQ(t.kerning(t.find('A'), 'V'), -3);
+	CHECK_EQ(t.kerning(t.find('A'), 'T'), -1);
+	CHECK_EQ(t.kerning(t.find('A'), 'X'), 0);
+	CHECK_EQ(t.kerning(t.find(0x1F600), 'A'), 4);
+	CHECK_EQ(t.kerning(t.find(0x1F600), 'V'), 0);
+}
+
+TEST_CASE(monospace_advance_is_between_mean_and_max) {
+	auto t = Glyph_table{};
+	t.add('i').advance = 2;
+	t.add('m').advance = 10;
+	t.add('n').advance = 6;
+	t.finish();
+
+	// max*0.5 + mean*0.5
+	CHECK_NEAR(t.monospace_advance(), 8.f, 0.001f);
+}
+
+TEST_CASE(many_kerning_pairs) {
+	auto t = Glyph_table{};
+	for(auto c=Text_char('A'); c<='z'; c++) {
+		t.add(c).advance = 1;
+		for(auto prev=Text_char('A'); prev<='z'; prev+=3) {
+			t.add_kerning(c, prev, int(c*prev % 7) - 3);
+		}
+	}
+	t.finish();
+	// also valid after more glyphs have been added
+	t.add(0x400);
+	t.finish();
+
+	for(auto c=Text_char('A'); c<='z'; c++) {
+		auto& g = t.find(c);
+		for(auto prev=Text_char('A'); prev<='z'; prev++) {
+			auto expected = (prev-'A')%3==0 ? int(c*prev % 7) - 3 : 0;
+			CHECK_EQ(t.kerning(g, prev), expected);
+		}
+		CHECK_EQ(t.kerning(g, 0x400), 0);
+	}
+}
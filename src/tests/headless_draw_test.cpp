@@ -0,0 +1,56 @@
+#include "test.hpp"
+
+#include <game/game_engine.hpp>
+#include <game/meta_system.hpp>
+#include <game/sys/physics/transform_comp.hpp>
+
+#include <core/renderer/null_gl.hpp>
+#include <core/utils/stacktrace.hpp>
+
+
+using namespace lux;
+using namespace lux::unit_literals;
+
+namespace {
+	char app_name[] = "headless_draw_test";
+	char* argv[] = {app_name, nullptr};
+	char* env[] = {nullptr};
+
+	auto create_engine() -> std::unique_ptr<Game_engine> {
+		util::init_stacktrace(argv[0]);
+		return std::make_unique<Game_engine>(app_name, 1, argv, env);
+	}
+}
+
+TEST_CASE(meta_system_draw_headless) {
+	auto engine = create_engine();
+
+	Meta_system systems(*engine);
+	systems.load_level("headless_draw_test", true);
+
+	for(auto i=0; i<4; i++) {
+		auto sprite = systems.entity_manager.emplace("blueprint:test"_aid);
+		sprite->get<sys::physics::Transform_comp>().get_or_throw().position(Position{float(i)*1_m, 0_m, 0_m});
+
+		auto light = systems.entity_manager.emplace("blueprint:test_light"_aid);
+		light->get<sys::physics::Transform_comp>().get_or_throw().position(Position{float(i)*1_m, 1_m, 0_m});
+	}
+
+	systems.update(Time{1/60.f}, update_all);
+
+	renderer::reset_null_gl_stats();
+	systems.draw();
+
+	auto& stats = renderer::null_gl_stats();
+	CHECK(stats.draw_calls>0);
+	CHECK(stats.state_changes>0);
+	CHECK(stats.bytes_uploaded>0);
+
+	// unchanged shadow maps are cached, so later frames can't issue more draw calls
+	auto first_frame_draws = stats.draw_calls;
+	renderer::reset_null_gl_stats();
+	systems.update(Time{1/60.f}, update_all);
+	systems.draw();
+	CHECK(renderer::null_gl_stats().draw_calls>0);
+	CHECK(renderer::null_gl_stats().draw_calls<=first_frame_draws);
+}
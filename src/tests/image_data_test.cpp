@@ -0,0 +1,121 @@
+#include "test.hpp"
+
+#include <core/renderer/image_data.hpp>
+
+#include <soil/stb_image_write.h>
+
+#include <cstring>
+
+
+using namespace lux::renderer;
+
+namespace {
+	auto png(int width, int height) -> std::vector<uint8_t> {
+		auto pixels = std::vector<uint8_t>(std::size_t(width*height*4));
+		for(auto i=std::size_t(0); i<pixels.size(); i++)
+			pixels[i] = static_cast<uint8_t>(i);
+
+		auto file = std::vector<uint8_t>();
+		stbi_write_png_to_func([](void* ctx, void* data, int size) {
+			auto bytes = static_cast<uint8_t*>(data);
+			static_cast<std::vector<uint8_t>*>(ctx)->insert(static_cast<std::vector<uint8_t>*>(ctx)->end(),
+			                                                bytes, bytes+size);
+		}, &file, width, height, 4, pixels.data(), width*4);
+		return file;
+	}
+
+	void write_u32(std::vector<uint8_t>& file, std::size_t offset, uint32_t v) {
+		for(auto i=0; i<4; i++)
+			file[offset+std::size_t(i)] = static_cast<uint8_t>(v >> (i*8));
+	}
+
+	/// DXT5 file with 'levels' mip levels and 'missing' bytes cut off at the end
+	auto dds(int width, int height, uint32_t levels, std::size_t missing=0) -> std::vector<uint8_t> {
+		auto file = std::vector<uint8_t>(128, 0);
+		std::memcpy(file.data(), "DDS ", 4);
+		write_u32(file, 4, 124);
+		write_u32(file, 12, uint32_t(height));
+		write_u32(file, 16, uint32_t(width));
+		write_u32(file, 28, levels);
+		std::memcpy(file.data()+84, "DXT5", 4);
+
+		for(auto i=0u; i<levels; i++) {
+			auto blocks = std::size_t(std::max(1, (width+3)/4)) * std::size_t(std::max(1, (height+3)/4));
+			file.resize(file.size() + blocks*16, static_cast<uint8_t>(i));
+			width = std::max(1, width/2);
+			height = std::max(1, height/2);
+		}
+		file.resize(file.size()-missing);
+		return file;
+	}
+}
+
+TEST_CASE(decode_png_to_rgba) {
+	auto file = png(3, 2);
+
+	auto width = 0;
+	auto height = 0;
+	CHECK(image_info(file, width, height));
+	CHECK_EQ(width, 3);
+	CHECK_EQ(height, 2);
+
+	auto image = Image_data{};
+	auto error = std::string();
+	CHECK(decode_image(file, image, error));
+	CHECK_EQ(image.width, 3);
+	CHECK_EQ(image.height, 2);
+	CHECK_EQ(image.compressed_format, 0u);
+	CHECK_EQ(image.levels.size(), 1u);
+	CHECK_EQ(image.bytes(), 3u*2u*4u);
+	CHECK_EQ(int(image.data[5]), 5);
+	CHECK_EQ(int(image.data[23]), 23);
+}
+
+TEST_CASE(decode_corrupt_png) {
+	auto file = png(64, 64);
+	file.resize(file.size()/2);
+
+	// the header is still intact
+	auto width = 0;
+	auto height = 0;
+	CHECK(image_info(file, width, height));
+
+	auto image = Image_data{};
+	auto error = std::string();
+	CHECK(!decode_image(file, image, error));
+	CHECK(!error.empty());
+}
+
+TEST_CASE(unknown_formats_are_left_to_soil) {
+	auto file = std::vector<uint8_t>(256, 42);
+	auto width = 0;
+	auto height = 0;
+	CHECK(!image_info(file, width, height));
+}
+
+TEST_CASE(decode_dds_keeps_the_mip_levels) {
+	auto file = dds(8, 8, 4);
+
+	auto image = Image_data{};
+	auto error = std::string();
+	CHECK(decode_image(file, image, error));
+	CHECK_EQ(image.width, 8);
+	CHECK_EQ(image.height, 8);
+	CHECK_EQ(image.compressed_format, 0x83F3u);
+	CHECK_EQ(image.levels.size(), 4u);
+	CHECK_EQ(image.levels[0].size, 4u*16u);
+	CHECK_EQ(image.levels[1].size, 16u);
+	CHECK_EQ(image.levels[3].width, 1);
+	CHECK_EQ(image.levels[3].offset, 4u*16u + 2u*16u);
+	CHECK_EQ(image.bytes(), file.size()-128);
+	CHECK_EQ(int(image.data[image.levels[2].offset]), 2);
+}
+
+TEST_CASE(decode_truncated_dds) {
+	auto file = dds(8, 8, 4, 1);
+
+	auto image = Image_data{};
+	auto error = std::string();
+	CHECK(!decode_image(file, image, error));
+	CHECK(!error.empty());
+}
@@ -0,0 +1,115 @@
+#include "benchmark.hpp"
+#include "ecs_fixture.hpp"
+
+#include <game/sys/light/light_index.hpp>
+#include <game/sys/physics/transform_comp.hpp>
+
+#include <glm/gtx/norm.hpp>
+
+#include <array>
+#include <random>
+#include <algorithm>
+
+
+using namespace lux;
+using namespace lux::unit_literals;
+using lux::sys::light::Light_comp;
+using lux::sys::light::Light_index;
+using lux::sys::light::Light_info;
+using lux::sys::physics::Transform_comp;
+
+namespace {
+	constexpr auto light_count = 5000;
+	constexpr auto world_size = 1000.f;
+	constexpr auto moving_lights = light_count / 20;
+	constexpr auto selected_lights = 32;
+
+	/// the previous implementation: scores every light and sorts the whole list
+	void select_brute_force(Light_comp::Pool& lights, glm::vec4 area, glm::vec2 center,
+	                        std::vector<Light_info>& tmp, std::array<Light_info, selected_lights>& out) {
+		tmp.clear();
+		for(auto& light : lights) {
+			auto& trans = light.owner().get<Transform_comp>().get_or_throw();
+			auto pos = remove_units(trans.position()) + trans.resolve_relative(light.offset());
+			auto radius = light.radius().value();
+			if(pos.x+radius < area.x || pos.x-radius > area.z ||
+			   pos.y+radius < area.y || pos.y-radius > area.w)
+				continue;
+
+			auto score = glm::length2(light.color()) / (1.f + glm::distance2(glm::vec2(pos.x, pos.y), center)
+			                                                  / (radius*radius));
+			auto info = Light_info{};
+			info.light = &light;
+			info.transform = &trans;
+			info.score = score;
+			tmp.push_back(info);
+		}
+
+		std::sort(tmp.begin(), tmp.end());
+		for(auto i=0u; i<out.size(); ++i)
+			out[i] = i<tmp.size() ? tmp[i] : Light_info{};
+	}
+}
+
+int main() {
+	test::Ecs_fixture f{"light_index_bench"};
+	f.ecs.register_component_type<Transform_comp>();
+	f.ecs.register_component_type<Light_comp>();
+
+	auto rand = std::mt19937{42};
+	auto coord = std::uniform_real_distribution<float>{0.f, world_size};
+	auto radius = std::uniform_int_distribution<int>{2, 20};
+
+	auto entities = std::vector<ecs::Entity_ptr>();
+	entities.reserve(light_count);
+	for(auto i=0; i<light_count; i++) {
+		auto e = f.ecs.emplace();
+		e->emplace<Transform_comp>().position(Position{coord(rand)*1_m, coord(rand)*1_m, 0_m});
+		f.load(e->emplace<Light_comp>(), "{\"radius\": "+std::to_string(radius(rand))+"}");
+		entities.push_back(e);
+	}
+	f.ecs.process_queued_actions();
+
+	auto& lights = f.ecs.list<Light_comp>();
+	auto index = Light_index(lights);
+	index.update();
+
+	auto out = std::array<Light_info, selected_lights>{};
+	auto tmp = std::vector<Light_info>();
+	auto center = glm::vec2{world_size/2.f, world_size/2.f};
+	auto view = glm::vec4{center.x-20, center.y-12, center.x+20, center.y+12};
+	auto zoomed_out = glm::vec4{0, 0, world_size, world_size};
+
+	auto move_some = [&] {
+		for(auto i=0; i<moving_lights; i++) {
+			auto& e = entities[static_cast<std::size_t>(rand()) % entities.size()];
+			e->get<Transform_comp>().get_or_throw().position(Position{coord(rand)*1_m, coord(rand)*1_m, 0_m});
+		}
+	};
+
+	test::benchmark("update, nothing moved", 1000, [&] {
+		index.update();
+	});
+	test::benchmark("update, 5% moved", 200, [&] {
+		move_some();
+		index.update();
+	});
+
+	test::benchmark("select, 40x24m view", 1000, [&] {
+		index.select(view, center, out);
+		test::do_not_optimize(out);
+	});
+	test::benchmark("select, whole world", 100, [&] {
+		index.select(zoomed_out, center, out);
+		test::do_not_optimize(out);
+	});
+
+	test::benchmark("brute force, 40x24m view", 100, [&] {
+		select_brute_force(lights, view, center, tmp, out);
+		test::do_not_optimize(out);
+	});
+	test::benchmark("brute force, whole world", 100, [&] {
+		select_brute_force(lights, zoomed_out, center, tmp, out);
+		test::do_not_optimize(out);
+	});
+}
@@ -0,0 +1,122 @@
+#include "test.hpp"
+#include "ecs_fixture.hpp"
+
+#include <game/sys/light/light_index.hpp>
+#include <game/sys/physics/transform_comp.hpp>
+
+#include <array>
+
+
+using namespace lux;
+using namespace lux::unit_literals;
+using lux::sys::light::Light_comp;
+using lux::sys::light::Light_index;
+using lux::sys::light::Light_info;
+using lux::sys::physics::Transform_comp;
+
+namespace {
+	struct Fixture : test::Ecs_fixture {
+		Fixture() : Ecs_fixture("light_index_test") {
+			ecs.register_component_type<Transform_comp>();
+			ecs.register_component_type<Light_comp>();
+		}
+
+		auto add_light(glm::vec2 pos, const std::string& json) -> ecs::Entity_ptr {
+			auto e = ecs.emplace();
+			e->emplace<Transform_comp>().position(Position{pos.x*1_m, pos.y*1_m, 0_m});
+			load(e->emplace<Light_comp>(), json);
+			return e;
+		}
+	};
+}
+
+TEST_CASE(select_orders_by_score) {
+	Fixture f;
+	auto near = f.add_light({1,0}, R"({"radius": 4})");
+	auto far  = f.add_light({3,0}, R"({"radius": 4})");
+	f.ecs.process_queued_actions();
+
+	auto index = Light_index(f.ecs.list<Light_comp>());
+	index.update();
+
+	auto out = std::array<Light_info, 4>{};
+	index.select({-5,-5,5,5}, {0,0}, out);
+
+	CHECK(out[0].light==&near->get<Light_comp>().get_or_throw());
+	CHECK(out[1].light==&far->get<Light_comp>().get_or_throw());
+	CHECK(out[0].score>out[1].score);
+	CHECK(out[2].light==nullptr);
+	CHECK(out[3].light==nullptr);
+}
+
+TEST_CASE(select_skips_lights_out_of_reach) {
+	Fixture f;
+	f.add_light({100,0}, R"({"radius": 4})");
+	f.ecs.process_queued_actions();
+
+	auto index = Light_index(f.ecs.list<Light_comp>());
+	index.update();
+
+	auto out = std::array<Light_info, 1>{};
+	index.select({-5,-5,5,5}, {0,0}, out);
+	CHECK(out[0].light==nullptr);
+}
+
+TEST_CASE(select_includes_the_light_offset) {
+	Fixture f;
+	// the entity is far outside of the view, but the light itself is in its center
+	auto e = f.add_light({-40,0}, R"({"radius": 2, "offset": {"x": 40, "y": 0, "z": 0}})");
+	f.ecs.process_queued_actions();
+
+	auto index = Light_index(f.ecs.list<Light_comp>());
+	index.update();
+
+	auto out = std::array<Light_info, 1>{};
+	index.select({-5,-5,5,5}, {0,0}, out);
+	CHECK(out[0].light==&e->get<Light_comp>().get_or_throw());
+
+	// ... and is not selected at the position of its entity
+	index.select({-45,-5,-35,5}, {-40,0}, out);
+	CHECK(out[0].light==nullptr);
+}
+
+TEST_CASE(update_follows_moved_lights) {
+	Fixture f;
+	auto e = f.add_light({100,0}, R"({"radius": 4})");
+	f.ecs.process_queued_actions();
+
+	auto index = Light_index(f.ecs.list<Light_comp>());
+	index.update();
+
+	auto out = std::array<Light_info, 1>{};
+	index.select({-5,-5,5,5}, {0,0}, out);
+	CHECK(out[0].light==nullptr);
+
+	e->get<Transform_comp>().get_or_throw().position(Position{0_m, 0_m, 0_m});
+	index.update();
+	index.select({-5,-5,5,5}, {0,0}, out);
+	CHECK(out[0].light==&e->get<Light_comp>().get_or_throw());
+}
+
+TEST_CASE(update_follows_modified_lights) {
+	Fixture f;
+	auto e = f.add_light({0,0}, R"({"radius": 2, "offset": {"x": 100, "y": 0, "z": 0}})");
+	f.ecs.process_queued_actions();
+
+	auto index = Light_index(f.ecs.list<Light_comp>());
+	index.update();
+
+	auto out = std::array<Light_info, 1>{};
+	index.select({-5,-5,5,5}, {0,0}, out);
+	CHECK(out[0].light==nullptr);
+
+	// only the light changed, its Transform_comp is untouched
+	auto& light = e->get<Light_comp>().get_or_throw();
+	auto revision = light.revision();
+	f.load(light, R"({"offset": {"x": 0, "y": 0, "z": 0}})");
+	CHECK(light.revision()!=revision);
+
+	index.update();
+	index.select({-5,-5,5,5}, {0,0}, out);
+	CHECK(out[0].light==&light);
+}
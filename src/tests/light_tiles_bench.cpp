@@ -0,0 +1,64 @@
+#include "benchmark.hpp"
+
+#include <game/sys/light/light_tiles.hpp>
+
+#include <random>
+
+
+using namespace lux;
+using namespace lux::sys::light;
+
+int main() {
+	// 1920x1080 with 32px tiles and the maximum number of visible lights
+	constexpr auto columns = 60;
+	constexpr auto rows = 34;
+
+	auto rand = std::mt19937{42};
+	auto pos = std::uniform_real_distribution<float>{-0.1f, 1.1f};
+	auto size = std::uniform_real_distribution<float>{0.02f, 0.2f};
+	auto score = std::uniform_real_distribution<float>{0.f, 10.f};
+
+	auto tile_lights = std::vector<Tile_light>(Light_tiles::max_lights);
+	auto packed_lights = std::vector<Packed_light>(Light_tiles::max_lights);
+	for(auto i=0u; i<tile_lights.size(); i++) {
+		auto center = glm::vec2{pos(rand), pos(rand)};
+		auto extent = glm::vec2{size(rand), size(rand)};
+		tile_lights[i].min = center-extent;
+		tile_lights[i].max = center+extent;
+		tile_lights[i].score = score(rand);
+
+		packed_lights[i].pos = glm::vec3(center*100.f, 0.5f);
+		packed_lights[i].color = glm::vec3(1,2,3);
+		packed_lights[i].factors = glm::vec3(0,0,0.2f);
+	}
+
+	auto tiles = Light_tiles(columns, rows);
+	auto data = Light_texture_data{};
+	data.resize(columns, rows);
+
+	test::benchmark("bin 256 lights", 1000, [&] {
+		tiles.bin(tile_lights);
+	});
+	test::benchmark("write light parameters", 1000, [&] {
+		data.write_lights(packed_lights);
+		test::do_not_optimize(data);
+	});
+	test::benchmark("write tile lists", 1000, [&] {
+		data.write_tiles(tiles);
+		test::do_not_optimize(data);
+	});
+
+	// lights evaluated per fragment, compared to the 256 of an untiled loop
+	auto sum = 0;
+	auto max = 0;
+	for(auto y=0; y<rows; y++) {
+		for(auto x=0; x<columns; x++) {
+			auto count = static_cast<int>(tiles.lights(x,y).size());
+			sum += count;
+			max = std::max(max, count);
+		}
+	}
+	std::cout<<"lights per tile: avg "<<(float(sum)/(columns*rows))<<", max "<<max
+	         <<" (of "<<Light_tiles::max_lights<<")"<<std::endl;
+	std::cout<<"texture: "<<data.width()<<"x"<<data.height()<<" RGBA8"<<std::endl;
+}
@@ -0,0 +1,163 @@
+#include "test.hpp"
+
+#include <game/sys/light/light_tiles.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+using namespace lux::sys::light;
+
+namespace {
+	auto light(float x1, float y1, float x2, float y2, float score=1.f) -> Tile_light {
+		auto l = Tile_light{};
+		l.min = {x1, y1};
+		l.max = {x2, y2};
+		l.score = score;
+		return l;
+	}
+
+	// the decoding functions of sprite.frag
+	auto texel(const Light_texture_data& d, int x, int y) -> const uint8_t* {
+		return d.data() + (y*d.width() + x)*4;
+	}
+	auto unpack16(const uint8_t* v) -> float {
+		return (v[0]/255.f)*(65280.f/65535.f) + (v[1]/255.f)*(255.f/65535.f);
+	}
+	auto unpack_log16(const uint8_t* v) -> float {
+		auto u = unpack16(v);
+		return u>0.f ? std::exp2(u*24.f - 12.f) : 0.f;
+	}
+	auto relative_error(float actual, float expected) -> float {
+		return std::abs(actual-expected) / std::max(std::abs(expected), 1e-6f);
+	}
+}
+
+TEST_CASE(bin_covers_all_overlapped_tiles) {
+	auto tiles = Light_tiles(4, 2);
+	Tile_light lights[] = {light(0,0, 1,1), light(0.8f,0.6f, 0.9f,0.9f)};
+	tiles.bin(lights);
+
+	for(auto y=0; y<2; y++) {
+		for(auto x=0; x<4; x++) {
+			auto ids = tiles.lights(x, y);
+			auto expected = x==3 && y==1 ? 2 : 1;
+			CHECK_EQ(ids.size(), expected);
+			CHECK_EQ(int(ids[0]), 0);
+		}
+	}
+	CHECK_EQ(int(tiles.lights(3,1)[1]), 1);
+}
+
+TEST_CASE(bin_skips_offscreen_lights) {
+	auto tiles = Light_tiles(2, 2);
+	Tile_light lights[] = {light(-1,-1, -1,-1), light(1.5f,0, 2,1), light(0.1f,0.1f, 0.2f,0.2f)};
+	tiles.bin(lights);
+
+	CHECK_EQ(tiles.lights(0,0).size(), 1);
+	CHECK_EQ(int(tiles.lights(0,0)[0]), 2);
+	CHECK_EQ(tiles.lights(1,0).size(), 0);
+	CHECK_EQ(tiles.lights(0,1).size(), 0);
+	CHECK_EQ(tiles.lights(1,1).size(), 0);
+}
+
+TEST_CASE(bin_keeps_the_best_lights_of_full_tiles) {
+	auto tiles = Light_tiles(1, 1);
+	auto lights = std::vector<Tile_light>();
+	for(auto i=0; i<Light_tiles::max_lights; i++)
+		lights.push_back(light(0,0, 1,1, float((i*37)%Light_tiles::max_lights)));
+
+	tiles.bin(lights);
+
+	auto ids = tiles.lights(0, 0);
+	CHECK_EQ(ids.size(), Light_tiles::max_lights_per_tile);
+
+	auto min_score = Light_tiles::max_lights - Light_tiles::max_lights_per_tile;
+	for(auto id : ids)
+		CHECK(lights[id].score >= min_score);
+}
+
+TEST_CASE(texture_contains_the_tile_lists) {
+	auto tiles = Light_tiles(80, 45);
+	auto data = Light_texture_data{};
+	data.resize(80, 45);
+	CHECK_EQ(data.width(), 80*Light_texture_data::tile_texels);
+	CHECK_EQ(data.height(), Light_texture_data::light_rows+45);
+
+	auto lights = std::vector<Tile_light>(200, light(-1,-1,-1,-1));
+	lights[199] = light(0,0, 0.01f,0.01f);
+	lights[42]  = light(0,0, 1,1);
+	tiles.bin(lights);
+	data.write_tiles(tiles);
+
+	auto first = texel(data, 0, Light_texture_data::light_rows);
+	CHECK_EQ(int(first[0]), 2);
+	CHECK_EQ(int(first[1]), 42);
+	CHECK_EQ(int(first[2]), 199);
+	CHECK_EQ(int(first[3]), 0);
+
+	auto last = texel(data, 79*Light_texture_data::tile_texels, Light_texture_data::light_rows+44);
+	CHECK_EQ(int(last[0]), 1);
+	CHECK_EQ(int(last[1]), 42);
+}
+
+TEST_CASE(texture_is_at_least_max_lights_wide) {
+	auto data = Light_texture_data{};
+	data.resize(2, 2);
+	CHECK_EQ(data.width(), Light_tiles::max_lights);
+	CHECK_EQ(data.height(), Light_texture_data::light_rows+2);
+}
+
+TEST_CASE(texture_contains_the_light_parameters) {
+	auto data = Light_texture_data{};
+	data.resize(10, 10);
+
+	auto lights = std::vector<Packed_light>(Light_tiles::max_lights);
+	for(auto i=0u; i<lights.size(); i++) {
+		auto& l = lights[i];
+		l.pos = {i*0.5f - 20.f, 100.f - i*0.25f, i%3 * 0.1f};
+		l.dir = i*0.1f - 3.f;
+		l.angle = i*0.01f;
+		l.color = {5.f, 0.f, 0.01f*(i+1)};
+		l.factors = {i%2 ? 1.f : 0.f, 0.f, 0.001f*(i+1)};
+	}
+	data.write_lights(lights);
+
+	for(auto i=0; i<int(lights.size()); i++) {
+		auto& l = lights[i];
+		auto pos = data.pos_origin() + glm::vec3(unpack16(texel(data,i,0)), unpack16(texel(data,i,0)+2),
+		                                         unpack16(texel(data,i,1))) * data.pos_extent();
+		CHECK_NEAR(pos.x, l.pos.x, 0.01f);
+		CHECK_NEAR(pos.y, l.pos.y, 0.01f);
+		CHECK_NEAR(pos.z, l.pos.z, 0.01f);
+
+		auto dir = unpack16(texel(data,i,1)+2) * 2.f*3.14159265f;
+		CHECK_NEAR(std::cos(dir), std::cos(l.dir), 0.001f);
+		CHECK_NEAR(std::sin(dir), std::sin(l.dir), 0.001f);
+		CHECK_NEAR(unpack16(texel(data,i,2)) * 2.f*3.14159265f, l.angle, 0.001f);
+
+		CHECK(relative_error(unpack_log16(texel(data,i,2)+2), l.color.r) < 0.001f);
+		CHECK_EQ(unpack_log16(texel(data,i,3)), 0.f);
+		CHECK(relative_error(unpack_log16(texel(data,i,3)+2), l.color.b) < 0.001f);
+
+		CHECK(relative_error(unpack_log16(texel(data,i,4)), l.factors.x) < 0.001f);
+		CHECK_EQ(unpack_log16(texel(data,i,4)+2), 0.f);
+		CHECK(relative_error(unpack_log16(texel(data,i,5)), l.factors.z) < 0.001f);
+	}
+}
+
+TEST_CASE(unused_light_slots_are_black) {
+	auto data = Light_texture_data{};
+	data.resize(1, 1);
+
+	auto lights = std::vector<Packed_light>(3);
+	for(auto& l : lights)
+		l.color = {1,1,1};
+	data.write_lights(lights);
+	lights.resize(1);
+	data.write_lights(lights);
+
+	CHECK(unpack_log16(texel(data,0,2)+2) > 0.f);
+	CHECK_EQ(unpack_log16(texel(data,1,2)+2), 0.f);
+	CHECK_EQ(unpack_log16(texel(data,2,3)+2), 0.f);
+}
@@ -0,0 +1,231 @@
+#include "benchmark.hpp"
+
+#include <core/utils/messagebus.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+	/// expensive to copy: two reference counts per copy
+	struct Blob {
+		std::shared_ptr<int> a;
+		std::shared_ptr<int> b;
+		float value = 0;
+
+		Blob() = default;
+		Blob(std::shared_ptr<int> a, std::shared_ptr<int> b, float value) : a(a), b(b), value(value) {}
+	};
+	struct Copied_blob : Blob {
+		using Blob::Blob;
+	};
+	struct Arena_blob : Blob {
+		using Blob::Blob;
+	};
+}
+namespace lux {
+namespace util {
+	template<>
+	struct is_arena_message<Arena_blob> : std::true_type {};
+}
+}
+
+using namespace lux;
+using namespace lux::util;
+
+namespace {
+	constexpr auto subscriber_count = 20;
+	constexpr auto deliveries = 1000000; //< messages received per run, summed over all subscribers
+	constexpr auto bulk_size = default_msg_batch_size;
+
+	struct Msg {
+		int value = 0;
+		Msg() = default;
+		Msg(int value) : value(value) {}
+	};
+	struct Unused {
+		int value = 0;
+	};
+
+	/*
+	 * The previous implementation of Mailbox_collection: an unordered_map of
+	 *   std::function, that copies each batch into a local array before it
+	 *   is passed to the handler.
+	 */
+	class Function_collection {
+		public:
+			Function_collection(Message_bus& bus) : _bus(bus) {}
+
+			template<class T, typename Func>
+			void subscribe(Func handler) {
+				auto& box = _boxes[typeuid_of<T>()];
+				box.box = std::make_shared<Mailbox<T>>(_bus, default_mailbox_size);
+				box.handler = [handler](Sub& s) mutable {
+					T msg[bulk_size];
+					auto& cbox = *static_cast<Mailbox<T>*>(s.box.get());
+
+					auto count = std::size_t(0);
+					do {
+						count = cbox.receive(msg);
+						std::for_each(std::begin(msg), std::begin(msg)+count, handler);
+					} while(count>0);
+				};
+			}
+
+			void update_subscriptions() {
+				for(auto& b : _boxes)
+					if(b.second.handler)
+						b.second.handler(b.second);
+			}
+
+		private:
+			struct Sub {
+				std::shared_ptr<void> box;
+				std::function<void(Sub&)> handler;
+			};
+
+			Message_bus& _bus;
+			std::unordered_map<Typeuid, Sub> _boxes;
+	};
+
+	/// sends msgs_per_update messages to every subscriber, then lets them handle their mailboxes
+	template<class Subscriber>
+	void run(Message_bus& bus, std::vector<Subscriber>& subscribers, int msgs_per_update) {
+		auto updates = deliveries / (subscriber_count*msgs_per_update);
+		for(auto u=0; u<updates; u++) {
+			for(auto i=0; i<msgs_per_update; i++)
+				bus.send<Msg>(i);
+
+			for(auto& s : subscribers)
+				s.update_subscriptions();
+		}
+		bus.update();
+	}
+
+	constexpr auto arena_frames = 10;
+	constexpr auto arena_sends = 50000; //< per frame
+
+	/*
+	 * Sends arena_sends messages of type T per frame to 20 subscribers, half
+	 *   of them on a child bus, and prints the average time of the sends and
+	 *   of their dispatch, as well as the arena allocations in the measured
+	 *   frames (excluding the first, that fills the queues).
+	 */
+	template<class T>
+	void bench_send(const std::string& name) {
+		using namespace std::chrono;
+
+		Message_bus bus;
+		auto child = bus.create_child();
+		auto a = std::make_shared<int>(1);
+		auto b = std::make_shared<int>(2);
+		auto sum = 0.f;
+
+		auto subscribers = std::vector<Mailbox_collection>();
+		subscribers.reserve(subscriber_count);
+		for(auto i=0; i<subscriber_count; i++) {
+			subscribers.emplace_back(i%2 ? *child : bus);
+			subscribers.back().subscribe_to<bulk_size, arena_sends>([&](T& m) {
+				sum += m.value;
+			});
+		}
+
+		auto send_time = 0.0;
+		auto dispatch_time = 0.0;
+		auto arena_messages = std::size_t(0);
+		auto arena_pages = std::size_t(0);
+
+		for(auto frame=0; frame<=arena_frames; frame++) {
+			auto arena_before = bus.arena_stats();
+			auto start = steady_clock::now();
+
+			for(auto i=0; i<arena_sends; i++)
+				bus.send<T>(a, b, float(i));
+
+			auto sent = steady_clock::now();
+
+			for(auto& s : subscribers)
+				s.update_subscriptions();
+			bus.update();
+
+			auto end = steady_clock::now();
+			if(frame>0) {
+				send_time += duration<double, std::milli>(sent - start).count();
+				dispatch_time += duration<double, std::milli>(end - sent).count();
+				auto arena = bus.arena_stats();
+				arena_messages += arena.messages - arena_before.messages;
+				arena_pages += arena.pages_allocated - arena_before.pages_allocated;
+			}
+		}
+
+		test::do_not_optimize(sum);
+		std::cout<<name<<", 50k sends to 20 subscribers: send avg "<<(send_time/arena_frames)
+		         <<" ms, dispatch avg "<<(dispatch_time/arena_frames)<<" ms, "
+		         <<arena_messages<<" arena messages in "<<arena_pages<<" newly allocated pages in "
+		         <<arena_frames<<" frames, "<<bus.arena_stats().pages_allocated<<" pages in total"<<std::endl;
+	}
+}
+
+/*
+ * Both variants share the same bus and send path, so the difference between
+ *   them is the dispatch through the subscriptions.
+ */
+int main() {
+	Message_bus bus;
+	auto received = std::int64_t(0);
+	auto received_reference = std::int64_t(0);
+
+	auto subscribers = std::vector<Mailbox_collection>();
+	auto references = std::vector<Function_collection>();
+	subscribers.reserve(subscriber_count);
+	references.reserve(subscriber_count);
+	for(auto i=0; i<subscriber_count; i++) {
+		subscribers.emplace_back(bus);
+		subscribers.back().subscribe_to<bulk_size>(
+			[&](Msg& m) {received += m.value;},
+			[&](Unused& m) {received -= m.value;}
+		);
+	}
+
+	for(auto msgs_per_update : {1, 10, 100}) {
+		auto name = std::to_string(msgs_per_update)+" msgs/subscriber/update";
+		test::benchmark("Mailbox_collection, 1M messages, 20 subscribers, "+name, 10, [&] {
+			run(bus, subscribers, msgs_per_update);
+		});
+	}
+
+	// unregisters the mailboxes, so the reference doesn't pay for their sends
+	auto expected = received;
+	subscribers.clear();
+
+	for(auto i=0; i<subscriber_count; i++) {
+		references.emplace_back(bus);
+		references.back().subscribe<Msg>([&](Msg& m) {received_reference += m.value;});
+		references.back().subscribe<Unused>([&](Unused& m) {received_reference -= m.value;});
+	}
+
+	for(auto msgs_per_update : {1, 10, 100}) {
+		auto name = std::to_string(msgs_per_update)+" msgs/subscriber/update";
+		test::benchmark("unordered_map<std::function>, 1M messages, 20 subscribers, "+name, 10, [&] {
+			run(bus, references, msgs_per_update);
+		});
+	}
+
+	// the game is multithreaded, so the reference counts of shared_ptrs are atomic
+	std::thread([]{}).join();
+
+	bench_send<Copied_blob>("copied {shared_ptr, shared_ptr, float}");
+	bench_send<Arena_blob>("arena {shared_ptr, shared_ptr, float}");
+
+	if(expected!=received_reference) {
+		std::cerr<<"The subscribers received "<<expected<<", the reference "<<received_reference<<std::endl;
+		return 1;
+	}
+}
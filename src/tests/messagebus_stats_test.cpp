@@ -0,0 +1,138 @@
+#include "test.hpp"
+
+#include <core/utils/messagebus.hpp>
+
+#include <sstream>
+
+
+using namespace lux::util;
+
+namespace {
+	struct Stats_ping {
+		int value = 0;
+		Stats_ping() = default;
+		Stats_ping(int value) : value(value) {}
+	};
+	struct Stats_blob {
+		char data[256] = {};
+	};
+}
+namespace lux {
+namespace util {
+	template<>
+	struct is_arena_message<Stats_blob> : std::true_type {};
+}
+}
+
+namespace {
+	template<class T>
+	auto stats_of() -> Message_type_stats {
+		for(auto& s : message_type_stats()) {
+			if(s.type==typeName<T>())
+				return s;
+		}
+		return {};
+	}
+}
+
+#ifdef MESSAGEBUS_STATS
+
+TEST_CASE(sends_are_counted_with_their_fan_out) {
+	Message_bus bus;
+	auto child = bus.create_child();
+	Mailbox<Stats_ping> a(bus);
+	Mailbox<Stats_ping> b(bus);
+	Mailbox<Stats_ping> c(*child);
+	reset_message_bus_stats();
+
+	bus.send<Stats_ping>(1);
+	bus.send<Stats_ping>(2);
+	child->send<Stats_ping>(3);
+
+	auto s = stats_of<Stats_ping>();
+	CHECK_EQ(s.sent, 3u);
+	CHECK_EQ(s.delivered, 3u+3u+1u);
+	CHECK_EQ(s.max_fan_out, 3u);
+	CHECK_EQ(s.bytes, 7u*sizeof(Stats_ping));
+}
+
+TEST_CASE(arena_messages_are_counted_once) {
+	Message_bus bus;
+	Mailbox<Arena_msg<Stats_blob>> a(bus);
+	Mailbox<Arena_msg<Stats_blob>> b(bus);
+	reset_message_bus_stats();
+
+	bus.send<Stats_blob>();
+
+	auto s = stats_of<Stats_blob>();
+	CHECK_EQ(s.sent, 1u);
+	CHECK_EQ(s.delivered, 2u);
+	CHECK_EQ(s.bytes, sizeof(Stats_blob) + 2u*sizeof(Arena_msg<Stats_blob>));
+}
+
+TEST_CASE(handled_messages_and_queue_depth) {
+	Message_bus bus;
+	Mailbox_collection mailbox(bus);
+	auto handled = 0;
+	mailbox.subscribe_to([&](Stats_ping&) {handled++;});
+	reset_message_bus_stats();
+
+	for(auto i=0; i<10; i++)
+		bus.send<Stats_ping>(i);
+	mailbox.update_subscriptions();
+
+	auto s = stats_of<Stats_ping>();
+	CHECK_EQ(handled, 10);
+	CHECK_EQ(s.handled, 10u);
+	CHECK_EQ(s.max_queue_depth, 10u);
+
+	auto boxes = mailbox_stats();
+	auto found = std::count_if(boxes.begin(), boxes.end(), [](auto& m) {
+		return m.type==typeName<Stats_ping>() && m.max_queue_depth==10u;
+	});
+	CHECK_EQ(found, 1);
+}
+
+TEST_CASE(queue_depth_outlives_the_mailbox) {
+	Message_bus bus;
+	reset_message_bus_stats();
+	{
+		Mailbox<Stats_ping> box(bus);
+		for(auto i=0; i<5; i++)
+			bus.send<Stats_ping>(i);
+	}
+
+	CHECK_EQ(stats_of<Stats_ping>().max_queue_depth, 5u);
+
+	reset_message_bus_stats();
+	CHECK_EQ(stats_of<Stats_ping>().max_queue_depth, 0u);
+	CHECK_EQ(stats_of<Stats_ping>().sent, 0u);
+}
+
+TEST_CASE(stats_are_written_as_json) {
+	Message_bus bus;
+	Mailbox<Stats_ping> box(bus);
+	reset_message_bus_stats();
+	bus.send<Stats_ping>(1);
+
+	auto out = std::stringstream{};
+	write_message_bus_stats(out);
+	auto json = out.str();
+
+	CHECK(json.find("\"types\"")!=std::string::npos);
+	CHECK(json.find("\"mailboxes\"")!=std::string::npos);
+	CHECK(json.find(typeName<Stats_ping>())!=std::string::npos);
+}
+
+#else
+
+TEST_CASE(nothing_is_recorded_without_messagebus_stats) {
+	Message_bus bus;
+	Mailbox<Stats_ping> box(bus);
+	bus.send<Stats_ping>(1);
+
+	CHECK_EQ(stats_of<Stats_ping>().sent, 0u);
+	CHECK(mailbox_stats().empty());
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "test.hpp"
+
+#include <core/utils/messagebus.hpp>
+
+#include <atomic>
+#include <thread>
+
+
+using namespace lux::util;
+
+namespace {
+	struct Ping {
+		int value = 0;
+		Ping() = default;
+		Ping(int value) : value(value) {}
+	};
+	struct Pong {
+		int value = 0;
+		Pong() = default;
+		Pong(int value) : value(value) {}
+	};
+
+	auto drain(Mailbox<Ping>& box) {
+		auto sum = 0;
+		auto count = 0;
+		for(auto msg=box.receive(); msg.is_some(); msg=box.receive()) {
+			sum += msg.get_or_throw().value;
+			count++;
+		}
+		return std::make_pair(count, sum);
+	}
+}
+
+TEST_CASE(send_reaches_every_mailbox_of_the_type) {
+	Message_bus bus;
+	Mailbox<Ping> a(bus);
+	Mailbox<Ping> b(bus);
+	Mailbox<Pong> other(bus);
+
+	bus.send<Ping>(1);
+	bus.send<Ping>(2);
+
+	CHECK_EQ(drain(a).second, 3);
+	CHECK_EQ(drain(b).second, 3);
+	CHECK(other.empty());
+}
+
+TEST_CASE(mailboxes_receive_immediately_after_registration) {
+	Message_bus bus;
+	bus.send<Ping>(1);
+
+	Mailbox<Ping> box(bus);
+	CHECK(box.empty());
+
+	bus.send<Ping>(2);
+	CHECK_EQ(drain(box).second, 2);
+}
+
+TEST_CASE(destroyed_mailboxes_are_skipped) {
+	Message_bus bus;
+	Mailbox<Ping> stays(bus);
+	{
+		Mailbox<Ping> removed(bus);
+	}
+
+	bus.send<Ping>(1);
+	bus.update();
+	CHECK_EQ(drain(stays).first, 1);
+}
+
+TEST_CASE(messages_are_passed_down_to_children) {
+	Message_bus bus;
+	auto child = bus.create_child();
+	Mailbox<Ping> parent_box(bus);
+	Mailbox<Ping> child_box(*child);
+
+	bus.send<Ping>(1);
+	CHECK_EQ(drain(parent_box).first, 1);
+	CHECK_EQ(drain(child_box).first, 1);
+
+	// ... but not up to their parent
+	child->send<Ping>(2);
+	CHECK(parent_box.empty());
+	CHECK_EQ(drain(child_box).second, 2);
+
+	auto grandchild = child->create_child();
+	Mailbox<Ping> grandchild_box(*grandchild);
+	bus.send<Ping>(3);
+	CHECK_EQ(drain(grandchild_box).second, 3);
+}
+
+TEST_CASE(collection_dispatches_to_handlers) {
+	Message_bus bus;
+	Mailbox_collection mailbox(bus);
+
+	auto pings = 0;
+	auto pongs = 0;
+	mailbox.subscribe_to([&](Ping& p) {pings += p.value;},
+	                     [&](Pong& p) {pongs += p.value;});
+
+	// more than one batch
+	for(auto i=0; i<3*default_msg_batch_size+1; i++)
+		bus.send<Ping>(1);
+	bus.send<Pong>(5);
+
+	mailbox.update_subscriptions();
+	CHECK_EQ(pings, 3*default_msg_batch_size+1);
+	CHECK_EQ(pongs, 5);
+
+	mailbox.unsubscribe<Pong>();
+	bus.send<Pong>(5);
+	mailbox.update_subscriptions();
+	CHECK_EQ(pongs, 5);
+}
+
+TEST_CASE(disabled_collections_drop_messages) {
+	Message_bus bus;
+	Mailbox_collection mailbox(bus);
+
+	auto pings = 0;
+	mailbox.subscribe_to([&](Ping&) {pings++;});
+
+	mailbox.disable();
+	bus.send<Ping>(1);
+	mailbox.update_subscriptions();
+	CHECK_EQ(pings, 0);
+
+	mailbox.enable();
+	bus.send<Ping>(1);
+	mailbox.update_subscriptions();
+	CHECK_EQ(pings, 1);
+}
+
+TEST_CASE(concurrent_sends_and_registrations) {
+	constexpr auto senders = 4;
+	constexpr auto messages = 20000;
+
+	Message_bus bus;
+	Mailbox<Ping> box(bus, 1024);
+
+	std::atomic<int> done {0};
+	auto threads = std::vector<std::thread>();
+	for(auto t=0; t<senders; t++) {
+		threads.emplace_back([&] {
+			for(auto i=0; i<messages; i++)
+				bus.send<Ping>(1);
+			done++;
+		});
+	}
+
+	// the mailbox table is replaced while the senders are using it
+	auto received = 0;
+	auto churn = 0;
+	while(done.load()<senders) {
+		{
+			Mailbox<Ping> temporary(bus);
+			Mailbox<Pong> other(bus);
+			auto child = bus.create_child();
+			Mailbox<Ping> child_box(*child);
+		}
+		bus.update();
+		received += drain(box).first;
+		churn++;
+	}
+	for(auto& t : threads)
+		t.join();
+
+	received += drain(box).first;
+	CHECK_EQ(received, senders*messages);
+	CHECK(churn>0);
+}
@@ -0,0 +1,175 @@
+#include "test.hpp"
+
+#include <core/asset/asset_manager.hpp>
+#include <core/renderer/particles.hpp>
+
+#include <cstring>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	// particles:test spawns 60 particles per second, that live for 0.5 seconds
+	constexpr auto frame = 1/60.f;
+
+	struct Fixture {
+		asset::Asset_manager assets{"particle_renderer_test", "particle_renderer_test"};
+		Particle_renderer renderer{assets};
+
+		void run(float seconds) {
+			for(auto t=0.f; t<seconds; t+=frame) {
+				renderer.update(Time{frame});
+			}
+		}
+	};
+
+	auto vertices(const Particle_emitter& e) -> std::vector<Particle_draw> {
+		auto out = std::vector<Particle_draw>(e.particle_count());
+		e.write_vertices(out.data());
+		return out;
+	}
+}
+
+TEST_CASE(emitters_reach_a_steady_state) {
+	Fixture f;
+	auto e = f.renderer.create_emiter("test"_strid);
+
+	f.run(0.25f);
+	CHECK_NEAR(float(e->particle_count()), 15.f, 2.f);
+
+	f.run(2.f);
+	CHECK_NEAR(float(e->particle_count()), 30.f, 2.f);
+}
+
+TEST_CASE(disabled_emitters_die_and_are_reused) {
+	Fixture f;
+	auto e = f.renderer.create_emiter("test"_strid);
+	auto address = e.get();
+	f.run(1.f);
+
+	e->disable();
+	f.run(0.1f);
+	CHECK(e->particle_count()>0);
+	CHECK(!e->dead());
+
+	f.run(0.5f);
+	CHECK(e->dead());
+
+	e.reset();
+	f.run(frame);
+	auto reused = f.renderer.create_emiter("test"_strid);
+	CHECK(reused.get()==address);
+	CHECK_EQ(reused->particle_count(), 0u);
+	CHECK(reused->active());
+}
+
+TEST_CASE(frozen_emitters_catch_up) {
+	Fixture f;
+	f.renderer.lod_center({1000, 0});
+	auto e = f.renderer.create_emiter("test"_strid);
+
+	f.run(1.f);
+	CHECK_EQ(e->particle_count(), 0u);
+
+	// at most lifetime.max is simulated when it is unfrozen, spread over multiple frames
+	f.renderer.lod_center({0, 0});
+	f.run(frame);
+	auto max_catch_up = f.renderer.lod_settings().max_catch_up;
+	CHECK_NEAR(float(e->particle_count()), 60.f*(frame+max_catch_up), 2.f);
+
+	f.run(0.5f/max_catch_up * frame);
+	CHECK_NEAR(float(e->particle_count()), 30.f, 2.f);
+}
+
+TEST_CASE(particle_budget_is_shared) {
+	Fixture f;
+	auto settings = f.renderer.lod_settings();
+	settings.particle_budget = 20;
+	f.renderer.lod_settings(settings);
+
+	auto emitters = std::vector<Particle_emitter_ptr>();
+	for(auto i=0; i<4; i++)
+		emitters.emplace_back(f.renderer.create_emiter("test"_strid));
+
+	for(auto i=0; i<120; i++) {
+		f.run(frame);
+
+		auto sum = std::size_t(0);
+		for(auto& e : emitters)
+			sum += e->particle_count();
+		CHECK(sum<=20u);
+	}
+
+	for(auto& e : emitters)
+		CHECK(e->particle_count()>0u);
+}
+
+TEST_CASE(emitters_are_independent_of_each_other) {
+	// the first emitter of both renderers has the same id and therefore the same seed
+	Fixture f;
+	auto e = f.renderer.create_emiter("test"_strid);
+
+	Particle_renderer crowded{f.assets};
+	auto same_seed = crowded.create_emiter("test"_strid);
+	auto others = std::vector<Particle_emitter_ptr>();
+	for(auto i=0; i<32; i++)
+		others.emplace_back(crowded.create_emiter("test"_strid));
+
+	for(auto i=0; i<60; i++) {
+		f.renderer.update(Time{frame});
+		crowded.update(Time{frame});
+
+		auto expected = vertices(*e);
+		auto actual = vertices(*same_seed);
+		CHECK_EQ(actual.size(), expected.size());
+		CHECK(actual.size()==expected.size()
+		      && std::memcmp(actual.data(), expected.data(), actual.size()*sizeof(Particle_draw))==0);
+	}
+
+	// ... but the other emitters don't just repeat the same sequence
+	auto first = vertices(*same_seed);
+	auto other = vertices(*others.front());
+	CHECK(first.size()!=other.size()
+	      || std::memcmp(first.data(), other.data(), first.size()*sizeof(Particle_draw))!=0);
+}
+
+TEST_CASE(only_released_emitters_are_reused) {
+	Fixture f;
+	auto e = f.renderer.create_emiter("test"_strid);
+	f.run(0.5f);
+
+	// dead, but still referenced by the handle
+	e->disable();
+	f.run(1.f);
+	CHECK(e->dead());
+	auto other = f.renderer.create_emiter("test"_strid);
+	CHECK(other.get()!=e.get());
+
+	// moving the handle doesn't release the emitter, destroying the last one does
+	auto address = e.get();
+	auto moved = std::move(e);
+	f.run(frame);
+	auto probe = f.renderer.create_emiter("test"_strid);
+	CHECK(probe.get()!=address);
+
+	moved.reset();
+	f.run(frame);
+	CHECK(f.renderer.create_emiter("test"_strid).get()==address);
+}
+
+TEST_CASE(clear_keeps_referenced_emitters) {
+	Fixture f;
+	auto kept = f.renderer.create_emiter("test"_strid);
+	auto released = f.renderer.create_emiter("test"_strid);
+	auto released_address = released.get();
+	f.run(0.5f);
+
+	released.reset();
+	f.renderer.clear();
+	f.run(0.25f);
+	CHECK(kept->particle_count()>0u);
+
+	auto reused = f.renderer.create_emiter("test"_strid);
+	CHECK(reused.get()==released_address);
+}
@@ -0,0 +1,281 @@
+#include "benchmark.hpp"
+
+#include <core/asset/asset_manager.hpp>
+#include <core/renderer/particles.hpp>
+
+#include <glm/gtx/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	// particles:bench_* spawn 5000 particles per second, that live for 2 seconds
+	constexpr auto frame = 1/60.f;
+	constexpr auto emitter_count = 100; //< 10k particles each
+	constexpr auto max_difference = 0.001f;
+
+	/*
+	 * The previous implementation: an array of structures, simulated one
+	 *   particle at a time with quaternions.
+	 * Only supports types without random ranges (min==max), so the results
+	 *   can be compared with the emitters of the Particle_renderer.
+	 */
+	class Aos_emitter {
+		public:
+			Aos_emitter(const Particle_type& type) : _type(type) {
+				_sim.reserve(type.max_particle_count);
+				_draw.reserve(type.max_particle_count);
+			}
+
+			void update(Time dt) {
+				_dt_acc += dt;
+				auto spawn_now = _type.emision_rate.min;
+				_to_spawn = static_cast<int>(std::round(spawn_now * _dt_acc.value()));
+				_dt_acc -= Time(_to_spawn/spawn_now);
+
+				_reap(dt);
+				_spawn();
+				_simulation(dt);
+			}
+
+			auto vertices()const -> auto& {return _draw;}
+
+		private:
+			struct Particle_sim {
+				Time ttl;
+				Time lifetime;
+				float initial_alpha, final_alpha;
+				float initial_opacity, final_opacity;
+				float initial_size, final_size;
+				glm::quat direction;
+				float initial_speed, final_speed;
+				glm::quat angular_speed_local;
+				glm::quat angular_speed_global;
+			};
+
+			const Particle_type& _type;
+			std::vector<Particle_sim> _sim;
+			std::vector<Particle_draw> _draw;
+			int _to_spawn = 0;
+			Time _dt_acc{0};
+
+			void _reap(Time dt) {
+				auto new_end = static_cast<int>(_sim.size());
+				for(auto i=0; i<new_end; i++) {
+					_sim[i].ttl -= dt;
+					if(_sim[i].ttl.value()<=0.f) {
+						if(_to_spawn>0) {
+							_spawn_particle_at(i);
+							_to_spawn--;
+						} else {
+							std::swap(_sim[i], _sim[new_end-1]);
+							std::swap(_draw[i], _draw[new_end-1]);
+							i--;
+							new_end--;
+						}
+					}
+				}
+				_sim.resize(new_end);
+				_draw.resize(new_end);
+			}
+			void _spawn() {
+				auto max_spawn = _type.max_particle_count - static_cast<int>(_sim.size());
+				for(auto i=0; i<std::min(_to_spawn, max_spawn); i++) {
+					_sim.emplace_back();
+					_draw.emplace_back();
+					_spawn_particle_at(static_cast<int>(_sim.size())-1);
+				}
+			}
+			void _spawn_particle_at(int idx) {
+				auto& t = _type;
+				auto& sim = _sim[idx];
+				sim.ttl = sim.lifetime = Time(t.lifetime.min);
+				sim.initial_alpha = t.initial_alpha.min;
+				sim.final_alpha = t.final_alpha.min;
+				sim.initial_opacity = t.initial_opacity.min;
+				sim.final_opacity = t.final_opacity.min;
+				sim.initial_size = t.initial_size.min;
+				sim.final_size = t.final_size.min;
+				sim.initial_speed = t.initial_speed.min;
+				sim.final_speed = t.final_speed.min;
+				sim.angular_speed_local = glm::quat(0, t.speed_roll.min, t.speed_pitch.min, t.speed_yaw.min);
+				sim.angular_speed_global = glm::quat(0, t.speed_roll_global.min, t.speed_pitch_global.min,
+				                                     t.speed_yaw_global.min);
+				sim.direction = glm::normalize(glm::quat(glm::vec3(
+				                    t.initial_pitch.min, t.initial_yaw.min, t.initial_roll.min)));
+
+				auto& draw = _draw[idx];
+				draw.position = glm::vec3(t.spawn_x.min, t.spawn_y.min, t.spawn_z.min);
+				draw.direction = glm::rotate(sim.direction, glm::vec3(1,0,0));
+				draw.rotation = t.rotation.min;
+				draw.frames = t.animation_frames;
+				draw.current_frame = 0;
+				draw.size = sim.initial_size;
+				draw.alpha = sim.initial_alpha;
+				draw.opacity = sim.initial_opacity;
+				draw.hue_change_out = 300.f / 360.f;
+			}
+			void _simulation(Time dt) {
+				for(auto i=std::size_t(0); i<_sim.size(); i++) {
+					auto& sim = _sim[i];
+					auto& draw = _draw[i];
+					auto a = 1.f - sim.ttl.value()/sim.lifetime.value();
+
+					draw.alpha = glm::mix(sim.initial_alpha, sim.final_alpha, a);
+					draw.opacity = glm::mix(sim.initial_opacity, sim.final_opacity, a);
+					draw.size = glm::mix(sim.initial_size, sim.final_size, a);
+
+					if(_type.fps<0) {
+						draw.current_frame = (draw.frames-1.f)*a;
+					} else {
+						draw.current_frame = std::fmod(draw.current_frame + _type.fps*dt.value(), draw.frames);
+					}
+
+					auto speed = glm::mix(sim.initial_speed, sim.final_speed, a);
+
+					auto& q = sim.direction;
+					q = glm::normalize(q + dt.value()*0.5f * q * sim.angular_speed_local);
+					q = glm::normalize(q + dt.value()*0.5f * sim.angular_speed_global * q);
+
+					draw.direction = glm::rotate(glm::normalize(q), glm::vec3(1,0,0));
+					draw.position += draw.direction * speed;
+				}
+			}
+	};
+
+	/// particles of the same age are identical, so both sides are sorted by age before the comparison
+	void sort_by_age(std::vector<Particle_draw>& v) {
+		std::sort(v.begin(), v.end(), [](auto& lhs, auto& rhs) {return lhs.alpha>rhs.alpha;});
+	}
+	auto max_error(const Particle_draw& lhs, const Particle_draw& rhs) -> float {
+		auto d = glm::abs(lhs.position-rhs.position);
+		d = glm::max(d, glm::abs(lhs.direction-rhs.direction));
+		auto e = std::max({d.x, d.y, d.z,
+		                   std::abs(lhs.rotation-rhs.rotation),
+		                   std::abs(lhs.current_frame-rhs.current_frame),
+		                   std::abs(lhs.size-rhs.size),
+		                   std::abs(lhs.alpha-rhs.alpha),
+		                   std::abs(lhs.opacity-rhs.opacity)});
+		return e;
+	}
+
+	/// simulates 3 seconds with both implementations and returns the largest difference of a vertex value
+	auto compare(asset::Asset_manager& assets, Particle_type_id type_id) -> float {
+		auto type = assets.load<Particle_type>(asset::AID{"particle"_strid, type_id.str()});
+
+		Particle_renderer renderer{assets};
+		auto settings = renderer.lod_settings();
+		settings.particle_budget = 1000000;
+		renderer.lod_settings(settings);
+
+		auto emitter = renderer.create_emiter(type_id);
+		auto reference = Aos_emitter{*type};
+
+		for(auto t=0.f; t<3.f; t+=frame) {
+			renderer.update(Time{frame});
+			reference.update(Time{frame});
+		}
+
+		auto expected = reference.vertices();
+		auto actual = std::vector<Particle_draw>(emitter->particle_count());
+		emitter->write_vertices(actual.data());
+
+		if(actual.size()!=expected.size()) {
+			std::cout<<type_id.str()<<": "<<actual.size()<<" particles, expected "<<expected.size()<<std::endl;
+			return INFINITY;
+		}
+
+		sort_by_age(expected);
+		sort_by_age(actual);
+
+		auto error = 0.f;
+		for(auto i=std::size_t(0); i<actual.size(); i++)
+			error = std::max(error, max_error(actual[i], expected[i]));
+
+		std::cout<<type_id.str()<<": "<<actual.size()<<" particles, max. difference "<<error<<std::endl;
+		return error;
+	}
+
+	void bench(asset::Asset_manager& assets, Particle_type_id type_id) {
+		auto type = assets.load<Particle_type>(asset::AID{"particle"_strid, type_id.str()});
+
+		Particle_renderer renderer{assets};
+		auto settings = renderer.lod_settings();
+		settings.particle_budget = 2*emitter_count*type->max_particle_count;
+		renderer.lod_settings(settings);
+
+		auto emitters = std::vector<Particle_emitter_ptr>();
+		auto references = std::vector<Aos_emitter>();
+		for(auto i=0; i<emitter_count; i++) {
+			emitters.emplace_back(renderer.create_emiter(type_id));
+			references.emplace_back(*type);
+		}
+
+		// fill up to the steady state of 1M particles
+		for(auto t=0.f; t<2.5f; t+=frame) {
+			renderer.update(Time{frame});
+			for(auto& r : references)
+				r.update(Time{frame});
+		}
+
+		auto particles = std::size_t(0);
+		for(auto& e : emitters)
+			particles += e->particle_count();
+		auto name = type_id.str()+", "+std::to_string(particles)+" particles";
+
+		test::benchmark("Particle_renderer::update, "+name, 20, [&] {
+			renderer.update(Time{frame});
+		});
+		test::benchmark("array of structures (single thread, no upload), "+name, 20, [&] {
+			for(auto& r : references)
+				r.update(Time{frame});
+			test::do_not_optimize(references);
+		});
+	}
+
+	/// the same 1M particles, simulated and uploaded by thread pools of different sizes
+	void bench_threads(asset::Asset_manager& assets, Particle_type_id type_id) {
+		std::cout<<"hardware threads: "<<std::thread::hardware_concurrency()<<std::endl;
+
+		for(auto threads : {1, 2, 4, 8}) {
+			util::Thread_pool pool(threads);
+			Particle_renderer renderer{assets, pool};
+			auto settings = renderer.lod_settings();
+			settings.particle_budget = 2*emitter_count*10000;
+			renderer.lod_settings(settings);
+
+			auto emitters = std::vector<Particle_emitter_ptr>();
+			for(auto i=0; i<emitter_count; i++)
+				emitters.emplace_back(renderer.create_emiter(type_id));
+
+			renderer.warmup(Time{2.5f});
+
+			test::benchmark("Particle_renderer::update, "+type_id.str()+", "+std::to_string(threads)+" threads",
+			                20, [&] {
+				renderer.update(Time{frame});
+			});
+		}
+	}
+}
+
+int main() {
+	asset::Asset_manager assets{"particles_bench", "particles_bench"};
+
+	auto planar_error = compare(assets, "bench_planar"_strid);
+	auto spatial_error = compare(assets, "bench_spatial"_strid);
+
+	bench(assets, "bench_planar"_strid);
+	bench(assets, "bench_spatial"_strid);
+	bench_threads(assets, "bench_spatial"_strid);
+
+	if(!(planar_error<max_difference) || !(spatial_error<max_difference)) {
+		std::cerr<<"The simulation differs from the array of structures implementation"<<std::endl;
+		return 1;
+	}
+}
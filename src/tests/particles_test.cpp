@@ -0,0 +1,49 @@
+#include "test.hpp"
+
+#include <core/renderer/particles.hpp>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+TEST_CASE(spawn_count_follows_the_rate) {
+	auto acc = Time{0};
+	auto spawned = 0;
+	for(auto i=0; i<600; i++) {
+		acc += Time{1/60.f};
+		spawned += particle_spawn_count(10.f, acc);
+	}
+
+	// one particle about every 6th frame, the remainder is carried over
+	CHECK_NEAR(spawned, 100, 1);
+	CHECK(acc.value()>=-0.1f && acc.value()<=0.1f);
+}
+
+TEST_CASE(spawn_count_with_a_rate_of_zero) {
+	auto acc = Time{0.5f};
+	CHECK_EQ(particle_spawn_count(0.f, acc), 0);
+	CHECK_EQ(acc.value(), 0.f);
+
+	acc += Time{0.5f};
+	CHECK_EQ(particle_spawn_count(0.f, acc), 0);
+	CHECK_EQ(particle_spawn_count(10.f, acc), 0);
+	CHECK(std::isfinite(acc.value()));
+
+	acc += Time{1.f};
+	CHECK_EQ(particle_spawn_count(10.f, acc), 10);
+}
+
+TEST_CASE(lod_depends_on_the_distance) {
+	auto s = Particle_lod_settings{};
+	CHECK(particle_lod(s, 0.f)==Particle_lod::full);
+	CHECK(particle_lod(s, s.full_rate_distance+1.f)==Particle_lod::reduced);
+	CHECK(particle_lod(s, s.frozen_distance+1.f)==Particle_lod::frozen);
+}
+
+TEST_CASE(spawn_limit_splits_the_budget) {
+	CHECK_EQ(particle_spawn_limit(1000, 1.f, 4.f), 250u);
+	CHECK_EQ(particle_spawn_limit(1000, 4.f, 4.f), 1000u);
+	CHECK_EQ(particle_spawn_limit(1000, 0.f, 4.f), 0u);
+	CHECK_EQ(particle_spawn_limit(1000, 1.f, 0.f), 0u);
+	CHECK_EQ(particle_spawn_limit(0, 1.f, 1.f), 0u);
+}
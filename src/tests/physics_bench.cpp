@@ -0,0 +1,265 @@
+#include "benchmark.hpp"
+#include "ecs_fixture.hpp"
+
+#include <game/sys/physics/physics_comp.hpp>
+#include <game/sys/physics/physics_system.hpp>
+#include <game/sys/physics/transform_comp.hpp>
+
+#include <core/utils/messagebus.hpp>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+using namespace lux;
+using namespace lux::unit_literals;
+using lux::sys::physics::Contact_batch;
+using lux::sys::physics::Dynamic_body_comp;
+using lux::sys::physics::Physics_system;
+using lux::sys::physics::Ray;
+using lux::sys::physics::Raycast_result;
+using lux::sys::physics::Static_body_comp;
+using lux::sys::physics::Transform_comp;
+
+namespace {
+	constexpr auto frame = 1/60.f;
+
+	/// the bodies of a world, that is simulated without an engine
+	struct World {
+		test::Ecs_fixture& f;
+		util::Message_bus bus;
+		std::vector<ecs::Entity_ptr> entities;
+		Physics_system physics;
+
+		World(test::Ecs_fixture& f) : f(f), physics(bus, f.ecs) {}
+		~World() {
+			for(auto& e : entities)
+				f.ecs.erase(e);
+			f.ecs.process_queued_actions();
+		}
+
+		template<class Body>
+		auto add(glm::vec2 pos, const std::string& def) -> ecs::Entity& {
+			auto e = f.ecs.emplace();
+			e->emplace<Transform_comp>().position(Position{pos.x*1_m, pos.y*1_m, 0_m});
+			f.load(e->emplace<Body>(), def);
+			entities.push_back(e);
+			return *e;
+		}
+		auto add_box(glm::vec2 pos) -> ecs::Entity& {
+			return add<Dynamic_body_comp>(pos, R"({"size": {"x":1, "y":1}})");
+		}
+		void add_ground(float width) {
+			add<Static_body_comp>({0.f, -0.5f}, R"({"size": {"x":)"+std::to_string(width)+R"(, "y":1}})");
+		}
+
+		/// 2000 boxes (40 columns, 50 rows) above the ground
+		void add_pile() {
+			constexpr auto columns = 40;
+			constexpr auto rows = 50;
+
+			add_ground(200.f);
+			for(auto y=0; y<rows; y++) {
+				for(auto x=0; x<columns; x++)
+					add_box({(x-columns/2)*1.1f + (y%2)*0.5f, 1.f + y*1.1f});
+			}
+		}
+
+		void update() {
+			f.ecs.process_queued_actions();
+			physics.update(Time{frame});
+			bus.update();
+		}
+	};
+
+	/*
+	 * 2000 boxes dropped onto the ground as a pile, measured from the first
+	 *   contacts until most of it has settled.
+	 * Contact_batch replaced one message per begin/end and per PostSolve,
+	 *   so the events in the batches are the number of messages that were
+	 *   sent before (all boxes have a single fixture).
+	 */
+	void bench_contacts(test::Ecs_fixture& f) {
+		World world{f};
+		world.add_pile();
+
+		auto batches = std::size_t(0);
+		auto entries = std::size_t(0);
+		auto events = std::size_t(0); //< begin, end and collisions
+		auto subscriber = util::Mailbox_collection{world.bus};
+		subscriber.subscribe_to([&](Contact_batch& batch) {
+			batches++;
+			entries += batch.entries.size();
+			batch.process_contacts([&](auto&&) {events++;});
+			batch.process_collisions([&](auto&&) {events++;});
+		});
+
+		world.update();
+		subscriber.update_subscriptions();
+
+		test::benchmark("Physics_system::update, pile of 2000 boxes, with contact dispatch", 600, [&] {
+			world.update();
+			subscriber.update_subscriptions();
+		});
+
+		std::cout<<"contacts of 600 steps: "<<batches<<" batches with "<<entries<<" entries, "
+		         <<events<<" contact and collision events"<<std::endl;
+	}
+
+	/// random rays through the pile and rays down to the ground, like the ones of humanoids
+	auto create_rays(World& world) -> std::vector<Ray> {
+		constexpr auto ray_count = 10000;
+
+		auto rand = std::mt19937{42};
+		auto x = std::uniform_real_distribution<float>{-25.f, 25.f};
+		auto y = std::uniform_real_distribution<float>{0.f, 30.f};
+		auto angle = std::uniform_real_distribution<float>{0.f, 6.283f};
+		auto dist = std::uniform_real_distribution<float>{1.f, 20.f};
+
+		auto rays = std::vector<Ray>();
+		rays.reserve(ray_count);
+		for(auto i=0; i<ray_count/2; i++) {
+			auto a = angle(rand);
+			rays.push_back(Ray{{x(rand), y(rand)}, {std::cos(a), std::sin(a)}, dist(rand)});
+		}
+		for(auto i=0; i<ray_count/2; i++) {
+			auto& body = *world.entities[1 + static_cast<std::size_t>(rand())%(world.entities.size()-1)];
+			auto pos = remove_units(body.get<Transform_comp>().get_or_throw().position());
+			rays.push_back(Ray{{pos.x, pos.y}, {0.f, -1.f}, 20.f, &body});
+		}
+		return rays;
+	}
+
+	/*
+	 * 10k raycasts through a pile of 2000 boxes, once as single queries and
+	 *   once as one batch. Returns false if the results differ.
+	 */
+	auto bench_raycasts(test::Ecs_fixture& f) -> bool {
+		World world{f};
+		world.add_pile();
+		for(auto i=0; i<120; i++)
+			world.update();
+
+		auto rays = create_rays(world);
+		auto single = std::vector<Raycast_result>(rays.size());
+		auto batch = std::vector<Raycast_result>(rays.size());
+
+		test::benchmark("Physics_system::raycast, 10k single rays", 20, [&] {
+			for(auto i=std::size_t(0); i<rays.size(); i++) {
+				auto& r = rays[i];
+				auto hit = r.exclude ? world.physics.raycast(r.position, r.dir, r.max_dist, *r.exclude)
+				                     : world.physics.raycast(r.position, r.dir, r.max_dist);
+				single[i] = hit.get_or_other(Raycast_result{});
+			}
+			test::do_not_optimize(single);
+		});
+		test::benchmark("Physics_system::raycast_batch, 10k rays", 20, [&] {
+			world.physics.raycast_batch(rays.data(), rays.size(), batch.data());
+			test::do_not_optimize(batch);
+		});
+
+		auto hits = 0;
+		auto mismatches = 0;
+		for(auto i=std::size_t(0); i<rays.size(); i++) {
+			if(single[i].entity)
+				hits++;
+			if(single[i].entity!=batch[i].entity ||
+			   (single[i].entity && std::abs(single[i].distance-batch[i].distance)>0.0001f))
+				mismatches++;
+		}
+		std::cout<<"raycasts: "<<hits<<" hits, "<<mismatches<<" differences between single and batched rays"
+		         <<std::endl;
+		return mismatches==0;
+	}
+
+	/// 10k boxes, that rest on the ground far enough apart, that they don't touch each other
+	void add_row(World& world) {
+		constexpr auto count = 10000;
+		constexpr auto spacing = 2.f;
+
+		world.add_ground(count*spacing + 10.f);
+		for(auto i=0; i<count; i++)
+			world.add_box({(i-count/2)*spacing, 0.5f});
+	}
+
+	/*
+	 * 10k boxes, that are sent into the air at random and fall asleep again,
+	 *   so the Physics_system only has to visit the woken ones.
+	 * Afterwards 100 sleeping boxes are moved through their transforms,
+	 *   which has to be applied to their bodies by the next update.
+	 * Returns false if one of them can't be found at its new position.
+	 */
+	auto bench_sleeping(test::Ecs_fixture& f) -> bool {
+		World world{f};
+		add_row(world);
+
+		// until all boxes are asleep
+		for(auto i=0; i<120; i++)
+			world.update();
+
+		auto rand = std::mt19937{42};
+		auto pick = std::uniform_int_distribution<std::size_t>{1, world.entities.size()-1};
+
+		for(auto kicks : {0, 10, 50, 200}) {
+			auto kick = [&] {
+				for(auto i=0; i<kicks; i++)
+					world.entities[pick(rand)]->get<Dynamic_body_comp>().process([](auto& body) {
+						body.velocity({0.f, 2.f});
+					});
+			};
+
+			// the boxes sleep again about 50 updates after their kick
+			for(auto i=0; i<120; i++) {
+				kick();
+				world.update();
+			}
+
+			test::benchmark("Physics_system::update, 10k boxes, "+std::to_string(kicks)+" kicked per update",
+			                300, [&] {
+				kick();
+				world.update();
+			});
+		}
+
+		for(auto i=0; i<120; i++)
+			world.update();
+
+		auto moved = std::vector<ecs::Entity*>();
+		for(auto i=1; i<=100; i++) {
+			auto& e = *world.entities[i*97];
+			e.get<Transform_comp>().get_or_throw().position(Position{(30000.f+i*2.f)*1_m, 5_m, 0_m});
+			moved.push_back(&e);
+		}
+		world.update();
+
+		auto misses = 0;
+		for(auto i=1; i<=100; i++) {
+			auto hit = world.physics.raycast({30000.f+i*2.f, 10.f}, {0.f, -1.f}, 10.f);
+			if(!hit.is_some() || hit.get_or_throw().entity!=moved[i-1])
+				misses++;
+		}
+		std::cout<<"moved sleeping boxes: "<<(100-misses)<<" of 100 found at their new position"<<std::endl;
+		return misses==0;
+	}
+}
+
+int main() {
+	test::Ecs_fixture f{"physics_bench"};
+	f.ecs.register_component_type<Transform_comp>();
+	f.ecs.register_component_type<Dynamic_body_comp>();
+	f.ecs.register_component_type<Static_body_comp>();
+
+	bench_contacts(f);
+	auto raycasts_match = bench_raycasts(f);
+	auto moved_bodies_match = bench_sleeping(f);
+
+	if(!raycasts_match) {
+		std::cerr<<"The batched raycasts differ from the single ones"<<std::endl;
+		return 1;
+	}
+	if(!moved_bodies_match) {
+		std::cerr<<"Sleeping bodies didn't follow their transforms"<<std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,130 @@
+#include "test.hpp"
+
+#include <core/renderer/gl.hpp>
+#include <core/renderer/null_gl.hpp>
+#include <core/renderer/render_state.hpp>
+
+#include <cstring>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	auto gl_calls(const char* name) -> std::size_t {
+		auto sum = std::size_t(0);
+		for(auto& call : null_gl_stats().calls) {
+			if(std::strcmp(call.first, name)==0)
+				sum += call.second;
+		}
+		return sum;
+	}
+}
+
+TEST_CASE(redundant_program_binds_are_skipped) {
+	auto state = Render_state{};
+	reset_null_gl_stats();
+
+	state.program(1);
+	state.program(1);
+	state.program(2);
+	state.program(2);
+	state.program(1);
+
+	CHECK_EQ(gl_calls("glUseProgram"), 3u);
+	CHECK_EQ(state.stats().program_binds, 3);
+	CHECK_EQ(state.stats().skipped_changes, 2);
+}
+
+TEST_CASE(redundant_texture_binds_are_skipped) {
+	auto state = Render_state{};
+	reset_null_gl_stats();
+
+	state.texture(0, GL_TEXTURE_2D, 1);
+	state.texture(1, GL_TEXTURE_2D, 2);
+	state.texture(0, GL_TEXTURE_2D, 1);
+	state.texture(1, GL_TEXTURE_2D, 2);
+	CHECK_EQ(gl_calls("glBindTexture"), 2u);
+	CHECK_EQ(gl_calls("glActiveTexture"), 2u);
+
+	// same handle on another target is a different binding
+	state.texture(1, GL_TEXTURE_CUBE_MAP, 2);
+	CHECK_EQ(gl_calls("glBindTexture"), 3u);
+	CHECK_EQ(gl_calls("glActiveTexture"), 2u); //< unit 1 is still active
+
+	CHECK_EQ(state.stats().texture_binds, 3);
+	CHECK_EQ(state.stats().skipped_changes, 2);
+}
+
+TEST_CASE(redundant_options_are_skipped) {
+	auto state = Render_state{};
+	reset_null_gl_stats();
+
+	// the initial state is unknown, so every option has to be set once
+	state.gl_options(default_gl_options);
+	CHECK_EQ(gl_calls("glEnable"), 2u);
+	CHECK_EQ(gl_calls("glDepthMask"), 1u);
+
+	state.gl_options(default_gl_options);
+	CHECK_EQ(null_gl_stats().state_changes, 3u);
+
+	state.gl_options(Gl_option::blend|Gl_option::depth_test);
+	CHECK_EQ(gl_calls("glDepthMask"), 2u);
+	CHECK_EQ(gl_calls("glEnable"), 2u);
+	CHECK_EQ(gl_calls("glDisable"), 0u);
+
+	state.option(Gl_option::blend, false);
+	state.option(Gl_option::blend, false);
+	CHECK_EQ(gl_calls("glDisable"), 1u);
+
+	CHECK_EQ(state.stats().state_changes, 5);
+	CHECK_EQ(state.stats().skipped_changes, 3+2+1);
+}
+
+TEST_CASE(invalidate_forgets_the_cached_state) {
+	auto state = Render_state{};
+	state.program(1);
+	state.texture(0, GL_TEXTURE_2D, 1);
+	state.gl_options(default_gl_options);
+
+	reset_null_gl_stats();
+	state.invalidate();
+	state.program(1);
+	state.texture(0, GL_TEXTURE_2D, 1);
+	state.gl_options(default_gl_options);
+
+	CHECK_EQ(gl_calls("glUseProgram"), 1u);
+	CHECK_EQ(gl_calls("glBindTexture"), 1u);
+	CHECK_EQ(gl_calls("glActiveTexture"), 1u);
+	CHECK_EQ(gl_calls("glEnable")+gl_calls("glDepthMask"), 3u);
+}
+
+TEST_CASE(deleted_handles_are_rebound) {
+	auto state = Render_state{};
+	state.program(1);
+	state.texture(0, GL_TEXTURE_2D, 1);
+
+	// the driver may reuse the handles for new objects
+	reset_null_gl_stats();
+	state.on_delete_program(1);
+	state.on_delete_texture(1);
+	state.program(1);
+	state.texture(0, GL_TEXTURE_2D, 1);
+
+	CHECK_EQ(gl_calls("glUseProgram"), 1u);
+	CHECK_EQ(gl_calls("glBindTexture"), 1u);
+}
+
+TEST_CASE(stats_are_reset_per_frame) {
+	auto state = Render_state{};
+	state.program(1);
+	state.program(1);
+	state.count_draw_call();
+
+	state.end_frame();
+	CHECK_EQ(state.last_frame_stats().program_binds, 1);
+	CHECK_EQ(state.last_frame_stats().skipped_changes, 1);
+	CHECK_EQ(state.last_frame_stats().draw_calls, 1);
+	CHECK_EQ(state.stats().program_binds, 0);
+	CHECK_EQ(state.stats().draw_calls, 0);
+}
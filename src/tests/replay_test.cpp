@@ -0,0 +1,178 @@
+#include "test.hpp"
+
+#include <game/game_engine.hpp>
+#include <game/meta_system.hpp>
+#include <game/replay.hpp>
+
+#include <core/input/input_manager.hpp>
+#include <core/utils/stacktrace.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+
+using namespace lux;
+using namespace lux::unit_literals;
+
+namespace {
+	char app_name[] = "replay_test";
+	char* argv[] = {app_name, nullptr};
+	char* env[] = {nullptr};
+
+	constexpr auto level_id = "headless_draw_test";
+	constexpr auto replay_file = LUX_TEST_OUTPUT_DIR "/replay_test.lxrp";
+	constexpr auto truncated_file = LUX_TEST_OUTPUT_DIR "/replay_test_truncated.lxrp";
+	constexpr auto recorded_ticks = 10u;
+
+	auto engine() -> Game_engine& {
+		static auto engine = [] {
+			util::init_stacktrace(argv[0]);
+			return std::make_unique<Game_engine>(app_name, 1, argv, env);
+		}();
+		return *engine;
+	}
+
+	/// records 10 ticks: a jump at tick 2, a pointer move at 3, a reset and mask change at 5
+	void record(Game_engine& engine) {
+		Meta_system systems(engine);
+		systems.load_level(level_id, true);
+
+		engine.input().last_pointer_world_position({0,0});
+
+		Replay_recorder recorder(engine, replay_file, level_id, 42, 4);
+		auto mask = update_all;
+		for(auto tick=0u; tick<recorded_ticks; tick++) {
+			if(tick==2)
+				engine.bus().send<input::Once_action>("jump"_strid, input::Input_source(1));
+			if(tick==3)
+				engine.input().last_pointer_world_position({1,2});
+			if(tick==5) {
+				systems.gameplay.reset();
+				recorder.reset();
+				mask = Update::movements | Update::animations;
+			}
+
+			recorder.begin_tick(mask);
+			systems.update(Time{replay_tick}, mask);
+			recorder.end_tick(systems);
+		}
+	}
+
+	/// plays the file until its end and returns the number of ticks
+	auto play(Game_engine& engine, const std::string& path) -> uint32_t {
+		Meta_system systems(engine);
+		Replay_player player(engine, path);
+		systems.load_level(player.level_id(), true);
+
+		while(true) {
+			auto mask = player.begin_tick(systems);
+			if(player.finished())
+				break;
+
+			systems.update(Time{replay_tick}, mask);
+			player.end_tick(systems);
+		}
+
+		return player.tick();
+	}
+
+	void write_prefix(const std::string& path, std::size_t length) {
+		std::ifstream in(replay_file, std::ios::binary);
+		auto data = std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		INVARIANT(length<=data.size(), "Prefix is longer than the replay");
+
+		std::ofstream out(path, std::ios::binary);
+		out.write(data.data(), static_cast<std::streamsize>(length));
+	}
+	auto file_size(const std::string& path) -> std::size_t {
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		return static_cast<std::size_t>(in.tellg());
+	}
+
+	auto truncated_error(Game_engine& engine, std::size_t length) -> std::string {
+		write_prefix(truncated_file, length);
+		try {
+			play(engine, truncated_file);
+		} catch(const util::Error& e) {
+			return e.what();
+		}
+		return "";
+	}
+}
+
+TEST_CASE(replay_reproduces_recorded_session) {
+	auto& engine = ::engine();
+	record(engine);
+
+	Meta_system systems(engine);
+	Replay_player player(engine, replay_file);
+	CHECK_EQ(player.level_id(), std::string(level_id));
+	CHECK_EQ(player.seed(), 42u);
+	systems.load_level(player.level_id(), true);
+
+	auto received = std::vector<std::pair<uint32_t, input::Action_id>>();
+	util::Mailbox_collection mailbox(engine.bus());
+	mailbox.subscribe_to([&](input::Once_action& e) {
+		received.emplace_back(player.tick(), e.id);
+	});
+
+	engine.input().last_pointer_world_position({0,0});
+
+	while(true) {
+		auto mask = player.begin_tick(systems);
+		if(player.finished())
+			break;
+
+		mailbox.update_subscriptions();
+		CHECK(mask==(player.tick()<5 ? update_all : Update::movements | Update::animations));
+
+		auto expected_pointer = player.tick()<3 ? glm::vec2{0,0} : glm::vec2{1,2};
+		CHECK(engine.input().last_pointer_world_position()==expected_pointer);
+
+		systems.update(Time{replay_tick}, mask);
+		CHECK(player.end_tick(systems));
+	}
+
+	CHECK_EQ(player.tick(), recorded_ticks);
+	CHECK_EQ(received.size(), 1u);
+	if(!received.empty()) {
+		CHECK_EQ(received[0].first, 2u);
+		CHECK(received[0].second=="jump"_strid);
+	}
+
+	std::remove(replay_file);
+}
+
+TEST_CASE(truncated_replay_is_reported) {
+	auto& engine = ::engine();
+	record(engine);
+	auto size = file_size(replay_file);
+
+	// inside of the header, without the end record and inside of the end record
+	for(auto length : {std::size_t(6), size-2, size-1}) {
+		auto error = truncated_error(engine, length);
+		CHECK(error.find("truncated")!=std::string::npos);
+	}
+
+	// the complete file can still be played
+	CHECK_EQ(play(engine, replay_file), recorded_ticks);
+
+	std::remove(truncated_file);
+	std::remove(replay_file);
+}
+
+TEST_CASE(invalid_replay_is_rejected) {
+	auto& engine = ::engine();
+	{
+		std::ofstream out(truncated_file, std::ios::binary);
+		out<<"not a replay";
+	}
+
+	CHECK_THROWS(Replay_player(engine, truncated_file).tick(), util::Error);
+	CHECK_THROWS(Replay_player(engine, "does_not_exist.lxrp").tick(), util::Error);
+
+	std::remove(truncated_file);
+}
@@ -0,0 +1,117 @@
+#include "test.hpp"
+
+#include <game/sys/light/shadow_cache.hpp>
+
+#include <core/utils/stacktrace.hpp>
+
+
+using namespace lux::sys::light;
+
+namespace {
+	const auto view = glm::vec4{-10,-10, 10,10};
+
+	auto light(uint64_t id, glm::vec2 pos, uint64_t version=1) -> Shadow_light {
+		return Shadow_light{id, version, pos, 2.f};
+	}
+
+	/// one frame without any occluder changes, returns if the slot had to be rendered
+	auto frame(Shadow_cache& cache, const Shadow_light& l, glm::vec4 area=view) -> bool {
+		cache.view(area);
+		auto slot = cache.acquire(l);
+		auto outdated = !cache.valid(slot);
+		if(outdated)
+			cache.rendered(slot);
+		cache.end_frame();
+		return outdated;
+	}
+}
+
+TEST_CASE(slots_are_reused_until_the_light_moves) {
+	auto cache = Shadow_cache(4);
+	CHECK(frame(cache, light(1, {0,0})));
+	CHECK(!frame(cache, light(1, {0,0})));
+	CHECK_EQ(cache.last_frame_stats().slots_reused, 1);
+
+	CHECK(frame(cache, light(1, {0,0}, 2)));
+	CHECK(frame(cache, light(1, {1,0}, 2)));
+	CHECK(!frame(cache, light(1, {1,0}, 2)));
+}
+
+TEST_CASE(occluders_only_invalidate_lights_in_reach) {
+	auto cache = Shadow_cache(4);
+	cache.occluder(10, 1, {0,0}, 1.f);
+	CHECK(frame(cache, light(1, {0,0})));
+
+	// moved within the radius of the light
+	cache.occluder(10, 1, {1,0}, 1.f);
+	CHECK(frame(cache, light(1, {0,0})));
+
+	// new occluder, far away
+	cache.occluder(10, 1, {1,0}, 1.f);
+	cache.occluder(11, 1, {8,8}, 1.f);
+	CHECK(!frame(cache, light(1, {0,0})));
+
+	// changed its version (e.g. animation)
+	cache.occluder(10, 2, {1,0}, 1.f);
+	cache.occluder(11, 1, {8,8}, 1.f);
+	CHECK(frame(cache, light(1, {0,0})));
+
+	// removed
+	cache.occluder(11, 1, {8,8}, 1.f);
+	CHECK(frame(cache, light(1, {0,0})));
+	cache.occluder(11, 1, {8,8}, 1.f);
+	CHECK(!frame(cache, light(1, {0,0})));
+}
+
+TEST_CASE(moving_the_view_keeps_lights_inside_of_it) {
+	auto cache = Shadow_cache(4);
+	CHECK(frame(cache, light(1, {0,0})));
+
+	CHECK(!frame(cache, light(1, {0,0}), view+glm::vec4(5,0,5,0)));
+	CHECK(!frame(cache, light(1, {0,0}), view+glm::vec4(-7,-7,-7,-7)));
+
+	// the radius of the light is no longer completely visible
+	CHECK(frame(cache, light(1, {0,0}), view+glm::vec4(9,0,9,0)));
+}
+
+TEST_CASE(partially_visible_lights_are_invalidated_by_view_changes) {
+	auto cache = Shadow_cache(4);
+	CHECK(frame(cache, light(1, {9.5f,0})));
+	CHECK(!frame(cache, light(1, {9.5f,0})));
+
+	// completely visible, but the occluders that were outside haven't been rendered
+	CHECK(frame(cache, light(1, {9.5f,0}), view+glm::vec4(5,0,5,0)));
+	CHECK(!frame(cache, light(1, {9.5f,0}), view+glm::vec4(4,0,4,0)));
+}
+
+TEST_CASE(invalidate_all_keeps_the_slots) {
+	auto cache = Shadow_cache(2);
+	cache.view(view);
+	auto slot = cache.acquire(light(1, {0,0}));
+	cache.rendered(slot);
+	cache.end_frame();
+
+	cache.invalidate_all();
+	cache.view(view);
+	CHECK_EQ(cache.acquire(light(1, {0,0})), slot);
+	CHECK(!cache.valid(slot));
+}
+
+TEST_CASE(least_recently_used_slots_are_replaced) {
+	auto cache = Shadow_cache(2);
+	CHECK(frame(cache, light(1, {0,0})));
+	CHECK(frame(cache, light(2, {0,0})));
+	CHECK(frame(cache, light(3, {0,0}))); // replaces 1
+
+	CHECK(!frame(cache, light(2, {0,0})));
+	CHECK(frame(cache, light(1, {0,0}))); // replaces 3
+	CHECK(!frame(cache, light(2, {0,0})));
+}
+
+TEST_CASE(acquiring_more_lights_than_slots_fails) {
+	auto cache = Shadow_cache(2);
+	cache.view(view);
+	cache.acquire(light(1, {0,0}));
+	cache.acquire(light(2, {0,0}));
+	CHECK_THROWS(cache.acquire(light(3, {0,0})), lux::util::Error);
+}
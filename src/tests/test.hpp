@@ -0,0 +1,94 @@
+/** minimal assertions and registry for the unit tests ***********************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+
+/// directory for files written by the tests (logs, replays), set by CMake to the build directory
+#ifndef LUX_TEST_OUTPUT_DIR
+	#define LUX_TEST_OUTPUT_DIR "."
+#endif
+
+
+namespace lux {
+namespace test {
+
+	struct Test_case {
+		const char* name;
+		void (*func)();
+	};
+
+	inline auto test_cases() -> std::vector<Test_case>& {
+		static std::vector<Test_case> cases;
+		return cases;
+	}
+	inline auto failed_checks() -> int& {
+		static int failed = 0;
+		return failed;
+	}
+
+	struct Registration {
+		Registration(const char* name, void (*func)()) {
+			test_cases().push_back(Test_case{name, func});
+		}
+	};
+
+	/// runs all registered tests (or only those whose name contains filter)
+	extern auto run_all(const std::string& filter) -> int;
+
+}
+}
+
+#define TEST_CASE(NAME) \
+	static void NAME(); \
+	static ::lux::test::Registration NAME##_registration(#NAME, &NAME); \
+	static void NAME()
+
+#define CHECK(COND) \
+	do { \
+		if(!(COND)) { \
+			std::cerr<<__FILE__<<":"<<__LINE__<<": CHECK("<<#COND<<") failed"<<std::endl; \
+			::lux::test::failed_checks()++; \
+		} \
+	} while(false)
+
+#define CHECK_EQ(A, B) \
+	do { \
+		auto&& check_a_ = (A); \
+		auto&& check_b_ = (B); \
+		if(!(check_a_==check_b_)) { \
+			std::cerr<<__FILE__<<":"<<__LINE__<<": CHECK_EQ("<<#A<<", "<<#B<<") failed: " \
+			         <<check_a_<<" != "<<check_b_<<std::endl; \
+			::lux::test::failed_checks()++; \
+		} \
+	} while(false)
+
+#define CHECK_NEAR(A, B, EPS) \
+	do { \
+		auto check_a_ = (A); \
+		auto check_b_ = (B); \
+		if(std::abs(check_a_-check_b_) > (EPS)) { \
+			std::cerr<<__FILE__<<":"<<__LINE__<<": CHECK_NEAR("<<#A<<", "<<#B<<") failed: " \
+			         <<check_a_<<" != "<<check_b_<<std::endl; \
+			::lux::test::failed_checks()++; \
+		} \
+	} while(false)
+
+#define CHECK_THROWS(EXPR, EXCEPTION) \
+	do { \
+		auto check_thrown_ = false; \
+		try { EXPR; } catch(const EXCEPTION&) { check_thrown_ = true; } \
+		if(!check_thrown_) { \
+			std::cerr<<__FILE__<<":"<<__LINE__<<": CHECK_THROWS("<<#EXPR<<", "<<#EXCEPTION \
+			         <<") failed"<<std::endl; \
+			::lux::test::failed_checks()++; \
+		} \
+	} while(false)
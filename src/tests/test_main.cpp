@@ -0,0 +1,43 @@
+#include "test.hpp"
+
+#include <core/utils/log.hpp>
+
+#include <exception>
+
+
+namespace lux {
+namespace test {
+
+	auto run_all(const std::string& filter) -> int {
+		auto failed_tests = 0;
+
+		for(auto& tc : test_cases()) {
+			if(!filter.empty() && std::string(tc.name).find(filter)==std::string::npos)
+				continue;
+
+			auto checks_before = failed_checks();
+			try {
+				tc.func();
+			} catch(const std::exception& e) {
+				std::cerr<<tc.name<<": unexpected exception: "<<e.what()<<std::endl;
+				failed_checks()++;
+			}
+
+			if(failed_checks()!=checks_before) {
+				std::cerr<<"[FAILED] "<<tc.name<<std::endl;
+				failed_tests++;
+			} else {
+				std::cout<<"[OK]     "<<tc.name<<std::endl;
+			}
+		}
+
+		return failed_tests==0 ? 0 : 1;
+	}
+
+}
+}
+
+int main(int argc, char** argv) {
+	lux::util::log_directory(LUX_TEST_OUTPUT_DIR);
+	return lux::test::run_all(argc>1 ? argv[1] : "");
+}
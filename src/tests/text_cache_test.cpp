@@ -0,0 +1,108 @@
+#include "test.hpp"
+
+#include <core/asset/asset_manager.hpp>
+#include <core/renderer/null_gl.hpp>
+#include <core/renderer/text.hpp>
+
+#include <cstring>
+#include <sstream>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	struct Fixture {
+		asset::Asset_manager assets{"text_cache_test", "text_cache_test"};
+		std::shared_ptr<Font> font;
+
+		Fixture() {
+			// a monospaced font with 8x8 glyphs for all printable ASCII chars
+			auto desc = std::stringstream{};
+			desc<<"test\n8 8\nwhite\n"<<(127-32)<<"\n";
+			for(auto c=32; c<127; c++)
+				desc<<c<<" "<<(c%16)*8<<" "<<(c/16)*8<<" 8 8 0 0 8\n";
+			desc<<"0\n";
+
+			font = std::make_shared<Font>(assets, desc);
+			text_cache().clear();
+			text_cache().budget(Text_cache::default_budget);
+		}
+		~Fixture() {
+			shutdown_font_renderer();
+			text_cache().budget(Text_cache::default_budget);
+		}
+	};
+
+	auto gl_calls(const char* name) -> std::size_t {
+		auto sum = std::size_t(0);
+		for(auto& call : null_gl_stats().calls) {
+			if(std::strcmp(call.first, name)==0)
+				sum += call.second;
+		}
+		return sum;
+	}
+}
+
+TEST_CASE(repeated_texts_are_cached) {
+	Fixture f;
+	auto a = f.font->text("Hello");
+	auto b = f.font->text("Hello");
+	auto c = f.font->text("World");
+
+	CHECK(a==b);
+	CHECK(a!=c);
+	CHECK_EQ(text_cache().size(), 2u);
+}
+
+TEST_CASE(memory_is_bounded_by_the_budget) {
+	Fixture f;
+	constexpr auto budget = std::size_t(64*1024);
+	text_cache().budget(budget);
+
+	// e.g. a score or timer that changes every frame
+	for(auto i=0; i<5000; i++) {
+		f.font->text("Score: "+std::to_string(i));
+		CHECK(text_cache().bytes()<=budget);
+	}
+
+	CHECK(text_cache().size()>0u);
+	CHECK(text_cache().size()<5000u);
+
+	// the most recent texts are still there
+	auto last = f.font->text("Score: 4999");
+	CHECK(f.font->text("Score: 4999")==last);
+}
+
+TEST_CASE(least_recently_used_texts_are_dropped) {
+	Fixture f;
+	auto hot = f.font->text("hot");
+	auto hot_bytes = text_cache().bytes();
+	text_cache().budget(hot_bytes*4);
+
+	for(auto i=0; i<100; i++) {
+		CHECK(f.font->text("hot")==hot);
+		f.font->text("cold "+std::to_string(i));
+	}
+
+	CHECK(text_cache().bytes()<=hot_bytes*4);
+	CHECK(f.font->text("hot")==hot);
+
+	// shrinking the budget evicts immediately
+	text_cache().budget(0);
+	CHECK_EQ(text_cache().size(), 0u);
+	CHECK_EQ(text_cache().bytes(), 0u);
+}
+
+TEST_CASE(shutdown_releases_cached_buffers) {
+	Fixture f;
+	for(auto i=0; i<10; i++)
+		f.font->text("text "+std::to_string(i));
+
+	CHECK_EQ(text_cache().size(), 10u);
+
+	reset_null_gl_stats();
+	shutdown_font_renderer();
+	CHECK_EQ(text_cache().size(), 0u);
+	CHECK(gl_calls("glDeleteBuffers")>=10u);
+}
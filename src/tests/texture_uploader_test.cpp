@@ -0,0 +1,142 @@
+#include "test.hpp"
+
+#include <core/renderer/null_gl.hpp>
+#include <core/renderer/texture.hpp>
+
+#include <soil/stb_image_write.h>
+
+#include <cstring>
+
+
+using namespace lux::renderer;
+
+namespace {
+	auto png(int width, int height) -> std::vector<uint8_t> {
+		auto pixels = std::vector<uint8_t>(std::size_t(width*height*4), 255);
+
+		auto file = std::vector<uint8_t>();
+		stbi_write_png_to_func([](void* ctx, void* data, int size) {
+			auto bytes = static_cast<uint8_t*>(data);
+			static_cast<std::vector<uint8_t>*>(ctx)->insert(static_cast<std::vector<uint8_t>*>(ctx)->end(),
+			                                                bytes, bytes+size);
+		}, &file, width, height, 4, pixels.data(), width*4);
+		return file;
+	}
+
+	/// DXT1 file with the complete mip chain
+	auto dds(int size) -> std::vector<uint8_t> {
+		auto file = std::vector<uint8_t>(128, 0);
+		std::memcpy(file.data(), "DDS ", 4);
+		auto levels = 0u;
+		for(auto s=size; s>=1; s/=2, levels++) {
+			auto blocks = std::size_t(std::max(1, (s+3)/4));
+			file.resize(file.size() + blocks*blocks*8, 0);
+		}
+		file[12] = file[16] = static_cast<uint8_t>(size);
+		file[28] = static_cast<uint8_t>(levels);
+		std::memcpy(file.data()+84, "DXT1", 4);
+		return file;
+	}
+
+	auto gl_calls(const char* name) -> std::size_t {
+		auto sum = std::size_t(0);
+		for(auto& call : null_gl_stats().calls) {
+			if(std::strcmp(call.first, name)==0)
+				sum += call.second;
+		}
+		return sum;
+	}
+
+	struct Fixture {
+		Fixture() {
+			texture_uploader().budget(Texture_uploader::default_budget);
+		}
+		~Fixture() {
+			texture_uploader().budget(Texture_uploader::default_budget);
+		}
+	};
+}
+
+TEST_CASE(texture_is_uploaded_by_flush) {
+	Fixture f;
+	auto before = texture_uploader().stats();
+
+	auto texture = Texture(png(4, 8), false, "test");
+	CHECK_EQ(texture.width(), 4);
+	CHECK_EQ(texture.height(), 8);
+	CHECK_EQ(texture_uploader().stats().pending, 1u);
+
+	texture_uploader().flush();
+
+	auto after = texture_uploader().stats();
+	CHECK_EQ(after.pending, 0u);
+	CHECK_EQ(after.uploaded, before.uploaded+1);
+	CHECK_EQ(after.uploaded_bytes, before.uploaded_bytes + 4*8*4);
+}
+
+TEST_CASE(update_keeps_to_the_budget) {
+	Fixture f;
+	texture_uploader().budget(1);
+	auto before = texture_uploader().stats();
+
+	auto textures = std::vector<Texture>();
+	for(auto i=0; i<3; i++)
+		textures.emplace_back(png(16, 16), false, "test");
+
+	// the first decoded image is uploaded even though it's larger than the budget
+	auto max_per_update = std::size_t(0);
+	auto last = before.uploaded;
+	while(texture_uploader().stats().pending>0) {
+		texture_uploader().update();
+		auto uploaded = texture_uploader().stats().uploaded;
+		max_per_update = std::max(max_per_update, uploaded-last);
+		last = uploaded;
+	}
+
+	CHECK_EQ(max_per_update, 1u);
+	CHECK_EQ(texture_uploader().stats().uploaded, before.uploaded+3);
+}
+
+TEST_CASE(destroyed_textures_are_not_uploaded) {
+	Fixture f;
+	auto before = texture_uploader().stats();
+
+	{
+		auto texture = Texture(png(4, 4), false, "test");
+		CHECK_EQ(texture_uploader().stats().pending, 1u);
+	}
+	CHECK_EQ(texture_uploader().stats().pending, 0u);
+
+	texture_uploader().flush();
+	CHECK_EQ(texture_uploader().stats().uploaded, before.uploaded);
+}
+
+TEST_CASE(corrupt_images_throw_on_upload) {
+	Fixture f;
+	auto before = texture_uploader().stats();
+
+	auto file = png(64, 64);
+	file.resize(file.size()/2);
+	auto texture = Texture(file, false, "test");
+	auto valid = Texture(png(4, 4), false, "test");
+
+	CHECK_THROWS(texture_uploader().flush(), Texture_loading_failed);
+	CHECK_EQ(texture_uploader().stats().failed, before.failed+1);
+
+	// the failed job is gone, the others are still uploaded
+	texture_uploader().flush();
+	CHECK_EQ(texture_uploader().stats().pending, 0u);
+	CHECK_EQ(texture_uploader().stats().uploaded, before.uploaded+1);
+}
+
+TEST_CASE(compressed_textures_upload_all_levels) {
+	Fixture f;
+	auto texture = Texture(dds(16), false, "test");
+
+	reset_null_gl_stats();
+	texture_uploader().flush();
+
+	// 16, 8, 4, 2, 1
+	CHECK_EQ(gl_calls("glCompressedTexImage2D"), 5u);
+	CHECK_EQ(gl_calls("glTexImage2D"), 0u);
+}
@@ -0,0 +1,60 @@
+#include "benchmark.hpp"
+
+#include <core/renderer/triangulation.hpp>
+
+#include <glm/glm.hpp>
+
+#include <random>
+
+
+using namespace lux;
+using namespace lux::renderer;
+using glm::vec2;
+
+namespace {
+	constexpr auto vertex_count = 10000;
+}
+
+int main() {
+	auto rand = std::mt19937{42};
+	auto radius = std::uniform_real_distribution<float>{95.f, 100.f};
+	auto vertex = std::uniform_int_distribution<std::size_t>{0, vertex_count-1};
+
+	// star shaped, so moving points along their radius keeps it simple
+	auto polygon = std::vector<vec2>();
+	for(auto i=0; i<vertex_count; i++) {
+		auto a = 6.2831853f * i / vertex_count;
+		polygon.push_back(vec2(std::cos(a), std::sin(a)) * radius(rand));
+	}
+
+	auto triangles = std::vector<uint32_t>();
+	triangulate(polygon, triangles);
+
+	auto full = 0;
+	auto move = [&](float min_scale, float max_scale) {
+		auto v = vertex(rand);
+		auto scale = std::uniform_real_distribution<float>{min_scale, max_scale}(rand);
+		polygon[v] = glm::normalize(polygon[v]) * glm::clamp(glm::length(polygon[v])*scale, 50.f, 150.f);
+
+		if(!retriangulate_after_move(polygon, triangles, v)) {
+			full++;
+			triangulate(polygon, triangles);
+		}
+		test::do_not_optimize(triangles);
+	};
+
+	test::benchmark("full triangulation", 20, [&] {
+		triangulate(polygon, triangles);
+		test::do_not_optimize(triangles);
+	});
+
+	test::benchmark("small move", 1000, [&] {
+		move(0.999f, 1.001f);
+	});
+
+	full = 0;
+	test::benchmark("large move", 1000, [&] {
+		move(0.8f, 1.2f);
+	});
+	std::cout<<"  large moves that required a full triangulation: "<<full<<"\n";
+}
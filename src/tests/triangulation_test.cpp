@@ -0,0 +1,162 @@
+#include "test.hpp"
+
+#include <core/renderer/triangulation.hpp>
+
+#include <glm/glm.hpp>
+
+#include <random>
+
+
+using namespace lux::renderer;
+using glm::vec2;
+
+namespace {
+	auto polygon_area(const std::vector<vec2>& p) {
+		auto a = 0.f;
+		for(auto i=std::size_t(0); i<p.size(); i++) {
+			auto& q = p[i];
+			auto& r = p[(i+1) % p.size()];
+			a += q.x*r.y - r.x*q.y;
+		}
+		return a / 2.f;
+	}
+
+	/// checks the properties every triangulation of a simple polygon has.
+	/// Points that are (or become) collinear while ears are clipped don't produce triangles,
+	///   so only polygons without them always have exactly n-2 triangles.
+	auto valid_triangulation(const std::vector<vec2>& p, const std::vector<uint32_t>& t,
+	                         bool all_triangles=true) -> bool {
+		if(all_triangles ? t.size()!=(p.size()-2)*3 : t.size()>(p.size()-2)*3)
+			return false;
+
+		auto area = polygon_area(p);
+		auto sum = 0.f;
+		for(auto i=std::size_t(0); i<t.size(); i+=3) {
+			if(t[i]>=p.size() || t[i+1]>=p.size() || t[i+2]>=p.size())
+				return false;
+
+			auto& a = p[t[i]];
+			auto& b = p[t[i+1]];
+			auto& c = p[t[i+2]];
+			auto tri_area = ((b.x-a.x)*(c.y-a.y) - (b.y-a.y)*(c.x-a.x)) / 2.f;
+
+			// oriented like the polygon
+			if(tri_area*area<=0.f)
+				return false;
+			sum += std::abs(tri_area);
+		}
+
+		// overlapping triangles would cover more than the polygon
+		return std::abs(sum - std::abs(area)) <= std::abs(area)*1e-4f;
+	}
+
+	/// random polygon that is star shaped around the origin
+	auto star(std::mt19937& rng, std::size_t n, bool clockwise) -> std::vector<vec2> {
+		auto radius = std::uniform_real_distribution<float>{5.f, 10.f};
+		auto p = std::vector<vec2>();
+		for(auto i=std::size_t(0); i<n; i++) {
+			auto a = (clockwise ? -1.f : 1.f) * 6.2831853f * i / n;
+			p.push_back(vec2(std::cos(a), std::sin(a)) * radius(rng));
+		}
+		return p;
+	}
+}
+
+TEST_CASE(triangulate_random_star_polygons) {
+	auto rng = std::mt19937{1};
+	auto t = std::vector<uint32_t>();
+
+	for(auto n : {3, 4, 5, 10, 100, 1000, 5000}) {
+		for(auto clockwise : {false, true}) {
+			for(auto i=0; i<4; i++) {
+				auto p = star(rng, std::size_t(n), clockwise);
+				CHECK_EQ(triangulate(p, t), 0u);
+				CHECK(valid_triangulation(p, t));
+			}
+		}
+	}
+}
+
+TEST_CASE(triangulate_concave_polygons) {
+	auto t = std::vector<uint32_t>();
+
+	auto u = std::vector<vec2>{{0,0}, {0,10}, {1,10}, {1,1}, {9,1}, {9,10}, {10,10}, {10,0}};
+	CHECK_EQ(triangulate(u, t), 0u);
+	CHECK(valid_triangulation(u, t));
+
+	// comb with 50 teeth, open towards +y
+	auto comb = std::vector<vec2>{{100,0}, {0,0}};
+	for(auto i=0; i<50; i++) {
+		comb.push_back({i*2.f,     10.f});
+		comb.push_back({i*2.f+1.f, 10.f});
+		comb.push_back({i*2.f+1.f, 1.f});
+		comb.push_back({i*2.f+2.f, 1.f});
+	}
+	comb.back() = {100.f, 10.f};
+	CHECK_EQ(triangulate(comb, t), 0u);
+	CHECK(valid_triangulation(comb, t, false));
+}
+
+TEST_CASE(triangulate_with_collinear_points) {
+	auto t = std::vector<uint32_t>();
+	auto square = std::vector<vec2>{{0,0}, {0,5}, {0,10}, {10,10}, {10,0}};
+	CHECK_EQ(triangulate(square, t), 0u);
+	CHECK(valid_triangulation(square, t, false));
+}
+
+TEST_CASE(small_moves_keep_the_triangulation) {
+	auto rng = std::mt19937{2};
+	auto p = star(rng, 1000, false);
+	auto t = std::vector<uint32_t>();
+	triangulate(p, t);
+	auto before = t;
+
+	p[5] *= 1.01f;
+	CHECK(triangulation_valid_after_move(p, t, 5));
+	CHECK(retriangulate_after_move(p, t, 5));
+	CHECK(t==before);
+}
+
+TEST_CASE(retriangulate_after_random_moves) {
+	auto rng = std::mt19937{3};
+	auto vertex = std::uniform_int_distribution<std::size_t>{0, 199};
+	auto scale = std::uniform_real_distribution<float>{0.5f, 1.5f};
+
+	auto t = std::vector<uint32_t>();
+	auto local = 0;
+	auto full = 0;
+	for(auto polygon=0; polygon<20; polygon++) {
+		auto p = star(rng, 200, polygon%2==0);
+		CHECK_EQ(triangulate(p, t), 0u);
+
+		for(auto move=0; move<50; move++) {
+			// stays star shaped, so the polygon is always simple
+			auto v = vertex(rng);
+			p[v] = glm::normalize(p[v]) * glm::clamp(glm::length(p[v])*scale(rng), 2.f, 15.f);
+
+			if(retriangulate_after_move(p, t, v)) {
+				local++;
+			} else {
+				full++;
+				CHECK_EQ(triangulate(p, t), 0u);
+			}
+
+			CHECK(valid_triangulation(p, t));
+		}
+	}
+
+	// most moves are handled locally
+	CHECK(local > full*4);
+}
+
+TEST_CASE(retriangulate_rejects_self_intersections) {
+	auto p = std::vector<vec2>{{0,0}, {10,0}, {10,10}, {5,5}, {0,10}};
+	auto t = std::vector<uint32_t>();
+	CHECK_EQ(triangulate(p, t), 0u);
+	auto before = t;
+
+	// the edges of the moved vertex cross the polygon
+	p[3] = {5,-5};
+	CHECK(!retriangulate_after_move(p, t, 3));
+	CHECK(t==before);
+}
@@ -0,0 +1,76 @@
+#include "benchmark.hpp"
+
+#include <core/renderer/command_queue.hpp>
+#include <core/renderer/uniform_map.hpp>
+
+#include <array>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	constexpr auto commands = 10000;
+
+	// the uniforms of a sprite command
+	void fill(Cmd_uniform_map& m, int i) {
+		m.emplace("alpha_cutoff", i%2 ? 0.9f : 1.f/255)
+		 .emplace("model", glm::mat4())
+		 .emplace("hue_change_in", float(i%8))
+		 .emplace("shadow_resistence", 0.5f)
+		 .emplace("color", glm::vec4(1,1,1,1))
+		 .emplace("layer", i%4);
+	}
+}
+
+/*
+ * The programs are stubs of the null OpenGL implementation, so this only
+ *   measures the CPU side: name lookup, location caches and value comparison.
+ */
+int main() {
+	auto progs = std::array<Shader_program, 2>{};
+	auto maps = std::vector<Cmd_uniform_map>(commands);
+
+	test::benchmark("emplace 6 uniforms, 10k maps", 100, [&] {
+		for(auto i=0; i<commands; i++) {
+			maps[i].clear();
+			fill(maps[i], i);
+		}
+		test::do_not_optimize(maps);
+	});
+
+	test::benchmark("emplace existing names, 10k maps", 100, [&] {
+		for(auto i=0; i<commands; i++)
+			fill(maps[i], i);
+		test::do_not_optimize(maps);
+	});
+
+	test::benchmark("bind_all, one program, 10k maps", 100, [&] {
+		for(auto& m : maps)
+			m.bind_all(progs[0]);
+	});
+
+	test::benchmark("bind_all, alternating programs, 10k maps", 100, [&] {
+		for(auto i=0u; i<maps.size(); i++)
+			maps[i].bind_all(progs[i%2]);
+	});
+
+	// without the location cache of the maps: one lookup by name per uniform
+	test::benchmark("set_uniform by name, 10k commands", 100, [&] {
+		for(auto i=0; i<commands; i++) {
+			auto& p = progs[0];
+			p.set_uniform("alpha_cutoff", i%2 ? 0.9f : 1.f/255)
+			 .set_uniform("model", glm::mat4())
+			 .set_uniform("hue_change_in", float(i%8))
+			 .set_uniform("shadow_resistence", 0.5f)
+			 .set_uniform("color", glm::vec4(1,1,1,1))
+			 .set_uniform("layer", i%4);
+		}
+	});
+
+	auto uploads_before = render_state().stats().uniform_uploads;
+	for(auto& m : maps)
+		m.bind_all(progs[0]);
+	std::cout<<"uploads for 10k maps with 6 uniforms: "
+	         <<(render_state().stats().uniform_uploads-uploads_before)<<std::endl;
+}
@@ -0,0 +1,109 @@
+#include "test.hpp"
+
+#include <core/renderer/null_gl.hpp>
+#include <core/renderer/uniform_map.hpp>
+
+#include <cstring>
+
+
+using namespace lux;
+using namespace lux::renderer;
+
+namespace {
+	auto gl_calls(const char* name) -> std::size_t {
+		auto sum = std::size_t(0);
+		for(auto& call : null_gl_stats().calls) {
+			if(std::strcmp(call.first, name)==0)
+				sum += call.second;
+		}
+		return sum;
+	}
+	auto uniform_uploads() -> std::size_t {
+		return gl_calls("glUniform1i") + gl_calls("glUniform1f") + gl_calls("glUniform2fv")
+		     + gl_calls("glUniform3fv") + gl_calls("glUniform4fv") + gl_calls("glUniformMatrix4fv");
+	}
+}
+
+TEST_CASE(unchanged_values_are_skipped) {
+	auto prog = Shader_program{};
+	auto uniforms = Uniform_map<4>{};
+	uniforms.emplace("a", 1.f).emplace("b", glm::vec2{1,2}).emplace("c", 3).emplace("d", glm::mat4());
+
+	reset_null_gl_stats();
+	uniforms.bind_all(prog);
+	CHECK_EQ(uniform_uploads(), 4u);
+
+	uniforms.bind_all(prog);
+	CHECK_EQ(uniform_uploads(), 4u);
+
+	uniforms.emplace("b", glm::vec2{1,3});
+	uniforms.bind_all(prog);
+	CHECK_EQ(uniform_uploads(), 5u);
+	CHECK_EQ(gl_calls("glUniform2fv"), 2u);
+}
+
+TEST_CASE(values_are_tracked_per_program) {
+	auto prog_a = Shader_program{};
+	auto prog_b = Shader_program{};
+
+	reset_null_gl_stats();
+	prog_a.set_uniform("v", 1.f);
+	prog_b.set_uniform("v", 1.f);
+	prog_a.set_uniform("v", 1.f);
+	prog_b.set_uniform("v", 1.f);
+	CHECK_EQ(gl_calls("glUniform1f"), 2u);
+
+	// the same value from another map is still known to the program
+	auto uniforms = Uniform_map<1>{};
+	uniforms.emplace("v", 1.f);
+	uniforms.bind_all(prog_a);
+	CHECK_EQ(gl_calls("glUniform1f"), 2u);
+}
+
+TEST_CASE(locations_are_only_queried_once) {
+	auto prog = Shader_program{};
+	auto uniforms = Uniform_map<2>{};
+	uniforms.emplace("a", 1.f);
+
+	reset_null_gl_stats();
+	for(auto i=0; i<10; i++) {
+		uniforms.emplace("a", float(i));
+		uniforms.bind_all(prog);
+	}
+	CHECK_EQ(gl_calls("glGetUniformLocation"), 1u);
+	CHECK_EQ(gl_calls("glUniform1f"), 10u);
+
+	// slots added later are resolved on the next bind
+	uniforms.emplace("b", 2);
+	uniforms.bind_all(prog);
+	CHECK_EQ(gl_calls("glGetUniformLocation"), 2u);
+	CHECK_EQ(gl_calls("glUniform1i"), 1u);
+}
+
+TEST_CASE(rebuilding_a_program_resets_its_caches) {
+	auto prog = Shader_program{};
+	prog.build();
+	auto uniforms = Uniform_map<1>{};
+	uniforms.emplace("a", 1.f);
+	uniforms.bind_all(prog);
+
+	reset_null_gl_stats();
+	prog.build();
+	uniforms.bind_all(prog);
+	CHECK_EQ(gl_calls("glGetUniformLocation"), 1u);
+	CHECK_EQ(gl_calls("glUniform1f"), 1u);
+}
+
+TEST_CASE(cleared_maps_can_be_refilled) {
+	auto prog = Shader_program{};
+	auto uniforms = Uniform_map<2>{};
+	uniforms.emplace("a", 1.f).emplace("b", 2.f);
+	uniforms.bind_all(prog);
+
+	uniforms.clear();
+	uniforms.emplace("b", 3.f);
+
+	reset_null_gl_stats();
+	uniforms.bind_all(prog);
+	CHECK_EQ(gl_calls("glUniform1f"), 1u);
+}
@@ -0,0 +1,188 @@
+/** packs textures into atlas pages, that are loaded by renderer::Texture_atlas
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#include "packer.hpp"
+
+#include <soil/SOIL2.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Usage: atlas_packer <asset_root> <sub_dir> <name> <list_file> [page_size] [padding] [bleed]
+ *
+ * Each line of the list file describes one entry, whose layers are packed
+ *   to the same position on parallel pages (e.g. albedo, normal, material
+ *   and height of a material). All layers of an entry need the same size:
+ *     <texture_name>=<image_file> [<texture_name>=<image_file> ...]
+ *
+ * Writes for every page p and layer l:
+ *   <asset_root>/<sub_dir>/<name>_<p>_<l>.png   the page
+ *   <asset_root>/<sub_dir>/<name>_<p>_<l>.json  the Texture_atlas definition
+ * and <asset_root>/assets_<name>.map, that redirects the packed textures
+ *   (tex:<texture_name>) to their atlas. Packed textures must not have
+ *   other entries in the .map files.
+ */
+
+using namespace lux::tools;
+
+namespace {
+	struct Layer {
+		std::string name;
+		std::string file;
+		Image image;
+	};
+	using Entry = std::vector<Layer>;
+
+	auto load_image(const std::string& file, Image& out) -> bool {
+		int channels = 0;
+		auto data = SOIL_load_image(file.c_str(), &out.width, &out.height, &channels, SOIL_LOAD_RGBA);
+		if(!data)
+			return false;
+
+		out.rgba.assign(data, data + out.width*out.height*4);
+		SOIL_free_image_data(data);
+		return true;
+	}
+
+	auto load_entries(const std::string& list_file, std::vector<Entry>& entries) -> bool {
+		std::ifstream in(list_file);
+		if(!in) {
+			std::cerr<<"Couldn't open "<<list_file<<std::endl;
+			return false;
+		}
+
+		std::string line;
+		while(std::getline(in, line)) {
+			if(line.empty() || line[0]=='#')
+				continue;
+
+			auto entry = Entry{};
+			std::istringstream tokens(line);
+			std::string token;
+			while(tokens>>token) {
+				auto sep = token.find('=');
+				if(sep==std::string::npos) {
+					std::cerr<<"Invalid entry '"<<token<<"', expected <name>=<file>"<<std::endl;
+					return false;
+				}
+
+				auto layer = Layer{token.substr(0, sep), token.substr(sep+1), {}};
+				if(!load_image(layer.file, layer.image)) {
+					std::cerr<<"Couldn't load "<<layer.file<<": "<<SOIL_last_result()<<std::endl;
+					return false;
+				}
+
+				if(!entry.empty() && (layer.image.width!=entry.front().image.width
+				                      || layer.image.height!=entry.front().image.height)) {
+					std::cerr<<"Layers of "<<entry.front().name<<" have different sizes"<<std::endl;
+					return false;
+				}
+
+				entry.emplace_back(std::move(layer));
+			}
+
+			if(!entry.empty())
+				entries.emplace_back(std::move(entry));
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	if(argc<5) {
+		std::cerr<<"Usage: "<<argv[0]<<" <asset_root> <sub_dir> <name> <list_file> [page_size] [padding] [bleed]"<<std::endl;
+		return 1;
+	}
+
+	auto asset_root = std::string(argv[1]);
+	auto sub_dir    = std::string(argv[2]);
+	auto name       = std::string(argv[3]);
+
+	auto settings = Pack_settings{};
+	if(argc>5) settings.page_width = settings.page_height = std::stoi(argv[5]);
+	if(argc>6) settings.padding = std::stoi(argv[6]);
+	if(argc>7) settings.bleed = std::stoi(argv[7]);
+
+	auto entries = std::vector<Entry>();
+	if(!load_entries(argv[4], entries))
+		return 1;
+
+	auto layers = std::size_t(0);
+	auto rects = std::vector<Pack_rect>();
+	rects.reserve(entries.size());
+	for(auto& e : entries) {
+		layers = std::max(layers, e.size());
+		rects.push_back(Pack_rect{e.front().image.width, e.front().image.height});
+	}
+
+	auto pages = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto packed = pack(rects, settings, &pages);
+	auto end = std::chrono::steady_clock::now();
+
+	auto used_area = 0.0;
+	for(auto i=std::size_t(0); i<packed.size(); ++i) {
+		if(packed[i].page<0) {
+			std::cerr<<entries[i].front().name<<" is larger than a page"<<std::endl;
+			return 1;
+		}
+		used_area += double(packed[i].width) * packed[i].height;
+	}
+
+	std::cout<<"Packed "<<entries.size()<<" entries into "<<pages<<" pages in "
+	         <<std::chrono::duration<double, std::milli>(end-start).count()<<" ms ("
+	         <<int(100*used_area / (double(pages)*settings.page_width*settings.page_height))
+	         <<"% used)"<<std::endl;
+
+	auto page_name = [&](int page, std::size_t layer) {
+		return name+"_"+std::to_string(page)+"_"+std::to_string(layer);
+	};
+
+	std::ofstream map(asset_root+"/assets_"+name+".map");
+
+	for(auto page=0; page<pages; ++page) {
+		for(auto layer=std::size_t(0); layer<layers; ++layer) {
+			auto image = Image{settings.page_width, settings.page_height};
+			std::ofstream def(asset_root+"/"+sub_dir+"/"+page_name(page, layer)+".json");
+			def<<"{\n\t\"texture\": \"tex:"<<page_name(page, layer)<<"\",\n\t\"frames\": [";
+
+			auto first = true;
+			for(auto i=std::size_t(0); i<entries.size(); ++i) {
+				auto& p = packed[i];
+				if(p.page!=page || layer>=entries[i].size())
+					continue;
+
+				auto& l = entries[i][layer];
+				blit(l.image, image, p.x, p.y, settings.bleed);
+
+				def<<(first ? "" : ",")<<"\n\t\t{\"name\": \""<<l.name<<"\", \"x\": "<<p.x<<", \"y\": "<<p.y
+				   <<", \"width\": "<<p.width<<", \"height\": "<<p.height<<"}";
+				first = false;
+
+				map<<"tex:"<<l.name<<" = atlas:"<<page_name(page, layer)<<"\n";
+			}
+			def<<"\n\t]\n}\n";
+
+			auto file = asset_root+"/"+sub_dir+"/"+page_name(page, layer)+".png";
+			if(!SOIL_save_image(file.c_str(), SOIL_SAVE_TYPE_PNG, image.width, image.height, 4, image.rgba.data())) {
+				std::cerr<<"Couldn't write "<<file<<": "<<SOIL_last_result()<<std::endl;
+				return 1;
+			}
+
+			map<<"tex:"<<page_name(page, layer)<<" = "<<sub_dir<<"/"<<page_name(page, layer)<<".png\n";
+			map<<"atlas:"<<page_name(page, layer)<<" = "<<sub_dir<<"/"<<page_name(page, layer)<<".json\n";
+		}
+	}
+
+	return 0;
+}
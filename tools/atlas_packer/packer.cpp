@@ -0,0 +1,189 @@
+#include "packer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+
+namespace lux {
+namespace tools {
+
+	Max_rects_page::Max_rects_page(int width, int height) {
+		_free.push_back(Rect{0, 0, width, height});
+	}
+
+	auto Max_rects_page::insert(int width, int height, int& x, int& y) -> bool {
+		auto best = _free.end();
+		auto best_short = std::numeric_limits<int>::max();
+		auto best_long  = std::numeric_limits<int>::max();
+
+		for(auto iter=_free.begin(); iter!=_free.end(); ++iter) {
+			if(iter->width<width || iter->height<height)
+				continue;
+
+			auto leftover_x = iter->width - width;
+			auto leftover_y = iter->height - height;
+			auto short_side = std::min(leftover_x, leftover_y);
+			auto long_side  = std::max(leftover_x, leftover_y);
+
+			if(short_side<best_short || (short_side==best_short && long_side<best_long)) {
+				best = iter;
+				best_short = short_side;
+				best_long = long_side;
+			}
+		}
+
+		if(best==_free.end())
+			return false;
+
+		x = best->x;
+		y = best->y;
+		_prune(_split(Rect{x, y, width, height}));
+		_used_area += int64_t(width)*height;
+		return true;
+	}
+
+	auto Max_rects_page::_split(const Rect& used) -> std::size_t {
+		auto new_free = std::vector<Rect>();
+
+		for(auto iter=_free.begin(); iter!=_free.end();) {
+			auto& f = *iter;
+			auto intersects = used.x < f.x+f.width  && used.x+used.width  > f.x
+			               && used.y < f.y+f.height && used.y+used.height > f.y;
+			if(!intersects) {
+				++iter;
+				continue;
+			}
+
+			// up to four maximal rects around the used area
+			if(used.x > f.x)
+				new_free.push_back(Rect{f.x, f.y, used.x-f.x, f.height});
+			if(used.x+used.width < f.x+f.width)
+				new_free.push_back(Rect{used.x+used.width, f.y, f.x+f.width-used.x-used.width, f.height});
+			if(used.y > f.y)
+				new_free.push_back(Rect{f.x, f.y, f.width, used.y-f.y});
+			if(used.y+used.height < f.y+f.height)
+				new_free.push_back(Rect{f.x, used.y+used.height, f.width, f.y+f.height-used.y-used.height});
+
+			iter = _free.erase(iter);
+		}
+
+		auto first_new = _free.size();
+		_free.insert(_free.end(), new_free.begin(), new_free.end());
+		return first_new;
+	}
+
+	void Max_rects_page::_prune(std::size_t first_new) {
+		auto contains = [](const Rect& outer, const Rect& inner) {
+			return inner.x>=outer.x && inner.y>=outer.y
+			    && inner.x+inner.width <= outer.x+outer.width
+			    && inner.y+inner.height <= outer.y+outer.height;
+		};
+
+		// the old rects were already maximal, so only pairs with a new one have to be checked
+		auto removed = std::vector<bool>(_free.size(), false);
+		for(auto i=first_new; i<_free.size(); ++i) {
+			for(auto j=std::size_t(0); j<_free.size(); ++j) {
+				if(i==j || removed[j])
+					continue;
+
+				if(contains(_free[j], _free[i])) {
+					removed[i] = true;
+					break;
+				}
+				if(contains(_free[i], _free[j])) {
+					removed[j] = true;
+				}
+			}
+		}
+
+		auto out = std::size_t(0);
+		for(auto i=std::size_t(0); i<_free.size(); ++i) {
+			if(!removed[i])
+				_free[out++] = _free[i];
+		}
+		_free.resize(out);
+	}
+
+
+	auto pack(const std::vector<Pack_rect>& rects, const Pack_settings& settings,
+	          int* page_count) -> std::vector<Packed_rect> {
+		auto result = std::vector<Packed_rect>(rects.size());
+
+		// largest first; the index as the last key keeps the order of equal rects stable
+		auto order = std::vector<std::size_t>(rects.size());
+		std::iota(order.begin(), order.end(), std::size_t(0));
+		std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+			auto& l = rects[lhs];
+			auto& r = rects[rhs];
+			return std::make_tuple(-std::max(l.width, l.height), -std::min(l.width, l.height), lhs)
+			     < std::make_tuple(-std::max(r.width, r.height), -std::min(r.width, r.height), rhs);
+		});
+
+		// the padding after the last image of a row/column is not needed
+		auto bin_width  = settings.page_width + settings.padding;
+		auto bin_height = settings.page_height + settings.padding;
+		auto pages = std::vector<Max_rects_page>();
+
+		for(auto i : order) {
+			auto& r = rects[i];
+			auto& out = result[i];
+			out.width = r.width;
+			out.height = r.height;
+
+			auto width  = r.width  + 2*settings.bleed + settings.padding;
+			auto height = r.height + 2*settings.bleed + settings.padding;
+			if(width>bin_width || height>bin_height)
+				continue;
+
+			auto x = 0;
+			auto y = 0;
+			auto placed = false;
+			for(auto p=std::size_t(0); p<pages.size() && !placed; ++p) {
+				if(pages[p].insert(width, height, x, y)) {
+					out.page = static_cast<int>(p);
+					placed = true;
+				}
+			}
+
+			if(!placed) {
+				pages.emplace_back(bin_width, bin_height);
+				pages.back().insert(width, height, x, y);
+				out.page = static_cast<int>(pages.size()-1);
+			}
+
+			out.x = x + settings.bleed;
+			out.y = y + settings.bleed;
+		}
+
+		if(page_count)
+			*page_count = static_cast<int>(pages.size());
+
+		return result;
+	}
+
+
+	void blit(const Image& src, Image& dst, int x, int y, int bleed) {
+		for(auto dy=-bleed; dy<src.height+bleed; ++dy) {
+			auto ty = y + dy;
+			if(ty<0 || ty>=dst.height)
+				continue;
+
+			auto sy = std::max(0, std::min(src.height-1, dy));
+
+			for(auto dx=-bleed; dx<src.width+bleed; ++dx) {
+				auto tx = x + dx;
+				if(tx<0 || tx>=dst.width)
+					continue;
+
+				auto sx = std::max(0, std::min(src.width-1, dx));
+
+				auto s = src.rgba.begin() + (sy*src.width + sx)*4;
+				std::copy(s, s+4, dst.rgba.begin() + (ty*dst.width + tx)*4);
+			}
+		}
+	}
+
+}
+}
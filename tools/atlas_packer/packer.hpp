@@ -0,0 +1,88 @@
+/** packs images into texture atlas pages (MaxRects) *************************
+ *                                                                           *
+ * Copyright (c) 2016 Florian Oetke                                          *
+ *  This file is distributed under the MIT License                           *
+ *  See LICENSE file for details.                                            *
+\*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+
+namespace lux {
+namespace tools {
+
+	struct Pack_settings {
+		int page_width  = 2048;
+		int page_height = 2048;
+		int padding = 2; //< empty pixels between two images
+		int bleed = 1;   //< border pixels repeated around each image (against filtering artifacts)
+	};
+
+	struct Pack_rect {
+		int width = 0;
+		int height = 0;
+	};
+
+	/// position of the image (without bleed); page is -1 if the image is larger than a page
+	struct Packed_rect {
+		int page = -1;
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	/*
+	 * Single page of the MaxRects algorithm (best short side fit):
+	 *   keeps all maximal free rectangles and places new ones into the free
+	 *   rectangle that leaves the smallest leftover on its shorter side.
+	 */
+	class Max_rects_page {
+		public:
+			Max_rects_page(int width, int height);
+
+			/// returns false if there is no space left for the rect
+			auto insert(int width, int height, int& x, int& y) -> bool;
+
+			auto used_area()const noexcept {return _used_area;}
+
+		private:
+			struct Rect {
+				int x, y, width, height;
+			};
+
+			std::vector<Rect> _free;
+			int64_t _used_area = 0;
+
+			/// returns the index of the first new free rect
+			auto _split(const Rect& used) -> std::size_t;
+			void _prune(std::size_t first_new);
+	};
+
+	/*
+	 * Packs all rects into as few pages as necessary.
+	 * The result is index aligned with 'rects' and only depends on the input,
+	 *   i.e. packing the same images again results in the same atlas.
+	 */
+	extern auto pack(const std::vector<Pack_rect>& rects, const Pack_settings&,
+	                 int* page_count=nullptr) -> std::vector<Packed_rect>;
+
+
+	struct Image {
+		int width = 0;
+		int height = 0;
+		std::vector<uint8_t> rgba;
+
+		Image() = default;
+		Image(int width, int height)
+		    : width(width), height(height), rgba(std::size_t(width*height*4), 0) {}
+	};
+
+	/// copies 'src' to (x,y) of 'dst' and repeats its border 'bleed' times around it
+	extern void blit(const Image& src, Image& dst, int x, int y, int bleed);
+
+}
+}
@@ -0,0 +1,37 @@
+#include "packer.hpp"
+
+#include <benchmark.hpp>
+
+#include <random>
+
+
+using namespace lux;
+using namespace lux::tools;
+
+int main() {
+	auto rng = std::mt19937{42};
+
+	auto sprites = std::vector<Pack_rect>(2000);
+	auto size = std::uniform_int_distribution<int>{8, 128};
+	for(auto& r : sprites) {
+		r.width = size(rng);
+		r.height = size(rng);
+	}
+
+	auto tiles = std::vector<Pack_rect>(4000, Pack_rect{32, 32});
+
+	auto settings = Pack_settings{};
+	auto page_count = 0;
+
+	test::benchmark("2000 random sprites", 5, [&] {
+		auto r = pack(sprites, settings, &page_count);
+		test::do_not_optimize(r);
+	});
+	std::cout<<"  pages: "<<page_count<<"\n";
+
+	test::benchmark("4000 equal tiles", 5, [&] {
+		auto r = pack(tiles, settings, &page_count);
+		test::do_not_optimize(r);
+	});
+	std::cout<<"  pages: "<<page_count<<"\n";
+}
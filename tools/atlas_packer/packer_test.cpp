@@ -0,0 +1,157 @@
+#include "packer.hpp"
+
+#include <test.hpp>
+
+#include <random>
+
+
+using namespace lux::tools;
+
+namespace {
+	auto random_rects(unsigned seed, std::size_t count, int max_size) {
+		auto rng = std::mt19937{seed};
+		auto size = std::uniform_int_distribution<int>{1, max_size};
+		auto rects = std::vector<Pack_rect>(count);
+		for(auto& r : rects) {
+			r.width = size(rng);
+			r.height = size(rng);
+		}
+		return rects;
+	}
+
+	auto overlap(const Packed_rect& a, const Packed_rect& b, int margin) {
+		return a.page==b.page
+		    && a.x-margin < b.x+b.width  && b.x-margin < a.x+a.width
+		    && a.y-margin < b.y+b.height && b.y-margin < a.y+a.height;
+	}
+
+	auto equal(const Packed_rect& a, const Packed_rect& b) {
+		return a.page==b.page && a.x==b.x && a.y==b.y && a.width==b.width && a.height==b.height;
+	}
+}
+
+TEST_CASE(max_rects_page_fills_exactly) {
+	auto page = Max_rects_page(64, 64);
+	auto x = 0;
+	auto y = 0;
+
+	for(auto i=0; i<16; i++) {
+		CHECK(page.insert(16, 16, x, y));
+		CHECK_EQ(x%16, 0);
+		CHECK_EQ(y%16, 0);
+	}
+	CHECK_EQ(page.used_area(), 64*64);
+	CHECK(!page.insert(1, 1, x, y));
+}
+
+TEST_CASE(pack_known_layout) {
+	auto settings = Pack_settings{};
+	auto page_count = 0;
+	auto r = pack({{100,50}, {50,50}, {30,80}}, settings, &page_count);
+
+	CHECK_EQ(page_count, 1);
+
+	// largest side first: 100x50 at the origin, 30x80 right next to it
+	CHECK(equal(r[0], Packed_rect{0, 1, 1, 100, 50}));
+	CHECK(equal(r[2], Packed_rect{0, 105, 1, 30, 80}));
+	CHECK_EQ(r[1].page, 0);
+	CHECK_EQ(r[1].width, 50);
+	CHECK_EQ(r[1].height, 50);
+}
+
+TEST_CASE(pack_is_deterministic) {
+	auto settings = Pack_settings{};
+	settings.page_width = 512;
+	settings.page_height = 512;
+
+	auto rects = random_rects(1, 500, 64);
+	auto a = pack(rects, settings);
+	auto b = pack(rects, settings);
+
+	CHECK_EQ(a.size(), rects.size());
+	auto same = true;
+	for(auto i=std::size_t(0); i<a.size(); i++) {
+		same &= equal(a[i], b[i]);
+	}
+	CHECK(same);
+}
+
+TEST_CASE(pack_keeps_padding_and_bleed) {
+	auto settings = Pack_settings{};
+	settings.page_width = 256;
+	settings.page_height = 256;
+	settings.padding = 3;
+	settings.bleed = 2;
+
+	auto rects = random_rects(2, 300, 40);
+	auto page_count = 0;
+	auto r = pack(rects, settings, &page_count);
+	CHECK(page_count>1);
+
+	auto margin = settings.padding + 2*settings.bleed;
+	auto inside = true;
+	auto overlapping = 0;
+	for(auto i=std::size_t(0); i<r.size(); i++) {
+		inside &= r[i].page>=0 && r[i].page<page_count
+		       && r[i].x-settings.bleed>=0 && r[i].y-settings.bleed>=0
+		       && r[i].x+r[i].width+settings.bleed<=settings.page_width
+		       && r[i].y+r[i].height+settings.bleed<=settings.page_height;
+
+		for(auto j=i+1; j<r.size(); j++) {
+			if(overlap(r[i], r[j], margin))
+				overlapping++;
+		}
+	}
+	CHECK(inside);
+	CHECK_EQ(overlapping, 0);
+}
+
+TEST_CASE(pack_uses_new_pages_only_when_full) {
+	auto settings = Pack_settings{};
+	settings.padding = 0;
+	settings.bleed = 0;
+
+	auto page_count = 0;
+	pack(std::vector<Pack_rect>(4, Pack_rect{1024, 1024}), settings, &page_count);
+	CHECK_EQ(page_count, 1);
+
+	auto r = pack(std::vector<Pack_rect>(5, Pack_rect{1024, 1024}), settings, &page_count);
+	CHECK_EQ(page_count, 2);
+	CHECK_EQ(r[4].page, 1);
+}
+
+TEST_CASE(pack_skips_oversized_rects) {
+	auto settings = Pack_settings{};
+	auto page_count = 0;
+	auto r = pack({{4000, 10}, {10, 10}}, settings, &page_count);
+
+	CHECK_EQ(r[0].page, -1);
+	CHECK_EQ(r[1].page, 0);
+	CHECK_EQ(page_count, 1);
+}
+
+TEST_CASE(blit_repeats_the_border) {
+	auto src = Image(2, 2);
+	for(auto i=0; i<4; i++) {
+		src.rgba[std::size_t(i*4)] = uint8_t(i+1);
+	}
+
+	auto dst = Image(6, 6);
+	blit(src, dst, 2, 2, 1);
+
+	auto red = [&](int x, int y) {return int(dst.rgba[std::size_t((y*dst.width + x)*4)]);};
+	CHECK_EQ(red(2,2), 1);
+	CHECK_EQ(red(3,2), 2);
+	CHECK_EQ(red(2,3), 3);
+	CHECK_EQ(red(3,3), 4);
+
+	// bleed
+	CHECK_EQ(red(1,1), 1);
+	CHECK_EQ(red(4,1), 2);
+	CHECK_EQ(red(1,4), 3);
+	CHECK_EQ(red(4,4), 4);
+
+	// untouched
+	CHECK_EQ(red(0,0), 0);
+	CHECK_EQ(red(5,5), 0);
+}